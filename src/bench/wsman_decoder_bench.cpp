@@ -0,0 +1,359 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+// Benchmark of the WS-Management response decoders.
+//
+//     wsman_decoder_bench [ITERATIONS] FILE...
+//
+// Each FILE is a SOAP response of openwsman. Payloads are extracted the way
+// WSMANClient does it: children of wsen:Items of Enumerate and Pull
+// responses, the first child of the body otherwise. Each payload is decoded
+// ITERATIONS times and throughput and heap allocations per decoded item are
+// reported. Kind of a payload is recognized by its root element: Item,
+// EndpointReference, XmlFragment, method_OUTPUT; anything else is read as
+// an instance.
+
+#include <config.h>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <vector>
+#include <boost/python/object.hpp>
+#include <Pegasus/Common/CIMInstance.h>
+#include <Pegasus/Common/CIMMethod.h>
+#include <Pegasus/Common/CIMName.h>
+#include <Pegasus/Common/CIMObjectPath.h>
+#include <Pegasus/Common/CIMParamValue.h>
+#include <Pegasus/Common/CIMValue.h>
+#include <Pegasus/Common/Exception.h>
+#include <openwsman/wsman-names.h>
+#include <openwsman/wsman-xml-api.h>
+#include "lmiwbem_client_wsman_builder.h"
+#include "lmiwbem_client_wsman_xml.h"
+#include "lmiwbem_exception.h"
+#include "util/lmiwbem_string.h"
+#include "util/lmiwbem_util.h"
+
+namespace bp = boost::python;
+
+// Python exception types are created by the module initialization in
+// lmiwbem.cpp, which is not part of the benchmark; exceptions are never
+// translated to Python here.
+bp::object CIMErrorExc;
+bp::object ConnectionErrorExc;
+bp::object SLPErrorExc;
+bp::object WsmanErrorExc;
+
+namespace {
+
+size_t s_alloc_count = 0;
+size_t s_alloc_bytes = 0;
+
+void *counted_alloc(std::size_t size)
+{
+    ++s_alloc_count;
+    s_alloc_bytes += size;
+
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+} // unnamed namespace
+
+// Counting replacements of the global allocation functions; they exist only
+// in this binary.
+void *operator new(std::size_t size)
+{
+    return counted_alloc(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return counted_alloc(size);
+}
+
+void operator delete(void *ptr) throw()
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr) throw()
+{
+    free(ptr);
+}
+
+namespace {
+
+const char *HOSTNAME = "hostname";
+const char *NAMESPACE = "root/cimv2";
+
+struct Payload
+{
+    enum Kind {
+        KIND_ITEM,
+        KIND_INSTANCE,
+        KIND_FRAGMENT,
+        KIND_INSTANCE_NAME,
+        KIND_METHOD_RETURN
+    };
+
+    Kind kind;
+    String method_name;
+    std::string xml;
+};
+
+struct Fixture
+{
+    String name;
+    size_t bytes;
+    std::vector<Payload> payloads;
+};
+
+std::string read_file(const String &filename)
+{
+    std::ifstream fin(filename.c_str());
+    if (!fin)
+        throw WsmanException("Can't open " + filename);
+
+    std::stringstream ss;
+    ss << fin.rdbuf();
+    return ss.str();
+}
+
+std::string dump_node(WsXmlNodeH node)
+{
+    char *buf = NULL;
+    int size = 0;
+    ws_xml_dump_memory_node_tree(node, &buf, &size);
+    if (!buf)
+        return std::string();
+
+    std::string result(buf, size);
+    ws_xml_free_memory(buf);
+    return result;
+}
+
+Payload make_payload(const std::string &xml)
+{
+    XMLReader reader(xml);
+    XMLReader::Token token;
+    while ((token = reader.next()) == XMLReader::TOKEN_TEXT)
+        ;
+    if (token != XMLReader::TOKEN_START)
+        throw WsmanException("Payload without root element");
+
+    static const String output_suffix("_OUTPUT");
+    const String root(reader.name());
+
+    Payload payload;
+    payload.xml = xml;
+    if (root == "Item") {
+        payload.kind = Payload::KIND_ITEM;
+    } else if (root == "EndpointReference") {
+        payload.kind = Payload::KIND_INSTANCE_NAME;
+    } else if (root == "XmlFragment") {
+        payload.kind = Payload::KIND_FRAGMENT;
+    } else if (root.size() > output_suffix.size() &&
+        root.compare(
+            root.size() - output_suffix.size(),
+            output_suffix.size(),
+            output_suffix) == 0)
+    {
+        payload.kind = Payload::KIND_METHOD_RETURN;
+        payload.method_name = root.substr(
+            0, root.size() - output_suffix.size());
+    } else {
+        payload.kind = Payload::KIND_INSTANCE;
+    }
+
+    return payload;
+}
+
+WsXmlNodeH find_items(WsXmlNodeH body)
+{
+    WsXmlNodeH response = ws_xml_get_child(
+        body, 0, XML_NS_ENUMERATION, WSENUM_PULL_RESP);
+    if (!response) {
+        response = ws_xml_get_child(
+            body, 0, XML_NS_ENUMERATION, WSENUM_ENUMERATE_RESP);
+    }
+    if (!response)
+        return NULL;
+
+    WsXmlNodeH items = ws_xml_get_child(
+        response, 0, XML_NS_ENUMERATION, WSENUM_ITEMS);
+    if (!items)
+        items = ws_xml_get_child(response, 0, XML_NS_WS_MAN, WSENUM_ITEMS);
+    return items;
+}
+
+Fixture load_fixture(const String &filename)
+{
+    const std::string data(read_file(filename));
+    WsXmlDocH doc = ws_xml_read_memory(data.c_str(), data.size(), "UTF-8", 0);
+    if (!doc)
+        throw WsmanException("Can't parse " + filename);
+
+    std::vector<std::string> xmls;
+    WsXmlNodeH body = ws_xml_get_soap_body(doc);
+    WsXmlNodeH items = body ? find_items(body) : NULL;
+    if (items) {
+        const int cnt = ws_xml_get_child_count(items);
+        for (int i = 0; i < cnt; ++i)
+            xmls.push_back(dump_node(ws_xml_get_child(items, i, NULL, NULL)));
+    } else if (body) {
+        WsXmlNodeH node = ws_xml_get_child(body, 0, NULL, NULL);
+        if (node)
+            xmls.push_back(dump_node(node));
+    }
+    ws_xml_destroy_doc(doc);
+
+    if (xmls.empty())
+        throw WsmanException("No payload in " + filename);
+
+    Fixture fixture;
+    fixture.name = filename.substr(filename.rfind('/') + 1);
+    fixture.bytes = 0;
+    for (size_t i = 0; i < xmls.size(); ++i) {
+        fixture.payloads.push_back(make_payload(xmls[i]));
+        fixture.bytes += xmls[i].size();
+    }
+
+    return fixture;
+}
+
+void decode(const Payload &payload)
+{
+    switch (payload.kind) {
+    case Payload::KIND_ITEM:
+        ObjectFactory::makeCIMInstanceWithPath(
+            payload.xml, HOSTNAME, NAMESPACE);
+        break;
+    case Payload::KIND_INSTANCE:
+        ObjectFactory::makeCIMInstance(payload.xml);
+        break;
+    case Payload::KIND_FRAGMENT:
+        ObjectFactory::makeCIMInstanceFromFragment(
+            payload.xml, Pegasus::CIMName("CIM_ManagedElement"));
+        break;
+    case Payload::KIND_INSTANCE_NAME:
+        ObjectFactory::makeCIMInstanceName(
+            payload.xml, HOSTNAME, NAMESPACE);
+        break;
+    case Payload::KIND_METHOD_RETURN: {
+        Pegasus::Array<Pegasus::CIMParamValue> out_parameters;
+        ObjectFactory::makeMethodReturnValue(
+            payload.xml,
+            payload.method_name,
+            HOSTNAME,
+            NAMESPACE,
+            Pegasus::CIMConstMethod(),
+            out_parameters);
+        break;
+    }
+    }
+}
+
+void decode(const Fixture &fixture)
+{
+    for (size_t i = 0; i < fixture.payloads.size(); ++i)
+        decode(fixture.payloads[i]);
+}
+
+void bench(const Fixture &fixture, unsigned long iterations)
+{
+    // Warm up caches and Pegasus' static data.
+    decode(fixture);
+
+    const size_t alloc_count = s_alloc_count;
+    const size_t alloc_bytes = s_alloc_bytes;
+    const double start = monotonic_now();
+    for (unsigned long i = 0; i < iterations; ++i)
+        decode(fixture);
+    const double elapsed = monotonic_now() - start;
+
+    const double items =
+        static_cast<double>(iterations) * fixture.payloads.size();
+    const double bytes = static_cast<double>(iterations) * fixture.bytes;
+    std::cout << std::left << std::setw(32) << fixture.name.c_str()
+              << std::right << std::fixed
+              << std::setw(6) << fixture.payloads.size()
+              << std::setw(8) << fixture.bytes
+              << std::setprecision(0)
+              << std::setw(12) << items / elapsed
+              << std::setprecision(2)
+              << std::setw(10) << bytes / elapsed / 1e6
+              << std::setprecision(1)
+              << std::setw(10) << (s_alloc_count - alloc_count) / items
+              << std::setprecision(0)
+              << std::setw(12) << (s_alloc_bytes - alloc_bytes) / items
+              << std::endl;
+}
+
+} // unnamed namespace
+
+int main(int argc, char **argv)
+{
+    int arg = 1;
+    unsigned long iterations = 10000;
+    if (arg < argc && isdigit(*argv[arg]))
+        iterations = strtoul(argv[arg++], NULL, 10);
+    if (!iterations)
+        iterations = 1;
+
+    if (arg >= argc) {
+        std::cerr << "Usage: " << argv[0] << " [ITERATIONS] FILE..."
+                  << std::endl;
+        return 1;
+    }
+
+    try {
+        std::vector<Fixture> fixtures;
+        for (; arg < argc; ++arg)
+            fixtures.push_back(load_fixture(argv[arg]));
+
+        std::cout << std::left << std::setw(32) << "fixture"
+                  << std::right
+                  << std::setw(6) << "items"
+                  << std::setw(8) << "bytes"
+                  << std::setw(12) << "items/s"
+                  << std::setw(10) << "MB/s"
+                  << std::setw(10) << "allocs"
+                  << std::setw(12) << "alloc bytes"
+                  << std::endl;
+        for (size_t i = 0; i < fixtures.size(); ++i)
+            bench(fixtures[i], iterations);
+    } catch (const WsmanException &e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    } catch (const Pegasus::Exception &e) {
+        std::cerr << e.getMessage() << std::endl;
+        return 2;
+    }
+
+    return 0;
+}
@@ -27,8 +27,13 @@
 #include <boost/python/object.hpp>
 #include <boost/python/scope.hpp>
 #include "lmiwbem_exception.h"
+#include "obj/lmiwbem_association_cache.h"
+#include "obj/lmiwbem_class_cache.h"
+#include "obj/lmiwbem_class_hierarchy.h"
 #include "obj/lmiwbem_config.h"
 #include "obj/lmiwbem_connection.h"
+#include "obj/lmiwbem_instance_cache.h"
+#include "obj/lmiwbem_negative_cache.h"
 #ifdef HAVE_PEGASUS_LISTENER
 #  include "obj/lmiwbem_listener.h"
 #endif // HAVE_PEGASUS_LISTENER
@@ -36,6 +41,7 @@
 #  include "obj/lmiwbem_slp.h"
 #endif // HAVE_SLP
 #include "obj/lmiwbem_nocasedict.h"
+#include "obj/lmiwbem_snapshot.h"
 #include "obj/cim/lmiwbem_class.h"
 #include "obj/cim/lmiwbem_class_name.h"
 #include "obj/cim/lmiwbem_constants.h"
@@ -102,12 +108,26 @@ BOOST_PYTHON_MODULE(lmiwbem_core) {
         ":param string ns: namespace where to look for :py:class:`.CIMClass`-es\n"
         ":param string superclass: super class name\n"
         ":param subclass: either string containing sub class name of\n"
-        "\t:py:class:`.CIMClass` instance");
+        "\t:py:class:`.CIMClass` instance\n\n"
+        "If the connection has :py:attr:`.WBEMConnection.class_hierarchy` set\n"
+        "for the namespace, the answer comes from the local index.");
     def("is_error",
         is_error,
         "Checks, if the input value equals to a CIM or connection error code.\n\n"
         ":param int value: integer to check\n"
         ":returns: True, if value equals to a error code; False otherwise");
+    def("resolve_hosts",
+        resolve_hosts,
+        (bp::arg("hosts"),
+         bp::arg("workers") = 8),
+        "Resolves host names concurrently and stores the addresses in the\n"
+        "process-wide cache used by :py:meth:`.WBEMConnection.connect`. The\n"
+        "cache entries expire after ``lmiwbem.config.DNS_CACHE_TTL`` seconds;\n"
+        "at most ``lmiwbem.config.DNS_CACHE_MAX_SIZE`` hosts are kept.\n\n"
+        ":param list hosts: host names or URLs\n"
+        ":param int workers: maximum number of concurrent resolutions\n"
+        ":returns: dictionary mapping the hosts to their first numeric address;\n"
+        "\tNone for the hosts, which can't be resolved");
 
     // Initialize Python classes
     MinutesFromUTC::init_type();
@@ -133,6 +153,14 @@ BOOST_PYTHON_MODULE(lmiwbem_core) {
     NocaseDictValueIterator::init_type();
     NocaseDictItemIterator::init_type();
     ConfigProxy::init_type();
+    SnapshotWriter::init_type();
+    SnapshotReader::init_type();
+    SnapshotDiff::init_type();
+    ClassCache::init_type();
+    ClassHierarchy::init_type();
+    InstanceCache::init_type();
+    AssociationCache::init_type();
+    NegativeCache::init_type();
     CIMInstance::init_type();
     CIMInstanceName::init_type();
     CIMMethod::init_type();
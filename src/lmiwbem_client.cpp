@@ -21,16 +21,36 @@
 
 #include "lmiwbem_client.h"
 
+namespace {
+
+__thread CIMClient *s_current_client = NULL;
+
+} // unnamed namespace
+
+CIMClient::ScopedCurrentClient::ScopedCurrentClient(CIMClient *client)
+    : m_previous(s_current_client)
+{
+    s_current_client = client;
+}
+
+CIMClient::ScopedCurrentClient::~ScopedCurrentClient()
+{
+    s_current_client = m_previous;
+}
+
 CIMClient::ScopedCIMClientTransaction::ScopedCIMClientTransaction(
     CIMClient *client)
     : m_client(client)
+    , m_current(client)
 {
-    m_client->m_mutex.lock();
+    if (!m_client->isThreadSafe())
+        m_client->m_mutex.lock();
 }
 
 CIMClient::ScopedCIMClientTransaction::~ScopedCIMClientTransaction()
 {
-    m_client->m_mutex.unlock();
+    if (!m_client->isThreadSafe())
+        m_client->m_mutex.unlock();
 }
 
 CIMClient::CIMClient()
@@ -49,6 +69,16 @@ bool CIMClient::isConnected() const
     return m_is_connected;
 }
 
+bool CIMClient::isThreadSafe() const
+{
+    return false;
+}
+
+CIMClient *CIMClient::currentClient()
+{
+    return s_current_client;
+}
+
 void CIMClient::setVerifyCertificate(bool verify)
 {
     m_verify_cert = verify;
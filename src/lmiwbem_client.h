@@ -31,6 +31,7 @@
 #  include <Pegasus/Common/CIMObjectPath.h>
 #  include <Pegasus/Common/CIMParamValue.h>
 #  ifdef HAVE_PEGASUS_ENUMERATION_CONTEXT
+#    include <boost/shared_ptr.hpp>
 #    include <Pegasus/Client/CIMEnumerationContext.h>
 #    include <Pegasus/Common/UintArgs.h>
 #  endif // HAVE_PEGASUS_ENUMERATION_CONTEXT
@@ -38,16 +39,49 @@
 #  include "lmiwbem_urlinfo.h"
 #  include "util/lmiwbem_string.h"
 
+#  ifdef HAVE_PEGASUS_ENUMERATION_CONTEXT
+// Pegasus' enumeration context, which can also carry the state of clients
+// not implemented by Pegasus. The state is destroyed with the context.
+class EnumerationContext: public Pegasus::CIMEnumerationContext
+{
+public:
+    class State
+    {
+    public:
+        virtual ~State() { }
+    };
+
+    boost::shared_ptr<State> getState() const { return m_state; }
+    void setState(const boost::shared_ptr<State> &state) { m_state = state; }
+    void resetState() { m_state.reset(); }
+
+private:
+    boost::shared_ptr<State> m_state;
+};
+#  endif // HAVE_PEGASUS_ENUMERATION_CONTEXT
+
 // Base class for CIMXML and WSMAN clients.
 class CIMClient
 {
 public:
-    // Every CIMClient operation needs to have a guard.
+    // Every CIMClient operation needs to have a guard. Operations of clients,
+    // which are not thread-safe, are serialized by it.
     //
     // Example:
     //     CIMClient client;
     //     CIMClient::ScopedCIMClientTransaction sc(client);
     //     ... further CIM operations ...
+    // Makes the client current in the calling thread for the guard's
+    // lifetime; see currentClient().
+    class ScopedCurrentClient
+    {
+    public:
+        ScopedCurrentClient(CIMClient *client);
+        ~ScopedCurrentClient();
+    private:
+        CIMClient *m_previous;
+    };
+
     class ScopedCIMClientTransaction
     {
     public:
@@ -55,10 +89,16 @@ public:
         ~ScopedCIMClientTransaction();
     private:
         CIMClient *m_client;
+        ScopedCurrentClient m_current;
     };
 
     friend class ScopedCIMClientTransaction;
 
+    // Client, whose transaction is in progress in the calling thread; NULL
+    // outside of transactions. Used by callbacks, which are not given the
+    // client, e.g. certificate verification.
+    static CIMClient *currentClient();
+
 public:
     CIMClient();
     virtual ~CIMClient() = 0;
@@ -77,6 +117,9 @@ public:
     virtual void disconnect() = 0;
     virtual bool isConnected() const;
 
+    // Thread-safe clients synchronize concurrent operations themselves.
+    virtual bool isThreadSafe() const;
+
     void setVerifyCertificate(bool verify = true);
     void setUrlInfo(const URLInfo &url_info);
     bool setUrl(const String &url);
@@ -192,7 +235,7 @@ public:
 #  ifdef HAVE_PEGASUS_ENUMERATION_CONTEXT
     // Pull operations
     virtual Pegasus::Array<Pegasus::CIMInstance> openEnumerateInstances(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::CIMName &className,
@@ -205,7 +248,7 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0) = 0;
     virtual Pegasus::Array<Pegasus::CIMObjectPath> openEnumerateInstancePaths(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::CIMName &className,
@@ -215,7 +258,7 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0) = 0;
     virtual Pegasus::Array<Pegasus::CIMInstance> openReferenceInstances(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::CIMObjectPath &objectName,
@@ -229,7 +272,7 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0) = 0;
     virtual Pegasus::Array<Pegasus::CIMObjectPath> openReferenceInstancePaths(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::CIMObjectPath &objectName,
@@ -241,7 +284,7 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0) = 0;
     virtual Pegasus::Array<Pegasus::CIMInstance> openAssociatorInstances(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::CIMObjectPath &objectName,
@@ -257,7 +300,7 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0) = 0;
     virtual Pegasus::Array<Pegasus::CIMObjectPath> openAssociatorInstancePaths(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::CIMObjectPath &objectName,
@@ -271,7 +314,7 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0) = 0;
     virtual Pegasus::Array<Pegasus::CIMInstance> openQueryInstances(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::String &queryLanguage,
@@ -282,21 +325,21 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0) = 0;
     virtual Pegasus::Array<Pegasus::CIMInstance> pullInstancesWithPath(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         Pegasus::Uint32 maxObjectCount) = 0;
     virtual Pegasus::Array<Pegasus::CIMObjectPath> pullInstancePaths(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         Pegasus::Uint32 maxObjectCount) = 0;
     virtual Pegasus::Array<Pegasus::CIMInstance> pullInstances(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         Pegasus::Uint32 maxObjectCount) = 0;
     virtual void closeEnumeration(
-        Pegasus::CIMEnumerationContext &enumerationContext) = 0;
+        EnumerationContext &enumerationContext) = 0;
     virtual Pegasus::Uint64Arg enumerationCount(
-        Pegasus::CIMEnumerationContext &enumerationContext) = 0;
+        EnumerationContext &enumerationContext) = 0;
 #  endif // HAVE_PEGASUS_ENUMERATION_CONTEXT
 
 protected:
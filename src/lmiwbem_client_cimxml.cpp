@@ -25,9 +25,55 @@
 #include "lmiwbem_client_cimxml.h"
 #include "lmiwbem_exception.h"
 #include "lmiwbem_gil.h"
+#include "lmiwbem_mutex.h"
+#include "lmiwbem_resolver.h"
 #include "obj/cim/lmiwbem_constants.h"
 
 #include <cctype>
+#include <map>
+#include <sstream>
+#include <sys/stat.h>
+#include <vector>
+
+namespace {
+
+// Loaded SSL contexts shared by all CIMXMLClients. Each entry remembers
+// modification times of the files it was built from, so a rotated
+// certificate or trust store is picked up on the next connect.
+//
+// Pegasus::CIMClient::connect() keeps its own copy of the context and the
+// copy loads the files again, so a connect still costs one load; the cache
+// saves the second one, which building the context here would add. TLS
+// sessions can't be resumed either, the client API doesn't expose them.
+class SSLContextEntry
+{
+public:
+    SSLContextEntry(): m_ctx(), m_mtimes() { }
+    SSLContextEntry(
+        const boost::shared_ptr<Pegasus::SSLContext> &ctx,
+        const String &mtimes)
+        : m_ctx(ctx), m_mtimes(mtimes) { }
+
+    boost::shared_ptr<Pegasus::SSLContext> m_ctx;
+    String m_mtimes;
+};
+
+typedef std::map<String, SSLContextEntry> SSLContextMap;
+
+Mutex s_ssl_ctx_mutex;
+SSLContextMap s_ssl_ctx_map;
+
+String ssl_context_mtime(const String &path)
+{
+    struct stat st;
+    std::stringstream ss;
+    if (!path.empty() && stat(path.c_str(), &st) == 0)
+        ss << st.st_mtime << '.' << st.st_size;
+    ss << ';';
+    return String(ss.str());
+}
+
+} // unnamed namespace
 
 CIMXMLClient::CIMXMLClient()
     : CIMClient()
@@ -58,33 +104,94 @@ void CIMXMLClient::connect(
 
     bool is_creds_valid = m_url_info.isCredsValid();
 
+    // Connect to the cached addresses; certificate verification still
+    // matches m_url_info's hostname, see verifyCertificate().
+    std::vector<String> addresses;
+    if (!m_url_info.isLocal())
+        addresses = Resolver::getAddresses(m_url_info.hostname());
+
     if (m_url_info.isLocal()) {
         connectLocally();
-    } else if (!m_url_info.isHttps()) {
-        m_client.connect(
-            m_url_info.hostname(),
-            m_url_info.port(),
-            is_creds_valid ? m_url_info.username() : username,
-            is_creds_valid ? m_url_info.password() : password);
     } else {
-        Pegasus::SSLContext ctx(
+        boost::shared_ptr<Pegasus::SSLContext> ctx;
+        if (m_url_info.isHttps())
+            ctx = sslContext(cert_file, key_file, trust_store);
+
+        // Addresses are tried in the resolver's order, until one of them
+        // accepts the connection; the last failure is reported.
+        for (size_t i = 0; i < addresses.size(); ++i) {
+            try {
+                connectAddress(
+                    addresses[i],
+                    ctx.get(),
+                    is_creds_valid ? m_url_info.username() : username,
+                    is_creds_valid ? m_url_info.password() : password);
+                break;
+            } catch (const Pegasus::CannotConnectException &) {
+                if (i + 1 == addresses.size())
+                    throw;
+            }
+        }
+    }
+    m_is_connected = true;
+}
+
+boost::shared_ptr<Pegasus::SSLContext> CIMXMLClient::sslContext(
+    const String &cert_file,
+    const String &key_file,
+    const String &trust_store)
+{
+    std::stringstream key_ss;
+    key_ss << trust_store.length() << ':' << trust_store
+           << cert_file.length() << ':' << cert_file
+           << key_file.length() << ':' << key_file
+           << m_verify_cert;
+    String key(key_ss.str());
+    String mtimes(
+        ssl_context_mtime(trust_store) +
+        ssl_context_mtime(cert_file) +
+        ssl_context_mtime(key_file));
+
+    {
+        ScopedMutex sm(s_ssl_ctx_mutex);
+        SSLContextMap::const_iterator found = s_ssl_ctx_map.find(key);
+        if (found != s_ssl_ctx_map.end() && found->second.m_mtimes == mtimes)
+            return found->second.m_ctx;
+    }
+
+    // Loading of the trust store, certificate and key is done without the
+    // lock held; concurrent connects may build the same context twice.
+    boost::shared_ptr<Pegasus::SSLContext> ctx(
+        new Pegasus::SSLContext(
             trust_store,
             cert_file,
             key_file,
             m_verify_cert ? verifyCertificate : NULL,
 #ifdef HAVE_PEGASUS_VERIFICATION_CALLBACK_WITH_DATA
-            this,
+            NULL,
 #endif // HAVE_PEGASUS_VERIFICATION_CALLBACK_WITH_DATA
-            String()
-        );
-        m_client.connect(
-            m_url_info.hostname(),
-            m_url_info.port(),
-            ctx,
-            is_creds_valid ? m_url_info.username() : username,
-            is_creds_valid ? m_url_info.password() : password);
+            String()));
+
+    ScopedMutex sm(s_ssl_ctx_mutex);
+    s_ssl_ctx_map[key] = SSLContextEntry(ctx, mtimes);
+    return ctx;
+}
+
+void CIMXMLClient::connectAddress(
+    const String &address,
+    Pegasus::SSLContext *ctx,
+    const String &username,
+    const String &password)
+{
+    if (!ctx) {
+        m_client.connect(address, m_url_info.port(), username, password);
+        return;
     }
-    m_is_connected = true;
+
+    // TLS handshake verifies the certificate against this client's
+    // hostname; see verifyCertificate().
+    ScopedCurrentClient current(this);
+    m_client.connect(address, m_url_info.port(), *ctx, username, password);
 }
 
 void CIMXMLClient::connectLocally()
@@ -286,7 +393,7 @@ Pegasus::Array<Pegasus::CIMObjectPath> CIMXMLClient::referenceNames(
 
 #ifdef HAVE_PEGASUS_ENUMERATION_CONTEXT
 Pegasus::Array<Pegasus::CIMInstance> CIMXMLClient::openEnumerateInstances(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     const Pegasus::CIMNamespaceName &nameSpace,
     const Pegasus::CIMName &className,
@@ -306,7 +413,7 @@ Pegasus::Array<Pegasus::CIMInstance> CIMXMLClient::openEnumerateInstances(
 }
 
 Pegasus::Array<Pegasus::CIMObjectPath> CIMXMLClient::openEnumerateInstancePaths(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     const Pegasus::CIMNamespaceName &nameSpace,
     const Pegasus::CIMName &className,
@@ -323,7 +430,7 @@ Pegasus::Array<Pegasus::CIMObjectPath> CIMXMLClient::openEnumerateInstancePaths(
 }
 
 Pegasus::Array<Pegasus::CIMInstance> CIMXMLClient::openReferenceInstances(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     const Pegasus::CIMNamespaceName &nameSpace,
     const Pegasus::CIMObjectPath &objectName,
@@ -344,7 +451,7 @@ Pegasus::Array<Pegasus::CIMInstance> CIMXMLClient::openReferenceInstances(
 }
 
 Pegasus::Array<Pegasus::CIMObjectPath> CIMXMLClient::openReferenceInstancePaths(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     const Pegasus::CIMNamespaceName &nameSpace,
     const Pegasus::CIMObjectPath &objectName,
@@ -363,7 +470,7 @@ Pegasus::Array<Pegasus::CIMObjectPath> CIMXMLClient::openReferenceInstancePaths(
 }
 
 Pegasus::Array<Pegasus::CIMInstance> CIMXMLClient::openAssociatorInstances(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     const Pegasus::CIMNamespaceName &nameSpace,
     const Pegasus::CIMObjectPath &objectName,
@@ -387,7 +494,7 @@ Pegasus::Array<Pegasus::CIMInstance> CIMXMLClient::openAssociatorInstances(
 }
 
 Pegasus::Array<Pegasus::CIMObjectPath> CIMXMLClient::openAssociatorInstancePaths(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     const Pegasus::CIMNamespaceName &nameSpace,
     const Pegasus::CIMObjectPath &objectName,
@@ -408,7 +515,7 @@ Pegasus::Array<Pegasus::CIMObjectPath> CIMXMLClient::openAssociatorInstancePaths
 }
 
 Pegasus::Array<Pegasus::CIMInstance> CIMXMLClient::openQueryInstances(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     const Pegasus::CIMNamespaceName &nameSpace,
     const Pegasus::String &queryLanguage,
@@ -426,7 +533,7 @@ Pegasus::Array<Pegasus::CIMInstance> CIMXMLClient::openQueryInstances(
 }
 
 Pegasus::Array<Pegasus::CIMInstance> CIMXMLClient::pullInstancesWithPath(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     Pegasus::Uint32 maxObjectCount)
 {
@@ -435,7 +542,7 @@ Pegasus::Array<Pegasus::CIMInstance> CIMXMLClient::pullInstancesWithPath(
 }
 
 Pegasus::Array<Pegasus::CIMObjectPath> CIMXMLClient::pullInstancePaths(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     Pegasus::Uint32 maxObjectCount)
 {
@@ -444,7 +551,7 @@ Pegasus::Array<Pegasus::CIMObjectPath> CIMXMLClient::pullInstancePaths(
 }
 
 Pegasus::Array<Pegasus::CIMInstance> CIMXMLClient::pullInstances(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     Pegasus::Uint32 maxObjectCount)
 {
@@ -453,13 +560,13 @@ Pegasus::Array<Pegasus::CIMInstance> CIMXMLClient::pullInstances(
 }
 
 void CIMXMLClient::closeEnumeration(
-    Pegasus::CIMEnumerationContext &enumerationContext)
+    EnumerationContext &enumerationContext)
 {
     m_client.closeEnumeration(enumerationContext);
 }
 
 Pegasus::Uint64Arg CIMXMLClient::enumerationCount(
-    Pegasus::CIMEnumerationContext &enumerationContext)
+    EnumerationContext &enumerationContext)
 {
     return m_client.enumerationCount(enumerationContext);
 }
@@ -501,8 +608,13 @@ Pegasus::Boolean CIMXMLClient::verifyCertificate(Pegasus::SSLCertificateInfo &ci
         return false;
     }
 
-    CIMXMLClient *fake_this = reinterpret_cast<CIMXMLClient*>(data);
-    Pegasus::String hostname(fake_this->m_url_info.hostname());
+    // The context is shared by clients of different hosts; the certificate
+    // is verified against the hostname of the client, which connects (or
+    // reconnects during an operation) in this thread.
+    const CIMClient *client = CIMClient::currentClient();
+    if (!client)
+        return false;
+    Pegasus::String hostname(client->getURLInfo().hostname());
 
     // Verify against DNS names
     Pegasus::Array<Pegasus::String> dnsNames = ci.getSubjectAltNames().getDnsNames();
@@ -22,6 +22,7 @@
 #ifndef   LMIWBEM_CLIENT_CIMXML_H
 #  define LMIWBEM_CLIENT_CIMXML_H
 
+#  include <boost/shared_ptr.hpp>
 #  include <Pegasus/Client/CIMClient.h>
 #  include "lmiwbem_client.h"
 #  include "util/lmiwbem_string.h"
@@ -152,7 +153,7 @@ public:
 #  ifdef HAVE_PEGASUS_ENUMERATION_CONTEXT
     // Pull operations
     virtual Pegasus::Array<Pegasus::CIMInstance> openEnumerateInstances(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::CIMName &className,
@@ -165,7 +166,7 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0);
     virtual Pegasus::Array<Pegasus::CIMObjectPath> openEnumerateInstancePaths(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::CIMName &className,
@@ -175,7 +176,7 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0);
     virtual Pegasus::Array<Pegasus::CIMInstance> openReferenceInstances(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::CIMObjectPath &objectName,
@@ -189,7 +190,7 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0);
     virtual Pegasus::Array<Pegasus::CIMObjectPath> openReferenceInstancePaths(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::CIMObjectPath &objectName,
@@ -201,7 +202,7 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0);
     virtual Pegasus::Array<Pegasus::CIMInstance> openAssociatorInstances(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::CIMObjectPath &objectName,
@@ -217,7 +218,7 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0);
     virtual Pegasus::Array<Pegasus::CIMObjectPath> openAssociatorInstancePaths(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::CIMObjectPath &objectName,
@@ -231,7 +232,7 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0);
     virtual Pegasus::Array<Pegasus::CIMInstance> openQueryInstances(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::String &queryLanguage,
@@ -242,24 +243,36 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0);
     virtual Pegasus::Array<Pegasus::CIMInstance> pullInstancesWithPath(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         Pegasus::Uint32 maxObjectCount);
     virtual Pegasus::Array<Pegasus::CIMObjectPath> pullInstancePaths(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         Pegasus::Uint32 maxObjectCount);
     virtual Pegasus::Array<Pegasus::CIMInstance> pullInstances(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         Pegasus::Uint32 maxObjectCount);
     virtual void closeEnumeration(
-        Pegasus::CIMEnumerationContext &enumerationContext);
+        EnumerationContext &enumerationContext);
     virtual Pegasus::Uint64Arg enumerationCount(
-        Pegasus::CIMEnumerationContext &enumerationContext);
+        EnumerationContext &enumerationContext);
 #  endif // HAVE_PEGASUS_ENUMERATION_CONTEXT
 
 private:
+    // Plain HTTP connection is used, if ctx is NULL.
+    void connectAddress(
+        const String &address,
+        Pegasus::SSLContext *ctx,
+        const String &username,
+        const String &password);
+
+    boost::shared_ptr<Pegasus::SSLContext> sslContext(
+        const String &cert_file,
+        const String &key_file,
+        const String &trust_store);
+
     static bool matchPattern(const Pegasus::String &pattern, const Pegasus::String &str);
 
 #  ifdef HAVE_PEGASUS_VERIFICATION_CALLBACK_WITH_DATA
@@ -20,73 +20,310 @@
  * ***** END LICENSE BLOCK ***** */
 
 #include <config.h>
-#include <vector>
+#include <sstream>
 #include <Pegasus/Common/Array.h>
 #include <Pegasus/Common/CIMClass.h>
 #include <Pegasus/Common/CIMInstance.h>
+#include <Pegasus/Common/CIMMethod.h>
 #include <Pegasus/Common/CIMName.h>
 #include <Pegasus/Common/CIMObject.h>
 #include <Pegasus/Common/CIMObjectPath.h>
 #include <Pegasus/Common/CIMStatusCode.h>
 #include <Pegasus/Common/CIMValue.h>
-#include <boost/property_tree/exceptions.hpp>
+#include <openwsman/u/libu.h>
+#include <openwsman/wsman-client-api.h>
+#include <openwsman/wsman-client-transport.h>
 #include <openwsman/wsman-names.h>
-#include <openwsman/cpp/OpenWsmanClient.h>
+#include <openwsman/wsman-xml-api.h>
 #include <openwsman/cpp/WsmanEPR.h>
+#include <openwsman/cpp/WsmanFilter.h>
+#include <openwsman/cpp/WsmanOptions.h>
 #include "lmiwbem_client_wsman.h"
 #include "lmiwbem_client_wsman_builder.h"
+#include "lmiwbem_client_wsman_query.h"
 #include "lmiwbem_client_wsman_request.h"
 #include "lmiwbem_exception.h"
+#include "lmiwbem_mutex.h"
+#include "lmiwbem_resolver.h"
 #include "lmiwbem_urlinfo.h"
-#include "obj/cim/lmiwbem_value.h"
 #include "util/lmiwbem_convert.h"
 #include "util/lmiwbem_string.h"
 
-typedef std::vector<std::string> EnumerationResult;
-
 using namespace WsmanClientNamespace;
 
-namespace ptree = boost::property_tree;
-
 namespace {
 
-void handle_wsman_exceptions()
+// Bounds of MaxElements for adaptive enumeration.
+const Pegasus::Uint32 ADAPTIVE_INITIAL_ELEMENTS = 16;
+const Pegasus::Uint32 ADAPTIVE_MAX_ELEMENTS = 4096;
+
+Pegasus::Array<Pegasus::CIMObject> instances_to_objects(
+    const Pegasus::Array<Pegasus::CIMInstance> &instances)
 {
-    try {
-        // Re-throw and convert to Pegasus's exceptions.
-        throw;
-    } catch (WsmanResourceNotFound &e) {
-        throw Pegasus::CIMException(
-            Pegasus::CIM_ERR_NOT_FOUND,
-            e.getDetail().c_str());
-    } catch (WsmanSoapFault &e) {
-        throw WsmanException(e.GetFaultReason());
-    } catch (WsmanClientException &e) {
-        throw WsmanException(e.getDetail());
+    const Pegasus::Uint32 cnt = instances.size();
+    Pegasus::Array<Pegasus::CIMObject> objects(cnt);
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        objects[i] = instances[i];
+
+    return objects;
+}
+
+// Destroys a request or response document when leaving the scope.
+class ScopedXmlDoc
+{
+public:
+    ScopedXmlDoc(WsXmlDocH doc): m_doc(doc) { }
+    ~ScopedXmlDoc() { if (m_doc) ws_xml_destroy_doc(m_doc); }
+
+    WsXmlDocH get() const { return m_doc; }
+
+private:
+    ScopedXmlDoc(const ScopedXmlDoc &copy);
+    ScopedXmlDoc &operator=(const ScopedXmlDoc &rhs);
+
+    WsXmlDocH m_doc;
+};
+
+// Owns the context of a running enumeration. Unless the enumeration reached
+// its end, the context is released on the server when leaving the scope.
+class ScopedEnumContext
+{
+public:
+    ScopedEnumContext(
+        WsManClient *client,
+        const char *resource_uri,
+        client_opt_t *options)
+        : m_client(client)
+        , m_resource_uri(resource_uri)
+        , m_options(options)
+        , m_context()
+    {
+    }
+
+    ~ScopedEnumContext()
+    {
+        if (!m_context.empty()) {
+            ws_xml_destroy_doc(wsmc_action_release(
+                m_client, m_resource_uri, m_options, m_context.c_str()));
+        }
     }
+
+    void reset(const String &context) { m_context = context; }
+
+    String release()
+    {
+        String context(m_context);
+        m_context.clear();
+        return context;
+    }
+
+    bool isEmpty() const { return m_context.empty(); }
+    const char *get() const { return m_context.c_str(); }
+
+private:
+    ScopedEnumContext(const ScopedEnumContext &copy);
+    ScopedEnumContext &operator=(const ScopedEnumContext &rhs);
+
+    WsManClient *m_client;
+    const char *m_resource_uri;
+    client_opt_t *m_options;
+    String m_context;
+};
+
+// Subcodes and details of the faults, which reject fragment-level access.
+const char *FAULT_UNSUPPORTED_FEATURE = "UnsupportedFeature";
+const char *FAULT_ACTION_NOT_SUPPORTED = "ActionNotSupported";
+const char *FAULT_DETAIL_FRAGMENT_LEVEL_ACCESS =
+    "http://schemas.dmtf.org/wbem/wsman/1/wsman/faultDetail/FragmentLevelAccess";
+
+// SOAP fault returned by the server.
+class FaultException: public WsmanException
+{
+public:
+    FaultException(
+        const String &what_arg,
+        const String &subcode,
+        const String &detail) throw()
+        : WsmanException(what_arg)
+        , m_subcode(subcode)
+        , m_detail(detail)
+    {
+    }
+
+    ~FaultException() throw()
+    {
+    }
+
+    bool isFragmentUnsupported() const
+    {
+        return m_subcode == FAULT_UNSUPPORTED_FEATURE ||
+            (m_subcode == FAULT_ACTION_NOT_SUPPORTED &&
+             m_detail == FAULT_DETAIL_FRAGMENT_LEVEL_ACCESS);
+    }
+
+private:
+    String m_subcode;
+    String m_detail;
+};
+
+// Raises an exception for transport errors and SOAP faults.
+void check_response(WsManClient *client, WsXmlDocH doc)
+{
+    WS_LASTERR_Code err = wsmc_get_last_error(client);
+    if (err != WS_LASTERR_OK) {
+        throw TransportException(
+            wsman_transport_get_last_error_string(err),
+            err == WS_LASTERR_OPERATION_TIMEDOUT);
+    }
+
+    if (!doc) {
+        std::stringstream ss;
+        ss << "Invalid response, HTTP code: " << wsmc_get_response_code(client);
+        throw WsmanException(ss.str());
+    }
+
+    if (!wsmc_check_for_fault(doc))
+        return;
+
+    WsManFault *fault = wsmc_fault_new();
+    wsmc_get_fault_data(doc, fault);
+    String reason(fault->reason ? fault->reason : "Unknown SOAP fault");
+    String subcode(fault->subcode ? fault->subcode : "");
+    String detail(fault->fault_detail ? fault->fault_detail : "");
+    wsmc_fault_destroy(fault);
+
+    if (subcode == WSA_DESTINATION_UNREACHABLE)
+        throw Pegasus::CIMException(Pegasus::CIM_ERR_NOT_FOUND, reason);
+    throw FaultException(reason, subcode, detail);
 }
 
-void handle_xml_exceptions()
+// Checks the response to Enumerate. Missing resource is an empty
+// enumeration, for which false is returned.
+bool check_enumerate_response(WsManClient *client, WsXmlDocH doc)
 {
     try {
-        // Re-throw and convert to Pegasus's exceptions.
+        check_response(client, doc);
+    } catch (const Pegasus::CIMException &e) {
+        if (e.getCode() == Pegasus::CIM_ERR_NOT_FOUND)
+            return false;
         throw;
-    } catch (const ptree::ptree_error &e) {
-        throw WsmanException(e.what());
     }
+
+    return true;
 }
 
-Pegasus::Array<Pegasus::CIMObject> instances_to_objects(
-    const Pegasus::Array<Pegasus::CIMInstance> &instances)
+// Returns the first element of the response body.
+String get_payload(WsManClient *client, WsXmlDocH doc)
 {
-    const Pegasus::Uint32 cnt = instances.size();
-    Pegasus::Array<Pegasus::CIMObject> objects(cnt);
-    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
-        objects[i] = instances[i];
+    check_response(client, doc);
+
+    WsXmlNodeH payload = ws_xml_get_child(
+        ws_xml_get_soap_body(doc), 0, NULL, NULL);
+    if (!payload)
+        return String();
+
+    char *buf = NULL;
+    int size = 0;
+    ws_xml_dump_memory_node_tree(payload, &buf, &size);
+    if (!buf)
+        return String();
+
+    String result(std::string(buf, size));
+    ws_xml_free_memory(buf);
+    return result;
+}
 
-    return objects;
+String get_enum_context(WsXmlDocH doc)
+{
+    char *context = wsmc_get_enum_context(doc);
+    String result(context ? context : "");
+    u_free(context);
+    return result;
+}
+
+// Reads wsman:TotalItemsCountEstimate of an Enumerate response.
+bool get_count_estimate(WsXmlDocH doc, Pegasus::Uint64 &count)
+{
+    WsXmlNodeH node = ws_xml_get_child(
+        ws_xml_get_soap_header(doc), 0, XML_NS_WS_MAN, WSM_TOTAL_ESTIMATE);
+    const char *text = node ? ws_xml_get_node_text(node) : NULL;
+    if (!text || !*text)
+        return false;
+
+    std::stringstream ss(text);
+    return static_cast<bool>(ss >> count);
+}
+
+// Hands the items of an Enumerate or Pull response to the handler one by
+// one. Optimized enumerations carry the items in WS-Management namespace.
+// Returns true, if the response marks the end of the enumeration; count is
+// set to the number of items in the response.
+template <typename Handler>
+bool handle_items(
+    WsXmlDocH doc,
+    const char *response,
+    Handler &handler,
+    Pegasus::Uint32 *count = NULL)
+{
+    WsXmlNodeH node = ws_xml_get_child(
+        ws_xml_get_soap_body(doc), 0, XML_NS_ENUMERATION, response);
+    if (!node)
+        return false;
+
+    const bool end_of_sequence =
+        ws_xml_get_child(node, 0, XML_NS_ENUMERATION, WSENUM_END_OF_SEQUENCE) ||
+        ws_xml_get_child(node, 0, XML_NS_WS_MAN, WSENUM_END_OF_SEQUENCE);
+
+    WsXmlNodeH items = ws_xml_get_child(
+        node, 0, XML_NS_ENUMERATION, WSENUM_ITEMS);
+    if (!items)
+        items = ws_xml_get_child(node, 0, XML_NS_WS_MAN, WSENUM_ITEMS);
+    if (!items)
+        return end_of_sequence;
+
+    const int cnt = ws_xml_get_child_count(items);
+    if (count)
+        *count = static_cast<Pegasus::Uint32>(cnt);
+    for (int i = 0; i < cnt; ++i) {
+        char *buf = NULL;
+        int size = 0;
+        ws_xml_dump_memory_node_tree(
+            ws_xml_get_child(items, i, NULL, NULL), &buf, &size);
+        if (!buf)
+            continue;
+
+        std::string item(buf, size);
+        ws_xml_free_memory(buf);
+        handler.handleItem(item);
+    }
+
+    return end_of_sequence;
 }
 
+WsmanOptions &add_selectors(
+    WsmanOptions &options,
+    const Pegasus::CIMObjectPath &path)
+{
+    const Pegasus::Array<Pegasus::CIMKeyBinding> &keybindings = path.getKeyBindings();
+    const Pegasus::Uint32 cnt = keybindings.size();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+        options.addSelector(
+            String(keybindings[i].getName().getString()),
+            String(keybindings[i].getValue()));
+    }
+
+    return options;
+}
+
+#ifdef HAVE_PEGASUS_ENUMERATION_CONTEXT
+// WS-Enumeration filters are dialect specific; FQL has no counterpart.
+void check_filter_query(const Pegasus::String &filterQuery)
+{
+    if (filterQuery.size())
+        throw NotSupportedException("FilterQuery not supported");
+}
+#endif // HAVE_PEGASUS_ENUMERATION_CONTEXT
+
 WsmanEPR pegasusObjectPathToEPR(const Pegasus::CIMObjectPath &path)
 {
     Request request(
@@ -108,10 +345,210 @@ WsmanEPR pegasusObjectPathToEPR(const Pegasus::CIMObjectPath &path)
     return epr;
 }
 
+class InstanceNameCollector: public WSMANClient::EnumerationHandler
+{
+public:
+    InstanceNameCollector(const String &hostname, const String &ns)
+        : m_hostname(hostname)
+        , m_ns(ns)
+    {
+    }
+
+    virtual void handleItem(const std::string &item)
+    {
+        m_result.append(ObjectFactory::makeCIMInstanceName(
+            item, m_hostname, m_ns));
+    }
+
+    const Pegasus::Array<Pegasus::CIMObjectPath> &result() const
+    {
+        return m_result;
+    }
+
+private:
+    String m_hostname;
+    String m_ns;
+    Pegasus::Array<Pegasus::CIMObjectPath> m_result;
+};
+
+class InstanceCollector: public WSMANClient::EnumerationHandler
+{
+public:
+    InstanceCollector(
+        const String &hostname,
+        const String &ns,
+        const Pegasus::CIMPropertyList &property_list)
+        : m_hostname(hostname)
+        , m_ns(ns)
+        , m_property_list(property_list)
+    {
+    }
+
+    virtual void handleItem(const std::string &item)
+    {
+        m_result.append(ObjectFactory::makeCIMInstanceWithPath(
+            item, m_hostname, m_ns, m_property_list));
+    }
+
+    const Pegasus::Array<Pegasus::CIMInstance> &result() const
+    {
+        return m_result;
+    }
+
+private:
+    String m_hostname;
+    String m_ns;
+    Pegasus::CIMPropertyList m_property_list;
+    Pegasus::Array<Pegasus::CIMInstance> m_result;
+};
+
+// Collects instances matching the client side part of a query.
+class QueryCollector: public WSMANClient::EnumerationHandler
+{
+public:
+    QueryCollector(
+        const String &hostname,
+        const String &ns,
+        const WsmanQuery &query)
+        : m_hostname(hostname)
+        , m_ns(ns)
+        , m_query(query)
+        , m_property_list(query.getDecodePropertyList())
+        , m_received(false)
+    {
+    }
+
+    virtual void handleItem(const std::string &item)
+    {
+        m_received = true;
+
+        Pegasus::CIMInstance instance(ObjectFactory::makeCIMInstanceWithPath(
+            item, m_hostname, m_ns, m_property_list));
+        if (!m_query.matches(instance))
+            return;
+
+        m_query.project(instance);
+        m_result.append(instance);
+    }
+
+    bool received() const
+    {
+        return m_received;
+    }
+
+    const Pegasus::Array<Pegasus::CIMInstance> &result() const
+    {
+        return m_result;
+    }
+
+private:
+    String m_hostname;
+    String m_ns;
+    WsmanQuery m_query;
+    Pegasus::CIMPropertyList m_property_list;
+    bool m_received;
+    Pegasus::Array<Pegasus::CIMInstance> m_result;
+};
+
+// Whether a fault of a filtered enumeration means the server can't process
+// the filter. Faults after the first items are real failures; transport
+// errors never get here, see TransportException.
+bool is_filter_rejected(const QueryCollector &collector)
+{
+    return !collector.received();
+}
+
+WsmanQuery parse_query(const Pegasus::String &queryLanguage, const Pegasus::String &query)
+{
+    WsmanQuery parsed((String(queryLanguage)), String(query));
+    if (!parsed.isValid()) {
+        throw Pegasus::CIMException(
+            Pegasus::CIM_ERR_INVALID_QUERY,
+            parsed.getError());
+    }
+
+    return parsed;
+}
+
+// openwsman initializes the transport library on the first session; don't
+// let two threads do it at once.
+Mutex s_transport_mutex;
+
 } // unnamed namespace
 
+WSMANClient::ScopedSession::ScopedSession(WSMANClient *client)
+    : m_client(client)
+    , m_session()
+    , m_generation(0)
+{
+    SessionParams params;
+    Pegasus::Uint32 timeout;
+    {
+        ScopedMutex sm(m_client->m_state_mutex);
+        while (m_client->m_idle_sessions.empty() &&
+               m_client->m_session_count >= m_client->m_max_sessions)
+        {
+            m_client->m_session_released.wait(m_client->m_state_mutex);
+        }
+
+        m_generation = m_client->m_generation;
+        timeout = m_client->m_timeout;
+        if (!m_client->m_idle_sessions.empty()) {
+            m_session = m_client->m_idle_sessions.back();
+            m_client->m_idle_sessions.pop_back();
+        } else {
+            // Reserve the slot; the session is created without the lock.
+            params = m_client->m_session_params;
+            ++m_client->m_session_count;
+        }
+    }
+
+    if (!m_session) {
+        try {
+            m_session = m_client->createSession(params);
+        } catch (...) {
+            ScopedMutex sm(m_client->m_state_mutex);
+            if (m_generation == m_client->m_generation)
+                --m_client->m_session_count;
+            m_client->m_session_released.signal();
+            throw;
+        }
+    }
+
+    // The transport counts whole seconds; zero disables the timeout.
+    wsman_transport_set_timeout(
+        m_session.get(),
+        static_cast<unsigned long>((timeout + 999) / 1000));
+}
+
+WSMANClient::ScopedSession::~ScopedSession()
+{
+    ScopedMutex sm(m_client->m_state_mutex);
+    if (m_generation != m_client->m_generation)
+        return;
+
+    if (m_client->m_session_count > m_client->m_max_sessions) {
+        // The limit was lowered meanwhile.
+        --m_client->m_session_count;
+        return;
+    }
+
+    m_client->m_idle_sessions.push_back(m_session);
+    m_client->m_session_released.signal();
+}
+
 WSMANClient::WSMANClient()
-    : m_client()
+    : m_state_mutex()
+    , m_session_released()
+    , m_session_params()
+    , m_session_key()
+    , m_idle_sessions()
+    , m_session_count(0)
+    , m_max_sessions(1)
+    , m_generation(0)
+    , m_fragment_unsupported(false)
+    , m_timeout(0)
+    , m_enum_options()
 {
 }
 
@@ -128,17 +565,44 @@ void WSMANClient::connect(
     const String &trust_store)
 {
     URLInfo url_info(uri);
-    m_client.reset(
-        new WsmanClientNamespace::OpenWsmanClient(
-            url_info.hostname().c_str(),
-            static_cast<const int>(url_info.port()),
-            url_info.path().c_str(),
-            url_info.scheme().c_str(),
-            "Basic", // Authentication method
-            username.c_str(),
-            password.c_str()));
 
-    m_client->SetClientCert(cert_file, key_file);
+    // Over HTTPS, the transport matches the server certificate against the
+    // host from the URL; only plain HTTP can use the cached address. The
+    // session connects lazily, so only the first address is used.
+    String host(url_info.hostname());
+    if (!url_info.isHttps()) {
+        host = Resolver::getAddress(host);
+        if (host.find(':') != String::npos)
+            host = "[" + host + "]";
+    }
+
+    std::stringstream ss;
+    ss << host << '\n' << url_info.port() << '\n' << url_info.path() << '\n'
+       << url_info.scheme() << '\n' << username << '\n' << password << '\n'
+       << cert_file << '\n' << key_file;
+    const String session_key(ss.str());
+
+    // Idle sessions are reused for the same endpoint. Sessions in use by
+    // other requests are released, when they finish.
+    ScopedMutex sm(m_state_mutex);
+    if (m_session_key != session_key) {
+        m_session_params.m_host = host;
+        m_session_params.m_port = url_info.port();
+        m_session_params.m_path = url_info.path();
+        m_session_params.m_scheme = url_info.scheme();
+        m_session_params.m_username = username;
+        m_session_params.m_password = password;
+        m_session_params.m_cert_file = cert_file;
+        m_session_params.m_key_file = key_file;
+        m_session_key = session_key;
+        m_idle_sessions.clear();
+        m_session_count = 0;
+        ++m_generation;
+        m_fragment_unsupported = false;
+        m_session_released.broadcast();
+    }
+
+    m_is_connected = true;
 }
 
 void WSMANClient::connectLocally()
@@ -148,7 +612,45 @@ void WSMANClient::connectLocally()
 
 void WSMANClient::disconnect()
 {
-    m_client.reset();
+    // WBEMConnection connects for every operation; idle sessions stay around
+    // for the next one and are released with the client.
+    m_is_connected = false;
+}
+
+bool WSMANClient::isThreadSafe() const
+{
+    return true;
+}
+
+void WSMANClient::setEnumerationOptions(const EnumerationOptions &options)
+{
+    ScopedMutex sm(m_state_mutex);
+    m_enum_options = options;
+}
+
+WSMANClient::EnumerationOptions WSMANClient::getEnumerationOptions() const
+{
+    ScopedMutex sm(m_state_mutex);
+    return m_enum_options;
+}
+
+void WSMANClient::setMaxSessions(Pegasus::Uint32 max_sessions)
+{
+    ScopedMutex sm(m_state_mutex);
+    m_max_sessions = max_sessions ? max_sessions : 1;
+    while (m_idle_sessions.size() > m_max_sessions) {
+        m_idle_sessions.pop_back();
+        --m_session_count;
+    }
+
+    // Raising the limit lets the waiting requests in.
+    m_session_released.broadcast();
+}
+
+Pegasus::Uint32 WSMANClient::getMaxSessions() const
+{
+    ScopedMutex sm(m_state_mutex);
+    return m_max_sessions;
 }
 
 // ------------------------------------------------------------------------
@@ -156,6 +658,9 @@ void WSMANClient::disconnect()
 //
 void WSMANClient::setTimeout(Pegasus::Uint32 timeoutMilliseconds)
 {
+    // Applied to a session, when it's leased.
+    ScopedMutex sm(m_state_mutex);
+    m_timeout = timeoutMilliseconds;
 }
 
 void WSMANClient::setRequestAcceptLanguages(const Pegasus::AcceptLanguageList& langs)
@@ -164,7 +669,8 @@ void WSMANClient::setRequestAcceptLanguages(const Pegasus::AcceptLanguageList& l
 
 Pegasus::Uint32 WSMANClient::getTimeout() const
 {
-    return 0;
+    ScopedMutex sm(m_state_mutex);
+    return m_timeout;
 }
 
 Pegasus::AcceptLanguageList WSMANClient::getRequestAcceptLanguages() const
@@ -236,7 +742,6 @@ Pegasus::Array<Pegasus::CIMInstance> WSMANClient::enumerateInstances(
     UNUSED(localOnly);
     UNUSED(includeQualifiers);
     UNUSED(includeClassOrigin);
-    UNUSED(propertyList);
 
     Request request(
         getHostname(),
@@ -249,7 +754,11 @@ Pegasus::Array<Pegasus::CIMInstance> WSMANClient::enumerateInstances(
     else
         options.addFlag(FLAG_INCLUDESUBCLASSPROPERTIES);
 
-    return enumerateInstancesWithPath(request, options);
+    return enumerateInstancesWithPath(
+        request,
+        options,
+        WsmanFilter(),
+        propertyList);
 }
 
 Pegasus::Array<Pegasus::CIMObjectPath> WSMANClient::enumerateInstanceNames(
@@ -271,25 +780,51 @@ Pegasus::Array<Pegasus::CIMObject> WSMANClient::execQuery(
     const Pegasus::String &queryLanguage,
     const Pegasus::String &query)
 {
+    WsmanQuery parsed(parse_query(queryLanguage, query));
+
+    if (parsed.hasServerQuery()) {
+        Request request(
+            getHostname(),
+            String(nameSpace.getString()),
+            parsed);
+
+        WsmanOptions options(FLAG_ENUMERATION_ENUM_OBJ_AND_EPR);
+        WsmanFilter filter(
+            request.getQueryDialect(),
+            request.getQuery());
+
+        QueryCollector collector(
+            request.getHostname(),
+            request.getNamespace(),
+            parsed);
+        try {
+            enumerate(request, options, filter, collector);
+            return instances_to_objects(collector.result());
+        } catch (const TransportException &) {
+            throw;
+        } catch (const WsmanException &) {
+            if (!is_filter_rejected(collector))
+                throw;
+        }
+
+        // The server doesn't support the filter dialect; evaluate the whole
+        // condition here.
+        parsed.disableServerQuery();
+    }
+
     Request request(
         getHostname(),
         String(nameSpace.getString()),
-        String(queryLanguage),
-        String(query));
-
-    if (!request.isValid()) {
-        throw Pegasus::CIMException(
-            Pegasus::CIM_ERR_INVALID_QUERY,
-            "Invalid query");
-    }
+        parsed.getClassname());
 
     WsmanOptions options(FLAG_ENUMERATION_ENUM_OBJ_AND_EPR);
-    WsmanFilter filter(
-        request.getQueryDialect(),
-        request.getQuery());
+    QueryCollector collector(
+        request.getHostname(),
+        request.getNamespace(),
+        parsed);
+    enumerate(request, options, WsmanFilter(), collector);
 
-    return instances_to_objects(
-        enumerateInstancesWithPath(request, options, filter));
+    return instances_to_objects(collector.result());
 }
 
 Pegasus::CIMClass WSMANClient::getClass(
@@ -323,33 +858,60 @@ Pegasus::CIMInstance WSMANClient::getInstance(
         String(nameSpace.getString()),
         String(instanceName.getClassName().getString()));
 
-    const Pegasus::Array<Pegasus::CIMKeyBinding> &keybindings = instanceName.getKeyBindings();
-    const Pegasus::Uint32 cnt = keybindings.size();
-    WsmanOptions options;
-    options.setNamespace(request.getNamespace());
-    for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
-        options.addSelector(
-            String(keybindings[i].getName().getString()),
-            String(keybindings[i].getValue()));
+    ScopedSession session(this);
+    WsManClient *client = session.get();
+    const String resource_uri(request.asString());
+    Pegasus::CIMInstance peg_instance;
+
+    bool fragment_unsupported;
+    {
+        ScopedMutex sm(m_state_mutex);
+        fragment_unsupported = m_fragment_unsupported;
     }
 
-    String instance;
-    try {
-        instance = m_client->Get(request, options);
-    } catch (...) {
-        handle_wsman_exceptions();
+    // A single property is transferred alone, if the server implements
+    // fragment-level access.
+    if (!propertyList.isNull() &&
+        propertyList.size() == 1 &&
+        !fragment_unsupported)
+    {
+        WsmanOptions options;
+        options.setNamespace(request.getNamespace());
+        add_selectors(options, instanceName);
+
+        const String fragment(propertyList[0].getString());
+        wsmc_set_fragment(fragment.c_str(), options);
+
+        ScopedXmlDoc response(wsmc_action_get(
+            client, resource_uri.c_str(), options));
+        try {
+            peg_instance = ObjectFactory::makeCIMInstanceFromFragment(
+                get_payload(client, response.get()),
+                instanceName.getClassName());
+        } catch (const FaultException &e) {
+            if (!e.isFragmentUnsupported())
+                throw;
+
+            // Fall back to the whole instance and don't try again.
+            ScopedMutex sm(m_state_mutex);
+            m_fragment_unsupported = true;
+        }
     }
 
-    try {
-        Pegasus::CIMInstance peg_instance(ObjectFactory::makeCIMInstance(
-            instance));
-        peg_instance.setPath(instanceName);
-        return peg_instance;
-    } catch (...) {
-        handle_xml_exceptions();
+    if (peg_instance.isUninitialized()) {
+        WsmanOptions options;
+        options.setNamespace(request.getNamespace());
+        add_selectors(options, instanceName);
+
+        ScopedXmlDoc response(wsmc_action_get(
+            client, resource_uri.c_str(), options));
+        peg_instance = ObjectFactory::makeCIMInstance(
+            get_payload(client, response.get()),
+            propertyList);
     }
 
-    return Pegasus::CIMInstance();
+    peg_instance.setPath(instanceName);
+    return peg_instance;
 }
 
 Pegasus::CIMValue WSMANClient::invokeMethod(
@@ -358,53 +920,64 @@ Pegasus::CIMValue WSMANClient::invokeMethod(
     const Pegasus::CIMName &methodName,
     const Pegasus::Array<Pegasus::CIMParamValue> &inParameters,
     Pegasus::Array<Pegasus::CIMParamValue> &outParameters)
+{
+    return invokeMethod(
+        nameSpace,
+        instanceName,
+        methodName,
+        inParameters,
+        outParameters,
+        Pegasus::CIMConstMethod());
+}
+
+Pegasus::CIMValue WSMANClient::invokeMethod(
+    const Pegasus::CIMNamespaceName &nameSpace,
+    const Pegasus::CIMObjectPath &instanceName,
+    const Pegasus::CIMName &methodName,
+    const Pegasus::Array<Pegasus::CIMParamValue> &inParameters,
+    Pegasus::Array<Pegasus::CIMParamValue> &outParameters,
+    const Pegasus::CIMConstMethod &method)
 {
     Request request(
         getHostname(),
         String(instanceName.getNameSpace().getString()),
         String(instanceName.getClassName().getString()));
 
-    const Pegasus::Array<Pegasus::CIMKeyBinding> &keybindings = instanceName.getKeyBindings();
-    Pegasus::Uint32 cnt = keybindings.size();
     WsmanOptions options;
     options.setNamespace(request.getNamespace());
-    for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
-        options.addSelector(
-            String(keybindings[i].getName().getString()),
-            String(keybindings[i].getValue()));
-    }
-
-    cnt = inParameters.size();
-    for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
-        const Pegasus::CIMParamValue &param = inParameters[i];
-        try {
-            options.addProperty(
-                String(param.getParameterName()),
-                CIMValue::asString(param.getValue()));
-        } catch (const Pegasus::TypeMismatchException &e) {
-            // We got a unsupported value type
-            continue;
-        }
-    }
-
-    String method_name(methodName.getString());
-    String rval;
-    try {
-        rval = m_client->Invoke(
-            request,
-            method_name,
-            options);
-    } catch (...) {
-        handle_wsman_exceptions();
-    }
-
-    try {
-        return ObjectFactory::makeMethodReturnValue(rval, method_name, outParameters);
-    } catch (...) {
-        handle_xml_exceptions();
-    }
-
-    return Pegasus::CIMValue();
+    add_selectors(options, instanceName);
+
+    // Parameters are sent as a document; the property list of the options
+    // holds only single string values.
+    const String resource_uri(request.asString());
+    const String method_name(methodName.getString());
+    const std::string input(ObjectFactory::makeMethodInput(
+        resource_uri,
+        method_name,
+        request.getNamespace(),
+        inParameters));
+    ScopedXmlDoc input_doc(ws_xml_read_memory(
+        input.c_str(), input.size(), "UTF-8", 0));
+    if (!input_doc.get())
+        throw WsmanException("Can't encode method parameters");
+
+    ScopedSession session(this);
+    WsManClient *client = session.get();
+    ScopedXmlDoc response(wsmc_action_invoke(
+        client,
+        resource_uri.c_str(),
+        options,
+        method_name.c_str(),
+        input_doc.get()));
+    String rval(get_payload(client, response.get()));
+
+    return ObjectFactory::makeMethodReturnValue(
+        rval,
+        method_name,
+        request.getHostname(),
+        request.getNamespace(),
+        method,
+        outParameters);
 }
 
 Pegasus::Array<Pegasus::CIMObject> WSMANClient::associators(
@@ -420,7 +993,6 @@ Pegasus::Array<Pegasus::CIMObject> WSMANClient::associators(
 {
     UNUSED(includeQualifiers);
     UNUSED(includeClassOrigin);
-    UNUSED(propertyList);
 
     Request request(
         getHostname(),
@@ -439,7 +1011,7 @@ Pegasus::Array<Pegasus::CIMObject> WSMANClient::associators(
         String(resultRole));
 
     return instances_to_objects(
-        enumerateInstancesWithPath(request, options, filter));
+        enumerateInstancesWithPath(request, options, filter, propertyList));
 }
 
 Pegasus::Array<Pegasus::CIMObjectPath> WSMANClient::associatorNames(
@@ -480,7 +1052,6 @@ Pegasus::Array<Pegasus::CIMObject> WSMANClient::references(
 {
     UNUSED(includeQualifiers);
     UNUSED(includeClassOrigin);
-    UNUSED(propertyList);
 
     Request request(
         getHostname(),
@@ -499,7 +1070,7 @@ Pegasus::Array<Pegasus::CIMObject> WSMANClient::references(
         String()); // ResultRole
 
     return instances_to_objects(
-        enumerateInstancesWithPath(request, options, filter));
+        enumerateInstancesWithPath(request, options, filter, propertyList));
 }
 
 Pegasus::Array<Pegasus::CIMObjectPath> WSMANClient::referenceNames(
@@ -529,7 +1100,7 @@ Pegasus::Array<Pegasus::CIMObjectPath> WSMANClient::referenceNames(
 
 #ifdef HAVE_PEGASUS_ENUMERATION_CONTEXT
 Pegasus::Array<Pegasus::CIMInstance> WSMANClient::openEnumerateInstances(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     const Pegasus::CIMNamespaceName &nameSpace,
     const Pegasus::CIMName &className,
@@ -542,26 +1113,44 @@ Pegasus::Array<Pegasus::CIMInstance> WSMANClient::openEnumerateInstances(
     Pegasus::Boolean continueOnError,
     Pegasus::Uint32 maxObjectCount)
 {
-    UNUSED(enumerationContext);
-    UNUSED(endOfSequence);
-    UNUSED(nameSpace);
-    UNUSED(className);
-    UNUSED(deepInheritance);
     UNUSED(includeClassOrigin);
-    UNUSED(propertyList);
     UNUSED(filterQueryLanguage);
-    UNUSED(filterQuery);
     UNUSED(operationTimeout);
     UNUSED(continueOnError);
-    UNUSED(maxObjectCount);
 
-    throw NotSupportedException("OpenEnumerateInstances() not supported");
+    check_filter_query(filterQuery);
 
-    return Pegasus::Array<Pegasus::CIMInstance>();
+    Request request(
+        getHostname(),
+        nameSpace.getString(),
+        className.getString());
+
+    WsmanOptions options(FLAG_ENUMERATION_ENUM_OBJ_AND_EPR);
+    if (deepInheritance)
+        options.addFlag(FLAG_EXCLUDESUBCLASSPROPERTIES);
+    else
+        options.addFlag(FLAG_INCLUDESUBCLASSPROPERTIES);
+
+    InstanceCollector collector(
+        request.getHostname(),
+        request.getNamespace(),
+        propertyList);
+    openEnumeration(
+        enumerationContext,
+        endOfSequence,
+        request,
+        options,
+        WsmanFilter(),
+        false,
+        propertyList,
+        maxObjectCount,
+        collector);
+
+    return collector.result();
 }
 
 Pegasus::Array<Pegasus::CIMObjectPath> WSMANClient::openEnumerateInstancePaths(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     const Pegasus::CIMNamespaceName &nameSpace,
     const Pegasus::CIMName &className,
@@ -571,23 +1160,38 @@ Pegasus::Array<Pegasus::CIMObjectPath> WSMANClient::openEnumerateInstancePaths(
     Pegasus::Boolean continueOnError,
     Pegasus::Uint32 maxObjectCount)
 {
-    UNUSED(enumerationContext);
-    UNUSED(endOfSequence);
-    UNUSED(nameSpace);
-    UNUSED(className);
     UNUSED(filterQueryLanguage);
-    UNUSED(filterQuery);
     UNUSED(operationTimeout);
     UNUSED(continueOnError);
-    UNUSED(maxObjectCount);
 
-    throw NotSupportedException("OpenEnumerateInstanceNames() not supported");
+    check_filter_query(filterQuery);
 
-    return Pegasus::Array<Pegasus::CIMObjectPath>();
+    Request request(
+        getHostname(),
+        nameSpace.getString(),
+        className.getString());
+
+    WsmanOptions options(FLAG_ENUMERATION_ENUM_EPR);
+
+    InstanceNameCollector collector(
+        request.getHostname(),
+        request.getNamespace());
+    openEnumeration(
+        enumerationContext,
+        endOfSequence,
+        request,
+        options,
+        WsmanFilter(),
+        true,
+        Pegasus::CIMPropertyList(),
+        maxObjectCount,
+        collector);
+
+    return collector.result();
 }
 
 Pegasus::Array<Pegasus::CIMInstance> WSMANClient::openReferenceInstances(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     const Pegasus::CIMNamespaceName &nameSpace,
     const Pegasus::CIMObjectPath &objectName,
@@ -601,27 +1205,49 @@ Pegasus::Array<Pegasus::CIMInstance> WSMANClient::openReferenceInstances(
     Pegasus::Boolean continueOnError,
     Pegasus::Uint32 maxObjectCount)
 {
-    UNUSED(enumerationContext);
-    UNUSED(endOfSequence);
-    UNUSED(nameSpace);
-    UNUSED(objectName);
-    UNUSED(resultClass);
-    UNUSED(role);
     UNUSED(includeClassOrigin);
-    UNUSED(propertyList);
     UNUSED(filterQueryLanguage);
-    UNUSED(filterQuery);
     UNUSED(operationTimeout);
     UNUSED(continueOnError);
-    UNUSED(maxObjectCount);
 
-    throw NotSupportedException("OpenReferences() not supported");
+    check_filter_query(filterQuery);
+
+    Request request(
+        getHostname(),
+        String(nameSpace.getString()),
+        String(objectName.getClassName().getString()),
+        true);
+
+    WsmanOptions options(FLAG_ENUMERATION_ENUM_OBJ_AND_EPR);
 
-    return Pegasus::Array<Pegasus::CIMInstance>();
+    WsmanFilter filter(
+        pegasusObjectPathToEPR(objectName),
+        WSMAN_ASSOCIATED,
+        String(), // AssocClass
+        String(resultClass.getString()),
+        String(role),
+        String()); // ResultRole
+
+    InstanceCollector collector(
+        request.getHostname(),
+        request.getNamespace(),
+        propertyList);
+    openEnumeration(
+        enumerationContext,
+        endOfSequence,
+        request,
+        options,
+        filter,
+        false,
+        propertyList,
+        maxObjectCount,
+        collector);
+
+    return collector.result();
 }
 
 Pegasus::Array<Pegasus::CIMObjectPath> WSMANClient::openReferenceInstancePaths(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     const Pegasus::CIMNamespaceName &nameSpace,
     const Pegasus::CIMObjectPath &objectName,
@@ -633,25 +1259,47 @@ Pegasus::Array<Pegasus::CIMObjectPath> WSMANClient::openReferenceInstancePaths(
     Pegasus::Boolean continueOnError,
     Pegasus::Uint32 maxObjectCount)
 {
-    UNUSED(enumerationContext);
-    UNUSED(endOfSequence);
-    UNUSED(nameSpace);
-    UNUSED(objectName);
-    UNUSED(resultClass);
-    UNUSED(role);
     UNUSED(filterQueryLanguage);
-    UNUSED(filterQuery);
     UNUSED(operationTimeout);
     UNUSED(continueOnError);
-    UNUSED(maxObjectCount);
 
-    throw NotSupportedException("OpenReferenceNames() not supported");
+    check_filter_query(filterQuery);
+
+    Request request(
+        getHostname(),
+        String(nameSpace.getString()),
+        String(objectName.getClassName().getString()),
+        true);
+
+    WsmanOptions options(FLAG_ENUMERATION_ENUM_EPR);
+
+    WsmanFilter filter(
+        pegasusObjectPathToEPR(objectName),
+        WSMAN_ASSOCIATED,
+        String(), // AssocClass
+        String(resultClass.getString()),
+        String(role),
+        String()); // ResultRole
 
-    return Pegasus::Array<Pegasus::CIMObjectPath>();
+    InstanceNameCollector collector(
+        request.getHostname(),
+        request.getNamespace());
+    openEnumeration(
+        enumerationContext,
+        endOfSequence,
+        request,
+        options,
+        filter,
+        true,
+        Pegasus::CIMPropertyList(),
+        maxObjectCount,
+        collector);
+
+    return collector.result();
 }
 
 Pegasus::Array<Pegasus::CIMInstance> WSMANClient::openAssociatorInstances(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     const Pegasus::CIMNamespaceName &nameSpace,
     const Pegasus::CIMObjectPath &objectName,
@@ -667,29 +1315,49 @@ Pegasus::Array<Pegasus::CIMInstance> WSMANClient::openAssociatorInstances(
     Pegasus::Boolean continueOnError,
     Pegasus::Uint32 maxObjectCount)
 {
-    UNUSED(enumerationContext);
-    UNUSED(endOfSequence);
-    UNUSED(nameSpace);
-    UNUSED(objectName);
-    UNUSED(assocClass);
-    UNUSED(resultClass);
-    UNUSED(role);
-    UNUSED(resultRole);
     UNUSED(includeClassOrigin);
-    UNUSED(propertyList);
     UNUSED(filterQueryLanguage);
-    UNUSED(filterQuery);
     UNUSED(operationTimeout);
     UNUSED(continueOnError);
-    UNUSED(maxObjectCount);
 
-    throw NotSupportedException("OpenAssociators() not supported");
+    check_filter_query(filterQuery);
 
-    return Pegasus::Array<Pegasus::CIMInstance>();
+    Request request(
+        getHostname(),
+        String(nameSpace.getString()),
+        String(objectName.getClassName().getString()),
+        true);
+
+    WsmanOptions options(FLAG_ENUMERATION_ENUM_OBJ_AND_EPR);
+
+    WsmanFilter filter(
+        pegasusObjectPathToEPR(objectName),
+        WSMAN_ASSOCIATOR,
+        String(assocClass.getString()),
+        String(resultClass.getString()),
+        String(role),
+        String(resultRole));
+
+    InstanceCollector collector(
+        request.getHostname(),
+        request.getNamespace(),
+        propertyList);
+    openEnumeration(
+        enumerationContext,
+        endOfSequence,
+        request,
+        options,
+        filter,
+        false,
+        propertyList,
+        maxObjectCount,
+        collector);
+
+    return collector.result();
 }
 
 Pegasus::Array<Pegasus::CIMObjectPath> WSMANClient::openAssociatorInstancePaths(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     const Pegasus::CIMNamespaceName &nameSpace,
     const Pegasus::CIMObjectPath &objectName,
@@ -703,27 +1371,47 @@ Pegasus::Array<Pegasus::CIMObjectPath> WSMANClient::openAssociatorInstancePaths(
     Pegasus::Boolean continueOnError,
     Pegasus::Uint32 maxObjectCount)
 {
-    UNUSED(enumerationContext);
-    UNUSED(endOfSequence);
-    UNUSED(nameSpace);
-    UNUSED(objectName);
-    UNUSED(assocClass);
-    UNUSED(resultClass);
-    UNUSED(role);
-    UNUSED(resultRole);
     UNUSED(filterQueryLanguage);
-    UNUSED(filterQuery);
     UNUSED(operationTimeout);
     UNUSED(continueOnError);
-    UNUSED(maxObjectCount);
 
-    throw NotSupportedException("OpenAssociatorNames() not supported");
+    check_filter_query(filterQuery);
+
+    Request request(
+        getHostname(),
+        String(nameSpace.getString()),
+        String(objectName.getClassName().getString()),
+        true);
+
+    WsmanOptions options(FLAG_ENUMERATION_ENUM_EPR);
 
-    return Pegasus::Array<Pegasus::CIMObjectPath>();
+    WsmanFilter filter(
+        pegasusObjectPathToEPR(objectName),
+        WSMAN_ASSOCIATOR,
+        String(assocClass.getString()),
+        String(resultClass.getString()),
+        String(role),
+        String(resultRole));
+
+    InstanceNameCollector collector(
+        request.getHostname(),
+        request.getNamespace());
+    openEnumeration(
+        enumerationContext,
+        endOfSequence,
+        request,
+        options,
+        filter,
+        true,
+        Pegasus::CIMPropertyList(),
+        maxObjectCount,
+        collector);
+
+    return collector.result();
 }
 
 Pegasus::Array<Pegasus::CIMInstance> WSMANClient::openQueryInstances(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     const Pegasus::CIMNamespaceName &nameSpace,
     const Pegasus::String &queryLanguage,
@@ -734,139 +1422,460 @@ Pegasus::Array<Pegasus::CIMInstance> WSMANClient::openQueryInstances(
     Pegasus::Boolean continueOnError,
     Pegasus::Uint32 maxObjectCount)
 {
-    UNUSED(enumerationContext);
-    UNUSED(endOfSequence);
-    UNUSED(nameSpace);
-    UNUSED(queryLanguage);
-    UNUSED(query);
     UNUSED(queryResultClass);
-    UNUSED(returnQueryResultClass);
     UNUSED(operationTimeout);
     UNUSED(continueOnError);
-    UNUSED(maxObjectCount);
 
-    throw NotSupportedException("OpenExecQuery() not supported");
+    if (returnQueryResultClass)
+        throw NotSupportedException("ReturnQueryResultClass not supported");
+
+    WsmanQuery parsed(parse_query(queryLanguage, query));
+
+    Pegasus::Array<Pegasus::CIMInstance> result;
+    bool opened = false;
+    if (parsed.hasServerQuery()) {
+        Request request(
+            getHostname(),
+            String(nameSpace.getString()),
+            parsed);
 
-    return Pegasus::Array<Pegasus::CIMInstance>();
+        WsmanOptions options(FLAG_ENUMERATION_ENUM_OBJ_AND_EPR);
+        WsmanFilter filter(
+            request.getQueryDialect(),
+            request.getQuery());
+
+        QueryCollector collector(
+            request.getHostname(),
+            request.getNamespace(),
+            parsed);
+        try {
+            openEnumeration(
+                enumerationContext,
+                endOfSequence,
+                request,
+                options,
+                filter,
+                false,
+                Pegasus::CIMPropertyList(),
+                maxObjectCount,
+                collector);
+            result = collector.result();
+            opened = true;
+        } catch (const TransportException &) {
+            throw;
+        } catch (const WsmanException &) {
+            if (!is_filter_rejected(collector))
+                throw;
+            parsed.disableServerQuery();
+        }
+    }
+
+    if (!opened) {
+        Request request(
+            getHostname(),
+            String(nameSpace.getString()),
+            parsed.getClassname());
+
+        WsmanOptions options(FLAG_ENUMERATION_ENUM_OBJ_AND_EPR);
+        QueryCollector collector(
+            request.getHostname(),
+            request.getNamespace(),
+            parsed);
+        openEnumeration(
+            enumerationContext,
+            endOfSequence,
+            request,
+            options,
+            WsmanFilter(),
+            false,
+            Pegasus::CIMPropertyList(),
+            maxObjectCount,
+            collector);
+        result = collector.result();
+    }
+
+    // Pulled instances go through the same client side condition.
+    ScopedMutex sm(m_state_mutex);
+    boost::shared_ptr<Enumeration> enumeration(
+        findEnumeration(enumerationContext));
+    if (enumeration)
+        enumeration->m_query.reset(new WsmanQuery(parsed));
+
+    return result;
 }
 
 Pegasus::Array<Pegasus::CIMInstance> WSMANClient::pullInstancesWithPath(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     Pegasus::Uint32 maxObjectCount)
 {
-    UNUSED(enumerationContext);
-    UNUSED(endOfSequence);
-    UNUSED(maxObjectCount);
-
-    throw NotSupportedException("PullInstances() not supported");
+    const Enumeration enumeration(getEnumeration(enumerationContext, false));
+    if (enumeration.m_query) {
+        QueryCollector collector(
+            enumeration.m_hostname,
+            enumeration.m_namespace,
+            *enumeration.m_query);
+        pullEnumeration(
+            enumerationContext,
+            endOfSequence,
+            maxObjectCount,
+            collector);
+
+        return collector.result();
+    }
 
-    return Pegasus::Array<Pegasus::CIMInstance>();
+    InstanceCollector collector(
+        enumeration.m_hostname,
+        enumeration.m_namespace,
+        enumeration.m_property_list);
+    pullEnumeration(
+        enumerationContext,
+        endOfSequence,
+        maxObjectCount,
+        collector);
+
+    return collector.result();
 }
 
 Pegasus::Array<Pegasus::CIMObjectPath> WSMANClient::pullInstancePaths(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     Pegasus::Uint32 maxObjectCount)
 {
-    UNUSED(enumerationContext);
-    UNUSED(endOfSequence);
-    UNUSED(maxObjectCount);
-
-    throw NotSupportedException("PullInstanceNames() not supported");
-
-    return Pegasus::Array<Pegasus::CIMObjectPath>();
+    const Enumeration enumeration(getEnumeration(enumerationContext, true));
+    InstanceNameCollector collector(
+        enumeration.m_hostname,
+        enumeration.m_namespace);
+    pullEnumeration(
+        enumerationContext,
+        endOfSequence,
+        maxObjectCount,
+        collector);
+
+    return collector.result();
 }
 
 Pegasus::Array<Pegasus::CIMInstance> WSMANClient::pullInstances(
-    Pegasus::CIMEnumerationContext &enumerationContext,
+    EnumerationContext &enumerationContext,
     Pegasus::Boolean &endOfSequence,
     Pegasus::Uint32 maxObjectCount)
 {
-    UNUSED(enumerationContext);
-    UNUSED(endOfSequence);
-    UNUSED(maxObjectCount);
-
-    throw NotSupportedException("PullInstances() not supported");
-
-    return Pegasus::Array<Pegasus::CIMInstance>();
+    // WS-Enumeration items always carry the EPR.
+    return pullInstancesWithPath(
+        enumerationContext,
+        endOfSequence,
+        maxObjectCount);
 }
 
 void WSMANClient::closeEnumeration(
-    Pegasus::CIMEnumerationContext &enumerationContext)
+    EnumerationContext &enumerationContext)
 {
-    throw NotSupportedException("CloseEnumeration() not supported");
+    Enumeration enumeration;
+    {
+        ScopedMutex sm(m_state_mutex);
+        boost::shared_ptr<Enumeration> found(
+            findEnumeration(enumerationContext));
+        if (!found)
+            return;
+
+        // Copy the state out; the context is closed before any request is
+        // sent.
+        enumeration = *found;
+        enumerationContext.resetState();
+    }
+
+    ScopedSession session(this);
+    WsManClient *client = session.get();
+    WsmanOptions options;
+    ScopedXmlDoc response(wsmc_action_release(
+        client,
+        enumeration.m_resource_uri.c_str(),
+        options,
+        enumeration.m_context.c_str()));
+    check_response(client, response.get());
 }
 
 Pegasus::Uint64Arg WSMANClient::enumerationCount(
-    Pegasus::CIMEnumerationContext &enumerationContext)
+    EnumerationContext &enumerationContext)
 {
-    throw NotSupportedException("EnumerationCount() not supported");
-
-    return Pegasus::Uint64Arg();
+    Pegasus::Uint64Arg count;
+    ScopedMutex sm(m_state_mutex);
+    boost::shared_ptr<Enumeration> enumeration(
+        findEnumeration(enumerationContext));
+    if (enumeration && enumeration->m_has_count)
+        count.setValue(enumeration->m_count);
+
+    return count;
 }
 #endif // HAVE_PEGASUS_ENUMERATION_CONTEXT
 
-Pegasus::Array<Pegasus::CIMObjectPath> WSMANClient::enumerateInstanceNames(
+WSMANClient::Session WSMANClient::createSession(
+    const SessionParams &params) const
+{
+    ScopedMutex sm(s_transport_mutex);
+    WsManClient *session = wsmc_create(
+        params.m_host.c_str(),
+        static_cast<const int>(params.m_port),
+        params.m_path.c_str(),
+        params.m_scheme.c_str(),
+        params.m_username.c_str(),
+        params.m_password.c_str());
+    if (!session)
+        throw WsmanException("Can't create WS-Management client");
+
+    Session result(session, wsmc_release);
+    wsmc_transport_init(session, NULL);
+    wsman_transport_set_auth_method(session, "Basic");
+    if (!params.m_cert_file.empty())
+        wsman_transport_set_cert(session, params.m_cert_file.c_str());
+    if (!params.m_key_file.empty())
+        wsman_transport_set_key(session, params.m_key_file.c_str());
+
+    return result;
+}
+
+void WSMANClient::enumerate(
     const Request &request,
-    const WsmanClientNamespace::WsmanOptions &options)
+    WsmanClientNamespace::WsmanOptions &options,
+    const WsmanClientNamespace::WsmanFilter &filter,
+    EnumerationHandler &handler)
 {
-    return enumerateInstanceNames(request, options, WsmanFilter());
+    const EnumerationOptions enum_options(getEnumerationOptions());
+    ScopedSession session(this);
+    WsManClient *client = session.get();
+    const String resource_uri(request.asString());
+
+    client_opt_t *opts = options;
+    if (enum_options.m_optimized)
+        options.addFlag(FLAG_ENUMERATION_OPTIMIZATION);
+    opts->max_elements = enum_options.m_max_elements;
+    opts->max_envelope_size = enum_options.m_max_envelope_size;
+    if (enum_options.m_adaptive && !opts->max_elements)
+        opts->max_elements = ADAPTIVE_INITIAL_ELEMENTS;
+
+    ScopedXmlDoc response(wsmc_action_enumerate(
+        client, resource_uri.c_str(), options, filter));
+    if (!check_enumerate_response(client, response.get()))
+        return;
+
+    ScopedEnumContext context(client, resource_uri.c_str(), options);
+    context.reset(get_enum_context(response.get()));
+    if (handle_items(response.get(), WSENUM_ENUMERATE_RESP, handler))
+        context.release();
+
+    while (!context.isEmpty()) {
+        ScopedXmlDoc pull_response(wsmc_action_pull(
+            client, resource_uri.c_str(), options, filter, context.get()));
+        check_response(client, pull_response.get());
+
+        Pegasus::Uint32 count = 0;
+        context.reset(get_enum_context(pull_response.get()));
+        if (handle_items(pull_response.get(), WSENUM_PULL_RESP, handler, &count))
+            context.release();
+
+        // A full batch means MaxElements, not MaxEnvelopeSize, limited the
+        // response; ask for more items per round-trip next time.
+        if (enum_options.m_adaptive &&
+            count == opts->max_elements &&
+            opts->max_elements < ADAPTIVE_MAX_ELEMENTS)
+        {
+            opts->max_elements *= 2;
+        }
+    }
 }
 
-Pegasus::Array<Pegasus::CIMObjectPath> WSMANClient::enumerateInstanceNames(
+#ifdef HAVE_PEGASUS_ENUMERATION_CONTEXT
+void WSMANClient::openEnumeration(
+    EnumerationContext &enumerationContext,
+    Pegasus::Boolean &endOfSequence,
     const Request &request,
-    const WsmanClientNamespace::WsmanOptions &options,
-    const WsmanClientNamespace::WsmanFilter &filter)
+    WsmanClientNamespace::WsmanOptions &options,
+    const WsmanClientNamespace::WsmanFilter &filter,
+    bool paths_only,
+    const Pegasus::CIMPropertyList &propertyList,
+    Pegasus::Uint32 maxObjectCount,
+    EnumerationHandler &handler)
 {
-    EnumerationResult enum_result;
+    {
+        ScopedMutex sm(m_state_mutex);
+        enumerationContext.resetState();
+    }
+    endOfSequence = true;
+
+    // The first batch comes with the Enumerate response itself.
+    client_opt_t *opts = options;
+    options.addFlag(FLAG_ENUMERATION_COUNT_ESTIMATION);
+    if (maxObjectCount) {
+        options.addFlag(FLAG_ENUMERATION_OPTIMIZATION);
+        opts->max_elements = maxObjectCount;
+    }
+    opts->max_envelope_size = getEnumerationOptions().m_max_envelope_size;
+
+    ScopedSession session(this);
+    WsManClient *client = session.get();
+    const String resource_uri(request.asString());
+
+    ScopedXmlDoc response(wsmc_action_enumerate(
+        client, resource_uri.c_str(), options, filter));
+    if (!check_enumerate_response(client, response.get()))
+        return;
+
+    ScopedEnumContext context(client, resource_uri.c_str(), options);
+    context.reset(get_enum_context(response.get()));
+    if (handle_items(response.get(), WSENUM_ENUMERATE_RESP, handler) ||
+        context.isEmpty())
+    {
+        context.release();
+        return;
+    }
 
-    try {
-        m_client->Enumerate(request, enum_result, options, filter);
-    } catch (...) {
-        handle_wsman_exceptions();
+    boost::shared_ptr<Enumeration> enumeration(new Enumeration);
+    enumeration->m_resource_uri = resource_uri;
+    enumeration->m_hostname = request.getHostname();
+    enumeration->m_namespace = request.getNamespace();
+    enumeration->m_context = context.release();
+    enumeration->m_paths_only = paths_only;
+    enumeration->m_property_list = propertyList;
+    enumeration->m_has_count = get_count_estimate(
+        response.get(), enumeration->m_count);
+
+    ScopedMutex sm(m_state_mutex);
+    enumerationContext.setState(enumeration);
+    endOfSequence = false;
+}
+
+void WSMANClient::pullEnumeration(
+    EnumerationContext &enumerationContext,
+    Pegasus::Boolean &endOfSequence,
+    Pegasus::Uint32 maxObjectCount,
+    EnumerationHandler &handler)
+{
+    endOfSequence = false;
+    if (maxObjectCount == 0)
+        return;
+
+    // The state is not locked during the request, so it is copied out and
+    // the new context is stored back afterwards.
+    Enumeration enumeration;
+    WsmanOptions options;
+    client_opt_t *opts = options;
+    opts->max_elements = maxObjectCount;
+    {
+        ScopedMutex sm(m_state_mutex);
+        boost::shared_ptr<Enumeration> found(
+            findEnumeration(enumerationContext));
+        if (!found) {
+            throw Pegasus::CIMException(
+                Pegasus::CIM_ERR_INVALID_ENUMERATION_CONTEXT,
+                "Enumeration context is closed or was not opened");
+        }
+
+        enumeration = *found;
+        opts->max_envelope_size = m_enum_options.m_max_envelope_size;
     }
 
+    ScopedSession session(this);
+    WsManClient *client = session.get();
+    ScopedXmlDoc response(wsmc_action_pull(
+        client,
+        enumeration.m_resource_uri.c_str(),
+        options,
+        NULL,
+        enumeration.m_context.c_str()));
     try {
-        return ListConv::asPegasusCIMInstanceNameList(
-            enum_result,
-            request.getHostname(),
-            request.getNamespace());
+        check_response(client, response.get());
     } catch (...) {
-        handle_xml_exceptions();
+        // The server has dropped the context on a fault.
+        ScopedMutex sm(m_state_mutex);
+        enumerationContext.resetState();
+        throw;
     }
 
-    return Pegasus::Array<Pegasus::CIMObjectPath>();
+    const String context(get_enum_context(response.get()));
+    endOfSequence = handle_items(response.get(), WSENUM_PULL_RESP, handler) ||
+        context.empty();
+
+    ScopedMutex sm(m_state_mutex);
+    boost::shared_ptr<Enumeration> found(findEnumeration(enumerationContext));
+    if (!found)
+        return;
+
+    if (endOfSequence)
+        enumerationContext.resetState();
+    else
+        found->m_context = context;
 }
 
-Pegasus::Array<Pegasus::CIMInstance> WSMANClient::enumerateInstancesWithPath(
+boost::shared_ptr<WSMANClient::Enumeration> WSMANClient::findEnumeration(
+    const EnumerationContext &enumerationContext)
+{
+    // Contexts opened by other clients carry no or foreign state.
+    return boost::dynamic_pointer_cast<Enumeration>(
+        enumerationContext.getState());
+}
+
+WSMANClient::Enumeration WSMANClient::getEnumeration(
+    const EnumerationContext &enumerationContext,
+    bool paths_only) const
+{
+    ScopedMutex sm(m_state_mutex);
+    boost::shared_ptr<Enumeration> found(findEnumeration(enumerationContext));
+    if (!found) {
+        throw Pegasus::CIMException(
+            Pegasus::CIM_ERR_INVALID_ENUMERATION_CONTEXT,
+            "Enumeration context is closed or was not opened");
+    }
+
+    if (found->m_paths_only != paths_only) {
+        throw Pegasus::CIMException(
+            Pegasus::CIM_ERR_INVALID_ENUMERATION_CONTEXT,
+            paths_only ?
+                "Enumeration context was opened for instances" :
+                "Enumeration context was opened for instance names");
+    }
+
+    return *found;
+}
+#endif // HAVE_PEGASUS_ENUMERATION_CONTEXT
+
+Pegasus::Array<Pegasus::CIMObjectPath> WSMANClient::enumerateInstanceNames(
     const Request &request,
-    const WsmanClientNamespace::WsmanOptions &options)
+    WsmanClientNamespace::WsmanOptions &options)
 {
-    return enumerateInstancesWithPath(request, options, WsmanFilter());
+    return enumerateInstanceNames(request, options, WsmanFilter());
 }
 
-Pegasus::Array<Pegasus::CIMInstance> WSMANClient::enumerateInstancesWithPath(
+Pegasus::Array<Pegasus::CIMObjectPath> WSMANClient::enumerateInstanceNames(
     const Request &request,
-    const WsmanClientNamespace::WsmanOptions &options,
+    WsmanClientNamespace::WsmanOptions &options,
     const WsmanClientNamespace::WsmanFilter &filter)
 {
-    EnumerationResult enum_result;
+    InstanceNameCollector collector(
+        request.getHostname(),
+        request.getNamespace());
+    enumerate(request, options, filter, collector);
 
-    try {
-        m_client->Enumerate(request, enum_result, options, filter);
-    } catch (...) {
-        handle_wsman_exceptions();
-    }
+    return collector.result();
+}
 
-    try {
-        return ListConv::asPegasusCIMInstancesWithPathList(
-            enum_result,
-            request.getHostname(),
-            request.getNamespace());
-    } catch (...) {
-        handle_xml_exceptions();
-    }
+Pegasus::Array<Pegasus::CIMInstance> WSMANClient::enumerateInstancesWithPath(
+    const Request &request,
+    WsmanClientNamespace::WsmanOptions &options)
+{
+    return enumerateInstancesWithPath(request, options, WsmanFilter());
+}
+
+Pegasus::Array<Pegasus::CIMInstance> WSMANClient::enumerateInstancesWithPath(
+    const Request &request,
+    WsmanClientNamespace::WsmanOptions &options,
+    const WsmanClientNamespace::WsmanFilter &filter,
+    const Pegasus::CIMPropertyList &propertyList)
+{
+    InstanceCollector collector(
+        request.getHostname(),
+        request.getNamespace(),
+        propertyList);
+    enumerate(request, options, filter, collector);
 
-    return Pegasus::Array<Pegasus::CIMInstance>();
+    return collector.result();
 }
@@ -22,22 +22,55 @@
 #ifndef   LMIWBEM_CLIENT_WSMAN_H
 #  define LMIWBEM_CLIENT_WSMAN_H
 
+#  include <string>
+#  include <vector>
 #  include <boost/shared_ptr.hpp>
 #  include "lmiwbem.h"
 #  include "lmiwbem_client.h"
+#  include "lmiwbem_mutex.h"
 #  include "util/lmiwbem_string.h"
 
 WSMAN_CLIENT_BEGIN
-class OpenWsmanClient;
 class WsmanFilter;
 class WsmanOptions;
 WSMAN_CLIENT_END
 
+typedef struct _WsManClient WsManClient;
+
+class WsmanQuery;
 class Request;
 
 class WSMANClient: public CIMClient
 {
 public:
+    // Receives items of an enumeration. Each Pull response is handed over
+    // item by item before the next Pull is sent, so the raw XML of a single
+    // response is all that is kept in memory at a time.
+    class EnumerationHandler
+    {
+    public:
+        virtual ~EnumerationHandler() { }
+        virtual void handleItem(const std::string &item) = 0;
+    };
+
+    // Batching of WS-Enumeration requests. Zero values are left up to the
+    // server. Adaptive enumeration doubles MaxElements after every full batch.
+    struct EnumerationOptions
+    {
+        EnumerationOptions()
+            : m_optimized(false)
+            , m_adaptive(false)
+            , m_max_elements(0)
+            , m_max_envelope_size(0)
+        {
+        }
+
+        bool m_optimized;
+        bool m_adaptive;
+        Pegasus::Uint32 m_max_elements;
+        Pegasus::Uint32 m_max_envelope_size;
+    };
+
     WSMANClient();
     virtual ~WSMANClient();
 
@@ -52,6 +85,17 @@ public:
     virtual void connectLocally();
     virtual void disconnect();
 
+    // Requests run concurrently, each over its own WS-Management session.
+    virtual bool isThreadSafe() const;
+
+    void setEnumerationOptions(const EnumerationOptions &options);
+    EnumerationOptions getEnumerationOptions() const;
+
+    // Upper limit of sessions open to the server at a time; further requests
+    // wait for a free session.
+    void setMaxSessions(Pegasus::Uint32 max_sessions);
+    Pegasus::Uint32 getMaxSessions() const;
+
     // ------------------------------------------------------------------------
     // CIM API
     //
@@ -123,6 +167,15 @@ public:
         const Pegasus::CIMName &methodName,
         const Pegasus::Array<Pegasus::CIMParamValue> &inParameters,
         Pegasus::Array<Pegasus::CIMParamValue> &outParameters);
+    // WS-Management carries no types; the declaration types the return value
+    // and output parameters.
+    Pegasus::CIMValue invokeMethod(
+        const Pegasus::CIMNamespaceName &nameSpace,
+        const Pegasus::CIMObjectPath &instanceName,
+        const Pegasus::CIMName &methodName,
+        const Pegasus::Array<Pegasus::CIMParamValue> &inParameters,
+        Pegasus::Array<Pegasus::CIMParamValue> &outParameters,
+        const Pegasus::CIMConstMethod &method);
 
     // Associations
     virtual Pegasus::Array<Pegasus::CIMObject> associators(
@@ -159,7 +212,7 @@ public:
 #  ifdef HAVE_PEGASUS_ENUMERATION_CONTEXT
     // Pull operations
     virtual Pegasus::Array<Pegasus::CIMInstance> openEnumerateInstances(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::CIMName &className,
@@ -172,7 +225,7 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0);
     virtual Pegasus::Array<Pegasus::CIMObjectPath> openEnumerateInstancePaths(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::CIMName &className,
@@ -182,7 +235,7 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0);
     virtual Pegasus::Array<Pegasus::CIMInstance> openReferenceInstances(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::CIMObjectPath &objectName,
@@ -196,7 +249,7 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0);
     virtual Pegasus::Array<Pegasus::CIMObjectPath> openReferenceInstancePaths(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::CIMObjectPath &objectName,
@@ -208,7 +261,7 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0);
     virtual Pegasus::Array<Pegasus::CIMInstance> openAssociatorInstances(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::CIMObjectPath &objectName,
@@ -224,7 +277,7 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0);
     virtual Pegasus::Array<Pegasus::CIMObjectPath> openAssociatorInstancePaths(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::CIMObjectPath &objectName,
@@ -238,7 +291,7 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0);
     virtual Pegasus::Array<Pegasus::CIMInstance> openQueryInstances(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         const Pegasus::CIMNamespaceName &nameSpace,
         const Pegasus::String &queryLanguage,
@@ -249,41 +302,148 @@ public:
         Pegasus::Boolean continueOnError = false,
         Pegasus::Uint32 maxObjectCount = 0);
     virtual Pegasus::Array<Pegasus::CIMInstance> pullInstancesWithPath(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         Pegasus::Uint32 maxObjectCount);
     virtual Pegasus::Array<Pegasus::CIMObjectPath> pullInstancePaths(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         Pegasus::Uint32 maxObjectCount);
     virtual Pegasus::Array<Pegasus::CIMInstance> pullInstances(
-        Pegasus::CIMEnumerationContext &enumerationContext,
+        EnumerationContext &enumerationContext,
         Pegasus::Boolean &endOfSequence,
         Pegasus::Uint32 maxObjectCount);
     virtual void closeEnumeration(
-        Pegasus::CIMEnumerationContext &enumerationContext);
+        EnumerationContext &enumerationContext);
     virtual Pegasus::Uint64Arg enumerationCount(
-        Pegasus::CIMEnumerationContext &enumerationContext);
+        EnumerationContext &enumerationContext);
 #  endif // HAVE_PEGASUS_ENUMERATION_CONTEXT
 
 protected:
+    void enumerate(
+        const Request &request,
+        WsmanClientNamespace::WsmanOptions &options,
+        const WsmanClientNamespace::WsmanFilter &filter,
+        EnumerationHandler &handler);
+
+#  ifdef HAVE_PEGASUS_ENUMERATION_CONTEXT
+    void openEnumeration(
+        EnumerationContext &enumerationContext,
+        Pegasus::Boolean &endOfSequence,
+        const Request &request,
+        WsmanClientNamespace::WsmanOptions &options,
+        const WsmanClientNamespace::WsmanFilter &filter,
+        bool paths_only,
+        const Pegasus::CIMPropertyList &propertyList,
+        Pegasus::Uint32 maxObjectCount,
+        EnumerationHandler &handler);
+    void pullEnumeration(
+        EnumerationContext &enumerationContext,
+        Pegasus::Boolean &endOfSequence,
+        Pegasus::Uint32 maxObjectCount,
+        EnumerationHandler &handler);
+#  endif // HAVE_PEGASUS_ENUMERATION_CONTEXT
+
     Pegasus::Array<Pegasus::CIMObjectPath> enumerateInstanceNames(
         const Request &request,
-        const WsmanClientNamespace::WsmanOptions &options);
+        WsmanClientNamespace::WsmanOptions &options);
     Pegasus::Array<Pegasus::CIMObjectPath> enumerateInstanceNames(
         const Request &request,
-        const WsmanClientNamespace::WsmanOptions &options,
+        WsmanClientNamespace::WsmanOptions &options,
         const WsmanClientNamespace::WsmanFilter &filter);
     Pegasus::Array<Pegasus::CIMInstance> enumerateInstancesWithPath(
         const Request &request,
-        const WsmanClientNamespace::WsmanOptions &options);
+        WsmanClientNamespace::WsmanOptions &options);
     Pegasus::Array<Pegasus::CIMInstance> enumerateInstancesWithPath(
         const Request &request,
-        const WsmanClientNamespace::WsmanOptions &options,
-        const WsmanClientNamespace::WsmanFilter &filter);
+        WsmanClientNamespace::WsmanOptions &options,
+        const WsmanClientNamespace::WsmanFilter &filter,
+        const Pegasus::CIMPropertyList &propertyList = Pegasus::CIMPropertyList());
 
 private:
-    boost::shared_ptr<WsmanClientNamespace::OpenWsmanClient> m_client;
+    typedef boost::shared_ptr<WsManClient> Session;
+
+    // Leases a session for the duration of a request. Sessions are reused,
+    // because the transport keeps its HTTP connection and TLS session between
+    // requests.
+    class ScopedSession
+    {
+    public:
+        ScopedSession(WSMANClient *client);
+        ~ScopedSession();
+
+        WsManClient *get() const { return m_session.get(); }
+
+    private:
+        ScopedSession(const ScopedSession &copy);
+        ScopedSession &operator=(const ScopedSession &rhs);
+
+        WSMANClient *m_client;
+        Session m_session;
+        Pegasus::Uint32 m_generation;
+    };
+
+    friend class ScopedSession;
+
+    // Endpoint and credentials of new sessions, see connect().
+    struct SessionParams
+    {
+        String m_host;
+        Pegasus::Uint32 m_port;
+        String m_path;
+        String m_scheme;
+        String m_username;
+        String m_password;
+        String m_cert_file;
+        String m_key_file;
+    };
+
+    Session createSession(const SessionParams &params) const;
+
+#  ifdef HAVE_PEGASUS_ENUMERATION_CONTEXT
+    // WS-Enumeration behind an open EnumerationContext. The state is stored
+    // in the context, so it is released together with the context. It
+    // outlives disconnect(), because the connection is reopened for every
+    // request.
+    struct Enumeration: public EnumerationContext::State
+    {
+        String m_resource_uri;
+        String m_hostname;
+        String m_namespace;
+        String m_context;
+        bool m_paths_only;
+        Pegasus::CIMPropertyList m_property_list;
+        // Client side part of a query; null for other enumerations.
+        boost::shared_ptr<WsmanQuery> m_query;
+        bool m_has_count;
+        Pegasus::Uint64 m_count;
+    };
+
+    // Returns null, if the context holds no WS-Enumeration.
+    static boost::shared_ptr<Enumeration> findEnumeration(
+        const EnumerationContext &enumerationContext);
+
+    Enumeration getEnumeration(
+        const EnumerationContext &enumerationContext,
+        bool paths_only) const;
+#  endif // HAVE_PEGASUS_ENUMERATION_CONTEXT
+
+    // Guards the state below and the enumeration states; never held during
+    // a request.
+    mutable Mutex m_state_mutex;
+    Condition m_session_released;
+
+    // Kept across disconnect(), see connect().
+    SessionParams m_session_params;
+    String m_session_key;
+    std::vector<Session> m_idle_sessions;
+    Pegasus::Uint32 m_session_count;
+    Pegasus::Uint32 m_max_sessions;
+    // Sessions of a previous endpoint are not returned to the idle list.
+    Pegasus::Uint32 m_generation;
+    bool m_fragment_unsupported;
+    Pegasus::Uint32 m_timeout;
+    EnumerationOptions m_enum_options;
 };
 
 #endif // LMIWBEM_CLIENT_WSMAN_H
@@ -20,18 +20,30 @@
  * ***** END LICENSE BLOCK ***** */
 
 #include <config.h>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <limits>
 #include <sstream>
-#include <boost/property_tree/xml_parser.hpp>
-#include <boost/property_tree/ptree.hpp>
+#include <vector>
+#include <Pegasus/Common/Char16.h>
+#include <Pegasus/Common/CIMDateTime.h>
 #include <Pegasus/Common/CIMInstance.h>
+#include <Pegasus/Common/CIMMethod.h>
+#include <Pegasus/Common/CIMObject.h>
+#include <Pegasus/Common/CIMParameter.h>
 #include <Pegasus/Common/CIMParamValue.h>
 #include <Pegasus/Common/CIMObjectPath.h>
 #include <Pegasus/Common/CIMValue.h>
 #include "lmiwbem_client_wsman_builder.h"
+#include "lmiwbem_client_wsman_request.h"
+#include "lmiwbem_client_wsman_xml.h"
+#include "lmiwbem_exception.h"
 #include "util/lmiwbem_string.h"
 
-namespace ptree = boost::property_tree;
-
 namespace {
 
 String get_class_from_resource_uri(const String &resource_uri)
@@ -42,307 +54,1163 @@ String get_class_from_resource_uri(const String &resource_uri)
     return resource_uri;
 }
 
-String xml_omit_namespace(const String &name)
+// Names of properties to decode; null property list accepts all of them.
+class PropertyFilter
+{
+public:
+    PropertyFilter(const Pegasus::CIMPropertyList &property_list)
+        : m_accept_all(property_list.isNull())
+        , m_names()
+    {
+        const Pegasus::Uint32 cnt = property_list.size();
+        for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+            m_names.push_back(String(property_list[i].getString()));
+    }
+
+    bool accepts(const String &name) const
+    {
+        if (m_accept_all)
+            return true;
+
+        // CIM names are ASCII and case-insensitive.
+        std::vector<String>::const_iterator it;
+        for (it = m_names.begin(); it != m_names.end(); ++it) {
+            if (strcasecmp(it->c_str(), name.c_str()) == 0)
+                return true;
+        }
+
+        return false;
+    }
+
+private:
+    bool m_accept_all;
+    std::vector<String> m_names;
+};
+
+void throw_no_such_node(const char *node)
 {
-    size_t pos = name.find(':');
-    if (pos != name.npos)
-        return name.substr(pos + 1);
-    return name;
+    throw WsmanException(String("No such node (") + String(node) + String(")"));
 }
 
-bool ptree_node_name_equals(
-    const String &xml_node,
-    const String &xml_node_without_namespace)
+// Moves to the first child element of the current one.
+void enter_first_child(XMLReader &reader, const char *parent)
 {
-    String xml_node_stripped(xml_omit_namespace(xml_node));
-    return xml_node_stripped == xml_node_without_namespace;
+    for (;;) {
+        switch (reader.next()) {
+        case XMLReader::TOKEN_START:
+            return;
+        case XMLReader::TOKEN_TEXT:
+            break;
+        default:
+            throw_no_such_node(parent);
+        }
+    }
 }
 
-bool ptree_is_xmlattr(const std::string &node_name)
+void add_property(
+    Pegasus::CIMInstance &peg_instance,
+    const Pegasus::CIMName &peg_name,
+    const Pegasus::Array<Pegasus::String> &values)
 {
-    return node_name == "<xmlattr>";
+    Pegasus::Uint32 prop_id = peg_instance.findProperty(peg_name);
+    if (prop_id == Pegasus::PEG_NOT_FOUND) {
+        // Repeated elements of a property form an array.
+        if (values.size() == 1) {
+            peg_instance.addProperty(
+                Pegasus::CIMProperty(peg_name, Pegasus::CIMValue(values[0])));
+        } else {
+            peg_instance.addProperty(
+                Pegasus::CIMProperty(peg_name, Pegasus::CIMValue(values)));
+        }
+        return;
+    }
+
+    // Property with such name has already been set and other properties were
+    // in between; make it an array and continue pushing to it.
+    Pegasus::CIMProperty existing_property(peg_instance.getProperty(prop_id));
+
+    const Pegasus::CIMValue &cpeg_value = existing_property.getValue();
+    Pegasus::Array<Pegasus::String> peg_array;
+
+    if (cpeg_value.isArray()) {
+        cpeg_value.get(peg_array);
+    } else {
+        Pegasus::String peg_str;
+        cpeg_value.get(peg_str);
+        peg_array.append(peg_str);
+    }
+    peg_array.appendArray(values);
+
+    peg_instance.removeProperty(prop_id);
+    peg_instance.addProperty(
+        Pegasus::CIMProperty(peg_name, Pegasus::CIMValue(peg_array)));
 }
 
-ptree::ptree ptree_walk(const ptree::ptree &pt, const String &path)
+// Reads properties from the content of the current element into the
+// instance. Consumes the end tag.
+void read_properties(
+    XMLReader &reader,
+    Pegasus::CIMInstance &peg_instance,
+    const PropertyFilter &filter)
 {
-    std::stringstream ss(path);
-    String member;
-
-    bool found = false;
-    ptree::ptree::const_iterator p(pt.begin());
-    ptree::ptree::const_iterator it(pt.begin());
-    ptree::ptree::const_iterator end(pt.end());
-
-    while (getline(ss, member, '.')) {
-        found = false;
-        for (; !found && it != end; ++it) {
-            if (ptree_node_name_equals(it->first, member)) {
-                p = it;
-                end = it->second.end();
-                it = it->second.begin();
-                found = true;
+    // Values of consecutive elements of the same name are collected first,
+    // so an array property is added once.
+    String prop_name;
+    Pegasus::Array<Pegasus::String> values;
+    for (;;) {
+        XMLReader::Token token = reader.next();
+        if (token == XMLReader::TOKEN_TEXT) {
+            continue;
+        } else if (token != XMLReader::TOKEN_START) {
+            break;
+        }
+
+        // XXX: Can WSMAN give us EPR?
+
+        if (!values.size() || !reader.nameEquals(prop_name)) {
+            if (values.size()) {
+                add_property(peg_instance, Pegasus::CIMName(prop_name), values);
+                values.clear();
             }
+
+            String name(reader.name());
+            if (!filter.accepts(name)) {
+                reader.skipElement();
+                continue;
+            }
+            prop_name = name;
+        }
+        values.append(reader.readText());
+    }
+
+    if (values.size())
+        add_property(peg_instance, Pegasus::CIMName(prop_name), values);
+}
+
+// Reads the instance from its element's content. Call after the start tag of
+// the instance element; consumes the end tag.
+Pegasus::CIMInstance read_instance(
+    XMLReader &reader,
+    const PropertyFilter &filter)
+{
+    Pegasus::CIMInstance peg_instance((Pegasus::CIMName(reader.name())));
+    read_properties(reader, peg_instance, filter);
+    return peg_instance;
+}
+
+// Reads an instance name from ReferenceParameters' content. Call after the
+// start tag of ReferenceParameters; consumes the end tag.
+Pegasus::CIMObjectPath read_reference_parameters(
+    XMLReader &reader,
+    const String &hostname,
+    const String &namespace_)
+{
+    String classname;
+    bool got_resource_uri = false;
+    bool got_selector_set = false;
+    Pegasus::Array<Pegasus::CIMKeyBinding> peg_keybindings;
+    for (;;) {
+        XMLReader::Token token = reader.next();
+        if (token == XMLReader::TOKEN_TEXT) {
+            continue;
+        } else if (token != XMLReader::TOKEN_START) {
+            break;
         }
 
-        if (!found)
-            throw ptree::ptree_bad_path("No such node", ptree::ptree::path_type(path));
+        if (reader.nameEquals("ResourceURI")) {
+            // Get class name from ResourceURI.
+            classname = get_class_from_resource_uri(reader.readText());
+            got_resource_uri = true;
+        } else if (reader.nameEquals("SelectorSet")) {
+            // Fill the keybindings.
+            got_selector_set = true;
+            while (reader.findChild("Selector")) {
+                String name;
+                if (!reader.attribute("Name", name))
+                    throw_no_such_node("Selector.Name");
+                String value(reader.readText());
+
+                peg_keybindings.append(
+                    Pegasus::CIMKeyBinding(
+                        Pegasus::CIMName(name),
+                        value,
+                        Pegasus::CIMKeyBinding::STRING));
+            }
+        } else {
+            reader.skipElement();
+        }
     }
 
-    return p->second;
+    if (!got_resource_uri)
+        throw_no_such_node("ResourceURI");
+    if (!got_selector_set)
+        throw_no_such_node("SelectorSet");
+
+    return Pegasus::CIMObjectPath(
+        hostname,
+        Pegasus::CIMNamespaceName(namespace_),
+        Pegasus::CIMName(classname),
+        peg_keybindings);
 }
 
-} // unnamed namespace
+// Reads an instance name from EndpointReference's content. Call after the
+// start tag of EndpointReference.
+Pegasus::CIMObjectPath read_instance_name(
+    XMLReader &reader,
+    const String &hostname,
+    const String &namespace_)
+{
+    if (!reader.findChild("ReferenceParameters"))
+        throw_no_such_node("ReferenceParameters");
+
+    return read_reference_parameters(reader, hostname, namespace_);
+}
 
-// Throws boost::property_tree::exceptions
-Pegasus::CIMInstance ObjectFactory::makeCIMInstance(const String &xml)
+void throw_invalid_value(const String &value, const char *type)
 {
-    std::stringstream ss(xml);
-    ptree::ptree pt;
+    throw WsmanException(
+        String("Invalid ") + String(type) + String(" value (") + value +
+        String(")"));
+}
 
-    // Read the XML.
-    ptree::read_xml(ss, pt);
+String trim(const String &text)
+{
+    static const char *whitespace = " \t\r\n";
+    const size_t begin = text.find_first_not_of(whitespace);
+    if (begin == String::npos)
+        return String();
 
-    // Walk to CIM Instance.
-    ptree::ptree instance = pt.get_child("");
-    ptree::ptree::const_iterator it = instance.begin();
-    if (ptree_is_xmlattr(it->first))
-        ++it;
+    const size_t end = text.find_last_not_of(whitespace);
+    return text.substr(begin, end - begin + 1);
+}
 
-    return makeCIMInstance(xml_omit_namespace(it->first), it->second);
+Pegasus::Uint64 to_unsigned(const String &text, Pegasus::Uint64 max)
+{
+    const char *str = text.c_str();
+    char *end = NULL;
+    errno = 0;
+    const Pegasus::Uint64 value = strtoull(str, &end, 10);
+    if (!isdigit(*str) || *end || errno || value > max)
+        throw_invalid_value(text, "integer");
+
+    return value;
 }
 
-// Throws boost::property_tree::exceptions
-Pegasus::CIMInstance ObjectFactory::makeCIMInstance(
-    const String &classname,
-    const ptree::ptree &instance)
+Pegasus::Sint64 to_signed(
+    const String &text,
+    Pegasus::Sint64 min,
+    Pegasus::Sint64 max)
+{
+    const char *str = text.c_str();
+    char *end = NULL;
+    errno = 0;
+    const Pegasus::Sint64 value = strtoll(str, &end, 10);
+    if (!*str || *end || errno || value < min || value > max)
+        throw_invalid_value(text, "integer");
+
+    return value;
+}
+
+Pegasus::Real64 to_real(const String &text)
+{
+    // XML Schema spells the special values differently from strtod().
+    if (text == "NaN")
+        return std::numeric_limits<Pegasus::Real64>::quiet_NaN();
+    else if (text == "INF")
+        return std::numeric_limits<Pegasus::Real64>::infinity();
+    else if (text == "-INF")
+        return -std::numeric_limits<Pegasus::Real64>::infinity();
+
+    const char *str = text.c_str();
+    char *end = NULL;
+    const Pegasus::Real64 value = strtod(str, &end);
+    if (!*str || *end)
+        throw_invalid_value(text, "real");
+
+    return value;
+}
+
+// Converts xs:dateTime to CIM datetime, e.g. 2015-06-30T12:00:00.5+02:00 to
+// 20150630120000.500000+120.
+String xs_datetime_to_cim(const String &text)
 {
-    Pegasus::CIMInstance peg_instance((Pegasus::CIMName(classname)));
-    bool xmlattr_skipped = false;
-    for (ptree::ptree::const_iterator it = instance.begin();
-         it != instance.end();
-         ++it)
+    int year, month, day, hour, minute, second;
+    int len = 0;
+    if (sscanf(text.c_str(), "%4d-%2d-%2dT%2d:%2d:%2d%n",
+            &year, &month, &day, &hour, &minute, &second, &len) != 6 || !len)
     {
-        if (!xmlattr_skipped && ptree_is_xmlattr(it->first)) {
-            xmlattr_skipped = true;
-            continue;
+        throw_invalid_value(text, "datetime");
+    }
+
+    const char *pos = text.c_str() + len;
+    char microseconds[] = "000000";
+    if (*pos == '.') {
+        for (int i = 0; isdigit(*++pos); ++i) {
+            if (i < 6)
+                microseconds[i] = *pos;
         }
+    }
 
-        // XXX: Can WSMAN give us EPR?
+    int offset = 0;
+    if (*pos == 'Z') {
+        ++pos;
+    } else if (*pos == '+' || *pos == '-') {
+        int offset_hours, offset_minutes;
+        if (sscanf(pos + 1, "%2d:%2d%n",
+                &offset_hours, &offset_minutes, &len) != 2)
+        {
+            throw_invalid_value(text, "datetime");
+        }
+        offset = offset_hours * 60 + offset_minutes;
+        if (*pos == '-')
+            offset = -offset;
+        pos += len + 1;
+    }
 
-        // Add property to CIMInstance.
-        String prop_name(xml_omit_namespace(it->first));
-        String prop_value(String(it->second.data()));
-        Pegasus::CIMValue peg_value;
-        Pegasus::Uint32 prop_id = peg_instance.findProperty(
-            Pegasus::CIMName(prop_name));
+    if (*pos)
+        throw_invalid_value(text, "datetime");
 
-        if (prop_id == Pegasus::PEG_NOT_FOUND) {
-            peg_value.set(prop_value);
-        } else {
-            // Property with such name has already been set; make it an array
-            // and continue pushing to it.
-            Pegasus::CIMProperty existing_property(
-                peg_instance.getProperty(prop_id));
-
-            const Pegasus::CIMValue &cpeg_value = existing_property.getValue();
-            Pegasus::Array<Pegasus::String> peg_array;
-
-            if (cpeg_value.isArray()) {
-                cpeg_value.get(peg_array);
-            } else {
-                Pegasus::String peg_str;
-                cpeg_value.get(peg_str);
-                peg_array.append(peg_str);
-            }
+    std::stringstream ss;
+    ss << std::setfill('0')
+       << std::setw(4) << year << std::setw(2) << month << std::setw(2) << day
+       << std::setw(2) << hour << std::setw(2) << minute
+       << std::setw(2) << second << '.' << microseconds
+       << (offset < 0 ? '-' : '+') << std::setw(3) << abs(offset);
+    return String(ss.str());
+}
+
+// Converts xs:duration to CIM interval, e.g. P1DT2H30M to
+// 00000001023000.000000:000. Years and months have no fixed length and are
+// rejected.
+String xs_duration_to_cim(const String &text)
+{
+    const char *pos = text.c_str();
+    if (*pos++ != 'P')
+        throw_invalid_value(text, "interval");
+
+    Pegasus::Uint64 days = 0;
+    Pegasus::Uint64 hours = 0;
+    Pegasus::Uint64 minutes = 0;
+    Pegasus::Uint64 seconds = 0;
+    char microseconds[] = "000000";
+    bool in_time = false;
+    while (*pos) {
+        if (*pos == 'T' && !in_time) {
+            in_time = true;
+            ++pos;
+            continue;
+        }
 
-            peg_array.append(prop_value);
-            peg_value.set(peg_array);
+        if (!isdigit(*pos))
+            throw_invalid_value(text, "interval");
+        char *end = NULL;
+        const Pegasus::Uint64 value = strtoull(pos, &end, 10);
+        pos = end;
 
-            peg_instance.removeProperty(prop_id);
+        if (*pos == '.' && in_time) {
+            for (int i = 0; isdigit(*++pos); ++i) {
+                if (i < 6)
+                    microseconds[i] = *pos;
+            }
+            if (*pos != 'S')
+                throw_invalid_value(text, "interval");
         }
 
-        peg_instance.addProperty(
-            Pegasus::CIMProperty(
-                Pegasus::CIMName(prop_name),
-                peg_value));
+        switch (*pos++) {
+        case 'D':
+            if (in_time)
+                throw_invalid_value(text, "interval");
+            days = value;
+            break;
+        case 'H':
+            hours = value;
+            break;
+        case 'M':
+            minutes = value;
+            break;
+        case 'S':
+            seconds = value;
+            break;
+        default:
+            throw_invalid_value(text, "interval");
+        }
+
+        if (!in_time && pos[-1] != 'D')
+            throw_invalid_value(text, "interval");
     }
 
-    return peg_instance;
+    minutes += seconds / 60;
+    hours += minutes / 60;
+    days += hours / 24;
+    if (days > 99999999)
+        throw_invalid_value(text, "interval");
+
+    std::stringstream ss;
+    ss << std::setfill('0')
+       << std::setw(8) << days << std::setw(2) << hours % 24
+       << std::setw(2) << minutes % 60 << std::setw(2) << seconds % 60
+       << '.' << microseconds << ":000";
+    return String(ss.str());
 }
 
-// Throws boost::property_tree::exceptions
-Pegasus::CIMInstance ObjectFactory::makeCIMInstanceWithPath(
-    const String &xml,
+// Converts text content of a parameter to a value of the type.
+Pegasus::CIMValue make_value(const String &text, Pegasus::CIMType type)
+{
+    // Whitespace is significant only in strings.
+    if (type == Pegasus::CIMTYPE_STRING)
+        return Pegasus::CIMValue(text.asPegasusString());
+
+    const String value(trim(text));
+    if (value.empty())
+        return Pegasus::CIMValue(type, false);
+
+    switch (type) {
+    case Pegasus::CIMTYPE_BOOLEAN:
+        if (value == "true" || value == "1")
+            return Pegasus::CIMValue(true);
+        else if (value == "false" || value == "0")
+            return Pegasus::CIMValue(false);
+        throw_invalid_value(value, "boolean");
+        break;
+    case Pegasus::CIMTYPE_UINT8:
+        return Pegasus::CIMValue(static_cast<Pegasus::Uint8>(
+            to_unsigned(value, std::numeric_limits<Pegasus::Uint8>::max())));
+    case Pegasus::CIMTYPE_SINT8:
+        return Pegasus::CIMValue(static_cast<Pegasus::Sint8>(
+            to_signed(value,
+                std::numeric_limits<Pegasus::Sint8>::min(),
+                std::numeric_limits<Pegasus::Sint8>::max())));
+    case Pegasus::CIMTYPE_UINT16:
+        return Pegasus::CIMValue(static_cast<Pegasus::Uint16>(
+            to_unsigned(value, std::numeric_limits<Pegasus::Uint16>::max())));
+    case Pegasus::CIMTYPE_SINT16:
+        return Pegasus::CIMValue(static_cast<Pegasus::Sint16>(
+            to_signed(value,
+                std::numeric_limits<Pegasus::Sint16>::min(),
+                std::numeric_limits<Pegasus::Sint16>::max())));
+    case Pegasus::CIMTYPE_UINT32:
+        return Pegasus::CIMValue(static_cast<Pegasus::Uint32>(
+            to_unsigned(value, std::numeric_limits<Pegasus::Uint32>::max())));
+    case Pegasus::CIMTYPE_SINT32:
+        return Pegasus::CIMValue(static_cast<Pegasus::Sint32>(
+            to_signed(value,
+                std::numeric_limits<Pegasus::Sint32>::min(),
+                std::numeric_limits<Pegasus::Sint32>::max())));
+    case Pegasus::CIMTYPE_UINT64:
+        return Pegasus::CIMValue(
+            to_unsigned(value, std::numeric_limits<Pegasus::Uint64>::max()));
+    case Pegasus::CIMTYPE_SINT64:
+        return Pegasus::CIMValue(
+            to_signed(value,
+                std::numeric_limits<Pegasus::Sint64>::min(),
+                std::numeric_limits<Pegasus::Sint64>::max()));
+    case Pegasus::CIMTYPE_REAL32:
+        return Pegasus::CIMValue(static_cast<Pegasus::Real32>(to_real(value)));
+    case Pegasus::CIMTYPE_REAL64:
+        return Pegasus::CIMValue(to_real(value));
+    case Pegasus::CIMTYPE_CHAR16:
+    {
+        const Pegasus::String str(value.asPegasusString());
+        if (str.size() != 1)
+            throw_invalid_value(value, "char16");
+        return Pegasus::CIMValue(str[0]);
+    }
+    case Pegasus::CIMTYPE_DATETIME:
+        return Pegasus::CIMValue(Pegasus::CIMDateTime(value.asPegasusString()));
+    default:
+        // References and embedded instances are elements, not text.
+        throw_invalid_value(value, "element");
+        break;
+    }
+
+    return Pegasus::CIMValue();
+}
+
+// Reads a value of a method parameter. Call after the start tag of the
+// parameter; consumes the end tag. The type applies to text content;
+// references, datetimes and embedded instances are recognized by their
+// elements.
+Pegasus::CIMValue read_param_value(
+    XMLReader &reader,
+    Pegasus::CIMType type,
     const String &hostname,
     const String &namespace_)
 {
-    std::stringstream ss(xml);
-    ptree::ptree pt;
+    String nil;
+    if (reader.attribute("nil", nil) && nil == "true") {
+        reader.skipElement();
+        return Pegasus::CIMValue(type, false);
+    }
 
-    // Read the XML.
-    ptree::read_xml(ss, pt);
+    String text;
+    Pegasus::CIMValue value;
+    bool got_element = false;
+    for (;;) {
+        XMLReader::Token token = reader.next();
+        if (token == XMLReader::TOKEN_TEXT) {
+            text.append(reader.text());
+            continue;
+        } else if (token != XMLReader::TOKEN_START) {
+            break;
+        }
 
-    // Walk to the class node.
-    ptree::ptree instance = ptree_walk(pt, "Item").get_child("");
-    ptree::ptree::const_iterator it = instance.begin();
-    if (ptree_is_xmlattr(it->first))
-        ++it;
-    Pegasus::CIMInstance peg_instance = makeCIMInstance(
-        xml_omit_namespace(it->first), it->second);
+        if (got_element || reader.nameEquals("Address")) {
+            // Address of an EPR is always anonymous.
+            reader.skipElement();
+            continue;
+        }
 
-    // Walk to EPR node.
-    ptree::ptree epr = ptree_walk(pt, "Item.EndpointReference");
-    peg_instance.setPath(makeCIMInstanceName(epr, hostname, namespace_));
+        got_element = true;
+        if (reader.nameEquals("ReferenceParameters")) {
+            value = Pegasus::CIMValue(
+                read_reference_parameters(reader, hostname, namespace_));
+        } else if (reader.nameEquals("EndpointReference")) {
+            value = Pegasus::CIMValue(
+                read_instance_name(reader, hostname, namespace_));
+            reader.skipElement();
+        } else if (reader.nameEquals("CIM_DateTime")) {
+            value = make_value(reader.readText(), Pegasus::CIMTYPE_DATETIME);
+        } else if (reader.nameEquals("Datetime")) {
+            value = make_value(
+                xs_datetime_to_cim(trim(reader.readText())),
+                Pegasus::CIMTYPE_DATETIME);
+        } else if (reader.nameEquals("Interval")) {
+            value = make_value(
+                xs_duration_to_cim(trim(reader.readText())),
+                Pegasus::CIMTYPE_DATETIME);
+        } else {
+            const Pegasus::CIMInstance instance(read_instance(
+                reader, PropertyFilter(Pegasus::CIMPropertyList())));
+            if (type == Pegasus::CIMTYPE_INSTANCE)
+                value = Pegasus::CIMValue(instance);
+            else
+                value = Pegasus::CIMValue(Pegasus::CIMObject(instance));
+        }
+    }
 
-    return peg_instance;
+    if (got_element)
+        return value;
+
+    return make_value(text, type);
 }
 
-// Throws boost::property_tree::exceptions
-Pegasus::CIMObjectPath ObjectFactory::makeCIMInstanceName(
-    const ptree::ptree &epr,
-    const String &hostname,
-    const String &namespace_)
+// Converts an array element to the type of the array. Returns null value,
+// if the element can't be converted.
+Pegasus::CIMValue convert_element(
+    const Pegasus::CIMValue &value,
+    Pegasus::CIMType type)
 {
-    // Walk the EPR tree to SelectorSet.
-    ptree::ptree reference_params = ptree_walk(epr, "ReferenceParameters");
-    ptree::ptree resource_uri = ptree_walk(reference_params, "ResourceURI");
-    ptree::ptree selector_set = ptree_walk(reference_params, "SelectorSet");
+    if (value.getType() == type)
+        return value;
 
-    // Get class name from ResourceURI.
-    String classname(get_class_from_resource_uri(resource_uri.data()));
+    switch (type) {
+    case Pegasus::CIMTYPE_STRING:
+        return Pegasus::CIMValue(value.toString());
+    case Pegasus::CIMTYPE_OBJECT:
+        if (value.getType() == Pegasus::CIMTYPE_INSTANCE) {
+            Pegasus::CIMInstance instance;
+            value.get(instance);
+            return Pegasus::CIMValue(Pegasus::CIMObject(instance));
+        }
+        break;
+    case Pegasus::CIMTYPE_INSTANCE:
+        if (value.getType() == Pegasus::CIMTYPE_OBJECT) {
+            Pegasus::CIMObject object;
+            value.get(object);
+            if (object.isInstance())
+                return Pegasus::CIMValue(Pegasus::CIMInstance(object));
+        }
+        break;
+    default:
+        break;
+    }
 
-    // Fill the keybindings.
-    Pegasus::Array<Pegasus::CIMKeyBinding> peg_keybindings;
-    ptree::ptree::const_iterator it;
-    for (it = selector_set.begin(); it != selector_set.end(); ++it) {
-        String name = it->second.get_child("<xmlattr>.Name").data();
-        String value = it->second.data();
+    return Pegasus::CIMValue();
+}
 
-        // XXX: Can WSMAN give us EPR?
+// Null elements and elements, which can't be converted to T, are skipped.
+template <typename T>
+Pegasus::CIMValue make_array(
+    Pegasus::CIMType type,
+    const std::vector<Pegasus::CIMValue> &values)
+{
+    Pegasus::Array<T> array;
+    array.reserveCapacity(values.size());
+
+    std::vector<Pegasus::CIMValue>::const_iterator it;
+    for (it = values.begin(); it != values.end(); ++it) {
+        if (it->isNull())
+            continue;
+
+        const Pegasus::CIMValue element(convert_element(*it, type));
+        if (element.isNull())
+            continue;
 
-        peg_keybindings.append(
-            Pegasus::CIMKeyBinding(
-                Pegasus::CIMName(name),
-                value,
-                Pegasus::CIMKeyBinding::STRING));
+        T raw_value;
+        element.get(raw_value);
+        array.append(raw_value);
     }
 
-    return Pegasus::CIMObjectPath(
-        hostname,
-        Pegasus::CIMNamespaceName(namespace_),
-        Pegasus::CIMName(classname),
-        peg_keybindings);
+    return Pegasus::CIMValue(array);
 }
 
-// Throws boost::property_tree::exceptions
+Pegasus::CIMValue make_array_value(
+    Pegasus::CIMType type,
+    const std::vector<Pegasus::CIMValue> &values)
+{
+    switch (type) {
+    case Pegasus::CIMTYPE_BOOLEAN:
+        return make_array<Pegasus::Boolean>(type, values);
+    case Pegasus::CIMTYPE_UINT8:
+        return make_array<Pegasus::Uint8>(type, values);
+    case Pegasus::CIMTYPE_SINT8:
+        return make_array<Pegasus::Sint8>(type, values);
+    case Pegasus::CIMTYPE_UINT16:
+        return make_array<Pegasus::Uint16>(type, values);
+    case Pegasus::CIMTYPE_SINT16:
+        return make_array<Pegasus::Sint16>(type, values);
+    case Pegasus::CIMTYPE_UINT32:
+        return make_array<Pegasus::Uint32>(type, values);
+    case Pegasus::CIMTYPE_SINT32:
+        return make_array<Pegasus::Sint32>(type, values);
+    case Pegasus::CIMTYPE_UINT64:
+        return make_array<Pegasus::Uint64>(type, values);
+    case Pegasus::CIMTYPE_SINT64:
+        return make_array<Pegasus::Sint64>(type, values);
+    case Pegasus::CIMTYPE_REAL32:
+        return make_array<Pegasus::Real32>(type, values);
+    case Pegasus::CIMTYPE_REAL64:
+        return make_array<Pegasus::Real64>(type, values);
+    case Pegasus::CIMTYPE_CHAR16:
+        return make_array<Pegasus::Char16>(type, values);
+    case Pegasus::CIMTYPE_STRING:
+        return make_array<Pegasus::String>(type, values);
+    case Pegasus::CIMTYPE_DATETIME:
+        return make_array<Pegasus::CIMDateTime>(type, values);
+    case Pegasus::CIMTYPE_REFERENCE:
+        return make_array<Pegasus::CIMObjectPath>(type, values);
+    case Pegasus::CIMTYPE_OBJECT:
+        return make_array<Pegasus::CIMObject>(type, values);
+    case Pegasus::CIMTYPE_INSTANCE:
+        return make_array<Pegasus::CIMInstance>(type, values);
+    }
+
+    return Pegasus::CIMValue();
+}
+
+// Elements of an output parameter with its declared type. Untyped
+// parameters are strings; repeated elements make them arrays.
+class OutParameter
+{
+public:
+    OutParameter(const String &name, const Pegasus::CIMConstMethod &method)
+        : m_name(name)
+        , m_type(Pegasus::CIMTYPE_STRING)
+        , m_is_array(false)
+        , m_values()
+    {
+        if (method.isUninitialized())
+            return;
+
+        const Pegasus::Uint32 idx = method.findParameter(Pegasus::CIMName(name));
+        if (idx == Pegasus::PEG_NOT_FOUND)
+            return;
+
+        const Pegasus::CIMConstParameter param(method.getParameter(idx));
+        m_type = param.getType();
+        m_is_array = param.isArray();
+    }
+
+    const String &getName() const { return m_name; }
+    Pegasus::CIMType getType() const { return m_type; }
+    void addValue(const Pegasus::CIMValue &value) { m_values.push_back(value); }
+
+    Pegasus::CIMValue getValue() const
+    {
+        if (!m_is_array && m_values.size() == 1)
+            return m_values[0];
+
+        // Elements may carry a more specific type than the declaration,
+        // e.g. an embedded instance of a string parameter. Elements of
+        // different types are converted to the declared type.
+        Pegasus::CIMType type = m_type;
+        bool got_element = false;
+        std::vector<Pegasus::CIMValue>::const_iterator it;
+        for (it = m_values.begin(); it != m_values.end(); ++it) {
+            if (it->isNull())
+                continue;
+
+            if (!got_element) {
+                type = it->getType();
+                got_element = true;
+            } else if (it->getType() != type) {
+                type = m_type;
+                break;
+            }
+        }
+
+        if (!got_element)
+            return Pegasus::CIMValue(m_type, true);
+        return make_array_value(type, m_values);
+    }
+
+private:
+    String m_name;
+    Pegasus::CIMType m_type;
+    bool m_is_array;
+    std::vector<Pegasus::CIMValue> m_values;
+};
+
+const char XMLNS_ADDRESSING[] = "http://schemas.xmlsoap.org/ws/2004/08/addressing";
+const char XMLNS_WSMAN[] = "http://schemas.dmtf.org/wbem/wsman/1/wsman.xsd";
+const char XMLNS_XSI[] = "http://www.w3.org/2001/XMLSchema-instance";
+const char WSA_ANONYMOUS[] =
+    "http://schemas.xmlsoap.org/ws/2004/08/addressing/role/anonymous";
+
+// Writes parameters of an Invoke request as XML text. Parameters and
+// properties of embedded instances are in the default namespace of their
+// class, so they need no prefix.
+class MethodInputWriter
+{
+public:
+    MethodInputWriter(const String &namespace_)
+        : m_namespace(namespace_)
+        , m_out()
+    {
+    }
+
+    void begin(const String &name, const String &resource_uri)
+    {
+        m_out += '<';
+        m_out += name;
+        m_out += " xmlns=\"";
+        writeEscaped(resource_uri.c_str());
+        m_out += "\" xmlns:wsa=\"";
+        m_out += XMLNS_ADDRESSING;
+        m_out += "\" xmlns:wsman=\"";
+        m_out += XMLNS_WSMAN;
+        m_out += "\" xmlns:xsi=\"";
+        m_out += XMLNS_XSI;
+        m_out += "\">";
+    }
+
+    void end(const String &name)
+    {
+        m_out += "</";
+        m_out += name;
+        m_out += '>';
+    }
+
+    void addValue(const String &name, const Pegasus::CIMValue &value)
+    {
+        if (value.isNull()) {
+            m_out += '<';
+            m_out += name;
+            m_out += " xsi:nil=\"true\"/>";
+            return;
+        }
+
+        switch (value.getType()) {
+        case Pegasus::CIMTYPE_BOOLEAN:
+            addElements<Pegasus::Boolean>(name, value);
+            break;
+        case Pegasus::CIMTYPE_UINT8:
+            addElements<Pegasus::Uint8>(name, value);
+            break;
+        case Pegasus::CIMTYPE_SINT8:
+            addElements<Pegasus::Sint8>(name, value);
+            break;
+        case Pegasus::CIMTYPE_UINT16:
+            addElements<Pegasus::Uint16>(name, value);
+            break;
+        case Pegasus::CIMTYPE_SINT16:
+            addElements<Pegasus::Sint16>(name, value);
+            break;
+        case Pegasus::CIMTYPE_UINT32:
+            addElements<Pegasus::Uint32>(name, value);
+            break;
+        case Pegasus::CIMTYPE_SINT32:
+            addElements<Pegasus::Sint32>(name, value);
+            break;
+        case Pegasus::CIMTYPE_UINT64:
+            addElements<Pegasus::Uint64>(name, value);
+            break;
+        case Pegasus::CIMTYPE_SINT64:
+            addElements<Pegasus::Sint64>(name, value);
+            break;
+        case Pegasus::CIMTYPE_REAL32:
+            addElements<Pegasus::Real32>(name, value);
+            break;
+        case Pegasus::CIMTYPE_REAL64:
+            addElements<Pegasus::Real64>(name, value);
+            break;
+        case Pegasus::CIMTYPE_CHAR16:
+            addElements<Pegasus::Char16>(name, value);
+            break;
+        case Pegasus::CIMTYPE_STRING:
+            addElements<Pegasus::String>(name, value);
+            break;
+        case Pegasus::CIMTYPE_DATETIME:
+            addElements<Pegasus::CIMDateTime>(name, value);
+            break;
+        case Pegasus::CIMTYPE_REFERENCE:
+            addElements<Pegasus::CIMObjectPath>(name, value);
+            break;
+        case Pegasus::CIMTYPE_OBJECT:
+            addElements<Pegasus::CIMObject>(name, value);
+            break;
+        case Pegasus::CIMTYPE_INSTANCE:
+            addElements<Pegasus::CIMInstance>(name, value);
+            break;
+        }
+    }
+
+    const std::string &str() const { return m_out; }
+
+private:
+    template <typename T>
+    void addElements(const String &name, const Pegasus::CIMValue &value)
+    {
+        if (!value.isArray()) {
+            T raw_value;
+            value.get(raw_value);
+            addElement(name, raw_value);
+            return;
+        }
+
+        // Arrays are repeated elements.
+        Pegasus::Array<T> array;
+        value.get(array);
+        const Pegasus::Uint32 cnt = array.size();
+        for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+            addElement(name, array[i]);
+    }
+
+    template <typename T>
+    void addElement(const String &name, const T &value)
+    {
+        m_out += '<';
+        m_out += name;
+        m_out += '>';
+        writeContent(value);
+        m_out += "</";
+        m_out += name;
+        m_out += '>';
+    }
+
+    // Integers
+    template <typename T>
+    void writeContent(const T &value)
+    {
+        if (!std::numeric_limits<T>::is_signed || value >= 0) {
+            writeUnsigned(static_cast<Pegasus::Uint64>(value));
+            return;
+        }
+
+        m_out += '-';
+        writeUnsigned(-static_cast<Pegasus::Uint64>(value));
+    }
+
+    void writeContent(const Pegasus::Boolean &value)
+    {
+        m_out += value ? "true" : "false";
+    }
+
+    void writeContent(const Pegasus::Real32 &value)
+    {
+        writeReal(value, std::numeric_limits<Pegasus::Real32>::digits10 + 3);
+    }
+
+    void writeContent(const Pegasus::Real64 &value)
+    {
+        writeReal(value, std::numeric_limits<Pegasus::Real64>::digits10 + 2);
+    }
+
+    void writeContent(const Pegasus::Char16 &value)
+    {
+        writeContent(Pegasus::String(&value, 1));
+    }
+
+    void writeContent(const Pegasus::String &value)
+    {
+        writeEscaped(value.getCString());
+    }
+
+    void writeContent(const Pegasus::CIMDateTime &value)
+    {
+        // CIM format as text; openwsman providers don't parse cim:Datetime.
+        writeContent(value.toString());
+    }
+
+    void writeContent(const Pegasus::CIMObjectPath &value)
+    {
+        String ns(value.getNameSpace().getString());
+        if (ns.empty())
+            ns = m_namespace;
+        const Request request(
+            String(),
+            ns,
+            String(value.getClassName().getString()));
+
+        m_out += "<wsa:Address>";
+        m_out += WSA_ANONYMOUS;
+        m_out += "</wsa:Address><wsa:ReferenceParameters><wsman:ResourceURI>";
+        writeEscaped(request.asString().c_str());
+        m_out += "</wsman:ResourceURI><wsman:SelectorSet>";
+
+        const Pegasus::Array<Pegasus::CIMKeyBinding> &keybindings =
+            value.getKeyBindings();
+        const Pegasus::Uint32 cnt = keybindings.size();
+        for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+            m_out += "<wsman:Selector Name=\"";
+            writeContent(keybindings[i].getName().getString());
+            m_out += "\">";
+            writeContent(keybindings[i].getValue());
+            m_out += "</wsman:Selector>";
+        }
+
+        m_out += "</wsman:SelectorSet></wsa:ReferenceParameters>";
+    }
+
+    void writeContent(const Pegasus::CIMObject &value)
+    {
+        if (!value.isInstance())
+            throw NotSupportedException("Class parameters not supported");
+
+        writeContent(Pegasus::CIMInstance(value));
+    }
+
+    void writeContent(const Pegasus::CIMInstance &value)
+    {
+        const String classname(value.getClassName().getString());
+        const Request request(String(), m_namespace, classname);
+
+        m_out += '<';
+        m_out += classname;
+        m_out += " xmlns=\"";
+        writeEscaped(request.asString().c_str());
+        m_out += "\">";
+
+        const Pegasus::Uint32 cnt = value.getPropertyCount();
+        for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+            const Pegasus::CIMConstProperty property(value.getProperty(i));
+            addValue(
+                String(property.getName().getString()),
+                property.getValue());
+        }
+
+        end(classname);
+    }
+
+    void writeUnsigned(Pegasus::Uint64 value)
+    {
+        char digits[24];
+        char *pos = digits + sizeof(digits);
+        do {
+            *--pos = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value);
+
+        m_out.append(pos, digits + sizeof(digits) - pos);
+    }
+
+    void writeReal(Pegasus::Real64 value, int precision)
+    {
+        // XML Schema spelling of the special values
+        if (value != value) {
+            m_out += "NaN";
+        } else if (value == std::numeric_limits<Pegasus::Real64>::infinity()) {
+            m_out += "INF";
+        } else if (value == -std::numeric_limits<Pegasus::Real64>::infinity()) {
+            m_out += "-INF";
+        } else {
+            char real[32];
+            snprintf(real, sizeof(real), "%.*g", precision, value);
+            m_out += real;
+        }
+    }
+
+    void writeEscaped(const char *text)
+    {
+        for (const char *pos = text; *pos; ++pos) {
+            switch (*pos) {
+            case '&':
+                m_out += "&amp;";
+                break;
+            case '<':
+                m_out += "&lt;";
+                break;
+            case '>':
+                m_out += "&gt;";
+                break;
+            case '"':
+                m_out += "&quot;";
+                break;
+            default:
+                m_out += *pos;
+            }
+        }
+    }
+
+    String m_namespace;
+    std::string m_out;
+};
+
+} // unnamed namespace
+
+// Throws WsmanException
+Pegasus::CIMInstance ObjectFactory::makeCIMInstance(
+    const std::string &xml,
+    const Pegasus::CIMPropertyList &property_list)
+{
+    XMLReader reader(xml);
+
+    // Walk to CIM Instance.
+    enter_first_child(reader, "instance");
+
+    return read_instance(reader, PropertyFilter(property_list));
+}
+
+// Throws WsmanException
+Pegasus::CIMInstance ObjectFactory::makeCIMInstanceWithPath(
+    const std::string &xml,
+    const String &hostname,
+    const String &namespace_,
+    const Pegasus::CIMPropertyList &property_list)
+{
+    XMLReader reader(xml);
+    if (!reader.findChild("Item"))
+        throw_no_such_node("Item");
+
+    // Instance is the first child of Item, EPR follows.
+    enter_first_child(reader, "Item");
+    Pegasus::CIMInstance peg_instance(read_instance(
+        reader, PropertyFilter(property_list)));
+
+    if (!reader.findChild("EndpointReference"))
+        throw_no_such_node("EndpointReference");
+    peg_instance.setPath(read_instance_name(reader, hostname, namespace_));
+
+    return peg_instance;
+}
+
+// Throws WsmanException
+Pegasus::CIMInstance ObjectFactory::makeCIMInstanceFromFragment(
+    const std::string &xml,
+    const Pegasus::CIMName &classname)
+{
+    XMLReader reader(xml);
+    if (!reader.findChild("XmlFragment"))
+        throw_no_such_node("XmlFragment");
+
+    Pegasus::CIMInstance peg_instance(classname);
+    read_properties(
+        reader,
+        peg_instance,
+        PropertyFilter(Pegasus::CIMPropertyList()));
+
+    return peg_instance;
+}
+
+// Throws WsmanException
 Pegasus::CIMObjectPath ObjectFactory::makeCIMInstanceName(
-    const String &xml,
+    const std::string &xml,
     const String &hostname,
     const String &namespace_)
 {
-    std::stringstream ss(xml);
-
-    // Read the XML.
-    ptree::ptree pt;
-    ptree::read_xml(ss, pt);
+    XMLReader reader(xml);
 
     // Walk the XML tree to EndpointReference.
-    ptree::ptree epr = ptree_walk(pt, "EndpointReference");
+    if (!reader.findChild("EndpointReference"))
+        throw_no_such_node("EndpointReference");
 
-    return makeCIMInstanceName(epr, hostname, namespace_);
+    return read_instance_name(reader, hostname, namespace_);
 }
 
-// Throws boost::property_tree::exceptions
+// Throws WsmanException
 Pegasus::CIMValue ObjectFactory::makeMethodReturnValue(
-    const String &xml,
+    const std::string &xml,
     const String &method_name,
+    const String &hostname,
+    const String &namespace_,
+    const Pegasus::CIMConstMethod &method,
     Pegasus::Array<Pegasus::CIMParamValue> &out_parameters)
 {
-    std::stringstream ss(xml);
-
-    // Read the XML.
-    ptree::ptree pt;
-    ptree::read_xml(ss, pt);
+    XMLReader reader(xml);
 
     // Walk to method_name_OUTPUT
-    ptree::ptree method = ptree_walk(
-        pt,
-        method_name + String("_OUTPUT"));
+    const String output(method_name + String("_OUTPUT"));
+    if (!reader.findChild(output))
+        throw_no_such_node(output.c_str());
+
+    const Pegasus::CIMType return_type = method.isUninitialized() ?
+        Pegasus::CIMTYPE_STRING : method.getType();
+    Pegasus::CIMValue return_value(
+        method.isUninitialized() ?
+            Pegasus::CIMValue(Pegasus::String()) :
+            Pegasus::CIMValue(return_type, false));
 
-    bool got_xmlattr = false;
     bool got_return_value = false;
-    String return_value;
-    ptree::ptree::const_iterator it;
-    for (it = method.begin(); it != method.end(); ++it) {
-        if (!got_xmlattr && ptree_is_xmlattr(it->first)) {
-            got_xmlattr = true;
+    std::vector<OutParameter> params;
+    for (;;) {
+        XMLReader::Token token = reader.next();
+        if (token == XMLReader::TOKEN_TEXT) {
             continue;
-        } else if (!got_return_value && ptree_node_name_equals(it->first, "ReturnValue")) {
+        } else if (token != XMLReader::TOKEN_START) {
+            break;
+        }
+
+        if (!got_return_value && reader.nameEquals("ReturnValue")) {
             got_return_value = true;
-            return_value = it->second.data();
-        } else {
-            out_parameters.append(
-                Pegasus::CIMParamValue(
-                    String(it->first),
-                    Pegasus::CIMValue(
-                        String(it->second.data()))));
+            return_value = read_param_value(
+                reader, return_type, hostname, namespace_);
+            continue;
         }
-    }
 
-    return Pegasus::CIMValue(return_value);
-}
+        // Array elements are usually adjacent; look from the back.
+        std::vector<OutParameter>::reverse_iterator it;
+        for (it = params.rbegin(); it != params.rend(); ++it) {
+            if (reader.nameEquals(it->getName()))
+                break;
+        }
+        if (it == params.rend()) {
+            params.push_back(OutParameter(reader.name(), method));
+            it = params.rbegin();
+        }
 
-#ifdef DEBUG
-#  include <iostream>
-#  include <fstream>
-#  include <sstream>
+        it->addValue(read_param_value(
+            reader, it->getType(), hostname, namespace_));
+    }
 
-Pegasus::CIMInstance readCIMInstance(const String &filename)
-{
-    std::ifstream fin(filename.c_str());
-    std::stringstream ss;
-    ss << fin.rdbuf();
+    std::vector<OutParameter>::const_iterator it;
+    for (it = params.begin(); it != params.end(); ++it) {
+        out_parameters.append(
+            Pegasus::CIMParamValue(it->getName(), it->getValue()));
+    }
 
-    return Pegasus::CIMInstance(
-        ObjectFactory::makeCIMInstanceWithPath(
-            ss.str(),
-            "hostname",
-            "root/cimv2"));
+    return return_value;
 }
 
-void printCIMInstance(const Pegasus::CIMInstance &instance)
+// Throws NotSupportedException
+std::string ObjectFactory::makeMethodInput(
+    const String &resource_uri,
+    const String &method_name,
+    const String &namespace_,
+    const Pegasus::Array<Pegasus::CIMParamValue> &in_parameters)
 {
-    std::cout << instance.getClassName().getString() << ':' << std::endl;
-
-    for (Pegasus::Uint32 i = 0; i < instance.getPropertyCount(); ++i) {
-        const Pegasus::CIMConstProperty &p = instance.getProperty(i);
-        std::cout << "    " << p.getName().getString() << " : ";
-        if (p.isArray()) {
-            Pegasus::Array<Pegasus::String> arr;
-            p.getValue().get(arr);
-            for (Pegasus::Uint32 j = 0; j < arr.size(); ++j)
-                std::cout << arr[j] << ' ';
-            std::cout << std::endl;
-        } else {
-            Pegasus::String v;
-            p.getValue().get(v);
-            std::cout << v << std::endl;
-        }
-    }
-}
+    const String input(method_name + String("_INPUT"));
 
+    MethodInputWriter writer(namespace_);
+    writer.begin(input, resource_uri);
 
-int main(int argc, char **argv)
-{
-    if (argc < 2) {
-        std::cerr << "XML file missing!" << std::endl;
-        return 1;
+    const Pegasus::Uint32 cnt = in_parameters.size();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+        const Pegasus::CIMParamValue &param = in_parameters[i];
+        writer.addValue(
+            String(param.getParameterName()),
+            param.getValue());
     }
 
-    printCIMInstance(
-        readCIMInstance(argv[1]));
-
-    return 0;
+    writer.end(input);
+    return writer.str();
 }
-
-#endif // DEBUG
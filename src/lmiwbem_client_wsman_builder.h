@@ -22,50 +22,69 @@
 #ifndef   LMIWBEM_CLIENT_WSMAN_BUILDER_H
 #  define LMIWBEM_CLIENT_WSMAN_BUILDER_H
 
-#  include <boost/property_tree/ptree.hpp>
+#  include <string>
 #  include <Pegasus/Common/Array.h>
+#  include <Pegasus/Common/CIMPropertyList.h>
 #  include "lmiwbem.h"
 #  include "util/lmiwbem_string.h"
 
 PEGASUS_BEGIN
+class CIMConstMethod;
 class CIMInstance;
+class CIMName;
 class CIMParamValue;
 class CIMObjectPath;
 class CIMValue;
 PEGASUS_END
 
-namespace ptree = boost::property_tree;
-
 class String;
 
+// Properties missing in a non-null property list are skipped while decoding
+// and never materialized.
 class ObjectFactory
 {
 public:
     static Pegasus::CIMInstance makeCIMInstance(
-        const String &classname,
-        const ptree::ptree &instance);
-    static Pegasus::CIMInstance makeCIMInstance(
-        const String &xml);
+        const std::string &xml,
+        const Pegasus::CIMPropertyList &property_list = Pegasus::CIMPropertyList());
 
     static Pegasus::CIMInstance makeCIMInstanceWithPath(
-        const String &xml,
+        const std::string &xml,
         const String &hostname,
-        const String &namespace_);
+        const String &namespace_,
+        const Pegasus::CIMPropertyList &property_list = Pegasus::CIMPropertyList());
+
+    // Builds an instance from wsman:XmlFragment of a fragment-level Get.
+    static Pegasus::CIMInstance makeCIMInstanceFromFragment(
+        const std::string &xml,
+        const Pegasus::CIMName &classname);
 
     static Pegasus::CIMObjectPath makeCIMInstanceName(
-        const String &xml,
-        const String &hostname,
-        const String &namespace_);
-    static Pegasus::CIMObjectPath makeCIMInstanceName(
-        const ptree::ptree &epr,
+        const std::string &xml,
         const String &hostname,
         const String &namespace_);
 
+    // Return value and output parameters are typed by the method's
+    // declaration. With an uninitialized declaration, they are strings,
+    // unless their content is a reference, datetime or embedded instance.
+    // Repeated elements form arrays.
     static Pegasus::CIMValue makeMethodReturnValue(
-        const String &xml,
+        const std::string &xml,
         const String &method_name,
+        const String &hostname,
+        const String &namespace_,
+        const Pegasus::CIMConstMethod &method,
         Pegasus::Array<Pegasus::CIMParamValue> &out_parameters);
 
+    // Builds the method_INPUT element of an Invoke request. Parameters are
+    // encoded by their value types: arrays as repeated elements, references
+    // as EPRs and embedded instances as child elements.
+    static std::string makeMethodInput(
+        const String &resource_uri,
+        const String &method_name,
+        const String &namespace_,
+        const Pegasus::Array<Pegasus::CIMParamValue> &in_parameters);
+
 private:
     ObjectFactory();
     ObjectFactory(const ObjectFactory &copy);
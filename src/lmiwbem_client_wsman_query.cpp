@@ -0,0 +1,1036 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#include <config.h>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <Pegasus/Common/CIMInstance.h>
+#include <Pegasus/Common/CIMProperty.h>
+#include <Pegasus/Common/CIMValue.h>
+#include "lmiwbem_client_wsman_query.h"
+
+struct QueryOperand
+{
+    enum Kind {
+        OPERAND_PROPERTY,
+        OPERAND_STRING,
+        OPERAND_NUMBER,
+        OPERAND_BOOLEAN,
+        OPERAND_NULL
+    };
+
+    QueryOperand()
+        : m_kind(OPERAND_NULL)
+        , m_text()
+        , m_value()
+    {
+    }
+
+    bool isLiteral() const
+    {
+        return m_kind != OPERAND_PROPERTY && m_kind != OPERAND_NULL;
+    }
+
+    Kind m_kind;
+    // Spelling in the query; property name without class qualifier.
+    String m_text;
+    // Unquoted value of a literal.
+    String m_value;
+};
+
+struct QueryNode
+{
+    enum Type {
+        NODE_AND,
+        NODE_OR,
+        NODE_NOT,
+        NODE_COMPARE,
+        NODE_IS_NULL,
+        NODE_LIKE
+    };
+
+    enum Operator {
+        OP_EQ,
+        OP_NE,
+        OP_LT,
+        OP_LE,
+        OP_GT,
+        OP_GE
+    };
+
+    QueryNode(Type type)
+        : m_type(type)
+        , m_op(OP_EQ)
+        , m_negated(false)
+        , m_lhs()
+        , m_rhs()
+        , m_left()
+        , m_right()
+    {
+    }
+
+    Type m_type;
+    Operator m_op;
+    // IS NOT NULL, NOT LIKE
+    bool m_negated;
+    QueryOperand m_lhs;
+    QueryOperand m_rhs;
+    QueryNodePtr m_left;
+    QueryNodePtr m_right;
+};
+
+namespace {
+
+struct QueryError
+{
+    QueryError(const String &message)
+        : m_message(message)
+    {
+    }
+
+    String m_message;
+};
+
+struct QueryToken
+{
+    enum Type {
+        TOKEN_END,
+        TOKEN_IDENT,
+        TOKEN_STRING,
+        TOKEN_NUMBER,
+        TOKEN_OPERATOR,
+        TOKEN_PUNCT
+    };
+
+    Type m_type;
+    String m_text;
+    String m_value;
+};
+
+bool equals_nocase(const String &lhs, const char *rhs)
+{
+    return strcasecmp(lhs.c_str(), rhs) == 0;
+}
+
+bool contains_nocase(const std::vector<String> &names, const String &name)
+{
+    std::vector<String>::const_iterator it;
+    for (it = names.begin(); it != names.end(); ++it) {
+        if (strcasecmp(it->c_str(), name.c_str()) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+std::vector<QueryToken> tokenize(const String &query)
+{
+    std::vector<QueryToken> tokens;
+    const char *pos = query.c_str();
+    for (;;) {
+        while (isspace(static_cast<unsigned char>(*pos)))
+            ++pos;
+
+        QueryToken token;
+        const char *begin = pos;
+        if (!*pos) {
+            token.m_type = QueryToken::TOKEN_END;
+            tokens.push_back(token);
+            return tokens;
+        } else if (isalpha(static_cast<unsigned char>(*pos)) || *pos == '_') {
+            token.m_type = QueryToken::TOKEN_IDENT;
+            while (isalnum(static_cast<unsigned char>(*pos)) || *pos == '_')
+                ++pos;
+        } else if (isdigit(static_cast<unsigned char>(*pos)) ||
+            (*pos == '.' && isdigit(static_cast<unsigned char>(pos[1]))))
+        {
+            token.m_type = QueryToken::TOKEN_NUMBER;
+            while (isdigit(static_cast<unsigned char>(*pos)))
+                ++pos;
+            if (*pos == '.') {
+                ++pos;
+                while (isdigit(static_cast<unsigned char>(*pos)))
+                    ++pos;
+            }
+            if (*pos == 'e' || *pos == 'E') {
+                const char *exp = pos + 1;
+                if (*exp == '+' || *exp == '-')
+                    ++exp;
+                if (isdigit(static_cast<unsigned char>(*exp))) {
+                    pos = exp;
+                    while (isdigit(static_cast<unsigned char>(*pos)))
+                        ++pos;
+                }
+            }
+        } else if (*pos == '\'' || *pos == '"') {
+            // Both backslash escapes and doubled quotes are understood.
+            token.m_type = QueryToken::TOKEN_STRING;
+            const char quote = *pos++;
+            for (;;) {
+                if (!*pos) {
+                    throw QueryError("Unterminated string literal");
+                } else if (*pos == '\\' && pos[1]) {
+                    token.m_value.push_back(pos[1]);
+                    pos += 2;
+                } else if (*pos == quote && pos[1] == quote) {
+                    token.m_value.push_back(quote);
+                    pos += 2;
+                } else if (*pos == quote) {
+                    ++pos;
+                    break;
+                } else {
+                    token.m_value.push_back(*pos++);
+                }
+            }
+        } else if (*pos == '<' || *pos == '>' || *pos == '=' || *pos == '!') {
+            token.m_type = QueryToken::TOKEN_OPERATOR;
+            ++pos;
+            if (*pos == '=' || (*begin == '<' && *pos == '>'))
+                ++pos;
+            if (pos - begin == 1 && *begin == '!')
+                throw QueryError("Invalid operator '!'");
+        } else if (strchr("(),*.-", *pos)) {
+            token.m_type = QueryToken::TOKEN_PUNCT;
+            ++pos;
+        } else {
+            std::stringstream ss;
+            ss << "Unexpected character '" << *pos << "'";
+            throw QueryError(ss.str());
+        }
+
+        token.m_text = String(std::string(begin, pos));
+        if (token.m_type != QueryToken::TOKEN_STRING)
+            token.m_value = token.m_text;
+        tokens.push_back(token);
+    }
+}
+
+// Recursive descent parser of the supported subset of WQL and CQL.
+class QueryParser
+{
+public:
+    QueryParser(const String &language, const String &query)
+        : m_is_wql(language == "WQL")
+        , m_tokens(tokenize(query))
+        , m_pos(0)
+        , m_qualifiers()
+        , m_classname()
+        , m_select_all(false)
+        , m_properties()
+        , m_condition()
+    {
+    }
+
+    void parse()
+    {
+        expectKeyword("SELECT");
+        if (acceptPunct('*')) {
+            m_select_all = true;
+        } else {
+            do {
+                m_properties.push_back(parseProperty());
+            } while (acceptPunct(','));
+        }
+
+        expectKeyword("FROM");
+        m_classname = expect(QueryToken::TOKEN_IDENT).m_text;
+
+        // Qualifiers seen before FROM can be checked only now.
+        std::vector<String>::const_iterator it;
+        for (it = m_qualifiers.begin(); it != m_qualifiers.end(); ++it) {
+            if (strcasecmp(it->c_str(), m_classname.c_str()) != 0)
+                throw QueryError("Only one class can be queried");
+        }
+
+        if (acceptKeyword("WHERE"))
+            m_condition = parseOr();
+
+        if (current().m_type != QueryToken::TOKEN_END)
+            unexpected();
+    }
+
+    String getClassname() const { return m_classname; }
+    bool isSelectAll() const { return m_select_all; }
+    const std::vector<String> &getProperties() const { return m_properties; }
+    QueryNodePtr getCondition() const { return m_condition; }
+
+private:
+    const QueryToken &current() const
+    {
+        return m_tokens[m_pos];
+    }
+
+    bool isKeyword(const char *keyword) const
+    {
+        return current().m_type == QueryToken::TOKEN_IDENT &&
+            equals_nocase(current().m_text, keyword);
+    }
+
+    bool acceptKeyword(const char *keyword)
+    {
+        if (!isKeyword(keyword))
+            return false;
+        ++m_pos;
+        return true;
+    }
+
+    void expectKeyword(const char *keyword)
+    {
+        if (!acceptKeyword(keyword)) {
+            std::stringstream ss;
+            ss << "Expected " << keyword;
+            throw QueryError(ss.str());
+        }
+    }
+
+    bool acceptPunct(char punct)
+    {
+        const QueryToken &token = current();
+        if (token.m_type != QueryToken::TOKEN_PUNCT || token.m_text[0] != punct)
+            return false;
+        ++m_pos;
+        return true;
+    }
+
+    const QueryToken &expect(QueryToken::Type type)
+    {
+        if (current().m_type != type)
+            unexpected();
+        return m_tokens[m_pos++];
+    }
+
+    void unexpected() const
+    {
+        std::stringstream ss;
+        if (current().m_type == QueryToken::TOKEN_END)
+            ss << "Unexpected end of query";
+        else
+            ss << "Unexpected '" << current().m_text << "'";
+        throw QueryError(ss.str());
+    }
+
+    bool isReserved() const
+    {
+        static const char *reserved[] = {
+            "SELECT", "FROM", "WHERE", "AND", "OR", "NOT", "IS", "LIKE",
+            "NULL", "TRUE", "FALSE", NULL
+        };
+
+        for (const char **word = reserved; *word; ++word) {
+            if (isKeyword(*word))
+                return true;
+        }
+
+        return false;
+    }
+
+    String parseProperty()
+    {
+        if (isReserved())
+            unexpected();
+
+        String name(expect(QueryToken::TOKEN_IDENT).m_text);
+        if (acceptPunct('.')) {
+            m_qualifiers.push_back(name);
+            if (isReserved())
+                unexpected();
+            name = expect(QueryToken::TOKEN_IDENT).m_text;
+        }
+
+        return name;
+    }
+
+    QueryNodePtr makeNode(
+        QueryNode::Type type,
+        const QueryNodePtr &left,
+        const QueryNodePtr &right = QueryNodePtr())
+    {
+        QueryNodePtr node(new QueryNode(type));
+        node->m_left = left;
+        node->m_right = right;
+        return node;
+    }
+
+    QueryNodePtr parseOr()
+    {
+        QueryNodePtr node(parseAnd());
+        while (acceptKeyword("OR"))
+            node = makeNode(QueryNode::NODE_OR, node, parseAnd());
+        return node;
+    }
+
+    QueryNodePtr parseAnd()
+    {
+        QueryNodePtr node(parseNot());
+        while (acceptKeyword("AND"))
+            node = makeNode(QueryNode::NODE_AND, node, parseNot());
+        return node;
+    }
+
+    QueryNodePtr parseNot()
+    {
+        if (acceptKeyword("NOT"))
+            return makeNode(QueryNode::NODE_NOT, parseNot());
+        return parsePredicate();
+    }
+
+    QueryOperand parseOperand()
+    {
+        QueryOperand operand;
+        const QueryToken &token = current();
+        if (token.m_type == QueryToken::TOKEN_STRING) {
+            operand.m_kind = QueryOperand::OPERAND_STRING;
+        } else if (token.m_type == QueryToken::TOKEN_NUMBER) {
+            operand.m_kind = QueryOperand::OPERAND_NUMBER;
+        } else if (acceptPunct('-')) {
+            const QueryToken &number = expect(QueryToken::TOKEN_NUMBER);
+            operand.m_kind = QueryOperand::OPERAND_NUMBER;
+            operand.m_text = String("-") + number.m_text;
+            operand.m_value = operand.m_text;
+            return operand;
+        } else if (isKeyword("TRUE") || isKeyword("FALSE")) {
+            operand.m_kind = QueryOperand::OPERAND_BOOLEAN;
+        } else if (isKeyword("NULL")) {
+            operand.m_kind = QueryOperand::OPERAND_NULL;
+        } else {
+            operand.m_kind = QueryOperand::OPERAND_PROPERTY;
+            operand.m_text = parseProperty();
+            operand.m_value = operand.m_text;
+            return operand;
+        }
+
+        operand.m_text = token.m_text;
+        operand.m_value = token.m_value;
+        ++m_pos;
+        return operand;
+    }
+
+    QueryNodePtr parsePredicate()
+    {
+        if (acceptPunct('(')) {
+            QueryNodePtr node(parseOr());
+            if (!acceptPunct(')'))
+                unexpected();
+            return node;
+        }
+
+        QueryOperand lhs(parseOperand());
+
+        if (acceptKeyword("IS")) {
+            QueryNodePtr node(new QueryNode(QueryNode::NODE_IS_NULL));
+            node->m_negated = acceptKeyword("NOT");
+            expectKeyword("NULL");
+            node->m_lhs = lhs;
+            return node;
+        }
+
+        const bool negated = acceptKeyword("NOT");
+        if (negated || isKeyword("LIKE")) {
+            expectKeyword("LIKE");
+            if (!m_is_wql)
+                throw QueryError("LIKE is supported only in WQL");
+
+            QueryNodePtr node(new QueryNode(QueryNode::NODE_LIKE));
+            node->m_negated = negated;
+            node->m_lhs = lhs;
+            node->m_rhs.m_kind = QueryOperand::OPERAND_STRING;
+            node->m_rhs.m_text = current().m_text;
+            node->m_rhs.m_value = expect(QueryToken::TOKEN_STRING).m_value;
+            return node;
+        }
+
+        const String op(expect(QueryToken::TOKEN_OPERATOR).m_text);
+        QueryNodePtr node(new QueryNode(QueryNode::NODE_COMPARE));
+        if (op == "=")
+            node->m_op = QueryNode::OP_EQ;
+        else if (op == "<>" || op == "!=")
+            node->m_op = QueryNode::OP_NE;
+        else if (op == "<")
+            node->m_op = QueryNode::OP_LT;
+        else if (op == "<=")
+            node->m_op = QueryNode::OP_LE;
+        else if (op == ">")
+            node->m_op = QueryNode::OP_GT;
+        else
+            node->m_op = QueryNode::OP_GE;
+        node->m_lhs = lhs;
+        node->m_rhs = parseOperand();
+
+        // WQL allows "prop = NULL" for "prop IS NULL".
+        const bool lhs_null = node->m_lhs.m_kind == QueryOperand::OPERAND_NULL;
+        const bool rhs_null = node->m_rhs.m_kind == QueryOperand::OPERAND_NULL;
+        if (lhs_null || rhs_null) {
+            if (lhs_null == rhs_null ||
+                (node->m_op != QueryNode::OP_EQ && node->m_op != QueryNode::OP_NE))
+            {
+                throw QueryError("NULL can be compared only for equality");
+            }
+
+            node->m_type = QueryNode::NODE_IS_NULL;
+            node->m_negated = node->m_op == QueryNode::OP_NE;
+            if (lhs_null)
+                node->m_lhs = node->m_rhs;
+        }
+
+        return node;
+    }
+
+    bool m_is_wql;
+    std::vector<QueryToken> m_tokens;
+    size_t m_pos;
+    std::vector<String> m_qualifiers;
+
+    String m_classname;
+    bool m_select_all;
+    std::vector<String> m_properties;
+    QueryNodePtr m_condition;
+};
+
+void split_conjunction(const QueryNodePtr &node, std::vector<QueryNodePtr> &terms)
+{
+    if (node->m_type == QueryNode::NODE_AND) {
+        split_conjunction(node->m_left, terms);
+        split_conjunction(node->m_right, terms);
+    } else {
+        terms.push_back(node);
+    }
+}
+
+// Whether the server can evaluate the term. Only comparisons of a property
+// with a literal are handed over; they are understood by all the WQL and CQL
+// implementations of WS-Management servers.
+bool is_server_side(const QueryNodePtr &node)
+{
+    switch (node->m_type) {
+    case QueryNode::NODE_AND:
+    case QueryNode::NODE_OR:
+        return is_server_side(node->m_left) && is_server_side(node->m_right);
+    case QueryNode::NODE_NOT:
+        return is_server_side(node->m_left);
+    case QueryNode::NODE_COMPARE:
+        return (node->m_lhs.m_kind == QueryOperand::OPERAND_PROPERTY &&
+                node->m_rhs.isLiteral()) ||
+            (node->m_lhs.isLiteral() &&
+                node->m_rhs.m_kind == QueryOperand::OPERAND_PROPERTY);
+    case QueryNode::NODE_IS_NULL:
+        return node->m_lhs.m_kind == QueryOperand::OPERAND_PROPERTY;
+    default:
+        return false;
+    }
+}
+
+void render(const QueryNodePtr &node, std::stringstream &ss)
+{
+    static const char *operators[] = { "=", "<>", "<", "<=", ">", ">=" };
+
+    switch (node->m_type) {
+    case QueryNode::NODE_AND:
+    case QueryNode::NODE_OR:
+        ss << '(';
+        render(node->m_left, ss);
+        ss << (node->m_type == QueryNode::NODE_AND ? " AND " : " OR ");
+        render(node->m_right, ss);
+        ss << ')';
+        break;
+    case QueryNode::NODE_NOT:
+        ss << "NOT (";
+        render(node->m_left, ss);
+        ss << ')';
+        break;
+    case QueryNode::NODE_COMPARE:
+        ss << node->m_lhs.m_text << ' ' << operators[node->m_op] << ' '
+           << node->m_rhs.m_text;
+        break;
+    case QueryNode::NODE_IS_NULL:
+        ss << node->m_lhs.m_text
+           << (node->m_negated ? " IS NOT NULL" : " IS NULL");
+        break;
+    case QueryNode::NODE_LIKE:
+        ss << node->m_lhs.m_text << (node->m_negated ? " NOT LIKE " : " LIKE ")
+           << node->m_rhs.m_text;
+        break;
+    }
+}
+
+void collect_properties(const QueryNodePtr &node, std::vector<String> &names)
+{
+    if (node->m_left)
+        collect_properties(node->m_left, names);
+    if (node->m_right)
+        collect_properties(node->m_right, names);
+
+    const QueryOperand *operands[] = { &node->m_lhs, &node->m_rhs };
+    for (size_t i = 0; i < 2; ++i) {
+        if (operands[i]->m_kind == QueryOperand::OPERAND_PROPERTY &&
+            !contains_nocase(names, operands[i]->m_text))
+        {
+            names.push_back(operands[i]->m_text);
+        }
+    }
+}
+
+// Value of an operand for the given instance. Property values decoded from
+// WS-Management responses are strings, so literals are compared with them
+// according to the literal type.
+struct Scalar
+{
+    enum Kind {
+        SCALAR_NULL,
+        SCALAR_ARRAY,
+        SCALAR_STRING,
+        SCALAR_NUMBER,
+        SCALAR_BOOLEAN
+    };
+
+    Kind m_kind;
+    String m_value;
+};
+
+Scalar evaluate_operand(
+    const QueryOperand &operand,
+    const Pegasus::CIMInstance &instance)
+{
+    Scalar scalar;
+    scalar.m_value = operand.m_value;
+    switch (operand.m_kind) {
+    case QueryOperand::OPERAND_STRING:
+        scalar.m_kind = Scalar::SCALAR_STRING;
+        return scalar;
+    case QueryOperand::OPERAND_NUMBER:
+        scalar.m_kind = Scalar::SCALAR_NUMBER;
+        return scalar;
+    case QueryOperand::OPERAND_BOOLEAN:
+        scalar.m_kind = Scalar::SCALAR_BOOLEAN;
+        return scalar;
+    case QueryOperand::OPERAND_NULL:
+        scalar.m_kind = Scalar::SCALAR_NULL;
+        return scalar;
+    default:
+        break;
+    }
+
+    scalar.m_kind = Scalar::SCALAR_NULL;
+    scalar.m_value.clear();
+
+    Pegasus::Uint32 idx = instance.findProperty(Pegasus::CIMName(operand.m_text));
+    if (idx == Pegasus::PEG_NOT_FOUND)
+        return scalar;
+
+    const Pegasus::CIMValue &value = instance.getProperty(idx).getValue();
+    if (value.isNull())
+        return scalar;
+
+    if (value.isArray()) {
+        scalar.m_kind = Scalar::SCALAR_ARRAY;
+    } else if (value.getType() == Pegasus::CIMTYPE_STRING) {
+        Pegasus::String str;
+        value.get(str);
+        scalar.m_kind = Scalar::SCALAR_STRING;
+        scalar.m_value = String(str);
+    } else {
+        scalar.m_kind = Scalar::SCALAR_STRING;
+        scalar.m_value = String(value.toString());
+    }
+
+    return scalar;
+}
+
+bool parse_integer(const String &str, Pegasus::Sint64 &value)
+{
+    std::istringstream ss(str);
+    ss >> value;
+    return !ss.fail() && ss.eof();
+}
+
+bool parse_real(const String &str, double &value)
+{
+    if (str.empty())
+        return false;
+
+    char *end;
+    value = strtod(str.c_str(), &end);
+    return *end == '\0';
+}
+
+bool parse_boolean(const String &str, bool &value)
+{
+    if (equals_nocase(str, "true"))
+        value = true;
+    else if (equals_nocase(str, "false"))
+        value = false;
+    else
+        return false;
+    return true;
+}
+
+template <typename T>
+int compare_values(const T &lhs, const T &rhs)
+{
+    return lhs < rhs ? -1 : (rhs < lhs ? 1 : 0);
+}
+
+// Three-way comparison of two scalars. Returns false, if they can't be
+// compared; the predicate is false in such case.
+bool compare_scalars(
+    const Scalar &lhs,
+    const Scalar &rhs,
+    bool nocase,
+    int &result)
+{
+    if (lhs.m_kind == Scalar::SCALAR_NULL || rhs.m_kind == Scalar::SCALAR_NULL ||
+        lhs.m_kind == Scalar::SCALAR_ARRAY || rhs.m_kind == Scalar::SCALAR_ARRAY)
+    {
+        return false;
+    }
+
+    if (lhs.m_kind == Scalar::SCALAR_NUMBER || rhs.m_kind == Scalar::SCALAR_NUMBER) {
+        Pegasus::Sint64 lhs_int, rhs_int;
+        if (parse_integer(lhs.m_value, lhs_int) &&
+            parse_integer(rhs.m_value, rhs_int))
+        {
+            result = compare_values(lhs_int, rhs_int);
+            return true;
+        }
+
+        double lhs_real, rhs_real;
+        if (!parse_real(lhs.m_value, lhs_real) ||
+            !parse_real(rhs.m_value, rhs_real))
+        {
+            return false;
+        }
+
+        result = compare_values(lhs_real, rhs_real);
+        return true;
+    }
+
+    if (lhs.m_kind == Scalar::SCALAR_BOOLEAN || rhs.m_kind == Scalar::SCALAR_BOOLEAN) {
+        bool lhs_bool, rhs_bool;
+        if (!parse_boolean(lhs.m_value, lhs_bool) ||
+            !parse_boolean(rhs.m_value, rhs_bool))
+        {
+            return false;
+        }
+
+        result = compare_values(lhs_bool, rhs_bool);
+        return true;
+    }
+
+    result = nocase ?
+        strcasecmp(lhs.m_value.c_str(), rhs.m_value.c_str()) :
+        strcmp(lhs.m_value.c_str(), rhs.m_value.c_str());
+    return true;
+}
+
+// WQL LIKE: '%' matches any sequence, '_' any character and '[...]' a set
+// or range of characters ('[^...]' negates it). Case-insensitive.
+bool like_match(const char *str, const char *pattern)
+{
+    for (; *pattern; ++pattern, ++str) {
+        if (*pattern == '%') {
+            while (*pattern == '%')
+                ++pattern;
+            if (!*pattern)
+                return true;
+            for (; *str; ++str) {
+                if (like_match(str, pattern))
+                    return true;
+            }
+            return false;
+        }
+
+        if (!*str)
+            return false;
+
+        const int ch = tolower(static_cast<unsigned char>(*str));
+        const char *set_end = *pattern == '[' ? strchr(pattern + 1, ']') : NULL;
+        if (set_end) {
+            const char *pos = pattern + 1;
+            const bool negated = *pos == '^';
+            if (negated)
+                ++pos;
+
+            bool found = false;
+            for (; pos < set_end; ++pos) {
+                const int first = tolower(static_cast<unsigned char>(*pos));
+                if (pos + 2 < set_end && pos[1] == '-') {
+                    const int last = tolower(static_cast<unsigned char>(pos[2]));
+                    found = found || (ch >= first && ch <= last);
+                    pos += 2;
+                } else {
+                    found = found || ch == first;
+                }
+            }
+
+            if (found == negated)
+                return false;
+            pattern = set_end;
+        } else if (*pattern != '_' &&
+            tolower(static_cast<unsigned char>(*pattern)) != ch)
+        {
+            return false;
+        }
+    }
+
+    return !*str;
+}
+
+bool evaluate(
+    const QueryNodePtr &node,
+    const Pegasus::CIMInstance &instance,
+    bool nocase)
+{
+    switch (node->m_type) {
+    case QueryNode::NODE_AND:
+        return evaluate(node->m_left, instance, nocase) &&
+            evaluate(node->m_right, instance, nocase);
+    case QueryNode::NODE_OR:
+        return evaluate(node->m_left, instance, nocase) ||
+            evaluate(node->m_right, instance, nocase);
+    case QueryNode::NODE_NOT:
+        return !evaluate(node->m_left, instance, nocase);
+    case QueryNode::NODE_IS_NULL: {
+        const Scalar value(evaluate_operand(node->m_lhs, instance));
+        return (value.m_kind == Scalar::SCALAR_NULL) != node->m_negated;
+    }
+    case QueryNode::NODE_LIKE: {
+        const Scalar value(evaluate_operand(node->m_lhs, instance));
+        if (value.m_kind == Scalar::SCALAR_NULL ||
+            value.m_kind == Scalar::SCALAR_ARRAY)
+        {
+            return false;
+        }
+        return like_match(value.m_value.c_str(), node->m_rhs.m_value.c_str()) !=
+            node->m_negated;
+    }
+    case QueryNode::NODE_COMPARE:
+        break;
+    }
+
+    int result;
+    if (!compare_scalars(
+            evaluate_operand(node->m_lhs, instance),
+            evaluate_operand(node->m_rhs, instance),
+            nocase,
+            result))
+    {
+        return false;
+    }
+
+    switch (node->m_op) {
+    case QueryNode::OP_EQ:
+        return result == 0;
+    case QueryNode::OP_NE:
+        return result != 0;
+    case QueryNode::OP_LT:
+        return result < 0;
+    case QueryNode::OP_LE:
+        return result <= 0;
+    case QueryNode::OP_GT:
+        return result > 0;
+    default:
+        return result >= 0;
+    }
+}
+
+Pegasus::CIMPropertyList make_property_list(const std::vector<String> &names)
+{
+    Pegasus::Array<Pegasus::CIMName> peg_names;
+    std::vector<String>::const_iterator it;
+    for (it = names.begin(); it != names.end(); ++it)
+        peg_names.append(Pegasus::CIMName(*it));
+    return Pegasus::CIMPropertyList(peg_names);
+}
+
+} // unnamed namespace
+
+WsmanQuery::WsmanQuery()
+    : m_language()
+    , m_classname()
+    , m_error()
+    , m_select_all(true)
+    , m_properties()
+    , m_terms()
+{
+}
+
+WsmanQuery::WsmanQuery(const String &language, const String &query)
+    : m_language()
+    , m_classname()
+    , m_error()
+    , m_select_all(true)
+    , m_properties()
+    , m_terms()
+{
+    if (equals_nocase(language, "WQL")) {
+        m_language = "WQL";
+    } else if (equals_nocase(language, "CQL") ||
+        equals_nocase(language, "DMTF:CQL"))
+    {
+        m_language = "CQL";
+    } else {
+        m_error = String("Query language not supported: ") + language;
+        return;
+    }
+
+    try {
+        parse(query);
+    } catch (const QueryError &e) {
+        m_classname.clear();
+        m_error = e.m_message;
+    }
+}
+
+void WsmanQuery::parse(const String &query)
+{
+    QueryParser parser(m_language, query);
+    parser.parse();
+
+    m_classname = parser.getClassname();
+    m_select_all = parser.isSelectAll();
+    m_properties = parser.getProperties();
+
+    if (!parser.getCondition())
+        return;
+
+    std::vector<QueryNodePtr> nodes;
+    split_conjunction(parser.getCondition(), nodes);
+
+    std::vector<QueryNodePtr>::const_iterator it;
+    for (it = nodes.begin(); it != nodes.end(); ++it) {
+        Term term;
+        term.m_node = *it;
+        term.m_server_side = is_server_side(*it);
+        m_terms.push_back(term);
+    }
+}
+
+bool WsmanQuery::isValid() const
+{
+    return m_error.empty() && !m_classname.empty();
+}
+
+String WsmanQuery::getError() const
+{
+    return m_error;
+}
+
+String WsmanQuery::getLanguage() const
+{
+    return m_language;
+}
+
+String WsmanQuery::getClassname() const
+{
+    return m_classname;
+}
+
+Pegasus::CIMPropertyList WsmanQuery::getPropertyList() const
+{
+    if (m_select_all)
+        return Pegasus::CIMPropertyList();
+    return make_property_list(m_properties);
+}
+
+Pegasus::CIMPropertyList WsmanQuery::getDecodePropertyList() const
+{
+    if (m_select_all)
+        return Pegasus::CIMPropertyList();
+
+    std::vector<String> names(m_properties);
+    std::vector<Term>::const_iterator it;
+    for (it = m_terms.begin(); it != m_terms.end(); ++it) {
+        if (!it->m_server_side)
+            collect_properties(it->m_node, names);
+    }
+
+    return make_property_list(names);
+}
+
+String WsmanQuery::getServerQuery() const
+{
+    if (!hasServerQuery())
+        return String();
+
+    // Projection is left to the client, which may need other properties
+    // for the rest of the condition.
+    std::stringstream ss;
+    ss << "SELECT * FROM " << m_classname << " WHERE ";
+
+    bool first = true;
+    std::vector<Term>::const_iterator it;
+    for (it = m_terms.begin(); it != m_terms.end(); ++it) {
+        if (!it->m_server_side)
+            continue;
+        if (!first)
+            ss << " AND ";
+        render(it->m_node, ss);
+        first = false;
+    }
+
+    return String(ss.str());
+}
+
+bool WsmanQuery::hasServerQuery() const
+{
+    std::vector<Term>::const_iterator it;
+    for (it = m_terms.begin(); it != m_terms.end(); ++it) {
+        if (it->m_server_side)
+            return true;
+    }
+
+    return false;
+}
+
+void WsmanQuery::disableServerQuery()
+{
+    std::vector<Term>::iterator it;
+    for (it = m_terms.begin(); it != m_terms.end(); ++it)
+        it->m_server_side = false;
+}
+
+bool WsmanQuery::matches(const Pegasus::CIMInstance &instance) const
+{
+    // WQL compares strings case-insensitively, CQL does not.
+    const bool nocase = m_language == "WQL";
+
+    std::vector<Term>::const_iterator it;
+    for (it = m_terms.begin(); it != m_terms.end(); ++it) {
+        if (!it->m_server_side && !evaluate(it->m_node, instance, nocase))
+            return false;
+    }
+
+    return true;
+}
+
+void WsmanQuery::project(Pegasus::CIMInstance &instance) const
+{
+    if (m_select_all)
+        return;
+
+    Pegasus::Uint32 idx = instance.getPropertyCount();
+    while (idx-- > 0) {
+        const String name(instance.getProperty(idx).getName().getString());
+        if (!contains_nocase(m_properties, name))
+            instance.removeProperty(idx);
+    }
+}
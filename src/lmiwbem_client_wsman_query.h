@@ -0,0 +1,94 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef   LMIWBEM_CLIENT_WSMAN_QUERY_H
+#  define LMIWBEM_CLIENT_WSMAN_QUERY_H
+
+#  include <vector>
+#  include <boost/shared_ptr.hpp>
+#  include <Pegasus/Common/CIMPropertyList.h>
+#  include "lmiwbem.h"
+#  include "util/lmiwbem_string.h"
+
+PEGASUS_BEGIN
+class CIMInstance;
+PEGASUS_END
+
+struct QueryNode;
+typedef boost::shared_ptr<QueryNode> QueryNodePtr;
+
+// Parsed WQL or CQL query of the form
+//
+//     SELECT * | prop [, prop]... FROM class [WHERE condition]
+//
+// Top-level AND terms of the condition, which compare a property with a
+// literal (and AND, OR and NOT of such terms), are handed to the server as a
+// query in the WS-Management filter dialect of the language. The remaining
+// terms (LIKE, comparisons of two properties, ...) are evaluated by matches()
+// on decoded instances. Projection is always done on the client side.
+class WsmanQuery
+{
+public:
+    WsmanQuery();
+    WsmanQuery(const String &language, const String &query);
+
+    bool isValid() const;
+    String getError() const;
+
+    // Canonical language name: "WQL" or "CQL".
+    String getLanguage() const;
+    String getClassname() const;
+
+    // Selected properties; null for SELECT *.
+    Pegasus::CIMPropertyList getPropertyList() const;
+
+    // Properties to decode: the selected ones and those needed by matches().
+    Pegasus::CIMPropertyList getDecodePropertyList() const;
+
+    // Query with the terms evaluated by the server; empty, if there are none.
+    String getServerQuery() const;
+    bool hasServerQuery() const;
+
+    // Evaluates all the terms on the client side; used when the server
+    // rejects the filter.
+    void disableServerQuery();
+
+    bool matches(const Pegasus::CIMInstance &instance) const;
+    void project(Pegasus::CIMInstance &instance) const;
+
+private:
+    struct Term
+    {
+        QueryNodePtr m_node;
+        bool m_server_side;
+    };
+
+    void parse(const String &query);
+
+    String m_language;
+    String m_classname;
+    String m_error;
+    bool m_select_all;
+    std::vector<String> m_properties;
+    std::vector<Term> m_terms;
+};
+
+#endif // LMIWBEM_CLIENT_WSMAN_QUERY_H
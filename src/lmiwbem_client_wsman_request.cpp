@@ -20,12 +20,12 @@
  * ***** END LICENSE BLOCK ***** */
 
 #include <config.h>
-#include <algorithm>
-#include <cctype>
 #include <sstream>
+#include "lmiwbem_client_wsman_query.h"
 #include "lmiwbem_client_wsman_request.h"
 
 std::map<String, String> Request::s_schemes = Request::makeSchemes();
+std::map<String, String> Request::s_dialects = Request::makeDialects();
 
 Request::Request()
     : m_hostname()
@@ -54,45 +54,14 @@ Request::Request(
 Request::Request(
     const String &hostname,
     const String &namespace_,
-    const String &query_language,
-    const String &query)
+    const WsmanQuery &query)
     : m_hostname(hostname)
     , m_namespace(namespace_)
-    , m_classname()
-    , m_query_language(query_language)
-    , m_query(query)
+    , m_classname(query.getClassname())
+    , m_query_language(query.getLanguage())
+    , m_query(query.getServerQuery())
     , m_use_wildcard(true)
 {
-    String query_lower(query);
-    std::transform(
-        query_lower.begin(),
-        query_lower.end(),
-        query_lower.begin(),
-        ::tolower);
-
-    size_t begin = query_lower.find("from");
-    if (begin == query_lower.npos)
-        return;
-
-    size_t end = query_lower.find("where", begin);
-
-    std::stringstream ss(query.substr(begin + 4, end - begin - 4));
-
-    int cnt;
-    String cls;
-    for (cnt = 0; cnt < 2 && getline(ss, cls, ','); ++cnt) {
-        // Trim leading and trailing spaces.
-        cls.erase(0, cls.find_first_not_of(' '));
-        cls.erase(cls.find_last_not_of(' ') + 1);
-    }
-
-    if (cnt > 1 || find_if(cls.begin(), cls.end(), ::isspace) != cls.end()) {
-        // We can't handle more classes in select; class name contains illegal
-        // characters.
-        return;
-    }
-
-    m_classname = cls;
 }
 
 
@@ -128,9 +97,10 @@ String Request::getClassname() const
 
 String Request::getQueryDialect() const
 {
-    std::stringstream ss;
-    ss << getScheme(true) << '/' << m_query_language;
-    return ss.str();
+    std::map<String, String>::const_iterator it = s_dialects.find(m_query_language);
+    if (it != s_dialects.end())
+        return it->second;
+    return String();
 }
 
 String Request::getQueryLanguage() const
@@ -194,24 +164,23 @@ std::map<String, String> Request::makeSchemes()
     // XXX: Dell's iDrac uses this schema
     // schemes["DCIM"] = "http://schemas.dmtf.org/wbem/wscim/1/cim-schema/2";
     schemes["DCIM"] = "http://schemas.dell.com/wbem/wscim/1/cim-schema/2";
-    // Query dialects...
-    schemes["WQL"] = "http://schemas.microsoft.com/wbem/wsman/1";
     return schemes;
 }
 
-String Request::getScheme(const bool for_query) const
+std::map<String, String> Request::makeDialects()
 {
-    std::map<String, String>::const_iterator it;
+    std::map<String, String> dialects;
+    dialects["WQL"] = "http://schemas.microsoft.com/wbem/wsman/1/WQL";
+    dialects["CQL"] = "http://schemas.dmtf.org/wbem/cql/1/dsp0202.pdf";
+    return dialects;
+}
 
-    if (for_query) {
-        it = s_schemes.find(m_query_language);
-        if (it != s_schemes.end())
+String Request::getScheme() const
+{
+    std::map<String, String>::const_iterator it;
+    for (it = s_schemes.begin(); it != s_schemes.end(); ++it) {
+        if (m_classname.find(it->first) != m_classname.npos)
             return it->second;
-    } else {
-        for (it = s_schemes.begin(); it != s_schemes.end(); ++it) {
-            if (m_classname.find(it->first) != m_classname.npos)
-                return it->second;
-        }
     }
 
     return String();
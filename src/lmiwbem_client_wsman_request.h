@@ -25,6 +25,8 @@
 #  include <map>
 #  include "util/lmiwbem_string.h"
 
+class WsmanQuery;
+
 class Request
 {
 public:
@@ -34,11 +36,11 @@ public:
         const String &namespace_,
         const String &classname,
         const bool use_wildcard = false);
+    // Enumeration filtered by the server side part of the query.
     Request(
         const String &hostname,
         const String &namespace_,
-        const String &query_language,
-        const String &query);
+        const WsmanQuery &query);
 
     void setHostname(const String &hostname);
     void setNamespace(const String &namespace_);
@@ -58,9 +60,11 @@ public:
     operator String() const;
 
 private:
-    String getScheme(const bool for_query = false) const;
+    String getScheme() const;
     static std::map<String, String> makeSchemes();
+    static std::map<String, String> makeDialects();
     static std::map<String, String> s_schemes;
+    static std::map<String, String> s_dialects;
 
     String m_hostname;
     String m_namespace;
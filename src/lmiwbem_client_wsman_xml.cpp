@@ -0,0 +1,379 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#include <config.h>
+#include <algorithm>
+#include <cstring>
+#include "lmiwbem_client_wsman_xml.h"
+#include "lmiwbem_exception.h"
+
+namespace {
+
+inline bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline bool is_name_end(char c)
+{
+    return is_space(c) || c == '/' || c == '>' || c == '=';
+}
+
+// Strips namespace prefix without copying.
+inline const char *local_name(const char *begin, const char *end)
+{
+    for (const char *p = end; p != begin; --p) {
+        if (p[-1] == ':')
+            return p;
+    }
+    return begin;
+}
+
+void append_utf8(String &out, unsigned long cp)
+{
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xc0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xe0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    } else {
+        out.push_back(static_cast<char>(0xf0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    }
+}
+
+} // unnamed namespace
+
+XMLReader::XMLReader(const char *data, size_t size)
+    : m_pos(data)
+    , m_end(data + size)
+    , m_name(data)
+    , m_name_len(0)
+    , m_attrs(data)
+    , m_attrs_end(data)
+    , m_pending_end(false)
+    , m_text()
+{
+}
+
+XMLReader::XMLReader(const std::string &data)
+    : m_pos(data.data())
+    , m_end(data.data() + data.size())
+    , m_name(data.data())
+    , m_name_len(0)
+    , m_attrs(data.data())
+    , m_attrs_end(data.data())
+    , m_pending_end(false)
+    , m_text()
+{
+}
+
+XMLReader::Token XMLReader::next()
+{
+    if (m_pending_end) {
+        // Second half of an empty-element tag.
+        m_pending_end = false;
+        return TOKEN_END;
+    }
+
+    while (m_pos < m_end) {
+        if (*m_pos != '<') {
+            const char *begin = m_pos;
+            const void *lt = memchr(m_pos, '<', m_end - m_pos);
+            m_pos = lt ? static_cast<const char*>(lt) : m_end;
+            decode(begin, m_pos, m_text);
+            return TOKEN_TEXT;
+        }
+
+        const char *p = m_pos + 1;
+        const size_t left = m_end - p;
+        if (left > 0 && *p == '?') {
+            // XML declaration or processing instruction
+            m_pos = find("?>") + 2;
+        } else if (left >= 3 && memcmp(p, "!--", 3) == 0) {
+            m_pos = find("-->") + 3;
+        } else if (left >= 8 && memcmp(p, "![CDATA[", 8) == 0) {
+            const char *begin = p + 8;
+            m_pos = begin;
+            const char *end = find("]]>");
+            m_text.assign(begin, end);
+            m_pos = end + 3;
+            return TOKEN_TEXT;
+        } else if (left > 0 && *p == '!') {
+            m_pos = find(">") + 1;
+        } else if (left > 0 && *p == '/') {
+            m_pos = p + 1;
+            readName();
+            while (m_pos < m_end && is_space(*m_pos))
+                ++m_pos;
+            if (m_pos == m_end || *m_pos != '>')
+                error("Malformed end tag");
+            ++m_pos;
+            return TOKEN_END;
+        } else {
+            m_pos = p;
+            readName();
+
+            // Find the end of the tag; '>' may appear in attribute values.
+            m_attrs = m_pos;
+            char quote = '\0';
+            while (m_pos < m_end && (quote || *m_pos != '>')) {
+                if (quote && *m_pos == quote)
+                    quote = '\0';
+                else if (!quote && (*m_pos == '"' || *m_pos == '\''))
+                    quote = *m_pos;
+                ++m_pos;
+            }
+            if (m_pos == m_end)
+                error("Unterminated start tag");
+
+            m_attrs_end = m_pos++;
+            if (m_attrs_end > m_attrs && m_attrs_end[-1] == '/') {
+                --m_attrs_end;
+                m_pending_end = true;
+            }
+            return TOKEN_START;
+        }
+    }
+
+    return TOKEN_EOF;
+}
+
+bool XMLReader::nameEquals(const char *name) const
+{
+    return strlen(name) == m_name_len &&
+        memcmp(name, m_name, m_name_len) == 0;
+}
+
+bool XMLReader::nameEquals(const String &name) const
+{
+    return name.size() == m_name_len &&
+        memcmp(name.data(), m_name, m_name_len) == 0;
+}
+
+String XMLReader::name() const
+{
+    return String(std::string(m_name, m_name_len));
+}
+
+bool XMLReader::attribute(const char *name, String &value) const
+{
+    const size_t name_len = strlen(name);
+    const char *p = m_attrs;
+    while (p < m_attrs_end) {
+        while (p < m_attrs_end && is_space(*p))
+            ++p;
+        const char *attr_begin = p;
+        while (p < m_attrs_end && !is_name_end(*p))
+            ++p;
+        const char *attr_end = p;
+        while (p < m_attrs_end && is_space(*p))
+            ++p;
+        if (p == m_attrs_end || *p != '=')
+            break;
+        ++p;
+        while (p < m_attrs_end && is_space(*p))
+            ++p;
+        if (p == m_attrs_end || (*p != '"' && *p != '\''))
+            error("Malformed attribute");
+
+        const char quote = *p++;
+        const char *value_begin = p;
+        while (p < m_attrs_end && *p != quote)
+            ++p;
+        if (p == m_attrs_end)
+            error("Malformed attribute");
+        const char *value_end = p++;
+
+        const char *attr_local = local_name(attr_begin, attr_end);
+        if (static_cast<size_t>(attr_end - attr_local) == name_len &&
+            memcmp(attr_local, name, name_len) == 0)
+        {
+            decode(value_begin, value_end, value);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+String XMLReader::readText()
+{
+    String text;
+    int depth = 0;
+    for (;;) {
+        switch (next()) {
+        case TOKEN_TEXT:
+            if (depth == 0)
+                text.append(m_text);
+            break;
+        case TOKEN_START:
+            ++depth;
+            break;
+        case TOKEN_END:
+            if (depth-- == 0)
+                return text;
+            break;
+        case TOKEN_EOF:
+            error("Unexpected end of document");
+        }
+    }
+}
+
+void XMLReader::skipElement()
+{
+    int depth = 0;
+    for (;;) {
+        switch (next()) {
+        case TOKEN_TEXT:
+            break;
+        case TOKEN_START:
+            ++depth;
+            break;
+        case TOKEN_END:
+            if (depth-- == 0)
+                return;
+            break;
+        case TOKEN_EOF:
+            error("Unexpected end of document");
+        }
+    }
+}
+
+bool XMLReader::findChild(const char *name)
+{
+    for (;;) {
+        switch (next()) {
+        case TOKEN_TEXT:
+            break;
+        case TOKEN_START:
+            if (nameEquals(name))
+                return true;
+            skipElement();
+            break;
+        case TOKEN_END:
+        case TOKEN_EOF:
+            return false;
+        }
+    }
+}
+
+bool XMLReader::findChild(const String &name)
+{
+    return findChild(name.c_str());
+}
+
+const char *XMLReader::find(const char *pattern) const
+{
+    const char *pattern_end = pattern + strlen(pattern);
+    const char *found = std::search(m_pos, m_end, pattern, pattern_end);
+    if (found == m_end)
+        error("Unexpected end of document");
+    return found;
+}
+
+void XMLReader::decode(const char *begin, const char *end, String &out) const
+{
+    const void *amp = memchr(begin, '&', end - begin);
+    if (!amp) {
+        // Common case; no entities.
+        out.assign(begin, end);
+        return;
+    }
+
+    out.assign(begin, static_cast<const char*>(amp));
+    const char *p = static_cast<const char*>(amp);
+    while (p < end) {
+        if (*p != '&') {
+            out.push_back(*p++);
+            continue;
+        }
+
+        const char *semicolon = std::find(p, end, ';');
+        if (semicolon == end)
+            error("Unterminated entity");
+
+        const char *entity = p + 1;
+        const size_t len = semicolon - entity;
+        if (len == 2 && memcmp(entity, "lt", 2) == 0) {
+            out.push_back('<');
+        } else if (len == 2 && memcmp(entity, "gt", 2) == 0) {
+            out.push_back('>');
+        } else if (len == 3 && memcmp(entity, "amp", 3) == 0) {
+            out.push_back('&');
+        } else if (len == 4 && memcmp(entity, "quot", 4) == 0) {
+            out.push_back('"');
+        } else if (len == 4 && memcmp(entity, "apos", 4) == 0) {
+            out.push_back('\'');
+        } else if (len > 1 && *entity == '#') {
+            unsigned long cp = 0;
+            const bool hex = entity[1] == 'x';
+            const char *digits = entity + (hex ? 2 : 1);
+            if (digits == semicolon)
+                error("Invalid character reference");
+            for (const char *d = digits; d < semicolon; ++d) {
+                int digit;
+                if (*d >= '0' && *d <= '9')
+                    digit = *d - '0';
+                else if (hex && *d >= 'a' && *d <= 'f')
+                    digit = *d - 'a' + 10;
+                else if (hex && *d >= 'A' && *d <= 'F')
+                    digit = *d - 'A' + 10;
+                else
+                    error("Invalid character reference");
+                cp = cp * (hex ? 16 : 10) + digit;
+                if (cp > 0x10ffff)
+                    error("Invalid character reference");
+            }
+            // NUL is not a legal XML character.
+            if (cp == 0)
+                error("Invalid character reference");
+            append_utf8(out, cp);
+        } else {
+            error("Unknown entity");
+        }
+
+        p = semicolon + 1;
+    }
+}
+
+void XMLReader::readName()
+{
+    const char *begin = m_pos;
+    while (m_pos < m_end && !is_name_end(*m_pos))
+        ++m_pos;
+    if (m_pos == begin)
+        error("Missing element name");
+
+    m_name = local_name(begin, m_pos);
+    m_name_len = m_pos - m_name;
+}
+
+void XMLReader::error(const char *message) const
+{
+    throw WsmanException(String("Invalid XML: ") + String(message));
+}
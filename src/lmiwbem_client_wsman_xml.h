@@ -0,0 +1,94 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef   LMIWBEM_CLIENT_WSMAN_XML_H
+#  define LMIWBEM_CLIENT_WSMAN_XML_H
+
+#  include <cstddef>
+#  include <string>
+#  include "util/lmiwbem_string.h"
+
+// Streaming (pull) reader of WS-Management XML documents. The reader walks
+// the document in place and reports start tags, end tags and text; element
+// and attribute names are reported without their namespace prefixes. Only
+// the subset of XML used by WS-Management is supported: no DTDs and no
+// entities other than the predefined ones and character references.
+//
+// Throws WsmanException on malformed input.
+class XMLReader
+{
+public:
+    enum Token {
+        TOKEN_START,
+        TOKEN_END,
+        TOKEN_TEXT,
+        TOKEN_EOF
+    };
+
+    XMLReader(const char *data, size_t size);
+    XMLReader(const std::string &data);
+
+    Token next();
+
+    // Name of the current element without namespace prefix; valid after
+    // TOKEN_START and TOKEN_END.
+    bool nameEquals(const char *name) const;
+    bool nameEquals(const String &name) const;
+    String name() const;
+
+    // Looks up an attribute of the current start tag by its name without
+    // namespace prefix.
+    bool attribute(const char *name, String &value) const;
+
+    // Decoded text; valid after TOKEN_TEXT.
+    const String &text() const { return m_text; }
+
+    // Reads the text directly contained by the current element and skips its
+    // child elements. Call after TOKEN_START; consumes the end tag.
+    String readText();
+
+    // Skips the rest of the current element. Call after TOKEN_START; consumes
+    // the end tag.
+    void skipElement();
+
+    // Advances to the next child element with given name and returns true.
+    // Returns false, when the end tag of the current element (or the end of
+    // the document at top level) is reached first; the end tag is consumed.
+    bool findChild(const char *name);
+    bool findChild(const String &name);
+
+private:
+    const char *find(const char *pattern) const;
+    void decode(const char *begin, const char *end, String &out) const;
+    void readName();
+    void error(const char *message) const;
+
+    const char *m_pos;
+    const char *m_end;
+    const char *m_name;
+    size_t m_name_len;
+    const char *m_attrs;
+    const char *m_attrs_end;
+    bool m_pending_end;
+    String m_text;
+};
+
+#endif // LMIWBEM_CLIENT_WSMAN_XML_H
@@ -61,6 +61,19 @@ WsmanException::WsmanException(const String &what_arg) throw()
 {
 }
 
+TransportException::TransportException(
+    const String &what_arg,
+    bool timeout) throw()
+    : WsmanException(what_arg)
+    , m_timeout(timeout)
+{
+}
+
+bool TransportException::isTimeout() const throw()
+{
+    return m_timeout;
+}
+
 namespace {
 
 inline void throw_core(PyObject *exc, const String &message)
@@ -145,6 +158,16 @@ void throw_KeyError(const String &message)
     throw_core(PyExc_KeyError, message);
 }
 
+void throw_IndexError(const String &message)
+{
+    throw_core(PyExc_IndexError, message);
+}
+
+void throw_IOError(const String &message)
+{
+    throw_core(PyExc_IOError, message);
+}
+
 void throw_MemoryError(const String &message)
 {
     throw_core(PyExc_MemoryError, message);
@@ -241,6 +264,12 @@ void handle_all_exceptions(std::stringstream &prefix)
         throw_CIMError(
             prefix.str(),
             CIMConstants::CIM_ERR_NOT_SUPPORTED);
+    } catch (const TransportException &e) {
+        throw_ConnectionError(
+            prefix.str(),
+            e.isTimeout() ?
+                CIMConstants::CON_ERR_CONNECTION_TIMEOUT :
+                CIMConstants::CON_ERR_CANNOT_CONNECT);
     } catch (const WsmanException &e) {
         throw_WsmanError(
             prefix.str(),
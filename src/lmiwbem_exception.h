@@ -58,6 +58,18 @@ public:
     WsmanException(const String &what_arg) throw();
 };
 
+// Failure to reach the WS-Management server, as opposed to an error response.
+class TransportException: public WsmanException
+{
+public:
+    TransportException(const String &what_arg, bool timeout = false) throw();
+
+    bool isTimeout() const throw();
+
+private:
+    bool m_timeout;
+};
+
 // -----------------------------------------------------------------------------
 
 void throw_Exception(const Pegasus::Exception &e);
@@ -70,6 +82,8 @@ void throw_WsmanError(const String &message, int code = 0);
 
 void throw_ValueError(const String &message);
 void throw_KeyError(const String &message);
+void throw_IndexError(const String &message);
+void throw_IOError(const String &message);
 void throw_MemoryError(const String &message);
 void throw_StopIteration(const String &message);
 void throw_TypeError(const String &message);
@@ -63,6 +63,41 @@ bool Mutex::isLocked() const
     return m_locked;
 }
 
+Condition::Condition()
+    : m_good(false)
+{
+    m_good = pthread_cond_init(&m_cond, NULL) == 0;
+}
+
+Condition::~Condition()
+{
+    pthread_cond_destroy(&m_cond);
+}
+
+bool Condition::wait(Mutex &m)
+{
+    if (!m_good || !m.m_good)
+        return false;
+
+    return pthread_cond_wait(&m_cond, &m.m_mutex) == 0;
+}
+
+bool Condition::signal()
+{
+    if (!m_good)
+        return false;
+
+    return pthread_cond_signal(&m_cond) == 0;
+}
+
+bool Condition::broadcast()
+{
+    if (!m_good)
+        return false;
+
+    return pthread_cond_broadcast(&m_cond) == 0;
+}
+
 ScopedMutex::ScopedMutex(Mutex &m)
     : m_mutex(m)
 {
@@ -37,11 +37,30 @@ public:
     bool isLocked() const;
 
 private:
+    friend class Condition;
+
     bool m_good;
     bool m_locked;
     pthread_mutex_t m_mutex;
 };
 
+class Condition
+{
+public:
+    Condition();
+    ~Condition();
+
+    // Unlocks the mutex, which has to be locked by the caller, and waits for
+    // a signal; the mutex is locked again on return.
+    bool wait(Mutex &m);
+    bool signal();
+    bool broadcast();
+
+private:
+    bool m_good;
+    pthread_cond_t m_cond;
+};
+
 class ScopedMutex
 {
 public:
@@ -0,0 +1,335 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#include <config.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <map>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <unistd.h>
+#include "lmiwbem_mutex.h"
+#include "lmiwbem_resolver.h"
+#include "lmiwbem_urlinfo.h"
+#include "util/lmiwbem_util.h"
+
+namespace {
+
+const unsigned int BUFLEN = 1024;
+const double RESOLVER_DEFAULT_TTL = 300.0;
+const size_t RESOLVER_DEFAULT_MAX_SIZE = 1000;
+
+class CacheEntry
+{
+public:
+    CacheEntry(): m_value(), m_expires(0) { }
+    CacheEntry(const String &value, double expires)
+        : m_value(value), m_expires(expires) { }
+
+    String m_value;
+    double m_expires;
+};
+
+// Resolved addresses of a single host.
+class AddressEntry
+{
+public:
+    AddressEntry(
+        const String &hostname,
+        const std::vector<String> &addresses,
+        double expires)
+        : m_hostname(hostname), m_addresses(addresses), m_expires(expires) { }
+
+    String m_hostname;
+    std::vector<String> m_addresses;
+    double m_expires;
+};
+
+// Most recently used entries are at the front.
+typedef std::list<AddressEntry> AddressList;
+typedef std::map<String, AddressList::iterator> AddressIndex;
+
+// Shared state of Resolver::resolve().
+class ResolveContext
+{
+public:
+    ResolveContext(const std::vector<String> &hostnames)
+        : m_mutex(), m_hostnames(hostnames), m_addresses(hostnames.size())
+        , m_next(0) { }
+
+    Mutex m_mutex;
+    const std::vector<String> &m_hostnames;
+    std::vector<String> m_addresses;
+    size_t m_next;
+};
+
+Mutex s_mutex;
+double s_ttl = RESOLVER_DEFAULT_TTL;
+CacheEntry s_fqdn;
+size_t s_max_size = RESOLVER_DEFAULT_MAX_SIZE;
+AddressList s_addresses;
+AddressIndex s_address_index;
+
+// Following functions expect s_mutex to be locked.
+void clear_addresses()
+{
+    s_addresses.clear();
+    s_address_index.clear();
+}
+
+void erase_address(AddressIndex::iterator it)
+{
+    s_addresses.erase(it->second);
+    s_address_index.erase(it);
+}
+
+void shrink_addresses()
+{
+    const double now = monotonic_now();
+    while (!s_addresses.empty() && (s_addresses.size() > s_max_size ||
+        s_addresses.back().m_expires < now))
+    {
+        s_address_index.erase(s_addresses.back().m_hostname);
+        s_addresses.pop_back();
+    }
+}
+
+String lookup_fqdn()
+{
+    struct addrinfo hints, *info, *p;
+    int gai_result;
+    char name[BUFLEN + 1];
+    char port[BUFLEN];
+
+    if (gethostname(name, BUFLEN) < 0)
+        return String("localhost");
+
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC; // either IPV4 or IPV6
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_CANONNAME;
+
+    snprintf(port, BUFLEN, "%d", URLInfo::PORT_CIMXML_HTTPS);
+    if ((gai_result = getaddrinfo(name, port, &hints, &info)) == 0) {
+        for (p = info; p != NULL; p = p->ai_next) {
+            if (p->ai_canonname != NULL) {
+                snprintf(name, BUFLEN, "%s", p->ai_canonname);
+                break;
+            }
+        }
+        freeaddrinfo(info);
+    }
+    return String(name);
+}
+
+bool lookup_address(const String &hostname, std::vector<String> &addresses)
+{
+    struct addrinfo hints, *info, *p;
+    char host[NI_MAXHOST];
+
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC; // either IPV4 or IPV6
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG;
+
+    if (getaddrinfo(hostname.c_str(), NULL, &hints, &info) != 0)
+        return false;
+
+    addresses.clear();
+    for (p = info; p != NULL; p = p->ai_next) {
+        if (getnameinfo(p->ai_addr, p->ai_addrlen, host, sizeof host,
+                NULL, 0, NI_NUMERICHOST) != 0)
+        {
+            continue;
+        }
+
+        const String address(host);
+        if (std::find(addresses.begin(), addresses.end(), address) ==
+            addresses.end())
+        {
+            addresses.push_back(address);
+        }
+    }
+    freeaddrinfo(info);
+
+    return !addresses.empty();
+}
+
+} // unnamed namespace
+
+String Resolver::getFQDN()
+{
+    {
+        ScopedMutex sm(s_mutex);
+        if (s_ttl > 0 && !s_fqdn.m_value.empty() &&
+            s_fqdn.m_expires >= monotonic_now())
+        {
+            return s_fqdn.m_value;
+        }
+    }
+
+    String fqdn(lookup_fqdn());
+
+    ScopedMutex sm(s_mutex);
+    if (s_ttl > 0)
+        s_fqdn = CacheEntry(fqdn, monotonic_now() + s_ttl);
+    return fqdn;
+}
+
+std::vector<String> Resolver::getAddresses(const String &hostname)
+{
+    std::vector<String> addresses;
+    if (!lookup(hostname, addresses)) {
+        // Let the caller's connect report the failure.
+        addresses.assign(1, hostname);
+    }
+    return addresses;
+}
+
+String Resolver::getAddress(const String &hostname)
+{
+    return getAddresses(hostname).front();
+}
+
+std::vector<String> Resolver::resolve(
+    const std::vector<String> &hostnames,
+    unsigned int workers)
+{
+    ResolveContext ctx(hostnames);
+
+    const size_t cnt = std::min(
+        static_cast<size_t>(workers), hostnames.size());
+    std::vector<pthread_t> threads(cnt);
+
+    size_t started = 0;
+    for (size_t i = 0; i < cnt; ++i) {
+        if (pthread_create(&threads[i], NULL,
+                &Resolver::resolveWorker, &ctx) != 0)
+        {
+            break;
+        }
+        ++started;
+    }
+
+    // We could not start any thread; resolve the hosts here.
+    if (!started)
+        resolveWorker(&ctx);
+
+    for (size_t i = 0; i < started; ++i)
+        pthread_join(threads[i], NULL);
+
+    return ctx.m_addresses;
+}
+
+double Resolver::getTTL()
+{
+    ScopedMutex sm(s_mutex);
+    return s_ttl;
+}
+
+void Resolver::setTTL(double ttl)
+{
+    ScopedMutex sm(s_mutex);
+    s_ttl = ttl;
+    if (s_ttl <= 0) {
+        s_fqdn = CacheEntry();
+        clear_addresses();
+    }
+}
+
+size_t Resolver::getMaxSize()
+{
+    ScopedMutex sm(s_mutex);
+    return s_max_size;
+}
+
+void Resolver::setMaxSize(size_t max_size)
+{
+    ScopedMutex sm(s_mutex);
+    s_max_size = max_size;
+    shrink_addresses();
+}
+
+void Resolver::clear()
+{
+    ScopedMutex sm(s_mutex);
+    s_fqdn = CacheEntry();
+    clear_addresses();
+}
+
+bool Resolver::lookup(
+    const String &hostname,
+    std::vector<String> &addresses)
+{
+    {
+        ScopedMutex sm(s_mutex);
+        AddressIndex::iterator found = s_address_index.find(hostname);
+        if (found != s_address_index.end()) {
+            if (s_ttl > 0 && found->second->m_expires >= monotonic_now()) {
+                s_addresses.splice(
+                    s_addresses.begin(), s_addresses, found->second);
+                addresses = found->second->m_addresses;
+                return true;
+            }
+            erase_address(found);
+        }
+    }
+
+    if (!lookup_address(hostname, addresses))
+        return false;
+
+    ScopedMutex sm(s_mutex);
+    if (s_ttl > 0 && s_max_size > 0) {
+        // Concurrent lookups of the same host may both get here.
+        AddressIndex::iterator found = s_address_index.find(hostname);
+        if (found != s_address_index.end())
+            erase_address(found);
+
+        s_addresses.push_front(
+            AddressEntry(hostname, addresses, monotonic_now() + s_ttl));
+        s_address_index[hostname] = s_addresses.begin();
+        shrink_addresses();
+    }
+    return true;
+}
+
+void *Resolver::resolveWorker(void *ctx)
+{
+    ResolveContext *c = static_cast<ResolveContext*>(ctx);
+    while (true) {
+        size_t i;
+        {
+            ScopedMutex sm(c->m_mutex);
+            if (c->m_next >= c->m_hostnames.size())
+                return NULL;
+            i = c->m_next++;
+        }
+
+        std::vector<String> addresses;
+        if (lookup(c->m_hostnames[i], addresses))
+            c->m_addresses[i] = addresses.front();
+    }
+
+    return NULL;
+}
@@ -0,0 +1,69 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef   LMIWBEM_RESOLVER_H
+#  define LMIWBEM_RESOLVER_H
+
+#  include <vector>
+#  include "util/lmiwbem_string.h"
+
+// Process-wide cache of host name resolutions. Both the local FQDN and the
+// addresses of target hosts are kept for TTL seconds; TTL set to 0 disables
+// the caching. At most max size hosts are cached; least recently used ones
+// are evicted first. All the methods are thread-safe and the resolver is
+// never called with the cache locked.
+class Resolver
+{
+public:
+    static String getFQDN();
+
+    // Returns all numeric addresses of the host in the order of
+    // getaddrinfo(), or the host name itself, if it can't be resolved.
+    static std::vector<String> getAddresses(const String &hostname);
+
+    // Returns the first numeric address of the host, or the host name
+    // itself, if it can't be resolved. Callers, which can't fall back to
+    // the other addresses, use this one.
+    static String getAddress(const String &hostname);
+
+    // Resolves the hosts concurrently and stores the results in the cache.
+    // Returns the first address of each host in the order of the hosts;
+    // empty strings stand for the hosts, which can't be resolved.
+    static std::vector<String> resolve(
+        const std::vector<String> &hostnames,
+        unsigned int workers);
+
+    static double getTTL();
+    static void setTTL(double ttl);
+    static size_t getMaxSize();
+    static void setMaxSize(size_t max_size);
+    static void clear();
+
+private:
+    Resolver();
+
+    static bool lookup(
+        const String &hostname,
+        std::vector<String> &addresses);
+    static void *resolveWorker(void *ctx);
+};
+
+#endif // LMIWBEM_RESOLVER_H
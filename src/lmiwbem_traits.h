@@ -31,9 +31,14 @@ class list;
 class tuple;
 BOOST_PYTHON_END
 
+class AssociationCache;
+class ClassCache;
+class ClassHierarchy;
+class InstanceCache;
 class CIMInstance;
 class CIMInstanceName;
 class CIMEnumerationContext;
+class NegativeCache;
 class NocaseDict;
 class WBEMConnection;
 
@@ -58,13 +63,26 @@ struct type_name
 
 DEF_TYPE_NAME(bool);
 DEF_TYPE_NAME(int);
+DEF_TYPE_NAME_TYPE(unsigned int, int);
+DEF_TYPE_NAME_TYPE(unsigned long, int);
+DEF_TYPE_NAME_TYPE(double, float);
+DEF_TYPE_NAME(AssociationCache);
+DEF_TYPE_NAME(ClassCache);
+DEF_TYPE_NAME(ClassHierarchy);
+DEF_TYPE_NAME(InstanceCache);
 DEF_TYPE_NAME(CIMInstance);
 DEF_TYPE_NAME(CIMInstanceName);
 DEF_TYPE_NAME(CIMEnumerationContext);
+DEF_TYPE_NAME(NegativeCache);
 DEF_TYPE_NAME(WBEMConnection);
+DEF_TYPE_NAME_TYPE(AssociationCache&, AssociationCache);
+DEF_TYPE_NAME_TYPE(ClassCache&, ClassCache);
+DEF_TYPE_NAME_TYPE(ClassHierarchy&, ClassHierarchy);
+DEF_TYPE_NAME_TYPE(InstanceCache&, InstanceCache);
 DEF_TYPE_NAME_TYPE(CIMInstance&, CIMInstance);
 DEF_TYPE_NAME_TYPE(CIMInstanceName&, CIMInstanceName);
 DEF_TYPE_NAME_TYPE(CIMEnumerationContext&, CIMEnumerationContext);
+DEF_TYPE_NAME_TYPE(NegativeCache&, NegativeCache);
 DEF_TYPE_NAME_TYPE(WBEMConnection&, WBEMConnection);
 DEF_TYPE_NAME(NocaseDict);
 DEF_TYPE_NAME_TYPE(bp::dict, dict);
@@ -22,47 +22,14 @@
 #include <config.h>
 #include <cctype>
 #include <cerrno>
+#include <cstdlib>
 #include <algorithm>
 #include <sstream>
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <netdb.h>
-#include <unistd.h>
-#include <string.h>
+#include "lmiwbem_resolver.h"
 #include "lmiwbem_urlinfo.h"
 
 namespace {
 
-const unsigned int BUFLEN = 1024;
-
-String get_fqdn()
-{
-    struct addrinfo hints, *info, *p;
-    int gai_result;
-    char name[BUFLEN + 1];
-    char port[BUFLEN];
-
-    if (gethostname(name, BUFLEN) < 0)
-        return String("localhost");
-
-    memset(&hints, 0, sizeof hints);
-    hints.ai_family = AF_UNSPEC; // either IPV4 or IPV6
-    hints.ai_socktype = SOCK_STREAM;
-    hints.ai_flags = AI_CANONNAME;
-
-    snprintf(port, BUFLEN, "%d", URLInfo::PORT_CIMXML_HTTPS);
-    if ((gai_result = getaddrinfo(name, port, &hints, &info)) == 0) {
-        for (p = info; p != NULL; p = p->ai_next) {
-            if (p->ai_canonname != NULL) {
-                snprintf(name, BUFLEN, "%s", p->ai_canonname);
-                break;
-            }
-        }
-        freeaddrinfo(info);
-    }
-    return String(name);
-}
-
 bool is_path_delimiter(int i)
 {
     // A bit simplified version how to determine a URL's path. This should work
@@ -135,7 +102,7 @@ bool URLInfo::set(const String &url)
     if (isLocalhost(m_url)) {
         m_is_https = false;
         m_is_local = true;
-        m_hostname = get_fqdn();
+        m_hostname = Resolver::getFQDN();
         m_port = 0;
         return m_is_valid = true;
     }
@@ -20,12 +20,15 @@
  * ***** END LICENSE BLOCK ***** */
 
 #include <config.h>
+#include <sstream>
 #include <boost/python/class.hpp>
 #include <boost/python/dict.hpp>
+#include <boost/python/tuple.hpp>
 #include <Pegasus/Common/CIMClass.h>
 #include <Pegasus/Common/CIMProperty.h>
 #include <Pegasus/Common/CIMQualifier.h>
 #include <Pegasus/Common/CIMMethod.h>
+#include "obj/lmiwbem_config.h"
 #include "obj/lmiwbem_nocasedict.h"
 #include "obj/cim/lmiwbem_class.h"
 #include "obj/cim/lmiwbem_class_pydoc.h"
@@ -33,6 +36,8 @@
 #include "obj/cim/lmiwbem_property.h"
 #include "obj/cim/lmiwbem_qualifier.h"
 #include "util/lmiwbem_convert.h"
+#include "util/lmiwbem_mof.h"
+#include "util/lmiwbem_serialize.h"
 #include "util/lmiwbem_util.h"
 
 CIMClass::CIMClass()
@@ -96,6 +101,9 @@ void CIMClass::init_type()
         .def("__le__", &CIMClass::le)
 #endif // PY_MAJOR_VERSION
         .def("__repr__", &CIMClass::repr, docstr_CIMClass_repr)
+        .def("tomof", &CIMClass::tomof, docstr_CIMClass_tomof)
+        .def("__reduce__", &CIMClass::reduce)
+        .def("__setstate__", &CIMClass::setstate)
         .def("copy", &CIMClass::copy, docstr_CIMClass_copy)
         .add_property("classname",
             &CIMClass::getPyClassname,
@@ -262,6 +270,123 @@ bp::object CIMClass::repr()
     return StringConv::asPyUnicode(ss.str());
 }
 
+bp::object CIMClass::tomof()
+{
+    std::string mof;
+    MOFWriter writer(mof);
+    writer.putClass(asPegasusCIMClass());
+    return StringConv::asPyUnicode(mof);
+}
+
+bp::object CIMClass::reduce() try
+{
+    Serializer s;
+    s.putHeader(Serializer::KIND_CLASS);
+    s.putString(m_classname);
+    s.putString(m_super_classname);
+
+    // Members, which were not evaluated yet, are stored as they are. All of
+    // them are restored lazily when unpickling.
+    if (!m_rc_class_properties.empty()) {
+        std::list<Pegasus::CIMConstProperty> &properties = *m_rc_class_properties.get();
+        std::list<Pegasus::CIMConstProperty>::const_iterator it;
+        s.putSize(properties.size());
+        for (it = properties.begin(); it != properties.end(); ++it)
+            s.putCIMProperty(*it);
+    } else if (!isnone(m_properties)) {
+        const NocaseDict &cim_properties = NocaseDict::asNative(m_properties);
+        nocase_map_t::const_iterator it;
+        s.putSize(cim_properties.size());
+        for (it = cim_properties.begin(); it != cim_properties.end(); ++it) {
+            CIMProperty &property = CIMProperty::asNative(it->second);
+            s.putCIMProperty(property.asPegasusCIMProperty());
+        }
+    } else {
+        s.putSize(0);
+    }
+
+    if (!m_rc_class_qualifiers.empty()) {
+        std::list<Pegasus::CIMConstQualifier> &qualifiers = *m_rc_class_qualifiers.get();
+        std::list<Pegasus::CIMConstQualifier>::const_iterator it;
+        s.putSize(qualifiers.size());
+        for (it = qualifiers.begin(); it != qualifiers.end(); ++it)
+            s.putCIMQualifier(*it);
+    } else if (!isnone(m_qualifiers)) {
+        const NocaseDict &cim_qualifiers = NocaseDict::asNative(m_qualifiers);
+        nocase_map_t::const_iterator it;
+        s.putSize(cim_qualifiers.size());
+        for (it = cim_qualifiers.begin(); it != cim_qualifiers.end(); ++it) {
+            CIMQualifier &qualifier = CIMQualifier::asNative(it->second);
+            s.putCIMQualifier(qualifier.asPegasusCIMQualifier());
+        }
+    } else {
+        s.putSize(0);
+    }
+
+    if (!m_rc_class_methods.empty()) {
+        std::list<Pegasus::CIMConstMethod> &methods = *m_rc_class_methods.get();
+        std::list<Pegasus::CIMConstMethod>::const_iterator it;
+        s.putSize(methods.size());
+        for (it = methods.begin(); it != methods.end(); ++it)
+            s.putCIMMethod(*it);
+    } else if (!isnone(m_methods)) {
+        const NocaseDict &cim_methods = NocaseDict::asNative(m_methods);
+        nocase_map_t::const_iterator it;
+        s.putSize(cim_methods.size());
+        for (it = cim_methods.begin(); it != cim_methods.end(); ++it) {
+            CIMMethod &method = CIMMethod::asNative(it->second);
+            s.putCIMMethod(method.asPegasusCIMMethod());
+        }
+    } else {
+        s.putSize(0);
+    }
+
+    return bp::make_tuple(
+        CIMClass::type(),
+        bp::tuple(),
+        StringConv::asPyBytes(s.data()));
+} catch (...) {
+    std::stringstream ss;
+    if (Config::isVerbose())
+        ss << "CIMClass.__reduce__()";
+    handle_all_exceptions(ss);
+    return None;
+}
+
+void CIMClass::setstate(const bp::object &state) try
+{
+    std::string data(StringConv::asStdBytes(state, "state"));
+    Deserializer d(data);
+    if (d.getHeader() != Serializer::KIND_CLASS)
+        throw_ValueError("CIMClass: Invalid state");
+
+    m_classname = d.getStdString();
+    m_super_classname = d.getStdString();
+    m_properties = None;
+    m_qualifiers = None;
+    m_methods = None;
+
+    m_rc_class_properties.set(std::list<Pegasus::CIMConstProperty>());
+    Pegasus::Uint32 cnt = d.getSize();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        m_rc_class_properties.get()->push_back(d.getCIMProperty());
+
+    m_rc_class_qualifiers.set(std::list<Pegasus::CIMConstQualifier>());
+    cnt = d.getSize();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        m_rc_class_qualifiers.get()->push_back(d.getCIMQualifier());
+
+    m_rc_class_methods.set(std::list<Pegasus::CIMConstMethod>());
+    cnt = d.getSize();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        m_rc_class_methods.get()->push_back(d.getCIMMethod());
+} catch (...) {
+    std::stringstream ss;
+    if (Config::isVerbose())
+        ss << "CIMClass.__setstate__()";
+    handle_all_exceptions(ss);
+}
+
 bp::object CIMClass::copy()
 {
     bp::object py_inst = CIMBase<CIMClass>::create();
@@ -66,6 +66,10 @@ public:
 #  endif // PY_MAJOR_VERSION
 
     bp::object repr();
+    bp::object tomof();
+
+    bp::object reduce();
+    void setstate(const bp::object &state);
 
     bp::object copy();
 
@@ -21,7 +21,7 @@
 
 #include <config.h>
 #include <boost/python/class.hpp>
-#include <Pegasus/Client/CIMEnumerationContext.h>
+#include "lmiwbem_client.h"
 #include "obj/cim/lmiwbem_enum_ctx.h"
 
 CIMEnumerationContext::CIMEnumerationContext()
@@ -40,7 +40,7 @@ void CIMEnumerationContext::init_type()
 }
 
 bp::object CIMEnumerationContext::create(
-    Pegasus::CIMEnumerationContext *ctx_ptr,
+    EnumerationContext *ctx_ptr,
     const bool with_paths,
     const String &ns)
 {
@@ -53,7 +53,7 @@ bp::object CIMEnumerationContext::create(
 }
 
 bp::object CIMEnumerationContext::create(
-    const boost::shared_ptr<Pegasus::CIMEnumerationContext> &ctx_ptr,
+    const boost::shared_ptr<EnumerationContext> &ctx_ptr,
     const bool with_paths,
     const String &ns)
 {
@@ -71,13 +71,13 @@ bp::object CIMEnumerationContext::repr()
         String("CIMEnumerationContext()"));
 }
 
-Pegasus::CIMEnumerationContext &CIMEnumerationContext::getPegasusContext()
+EnumerationContext &CIMEnumerationContext::getPegasusContext()
 {
     if (!m_enum_ctx_ptr) {
         std::cout << "We don't have a context!\n";
 
         // Just in case, we don't dereference a NULL pointer.
-        m_enum_ctx_ptr.reset(new Pegasus::CIMEnumerationContext);
+        m_enum_ctx_ptr.reset(new EnumerationContext);
     }
 
     return *m_enum_ctx_ptr;
@@ -108,4 +108,5 @@ void CIMEnumerationContext::clear()
     if (!m_enum_ctx_ptr)
         return;
     m_enum_ctx_ptr->clear();
+    m_enum_ctx_ptr->resetState();
 }
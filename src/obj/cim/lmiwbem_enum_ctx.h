@@ -30,6 +30,8 @@
 
 namespace bp = boost::python;
 
+class EnumerationContext;
+
 class CIMEnumerationContext: public CIMBase<CIMEnumerationContext>
 {
 public:
@@ -37,17 +39,17 @@ public:
 
     static void init_type();
     static bp::object create(
-        Pegasus::CIMEnumerationContext *ctx_ptr,
+        EnumerationContext *ctx_ptr,
         const bool with_paths = true,
         const String &ns = String());
     static bp::object create(
-        const boost::shared_ptr<Pegasus::CIMEnumerationContext> &ctx_ptr,
+        const boost::shared_ptr<EnumerationContext> &ctx_ptr,
         const bool with_paths = true,
         const String &ns = String());
 
     bp::object repr();
 
-    Pegasus::CIMEnumerationContext &getPegasusContext();
+    EnumerationContext &getPegasusContext();
 
     // These methods are present due to non-uniform Pegasus::CIMClient pull
     // methods (::pullInstancesWithPaths() vs. ::pullInstnaces()).
@@ -59,7 +61,7 @@ public:
     void clear();
 
 private:
-    boost::shared_ptr<Pegasus::CIMEnumerationContext> m_enum_ctx_ptr;
+    boost::shared_ptr<EnumerationContext> m_enum_ctx_ptr;
     bool m_is_with_paths;
     String m_namespace;
 };
@@ -25,6 +25,7 @@
 #include <boost/python/dict.hpp>
 #include <boost/python/list.hpp>
 #include <boost/python/str.hpp>
+#include <boost/python/tuple.hpp>
 #include <Pegasus/Common/CIMInstance.h>
 #include "obj/cim/lmiwbem_instance.h"
 #include "obj/cim/lmiwbem_instance_pydoc.h"
@@ -33,7 +34,10 @@
 #include "obj/cim/lmiwbem_property.h"
 #include "obj/cim/lmiwbem_qualifier.h"
 #include "obj/cim/lmiwbem_value.h"
+#include "obj/lmiwbem_config.h"
 #include "util/lmiwbem_convert.h"
+#include "util/lmiwbem_mof.h"
+#include "util/lmiwbem_serialize.h"
 #include "util/lmiwbem_util.h"
 
 namespace bp = boost::python;
@@ -123,6 +127,8 @@ void CIMInstance::init_type()
         .def("__setitem__", &CIMInstance::setitem)
         .def("__contains__", &CIMInstance::haskey)
         .def("__len__", &CIMInstance::len)
+        .def("__reduce__", &CIMInstance::reduce)
+        .def("__setstate__", &CIMInstance::setstate)
         .def("has_key", &CIMInstance::haskey, docstr_CIMInstance_has_key)
         .def("keys", &CIMInstance::keys, docstr_CIMInstance_keys)
         .def("values", &CIMInstance::values, docstr_CIMInstance_values)
@@ -213,6 +219,52 @@ Pegasus::CIMInstance CIMInstance::asPegasusCIMInstance()
     return peg_instance;
 }
 
+Pegasus::CIMObjectPath CIMInstance::getPegasusCIMObjectPath()
+{
+    if (!m_rc_inst_path.empty())
+        return *m_rc_inst_path.get();
+    if (isnone(m_path))
+        return Pegasus::CIMObjectPath();
+    return CIMInstanceName::asNative(m_path).asPegasusCIMObjectPath();
+}
+
+std::list<Pegasus::CIMConstProperty> CIMInstance::getPegasusCIMProperties()
+{
+    // Properties, which were not evaluated yet, are returned as they are;
+    // they are meant to be read only.
+    if (!m_rc_inst_properties.empty())
+        return *m_rc_inst_properties.get();
+
+    std::list<Pegasus::CIMConstProperty> properties;
+    const NocaseDict &cim_properties = NocaseDict::asNative(getPyProperties());
+    nocase_map_t::const_iterator it;
+    for (it = cim_properties.begin(); it != cim_properties.end(); ++it) {
+        CIMProperty &cim_property = CIMProperty::asNative(it->second);
+        properties.push_back(cim_property.asPegasusCIMProperty());
+    }
+    return properties;
+}
+
+std::list<Pegasus::CIMConstQualifier> CIMInstance::getPegasusCIMQualifiers()
+{
+    if (!m_rc_inst_qualifiers.empty())
+        return *m_rc_inst_qualifiers.get();
+
+    std::list<Pegasus::CIMConstQualifier> qualifiers;
+    const NocaseDict &cim_qualifiers = NocaseDict::asNative(getPyQualifiers());
+    nocase_map_t::const_iterator it;
+    for (it = cim_qualifiers.begin(); it != cim_qualifiers.end(); ++it) {
+        CIMQualifier &cim_qualifier = CIMQualifier::asNative(it->second);
+        qualifiers.push_back(cim_qualifier.asPegasusCIMQualifier());
+    }
+    return qualifiers;
+}
+
+bool CIMInstance::hasLazyProperties()
+{
+    return !m_rc_inst_properties.empty();
+}
+
 #if PY_MAJOR_VERSION < 3
 int CIMInstance::cmp(const bp::object &other)
 {
@@ -424,47 +476,197 @@ bp::object CIMInstance::copy()
     return py_inst;
 }
 
-String CIMInstance::tomofContent(const bp::object &value)
+void CIMInstance::tomofContent(const bp::object &value, std::string &mof)
 {
-    std::stringstream ss;
-
     if (isnone(value)) {
-        ss << "NULL";
+        mof += "NULL";
     } else if (PyList_Check(value.ptr())) {
-        ss << '{';
+        mof += '{';
         const int cnt = bp::len(value);
         for (int i = 0; i < cnt; ++i) {
-            ss << tomofContent(value[i]);
+            tomofContent(value[i], mof);
             if (i < cnt - 1)
-                ss << ", ";
+                mof += ", ";
         }
-        ss << '}';
+        mof += '}';
     } else if (isbasestring(value)) {
-        ss << '\'' << ObjectConv::asString(value) << '\'';
+        mof += '\'';
+        mof += ObjectConv::asString(value);
+        mof += '\'';
     } else {
-        ss << ObjectConv::asString(value);
+        mof += ObjectConv::asString(value);
     }
-
-    return ss.str();
 }
 
 bp::object CIMInstance::tomof()
 {
-    std::stringstream ss;
-    ss << "instance of " << m_classname << " {\n";
+    std::string mof;
+
+    if (!m_rc_inst_properties.empty()) {
+        // Properties were not evaluated yet; render them straight from
+        // Pegasus values. References get the same hostname as in
+        // evalProperties().
+        Pegasus::String hostname;
+        if (!m_rc_inst_path.empty())
+            hostname = m_rc_inst_path.get()->getHost();
+        else if (!isnone(m_path))
+            hostname = getPath().getHostname();
+
+        MOFWriter writer(mof, hostname);
+        writer.putInstance(
+            Pegasus::CIMName(m_classname),
+            *m_rc_inst_properties.get());
+
+        return StringConv::asPyUnicode(mof);
+    }
+
+    mof += "instance of ";
+    mof += m_classname;
+    mof += " {\n";
 
     NocaseDict &cim_properties = NocaseDict::asNative(getPyProperties());
     nocase_map_t::iterator it;
     for (it = cim_properties.begin(); it != cim_properties.end(); ++it) {
         CIMProperty &cim_property = CIMProperty::asNative(it->second);
-        ss << "\t" << cim_property.getName() << " = "
-           << tomofContent(cim_property.getPyValue())
-           << ";\n";
+        mof += '\t';
+        mof += cim_property.getName();
+        mof += " = ";
+        tomofContent(cim_property.getPyValue(), mof);
+        mof += ";\n";
     }
 
-    ss << "};\n";
+    mof += "};\n";
 
-    return StringConv::asPyUnicode(ss.str());
+    return StringConv::asPyUnicode(mof);
+}
+
+bp::object CIMInstance::reduce() try
+{
+    Serializer s;
+    s.putHeader(Serializer::KIND_INSTANCE);
+    s.putString(m_classname);
+
+    if (!m_rc_inst_path.empty()) {
+        s.putBool(true);
+        s.putCIMObjectPath(*m_rc_inst_path.get());
+    } else if (!isnone(m_path)) {
+        s.putBool(true);
+        s.putCIMObjectPath(
+            CIMInstanceName::asNative(m_path).asPegasusCIMObjectPath());
+    } else {
+        s.putBool(false);
+    }
+
+    // Properties, which were not evaluated yet, are stored as they are, so
+    // they will stay lazy after unpickling.
+    const bool is_lazy = !m_rc_inst_properties.empty();
+    s.putBool(is_lazy);
+    if (is_lazy) {
+        std::list<Pegasus::CIMConstProperty> &properties = *m_rc_inst_properties.get();
+        std::list<Pegasus::CIMConstProperty>::const_iterator it;
+        s.putSize(properties.size());
+        for (it = properties.begin(); it != properties.end(); ++it)
+            s.putCIMProperty(*it);
+    } else {
+        if (isnone(m_properties)) {
+            s.putSize(0);
+        } else {
+            const NocaseDict &cim_properties = NocaseDict::asNative(m_properties);
+            nocase_map_t::const_iterator it;
+            s.putSize(cim_properties.size());
+            for (it = cim_properties.begin(); it != cim_properties.end(); ++it) {
+                CIMProperty &cim_property = CIMProperty::asNative(it->second);
+                s.putCIMProperty(cim_property.asPegasusCIMProperty());
+            }
+        }
+
+        s.putBool(!isnone(m_property_list));
+        if (!isnone(m_property_list)) {
+            const int cnt = bp::len(m_property_list);
+            s.putSize(cnt);
+            for (int i = 0; i < cnt; ++i)
+                s.putString(StringConv::asString(m_property_list[i]));
+        }
+    }
+
+    if (!m_rc_inst_qualifiers.empty()) {
+        std::list<Pegasus::CIMConstQualifier> &qualifiers = *m_rc_inst_qualifiers.get();
+        std::list<Pegasus::CIMConstQualifier>::const_iterator it;
+        s.putSize(qualifiers.size());
+        for (it = qualifiers.begin(); it != qualifiers.end(); ++it)
+            s.putCIMQualifier(*it);
+    } else if (!isnone(m_qualifiers)) {
+        const NocaseDict &cim_qualifiers = NocaseDict::asNative(m_qualifiers);
+        nocase_map_t::const_iterator it;
+        s.putSize(cim_qualifiers.size());
+        for (it = cim_qualifiers.begin(); it != cim_qualifiers.end(); ++it) {
+            CIMQualifier &cim_qualifier = CIMQualifier::asNative(it->second);
+            s.putCIMQualifier(cim_qualifier.asPegasusCIMQualifier());
+        }
+    } else {
+        s.putSize(0);
+    }
+
+    return bp::make_tuple(
+        CIMInstance::type(),
+        bp::tuple(),
+        StringConv::asPyBytes(s.data()));
+} catch (...) {
+    std::stringstream ss;
+    if (Config::isVerbose())
+        ss << "CIMInstance.__reduce__()";
+    handle_all_exceptions(ss);
+    return None;
+}
+
+void CIMInstance::setstate(const bp::object &state) try
+{
+    std::string data(StringConv::asStdBytes(state, "state"));
+    Deserializer d(data);
+    if (d.getHeader() != Serializer::KIND_INSTANCE)
+        throw_ValueError("CIMInstance: Invalid state");
+
+    m_classname = d.getStdString();
+    m_path = None;
+    m_properties = None;
+    m_qualifiers = None;
+    m_property_list = None;
+
+    if (d.getBool())
+        m_rc_inst_path.set(d.getCIMObjectPath());
+
+    const bool is_lazy = d.getBool();
+    Pegasus::Uint32 cnt = d.getSize();
+    if (is_lazy) {
+        m_rc_inst_properties.set(std::list<Pegasus::CIMConstProperty>());
+        for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+            m_rc_inst_properties.get()->push_back(d.getCIMProperty());
+    } else {
+        m_properties = NocaseDict::create();
+        for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+            Pegasus::CIMProperty peg_property(d.getCIMProperty());
+            m_properties[bp::object(peg_property.getName())] =
+                CIMProperty::create(peg_property);
+        }
+
+        if (d.getBool()) {
+            bp::list py_property_list;
+            cnt = d.getSize();
+            for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+                py_property_list.append(StringConv::asPyUnicode(d.getString()));
+            m_property_list = py_property_list;
+        }
+    }
+
+    m_rc_inst_qualifiers.set(std::list<Pegasus::CIMConstQualifier>());
+    cnt = d.getSize();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        m_rc_inst_qualifiers.get()->push_back(d.getCIMQualifier());
+} catch (...) {
+    std::stringstream ss;
+    if (Config::isVerbose())
+        ss << "CIMInstance.__setstate__()";
+    handle_all_exceptions(ss);
 }
 
 CIMInstanceName CIMInstance::getPath()
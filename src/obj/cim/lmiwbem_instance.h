@@ -53,6 +53,10 @@ public:
     static bp::object create(const Pegasus::CIMObject &object);
 
     Pegasus::CIMInstance asPegasusCIMInstance();
+    Pegasus::CIMObjectPath getPegasusCIMObjectPath();
+    std::list<Pegasus::CIMConstProperty> getPegasusCIMProperties();
+    std::list<Pegasus::CIMConstQualifier> getPegasusCIMQualifiers();
+    bool hasLazyProperties();
 
 #  if PY_MAJOR_VERSION < 3
     int cmp(const bp::object &other);
@@ -67,6 +71,9 @@ public:
     bp::object repr();
     bp::object tomof();
 
+    bp::object reduce();
+    void setstate(const bp::object &state);
+
     bp::object getitem(const bp::object &key);
     void setitem(const bp::object &key, const bp::object &value);
     bp::object len();
@@ -107,7 +114,7 @@ public:
 private:
     void evalProperties();
 
-    static String tomofContent(const bp::object &value);
+    static void tomofContent(const bp::object &value, std::string &mof);
 
     String m_classname;
     bp::object m_path;
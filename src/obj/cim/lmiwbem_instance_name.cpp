@@ -24,12 +24,15 @@
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/python/class.hpp>
 #include <boost/python/dict.hpp>
+#include <boost/python/tuple.hpp>
 #include <Pegasus/Common/CIMObjectPath.h>
 #include <Pegasus/Common/CIMValue.h>
+#include "obj/lmiwbem_config.h"
 #include "obj/lmiwbem_nocasedict.h"
 #include "obj/cim/lmiwbem_instance_name.h"
 #include "obj/cim/lmiwbem_instance_name_pydoc.h"
 #include "util/lmiwbem_convert.h"
+#include "util/lmiwbem_serialize.h"
 #include "util/lmiwbem_util.h"
 
 CIMInstanceName::CIMInstanceName()
@@ -92,6 +95,8 @@ void CIMInstanceName::init_type()
         .def("__unicode__", &CIMInstanceName::unicode,
             docstr_CIMInstanceName_unicode)
         .def("__repr__", &CIMInstanceName::repr, docstr_CIMInstanceName_repr)
+        .def("__reduce__", &CIMInstanceName::reduce)
+        .def("__setstate__", &CIMInstanceName::setstate)
         .def("__getitem__", &CIMInstanceName::getitem)
         .def("__delitem__", &CIMInstanceName::delitem)
         .def("__setitem__", &CIMInstanceName::setitem)
@@ -305,6 +310,47 @@ bool CIMInstanceName::le(const bp::object &other)
 }
 #endif // PY_MAJOR_VERSION
 
+bp::object CIMInstanceName::reduce() const try
+{
+    Serializer s;
+    s.putHeader(Serializer::KIND_INSTANCE_NAME);
+    s.putCIMObjectPath(asPegasusCIMObjectPath());
+
+    return bp::make_tuple(
+        CIMInstanceName::type(),
+        bp::tuple(),
+        StringConv::asPyBytes(s.data()));
+} catch (...) {
+    std::stringstream ss;
+    if (Config::isVerbose())
+        ss << "CIMInstanceName.__reduce__()";
+    handle_all_exceptions(ss);
+    return None;
+}
+
+void CIMInstanceName::setstate(const bp::object &state) try
+{
+    std::string data(StringConv::asStdBytes(state, "state"));
+    Deserializer d(data);
+    if (d.getHeader() != Serializer::KIND_INSTANCE_NAME)
+        throw_ValueError("CIMInstanceName: Invalid state");
+
+    bp::object py_path(create(d.getCIMObjectPath()));
+    if (isnone(py_path))
+        return;
+
+    const CIMInstanceName &path = CIMInstanceName::asNative(py_path);
+    m_classname = path.m_classname;
+    m_namespace = path.m_namespace;
+    m_hostname = path.m_hostname;
+    m_keybindings = path.m_keybindings;
+} catch (...) {
+    std::stringstream ss;
+    if (Config::isVerbose())
+        ss << "CIMInstanceName.__setstate__()";
+    handle_all_exceptions(ss);
+}
+
 bp::object CIMInstanceName::copy()
 {
     bp::object py_inst = CIMBase<CIMInstanceName>::create();
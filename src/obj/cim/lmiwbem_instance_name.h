@@ -65,6 +65,9 @@ public:
     bp::object unicode() const;
     bp::object repr() const;
 
+    bp::object reduce() const;
+    void setstate(const bp::object &state);
+
     bp::object getitem(const bp::object &key);
     void delitem(const bp::object &key);
     void setitem(const bp::object &key, const bp::object &value);
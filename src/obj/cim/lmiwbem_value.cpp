@@ -149,6 +149,8 @@ Pegasus::String setPegasusValueCore<
     Pegasus::String,
     Pegasus::String>(const bp::object &value)
 {
+    if (isunicode(value))
+        return StringConv::asPegasusString(value);
     return StringConv::asString(value);
 }
 
@@ -307,6 +309,95 @@ Pegasus::CIMValue CIMValue::asPegasusCIMValue(
     return Pegasus::CIMValue();
 }
 
+Pegasus::CIMValue CIMValue::asPegasusCIMValue(
+    const bp::object &value,
+    const Pegasus::CIMType type,
+    const bool is_array)
+{
+    bool is_value_array = isarray(value);
+    if (isnone(value) || (is_value_array && bp::len(value) == 0))
+        return Pegasus::CIMValue(type, is_array);
+
+    // The value does not match the declaration; let the CIMOM decide.
+    if (is_value_array != is_array)
+        return asPegasusCIMValue(value);
+
+    bp::object py_value_type_check = is_array ? value[0] : value;
+
+    bool is_integer = islong(py_value_type_check);
+#if PY_MAJOR_VERSION < 3
+    is_integer = is_integer || isint(py_value_type_check);
+#endif // PY_MAJOR_VERSION
+
+    switch (type) {
+    case Pegasus::CIMTYPE_BOOLEAN:
+        if (is_integer)
+            return setPegasusValueS<bool>(value, is_array);
+        break;
+    case Pegasus::CIMTYPE_UINT8:
+        if (is_integer)
+            return setPegasusValueS<Pegasus::Uint8>(value, is_array);
+        break;
+    case Pegasus::CIMTYPE_SINT8:
+        if (is_integer)
+            return setPegasusValueS<Pegasus::Sint8>(value, is_array);
+        break;
+    case Pegasus::CIMTYPE_UINT16:
+        if (is_integer)
+            return setPegasusValueS<Pegasus::Uint16>(value, is_array);
+        break;
+    case Pegasus::CIMTYPE_SINT16:
+        if (is_integer)
+            return setPegasusValueS<Pegasus::Sint16>(value, is_array);
+        break;
+    case Pegasus::CIMTYPE_UINT32:
+        if (is_integer)
+            return setPegasusValueS<Pegasus::Uint32>(value, is_array);
+        break;
+    case Pegasus::CIMTYPE_SINT32:
+        if (is_integer)
+            return setPegasusValueS<Pegasus::Sint32>(value, is_array);
+        break;
+    case Pegasus::CIMTYPE_UINT64:
+        if (is_integer)
+            return setPegasusValueS<Pegasus::Uint64>(value, is_array);
+        break;
+    case Pegasus::CIMTYPE_SINT64:
+        if (is_integer)
+            return setPegasusValueS<Pegasus::Sint64>(value, is_array);
+        break;
+    case Pegasus::CIMTYPE_REAL32:
+        if (is_integer || isfloat(py_value_type_check))
+            return setPegasusValueS<Pegasus::Real32>(value, is_array);
+        break;
+    case Pegasus::CIMTYPE_REAL64:
+        if (is_integer || isfloat(py_value_type_check))
+            return setPegasusValueS<Pegasus::Real64>(value, is_array);
+        break;
+    case Pegasus::CIMTYPE_STRING:
+        if (isbasestring(py_value_type_check))
+            return setPegasusValueS<Pegasus::String>(value, is_array);
+        break;
+    case Pegasus::CIMTYPE_DATETIME:
+        if (isbasestring(py_value_type_check) ||
+            isinstance(py_value_type_check, CIMDateTime::type()))
+        {
+            return setPegasusValueS<Pegasus::CIMDateTime>(value, is_array);
+        }
+        break;
+    case Pegasus::CIMTYPE_REFERENCE:
+        if (isinstance(py_value_type_check, CIMInstanceName::type()))
+            return setPegasusValueS<Pegasus::CIMObjectPath>(value, is_array);
+        break;
+    default:
+        break;
+    }
+
+    // Char16, embedded objects and values of other types than declared are
+    // converted by their Python type.
+    return asPegasusCIMValue(value);
+}
+
 String CIMValue::asString(const Pegasus::CIMValue &value)
 {
     switch (value.getType()) {
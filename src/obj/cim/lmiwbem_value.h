@@ -23,6 +23,7 @@
 #  define LMIWBEM_VALUE_H
 
 #  include <boost/python/object.hpp>
+#  include <Pegasus/Common/CIMType.h>
 #  include "lmiwbem.h"
 #  include "util/lmiwbem_string.h"
 
@@ -38,6 +39,10 @@ public:
     static Pegasus::CIMValue asPegasusCIMValue(
         const bp::object &value,
         const String &def_type = String());
+    static Pegasus::CIMValue asPegasusCIMValue(
+        const bp::object &value,
+        const Pegasus::CIMType type,
+        const bool is_array);
     static String asString(const Pegasus::CIMValue &value);
 };
 
@@ -0,0 +1,325 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#include <config.h>
+#include <sstream>
+#include <boost/python/class.hpp>
+#include "lmiwbem_exception.h"
+#include "obj/lmiwbem_association_cache.h"
+#include "obj/lmiwbem_association_cache_pydoc.h"
+#include "obj/cim/lmiwbem_instance_name.h"
+#include "util/lmiwbem_convert.h"
+#include "util/lmiwbem_util.h"
+
+namespace {
+
+const double ASSOCIATION_CACHE_DEFAULT_TTL = 60.0;
+const size_t ASSOCIATION_CACHE_DEFAULT_MAX_SIZE = 10000;
+
+} // unnamed namespace
+
+AssociationCache::Key::Key(
+    const String &url,
+    const String &ns,
+    const Pegasus::CIMObjectPath &path,
+    const String &assoc_class,
+    const String &result_class,
+    const String &role,
+    const String &result_role)
+    : m_url(url)
+    , m_ns(lower(ns))
+    , m_path(canonical_path(path))
+    , m_filter()
+{
+    // Filters are prefixed with their length, so the string is unambiguous.
+    std::stringstream ss;
+    ss << assoc_class.size() << ':' << lower(assoc_class)
+       << result_class.size() << ':' << lower(result_class)
+       << role.size() << ':' << lower(role)
+       << result_role.size() << ':' << lower(result_role);
+    m_filter = ss.str();
+}
+
+bool AssociationCache::Key::operator<(const Key &rhs) const
+{
+    if (m_path != rhs.m_path)
+        return m_path < rhs.m_path;
+    if (m_filter != rhs.m_filter)
+        return m_filter < rhs.m_filter;
+    if (m_ns != rhs.m_ns)
+        return m_ns < rhs.m_ns;
+    return m_url < rhs.m_url;
+}
+
+AssociationCache::Entry::Entry(
+    const Key &key,
+    const Pegasus::Array<Pegasus::CIMObjectPath> &names,
+    double expires)
+    : m_key(key)
+    , m_names(names)
+    , m_expires(expires)
+{
+}
+
+bool AssociationCache::Entry::refers(const String &path) const
+{
+    if (m_key.m_path == path)
+        return true;
+
+    const Pegasus::Uint32 cnt = m_names.size();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+        if (canonical_path(m_names[i]) == path)
+            return true;
+    }
+
+    return false;
+}
+
+AssociationCache::AssociationCache(
+    const bp::object &ttl,
+    const bp::object &max_size)
+    : m_mutex()
+    , m_entries()
+    , m_index()
+    , m_ttl(ASSOCIATION_CACHE_DEFAULT_TTL)
+    , m_max_size(ASSOCIATION_CACHE_DEFAULT_MAX_SIZE)
+    , m_hits(0)
+    , m_misses(0)
+{
+    setPyTTL(ttl);
+    setPyMaxSize(max_size);
+}
+
+void AssociationCache::init_type()
+{
+    CIMBase<AssociationCache>::init_type(
+        bp::class_<AssociationCache, boost::noncopyable>("AssociationCache", bp::no_init)
+        .def(bp::init<
+            const bp::object &,
+            const bp::object &>((
+                bp::arg("ttl") = ASSOCIATION_CACHE_DEFAULT_TTL,
+                bp::arg("max_size") = ASSOCIATION_CACHE_DEFAULT_MAX_SIZE),
+                docstr_AssociationCache_init))
+        .def("__repr__", &AssociationCache::repr, docstr_AssociationCache_repr)
+        .def("__len__", &AssociationCache::len)
+        .def("invalidate", &AssociationCache::invalidate,
+            (bp::arg("ObjectName") = None,
+             bp::arg("url") = None),
+            docstr_AssociationCache_invalidate)
+        .def("clear", &AssociationCache::clear, docstr_AssociationCache_clear)
+        .add_property("ttl",
+            &AssociationCache::getPyTTL,
+            &AssociationCache::setPyTTL,
+            docstr_AssociationCache_ttl)
+        .add_property("max_size",
+            &AssociationCache::getPyMaxSize,
+            &AssociationCache::setPyMaxSize,
+            docstr_AssociationCache_max_size)
+        .add_property("hits", &AssociationCache::getPyHits)
+        .add_property("misses", &AssociationCache::getPyMisses));
+}
+
+bp::object AssociationCache::repr()
+{
+    ScopedMutex sm(m_mutex);
+    std::stringstream ss;
+    ss << "AssociationCache(ttl=" << m_ttl << ", max_size=" << m_max_size
+       << ", len=" << m_entries.size() << ", ...)";
+    return StringConv::asPyUnicode(ss.str());
+}
+
+bool AssociationCache::getAssociatorNames(
+    const String &url,
+    const String &ns,
+    const Pegasus::CIMObjectPath &path,
+    const String &assoc_class,
+    const String &result_class,
+    const String &role,
+    const String &result_role,
+    Pegasus::Array<Pegasus::CIMObjectPath> &names)
+{
+    ScopedMutex sm(m_mutex);
+
+    EntryIndex::iterator found = m_index.find(
+        Key(url, ns, path, assoc_class, result_class, role, result_role));
+    if (found == m_index.end()) {
+        ++m_misses;
+        return false;
+    }
+
+    EntryList::iterator entry = found->second;
+    if (entry->m_expires < monotonic_now()) {
+        erase(entry);
+        ++m_misses;
+        return false;
+    }
+
+    // Move the entry to the front of LRU list.
+    m_entries.splice(m_entries.begin(), m_entries, entry);
+
+    names = entry->m_names;
+    ++m_hits;
+    return true;
+}
+
+void AssociationCache::addAssociatorNames(
+    const String &url,
+    const String &ns,
+    const Pegasus::CIMObjectPath &path,
+    const String &assoc_class,
+    const String &result_class,
+    const String &role,
+    const String &result_role,
+    const Pegasus::Array<Pegasus::CIMObjectPath> &names)
+{
+    ScopedMutex sm(m_mutex);
+
+    Key key(url, ns, path, assoc_class, result_class, role, result_role);
+
+    EntryIndex::iterator found = m_index.find(key);
+    if (found != m_index.end())
+        erase(found->second);
+
+    m_entries.push_front(Entry(key, names, monotonic_now() + m_ttl));
+    m_index[key] = m_entries.begin();
+
+    shrink();
+}
+
+void AssociationCache::invalidateInstance(
+    const String &url,
+    const String &ns,
+    const Pegasus::CIMObjectPath &path)
+{
+    ScopedMutex sm(m_mutex);
+
+    String c_path(canonical_path(path));
+    String c_ns(lower(ns));
+
+    EntryList::iterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        const Key &key = it->m_key;
+        if (key.m_ns == c_ns && key.m_url == url && it->refers(c_path))
+            erase(it++);
+        else
+            ++it;
+    }
+}
+
+void AssociationCache::invalidate(
+    const bp::object &object_name,
+    const bp::object &url)
+{
+    String c_path;
+    String c_ns;
+    String c_url;
+    if (!isnone(object_name)) {
+        const CIMInstanceName &cim_inst_name = CIMInstanceName::asNative(
+            object_name, "ObjectName");
+        c_path = canonical_path(cim_inst_name.asPegasusCIMObjectPath());
+        c_ns = lower(cim_inst_name.getNamespace());
+    }
+    if (!isnone(url))
+        c_url = StringConv::asString(url, "url");
+
+    ScopedMutex sm(m_mutex);
+
+    EntryList::iterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        const Key &key = it->m_key;
+        if ((isnone(object_name) || ((c_ns.empty() || key.m_ns == c_ns) &&
+                it->refers(c_path))) &&
+            (isnone(url) || key.m_url == c_url))
+        {
+            erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void AssociationCache::clear()
+{
+    ScopedMutex sm(m_mutex);
+    m_entries.clear();
+    m_index.clear();
+}
+
+bp::object AssociationCache::len()
+{
+    ScopedMutex sm(m_mutex);
+    return bp::object(m_entries.size());
+}
+
+bp::object AssociationCache::getPyTTL() const
+{
+    return bp::object(m_ttl);
+}
+
+bp::object AssociationCache::getPyMaxSize() const
+{
+    return bp::object(m_max_size);
+}
+
+bp::object AssociationCache::getPyHits() const
+{
+    return bp::object(m_hits);
+}
+
+bp::object AssociationCache::getPyMisses() const
+{
+    return bp::object(m_misses);
+}
+
+void AssociationCache::setPyTTL(const bp::object &ttl)
+{
+    double c_ttl = Conv::as<double>(ttl, "ttl");
+    if (c_ttl < 0)
+        throw_ValueError("ttl must be non-negative");
+
+    ScopedMutex sm(m_mutex);
+    m_ttl = c_ttl;
+}
+
+void AssociationCache::setPyMaxSize(const bp::object &max_size)
+{
+    size_t c_max_size = Conv::as<size_t>(max_size, "max_size");
+    if (c_max_size == 0)
+        throw_ValueError("max_size must be positive");
+
+    ScopedMutex sm(m_mutex);
+    m_max_size = c_max_size;
+    shrink();
+}
+
+void AssociationCache::erase(EntryList::iterator entry)
+{
+    m_index.erase(entry->m_key);
+    m_entries.erase(entry);
+}
+
+void AssociationCache::shrink()
+{
+    while (m_entries.size() > m_max_size) {
+        EntryList::iterator last = m_entries.end();
+        erase(--last);
+    }
+}
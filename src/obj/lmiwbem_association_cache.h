@@ -0,0 +1,142 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef   LMIWBEM_ASSOCIATION_CACHE_H
+#  define LMIWBEM_ASSOCIATION_CACHE_H
+
+#  include <list>
+#  include <map>
+#  include <boost/python/object.hpp>
+#  include <Pegasus/Common/CIMObjectPath.h>
+#  include "lmiwbem.h"
+#  include "lmiwbem_mutex.h"
+#  include "obj/lmiwbem_cimbase.h"
+#  include "util/lmiwbem_string.h"
+
+namespace bp = boost::python;
+
+// Cache of AssociatorNames() results; the edges of the association graph.
+// Results are keyed by the CIMOM's URL, canonical object path and the
+// AssocClass, ResultClass, Role and ResultRole filters. Entries expire after
+// TTL seconds and the least recently used ones are dropped, when the number of
+// entries exceeds the limit.
+class AssociationCache: public CIMBase<AssociationCache>
+{
+public:
+    AssociationCache(
+        const bp::object &ttl,
+        const bp::object &max_size);
+
+    static void init_type();
+
+    bp::object repr();
+
+    bool getAssociatorNames(
+        const String &url,
+        const String &ns,
+        const Pegasus::CIMObjectPath &path,
+        const String &assoc_class,
+        const String &result_class,
+        const String &role,
+        const String &result_role,
+        Pegasus::Array<Pegasus::CIMObjectPath> &names);
+    void addAssociatorNames(
+        const String &url,
+        const String &ns,
+        const Pegasus::CIMObjectPath &path,
+        const String &assoc_class,
+        const String &result_class,
+        const String &role,
+        const String &result_role,
+        const Pegasus::Array<Pegasus::CIMObjectPath> &names);
+    void invalidateInstance(
+        const String &url,
+        const String &ns,
+        const Pegasus::CIMObjectPath &path);
+
+    void invalidate(
+        const bp::object &object_name,
+        const bp::object &url);
+    void clear();
+
+    bp::object len();
+
+    bp::object getPyTTL() const;
+    bp::object getPyMaxSize() const;
+    bp::object getPyHits() const;
+    bp::object getPyMisses() const;
+
+    void setPyTTL(const bp::object &ttl);
+    void setPyMaxSize(const bp::object &max_size);
+
+private:
+    class Key
+    {
+    public:
+        Key(
+            const String &url,
+            const String &ns,
+            const Pegasus::CIMObjectPath &path,
+            const String &assoc_class,
+            const String &result_class,
+            const String &role,
+            const String &result_role);
+
+        bool operator<(const Key &rhs) const;
+
+        String m_url;
+        String m_ns;
+        String m_path;
+        String m_filter;
+    };
+
+    class Entry
+    {
+    public:
+        Entry(
+            const Key &key,
+            const Pegasus::Array<Pegasus::CIMObjectPath> &names,
+            double expires);
+
+        bool refers(const String &path) const;
+
+        Key m_key;
+        Pegasus::Array<Pegasus::CIMObjectPath> m_names;
+        double m_expires;
+    };
+
+    // Entries are kept in LRU order, most recently used first.
+    typedef std::list<Entry> EntryList;
+    typedef std::map<Key, EntryList::iterator> EntryIndex;
+
+    void erase(EntryList::iterator entry);
+    void shrink();
+
+    Mutex m_mutex;
+    EntryList m_entries;
+    EntryIndex m_index;
+    double m_ttl;
+    size_t m_max_size;
+    unsigned long m_hits;
+    unsigned long m_misses;
+};
+
+#endif // LMIWBEM_ASSOCIATION_CACHE_H
@@ -0,0 +1,639 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#include <config.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <boost/python/class.hpp>
+#include "lmiwbem_exception.h"
+#include "obj/lmiwbem_class_cache.h"
+#include "obj/lmiwbem_class_cache_pydoc.h"
+#include "util/lmiwbem_convert.h"
+#include "util/lmiwbem_serialize.h"
+#include "util/lmiwbem_util.h"
+
+namespace {
+
+const double CLASS_CACHE_DEFAULT_TTL = 300.0;
+const unsigned int CLASS_CACHE_DEFAULT_MAX_SIZE = 1000;
+
+// Cache file layout (all the integers are little-endian):
+//
+//   magic    8 bytes
+//   version  Uint32
+//   strings  string table of identifiers
+//   schemas  URL, namespace and number of classes of each namespace
+//   classes  URL, namespace, class name, GetClass() flags and the class
+const char CLASS_CACHE_MAGIC[8] = { 'L', 'M', 'I', 'C', 'L', 'S', 'C', '\0' };
+const Pegasus::Uint32 CLASS_CACHE_VERSION = 1;
+
+enum {
+    FLAG_LOCAL_ONLY           = 1 << 0,
+    FLAG_INCLUDE_QUALIFIERS   = 1 << 1,
+    FLAG_INCLUDE_CLASS_ORIGIN = 1 << 2
+};
+
+String errno_message(const String &prefix, const String &filename)
+{
+    std::stringstream ss;
+    ss << prefix << " '" << filename << "': " << strerror(errno);
+    return ss.str();
+}
+
+bool write_all(int fd, const std::string &data)
+{
+    const char *ptr = data.data();
+    size_t size = data.size();
+    while (size > 0) {
+        ssize_t written = ::write(fd, ptr, size);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written < 0)
+            return false;
+        ptr += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+} // unnamed namespace
+
+ClassCache::Key::Key(
+    const String &url,
+    const String &ns,
+    const String &classname,
+    bool local_only,
+    bool include_qualifiers,
+    bool include_class_origin)
+    : m_url(url)
+    , m_ns(lower(ns))
+    , m_classname(lower(classname))
+    , m_flags(0)
+{
+    if (local_only)
+        m_flags |= FLAG_LOCAL_ONLY;
+    if (include_qualifiers)
+        m_flags |= FLAG_INCLUDE_QUALIFIERS;
+    if (include_class_origin)
+        m_flags |= FLAG_INCLUDE_CLASS_ORIGIN;
+}
+
+ClassCache::Key::Key(
+    const String &url,
+    const String &ns,
+    const String &classname,
+    unsigned int flags)
+    : m_url(url)
+    , m_ns(lower(ns))
+    , m_classname(lower(classname))
+    , m_flags(flags)
+{
+}
+
+bool ClassCache::Key::operator<(const Key &rhs) const
+{
+    if (m_classname != rhs.m_classname)
+        return m_classname < rhs.m_classname;
+    if (m_ns != rhs.m_ns)
+        return m_ns < rhs.m_ns;
+    if (m_url != rhs.m_url)
+        return m_url < rhs.m_url;
+    return m_flags < rhs.m_flags;
+}
+
+ClassCache::Entry::Entry(
+    const Pegasus::CIMClass &cls,
+    double expires,
+    LRUList::iterator lru)
+    : m_class(cls)
+    , m_expires(expires)
+    , m_lru(lru)
+    , m_methods()
+{
+}
+
+ClassCache::Schema::Schema()
+    : m_class_count(0)
+    , m_validated(false)
+{
+}
+
+ClassCache::ClassCache(
+    const bp::object &ttl,
+    const bp::object &max_size,
+    const bp::object &filename)
+    : m_mutex()
+    , m_entries()
+    , m_lru()
+    , m_ttl(CLASS_CACHE_DEFAULT_TTL)
+    , m_max_size(CLASS_CACHE_DEFAULT_MAX_SIZE)
+    , m_hits(0)
+    , m_misses(0)
+    , m_filename()
+    , m_schemas()
+{
+    setPyTTL(ttl);
+    setPyMaxSize(max_size);
+
+    if (!isnone(filename)) {
+        m_filename = StringConv::asString(filename, "filename");
+        load();
+    }
+}
+
+void ClassCache::init_type()
+{
+    CIMBase<ClassCache>::init_type(
+        bp::class_<ClassCache, boost::noncopyable>("ClassCache", bp::no_init)
+        .def(bp::init<
+            const bp::object &,
+            const bp::object &,
+            const bp::object &>((
+                bp::arg("ttl") = CLASS_CACHE_DEFAULT_TTL,
+                bp::arg("max_size") = CLASS_CACHE_DEFAULT_MAX_SIZE,
+                bp::arg("filename") = None),
+                docstr_ClassCache_init))
+        .def("__repr__", &ClassCache::repr, docstr_ClassCache_repr)
+        .def("__len__", &ClassCache::len)
+        .def("invalidate", &ClassCache::invalidate,
+            (bp::arg("ClassName") = None,
+             bp::arg("namespace") = None,
+             bp::arg("url") = None),
+            docstr_ClassCache_invalidate)
+        .def("clear", &ClassCache::clear, docstr_ClassCache_clear)
+        .def("save", &ClassCache::save, docstr_ClassCache_save)
+        .add_property("ttl",
+            &ClassCache::getPyTTL,
+            &ClassCache::setPyTTL,
+            docstr_ClassCache_ttl)
+        .add_property("max_size",
+            &ClassCache::getPyMaxSize,
+            &ClassCache::setPyMaxSize,
+            docstr_ClassCache_max_size)
+        .add_property("hits", &ClassCache::getPyHits)
+        .add_property("misses", &ClassCache::getPyMisses)
+        .add_property("filename",
+            &ClassCache::getPyFilename,
+            docstr_ClassCache_filename));
+}
+
+bp::object ClassCache::repr()
+{
+    ScopedMutex sm(m_mutex);
+    std::stringstream ss;
+    ss << "ClassCache(ttl=" << m_ttl << ", max_size=" << m_max_size
+       << ", len=" << m_entries.size() << ", ...)";
+    return StringConv::asPyUnicode(ss.str());
+}
+
+bool ClassCache::getClass(
+    const String &url,
+    const String &ns,
+    const String &classname,
+    bool local_only,
+    bool include_qualifiers,
+    bool include_class_origin,
+    Pegasus::CIMClass &cls)
+{
+    ScopedMutex sm(m_mutex);
+
+    EntryMap::iterator found = find(
+        Key(url, ns, classname, local_only, include_qualifiers,
+            include_class_origin));
+    if (found == m_entries.end())
+        return false;
+
+    cls = found->second.m_class;
+    return true;
+}
+
+bool ClassCache::getMethod(
+    const String &url,
+    const String &ns,
+    const String &classname,
+    const String &method,
+    Pegasus::CIMConstMethod &peg_method)
+{
+    ScopedMutex sm(m_mutex);
+
+    EntryMap::iterator found = find(
+        Key(url, ns, classname, false, false, false));
+    if (found == m_entries.end())
+        return false;
+
+    Entry &entry = found->second;
+    if (entry.m_methods.empty() && !entry.m_class.isUninitialized()) {
+        // Index the methods on first use.
+        const Pegasus::Uint32 cnt = entry.m_class.getMethodCount();
+        for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+            Pegasus::CIMConstMethod peg_cls_method(entry.m_class.getMethod(i));
+            entry.m_methods[lower(peg_cls_method.getName().getString())] =
+                peg_cls_method;
+        }
+    }
+
+    std::map<String, Pegasus::CIMConstMethod>::const_iterator method_it =
+        entry.m_methods.find(lower(method));
+    if (method_it != entry.m_methods.end())
+        peg_method = method_it->second;
+
+    return true;
+}
+
+void ClassCache::addClass(
+    const String &url,
+    const String &ns,
+    const String &classname,
+    bool local_only,
+    bool include_qualifiers,
+    bool include_class_origin,
+    const Pegasus::CIMClass &cls)
+{
+    ScopedMutex sm(m_mutex);
+
+    Key key(url, ns, classname, local_only, include_qualifiers,
+        include_class_origin);
+
+    EntryMap::iterator found = m_entries.find(key);
+    if (found != m_entries.end())
+        erase(found);
+
+    m_lru.push_front(key);
+    m_entries.insert(
+        std::make_pair(
+            key, Entry(cls, monotonic_now() + m_ttl, m_lru.begin())));
+
+    shrink();
+}
+
+bool ClassCache::needsValidation(const String &url, const String &ns)
+{
+    if (m_filename.empty())
+        return false;
+
+    ScopedMutex sm(m_mutex);
+    SchemaMap::const_iterator found = m_schemas.find(
+        std::make_pair(url, lower(ns)));
+    return found == m_schemas.end() || !found->second.m_validated;
+}
+
+void ClassCache::setClassCount(
+    const String &url,
+    const String &ns,
+    Pegasus::Uint32 count)
+{
+    ScopedMutex sm(m_mutex);
+
+    const String c_ns(lower(ns));
+    std::pair<SchemaMap::iterator, bool> inserted = m_schemas.insert(
+        std::make_pair(std::make_pair(url, c_ns), Schema()));
+    Schema &schema = inserted.first->second;
+    if (!inserted.second && schema.m_class_count != count) {
+        // The schema has changed since the classes were stored; drop them.
+        EntryMap::iterator it = m_entries.begin();
+        while (it != m_entries.end()) {
+            if (it->first.m_url == url && it->first.m_ns == c_ns)
+                erase(it++);
+            else
+                ++it;
+        }
+    }
+
+    schema.m_class_count = count;
+    schema.m_validated = true;
+}
+
+void ClassCache::invalidate(
+    const bp::object &cls,
+    const bp::object &ns,
+    const bp::object &url)
+{
+    String c_cls;
+    String c_ns;
+    String c_url;
+    if (!isnone(cls))
+        c_cls = lower(StringConv::asString(cls, "ClassName"));
+    if (!isnone(ns))
+        c_ns = lower(StringConv::asString(ns, "namespace"));
+    if (!isnone(url))
+        c_url = StringConv::asString(url, "url");
+
+    ScopedMutex sm(m_mutex);
+
+    EntryMap::iterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        const Key &key = it->first;
+        if ((isnone(cls) || key.m_classname == c_cls) &&
+            (isnone(ns)  || key.m_ns == c_ns) &&
+            (isnone(url) || key.m_url == c_url))
+        {
+            erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ClassCache::clear()
+{
+    ScopedMutex sm(m_mutex);
+    m_entries.clear();
+    m_lru.clear();
+}
+
+void ClassCache::save() try
+{
+    if (m_filename.empty())
+        throw_ValueError("ClassCache was constructed without filename");
+
+    SerializerStringTable strings;
+    Serializer body(&strings);
+    {
+        ScopedMutex sm(m_mutex);
+
+        body.putSize(m_schemas.size());
+        SchemaMap::const_iterator schema_it;
+        for (schema_it = m_schemas.begin(); schema_it != m_schemas.end(); ++schema_it) {
+            body.putString(schema_it->first.first);
+            body.putString(schema_it->first.second);
+            body.putUint32(schema_it->second.m_class_count);
+        }
+
+        // Only classes of namespaces with known number of classes can be
+        // validated when loaded.
+        const double now = monotonic_now();
+        std::vector<EntryMap::const_iterator> stored;
+        EntryMap::const_iterator it;
+        for (it = m_entries.begin(); it != m_entries.end(); ++it) {
+            const Key &key = it->first;
+            if (it->second.m_expires >= now &&
+                m_schemas.find(std::make_pair(key.m_url, key.m_ns)) !=
+                m_schemas.end())
+            {
+                stored.push_back(it);
+            }
+        }
+
+        body.putSize(stored.size());
+        for (size_t i = 0; i < stored.size(); ++i) {
+            const Key &key = stored[i]->first;
+            body.putString(key.m_url);
+            body.putString(key.m_ns);
+            body.putString(key.m_classname);
+            body.putUint8(static_cast<Pegasus::Uint8>(key.m_flags));
+            body.putCIMClass(stored[i]->second.m_class);
+        }
+    }
+
+    Serializer header;
+    for (size_t i = 0; i < sizeof(CLASS_CACHE_MAGIC); ++i)
+        header.putUint8(static_cast<Pegasus::Uint8>(CLASS_CACHE_MAGIC[i]));
+    header.putUint32(CLASS_CACHE_VERSION);
+    const std::vector<std::string> &table = strings.strings();
+    header.putSize(table.size());
+    for (size_t i = 0; i < table.size(); ++i)
+        header.putString(table[i]);
+
+    // Write a uniquely named temporary file in the same directory and rename
+    // it, so concurrent processes never load a partially written cache nor
+    // write the same temporary file.
+    const char suffix[] = ".XXXXXX";
+    std::vector<char> tmp_template(m_filename.begin(), m_filename.end());
+    tmp_template.insert(tmp_template.end(), suffix, suffix + sizeof(suffix));
+    int fd = ::mkstemp(&tmp_template[0]);
+    if (fd < 0)
+        throw_IOError(errno_message("Can't create class cache", m_filename));
+    const String tmp_filename(&tmp_template[0]);
+
+    String msg;
+    if (::fchmod(fd, 0644) < 0 ||
+        !write_all(fd, header.data()) ||
+        !write_all(fd, body.data()) ||
+        ::fsync(fd) < 0)
+    {
+        msg = errno_message("Can't write class cache", tmp_filename);
+    }
+    if (::close(fd) < 0 && msg.empty())
+        msg = errno_message("Can't write class cache", tmp_filename);
+    if (msg.empty() && ::rename(tmp_filename.c_str(), m_filename.c_str()) < 0)
+        msg = errno_message("Can't write class cache", m_filename);
+
+    if (!msg.empty()) {
+        ::unlink(tmp_filename.c_str());
+        throw_IOError(msg);
+    }
+} catch (...) {
+    std::stringstream ss;
+    ss << "ClassCache.save()";
+    handle_all_exceptions(ss);
+}
+
+bp::object ClassCache::len()
+{
+    ScopedMutex sm(m_mutex);
+    return bp::object(m_entries.size());
+}
+
+bp::object ClassCache::getPyTTL() const
+{
+    return bp::object(m_ttl);
+}
+
+bp::object ClassCache::getPyMaxSize() const
+{
+    return bp::object(m_max_size);
+}
+
+bp::object ClassCache::getPyHits() const
+{
+    return bp::object(m_hits);
+}
+
+bp::object ClassCache::getPyMisses() const
+{
+    return bp::object(m_misses);
+}
+
+bp::object ClassCache::getPyFilename() const
+{
+    if (m_filename.empty())
+        return None;
+    return StringConv::asPyUnicode(m_filename);
+}
+
+void ClassCache::setPyTTL(const bp::object &ttl)
+{
+    double c_ttl = Conv::as<double>(ttl, "ttl");
+    if (c_ttl < 0)
+        throw_ValueError("ttl must be non-negative");
+
+    ScopedMutex sm(m_mutex);
+    m_ttl = c_ttl;
+}
+
+void ClassCache::setPyMaxSize(const bp::object &max_size)
+{
+    unsigned int c_max_size = Conv::as<unsigned int>(max_size, "max_size");
+    if (c_max_size == 0)
+        throw_ValueError("max_size must be positive");
+
+    ScopedMutex sm(m_mutex);
+    m_max_size = c_max_size;
+    shrink();
+}
+
+ClassCache::EntryMap::iterator ClassCache::find(const Key &key)
+{
+    EntryMap::iterator found = m_entries.find(key);
+    if (found == m_entries.end()) {
+        ++m_misses;
+        return found;
+    }
+
+    if (found->second.m_expires < monotonic_now()) {
+        erase(found);
+        ++m_misses;
+        return m_entries.end();
+    }
+
+    // Move the entry to the front of LRU list.
+    m_lru.splice(m_lru.begin(), m_lru, found->second.m_lru);
+
+    ++m_hits;
+    return found;
+}
+
+void ClassCache::erase(EntryMap::iterator it)
+{
+    m_lru.erase(it->second.m_lru);
+    m_entries.erase(it);
+}
+
+void ClassCache::shrink()
+{
+    while (m_entries.size() > m_max_size) {
+        m_entries.erase(m_lru.back());
+        m_lru.pop_back();
+    }
+}
+
+void ClassCache::load()
+{
+    int fd = ::open(m_filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        // Missing file is an empty cache.
+        if (errno == ENOENT)
+            return;
+        throw_IOError(errno_message("Can't open class cache", m_filename));
+    }
+
+    std::string data;
+    struct stat st;
+    if (fstat(fd, &st) == 0)
+        data.resize(static_cast<size_t>(st.st_size));
+
+    size_t pos = 0;
+    while (pos < data.size()) {
+        ssize_t rval = ::read(fd, &data[pos], data.size() - pos);
+        if (rval < 0 && errno == EINTR)
+            continue;
+        if (rval <= 0)
+            break;
+        pos += static_cast<size_t>(rval);
+    }
+    ::close(fd);
+    data.resize(pos);
+
+    // Cache file of other version or a corrupted one is not an error; the
+    // cache just starts empty and is rewritten by save().
+    if (data.size() < sizeof(CLASS_CACHE_MAGIC) ||
+        memcmp(data.data(), CLASS_CACHE_MAGIC, sizeof(CLASS_CACHE_MAGIC)) != 0)
+    {
+        return;
+    }
+
+    SchemaMap schemas;
+    EntryMap entries;
+    LRUList lru;
+    try {
+        Deserializer header(
+            data.data() + sizeof(CLASS_CACHE_MAGIC),
+            data.size() - sizeof(CLASS_CACHE_MAGIC));
+        if (header.getUint32() != CLASS_CACHE_VERSION)
+            return;
+
+        // Each string takes at least a byte; a larger count comes from
+        // a truncated or corrupted file.
+        const Pegasus::Uint32 table_size = header.getSize();
+        if (table_size > header.remaining())
+            return;
+
+        std::vector<Pegasus::String> table(table_size);
+        for (size_t i = 0; i < table.size(); ++i)
+            table[i] = header.getString();
+
+        const size_t body_pos = sizeof(CLASS_CACHE_MAGIC) + header.pos();
+        Deserializer body(
+            data.data() + body_pos, data.size() - body_pos, &table);
+
+        Pegasus::Uint32 cnt = body.getSize();
+        for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+            String url(body.getStdString());
+            String ns(body.getStdString());
+            schemas[std::make_pair(url, ns)].m_class_count = body.getUint32();
+        }
+
+        const double expires = monotonic_now() + m_ttl;
+        cnt = body.getSize();
+        for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+            String url(body.getStdString());
+            String ns(body.getStdString());
+            String classname(body.getStdString());
+            unsigned int flags = body.getUint8();
+            Key key(url, ns, classname, flags);
+            Pegasus::CIMClass cls(body.getCIMClass());
+            if (entries.find(key) != entries.end())
+                continue;
+
+            lru.push_back(key);
+            entries.insert(
+                std::make_pair(key, Entry(cls, expires, --lru.end())));
+        }
+    } catch (const Exception &) {
+        return;
+    } catch (const Pegasus::Exception &) {
+        return;
+    }
+
+    ScopedMutex sm(m_mutex);
+    m_schemas.swap(schemas);
+    m_entries.swap(entries);
+    m_lru.swap(lru);
+    shrink();
+}
@@ -0,0 +1,180 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef   LMIWBEM_CLASS_CACHE_H
+#  define LMIWBEM_CLASS_CACHE_H
+
+#  include <list>
+#  include <map>
+#  include <boost/python/object.hpp>
+#  include <Pegasus/Common/CIMClass.h>
+#  include <Pegasus/Common/CIMMethod.h>
+#  include "lmiwbem.h"
+#  include "lmiwbem_mutex.h"
+#  include "obj/lmiwbem_cimbase.h"
+#  include "util/lmiwbem_string.h"
+
+namespace bp = boost::python;
+
+// Client-side cache of CIM classes. The cache is keyed by the CIMOM's URL,
+// namespace, class name and the GetClass() flags, which alter the content of
+// returned class. Entries expire after TTL seconds and the least recently
+// used ones are dropped when the cache grows over its size limit. A single
+// cache can be shared by several WBEMConnection objects.
+//
+// Cache constructed with a filename is persistent: it is loaded from the file
+// and save() stores it back. Each namespace's classes are stored with the
+// number of classes in the namespace, which is compared with the CIMOM's on
+// first use of the namespace in the process; see needsValidation().
+class ClassCache: public CIMBase<ClassCache>
+{
+public:
+    ClassCache(
+        const bp::object &ttl,
+        const bp::object &max_size,
+        const bp::object &filename);
+
+    static void init_type();
+
+    bp::object repr();
+
+    bool getClass(
+        const String &url,
+        const String &ns,
+        const String &classname,
+        bool local_only,
+        bool include_qualifiers,
+        bool include_class_origin,
+        Pegasus::CIMClass &cls);
+    void addClass(
+        const String &url,
+        const String &ns,
+        const String &classname,
+        bool local_only,
+        bool include_qualifiers,
+        bool include_class_origin,
+        const Pegasus::CIMClass &cls);
+
+    // Method signatures come from classes cached with LocalOnly=False, so
+    // inherited methods are included, and without qualifiers.
+    bool getMethod(
+        const String &url,
+        const String &ns,
+        const String &classname,
+        const String &method,
+        Pegasus::CIMConstMethod &peg_method);
+
+    // Loaded classes of the namespace are not validated yet; the caller
+    // shall count the classes on the CIMOM and call setClassCount().
+    bool needsValidation(const String &url, const String &ns);
+    void setClassCount(
+        const String &url,
+        const String &ns,
+        Pegasus::Uint32 count);
+
+    void invalidate(
+        const bp::object &cls,
+        const bp::object &ns,
+        const bp::object &url);
+    void clear();
+    void save();
+
+    bp::object len();
+
+    bp::object getPyTTL() const;
+    bp::object getPyMaxSize() const;
+    bp::object getPyHits() const;
+    bp::object getPyMisses() const;
+    bp::object getPyFilename() const;
+
+    void setPyTTL(const bp::object &ttl);
+    void setPyMaxSize(const bp::object &max_size);
+
+private:
+    class Key
+    {
+    public:
+        Key(
+            const String &url,
+            const String &ns,
+            const String &classname,
+            bool local_only,
+            bool include_qualifiers,
+            bool include_class_origin);
+        Key(
+            const String &url,
+            const String &ns,
+            const String &classname,
+            unsigned int flags);
+
+        bool operator<(const Key &rhs) const;
+
+        String m_url;
+        String m_ns;
+        String m_classname;
+        unsigned int m_flags;
+    };
+
+    typedef std::list<Key> LRUList;
+
+    class Entry
+    {
+    public:
+        Entry(const Pegasus::CIMClass &cls, double expires, LRUList::iterator lru);
+
+        Pegasus::CIMClass m_class;
+        double m_expires;
+        LRUList::iterator m_lru;
+        std::map<String, Pegasus::CIMConstMethod> m_methods;
+    };
+
+    typedef std::map<Key, Entry> EntryMap;
+
+    // Number of classes of a persisted namespace.
+    class Schema
+    {
+    public:
+        Schema();
+
+        Pegasus::Uint32 m_class_count;
+        bool m_validated;
+    };
+
+    // Schemas are keyed by the URL and lower-case namespace.
+    typedef std::map<std::pair<String, String>, Schema> SchemaMap;
+
+    EntryMap::iterator find(const Key &key);
+    void erase(EntryMap::iterator it);
+    void shrink();
+    void load();
+
+    Mutex m_mutex;
+    EntryMap m_entries;
+    LRUList m_lru;
+    double m_ttl;
+    unsigned int m_max_size;
+    unsigned long m_hits;
+    unsigned long m_misses;
+    String m_filename;
+    SchemaMap m_schemas;
+};
+
+#endif // LMIWBEM_CLASS_CACHE_H
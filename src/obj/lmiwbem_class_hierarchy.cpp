@@ -0,0 +1,392 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#include <config.h>
+#include <sstream>
+#include <utility>
+#include <boost/python/class.hpp>
+#include <boost/python/list.hpp>
+#include <boost/python/tuple.hpp>
+#include "lmiwbem_exception.h"
+#include "obj/lmiwbem_class_hierarchy.h"
+#include "obj/lmiwbem_class_hierarchy_pydoc.h"
+#include "obj/lmiwbem_config.h"
+#include "obj/lmiwbem_connection.h"
+#include "obj/cim/lmiwbem_class.h"
+#include "util/lmiwbem_convert.h"
+#include "util/lmiwbem_util.h"
+
+namespace {
+
+const size_t NOT_INDEXED = static_cast<size_t>(-1);
+
+} // unnamed namespace
+
+ClassHierarchy::Node::Node()
+    : m_name()
+    , m_superclass()
+    , m_first(NOT_INDEXED)
+    , m_last(NOT_INDEXED)
+{
+}
+
+ClassHierarchy::ClassHierarchy(const bp::object &ns)
+    : m_namespace(Config::getDefaultNamespace())
+    , m_nodes()
+    , m_order()
+    , m_roots()
+    , m_dirty(false)
+{
+    if (!isnone(ns))
+        m_namespace = StringConv::asString(ns, "namespace");
+}
+
+void ClassHierarchy::init_type()
+{
+    CIMBase<ClassHierarchy>::init_type(
+        bp::class_<ClassHierarchy, boost::noncopyable>("ClassHierarchy", bp::no_init)
+        .def(bp::init<const bp::object &>((
+            bp::arg("namespace") = None),
+            docstr_ClassHierarchy_init))
+        .def("__repr__", &ClassHierarchy::repr, docstr_ClassHierarchy_repr)
+        .def("__len__", &ClassHierarchy::len)
+        .def("__contains__", &ClassHierarchy::contains)
+        .def("refresh", &ClassHierarchy::refresh,
+            (bp::arg("conn"),
+             bp::arg("ClassName") = None),
+            docstr_ClassHierarchy_refresh)
+        .def("update", &ClassHierarchy::update,
+            (bp::arg("classes")),
+            docstr_ClassHierarchy_update)
+        .def("clear", &ClassHierarchy::clear, docstr_ClassHierarchy_clear)
+        .def("is_subclass",
+            static_cast<bp::object (ClassHierarchy::*)(
+                const bp::object &,
+                const bp::object &)>(&ClassHierarchy::isSubclass),
+            (bp::arg("superclass"),
+             bp::arg("subclass")),
+            docstr_ClassHierarchy_is_subclass)
+        .def("subclasses", &ClassHierarchy::subclasses,
+            (bp::arg("ClassName") = None,
+             bp::arg("DeepInheritance") = true),
+            docstr_ClassHierarchy_subclasses)
+        .def("ancestors", &ClassHierarchy::ancestors,
+            (bp::arg("ClassName")),
+            docstr_ClassHierarchy_ancestors)
+        .def("superclass", &ClassHierarchy::superclass,
+            (bp::arg("ClassName")),
+            docstr_ClassHierarchy_superclass)
+        .add_property("namespace", &ClassHierarchy::getPyNamespace));
+}
+
+bp::object ClassHierarchy::repr()
+{
+    std::stringstream ss;
+    ss << "ClassHierarchy(namespace=u'" << m_namespace << "', len="
+       << m_nodes.size() << ", ...)";
+    return StringConv::asPyUnicode(ss.str());
+}
+
+void ClassHierarchy::refresh(const bp::object &conn, const bp::object &cls)
+{
+    WBEMConnection &c_conn = WBEMConnection::asNative(conn, "conn");
+    bp::object py_ns = StringConv::asPyUnicode(m_namespace);
+
+    if (isnone(cls)) {
+        bp::object py_classes = c_conn.enumerateClasses(
+            py_ns, None, true, true, false, false);
+
+        clear();
+        addClasses(py_classes);
+        return;
+    }
+
+    // Fetch everything first, so the index stays intact, if a CIM operation
+    // fails.
+    bp::object py_class = c_conn.getClass(
+        cls, py_ns, true, false, false, bp::list());
+    bp::object py_subclasses = c_conn.enumerateClasses(
+        py_ns, cls, true, true, false, false);
+
+    removeSubclasses(StringConv::asString(cls, "ClassName"));
+    addClasses(bp::make_tuple(py_class));
+    addClasses(py_subclasses);
+}
+
+void ClassHierarchy::update(const bp::object &classes)
+{
+    addClasses(classes);
+}
+
+void ClassHierarchy::clear()
+{
+    m_nodes.clear();
+    m_order.clear();
+    m_roots.clear();
+    m_dirty = false;
+}
+
+bp::object ClassHierarchy::isSubclass(
+    const bp::object &superclass,
+    const bp::object &subclass)
+{
+    String c_superclass = StringConv::asString(superclass, "superclass");
+    String c_subclass = StringConv::asString(subclass, "subclass");
+
+    // Raise KeyError for unknown subclass.
+    node(c_subclass);
+
+    switch (isSubclass(c_superclass, c_subclass)) {
+    case SUBCLASS_YES:
+        return bp::object(true);
+    case SUBCLASS_NO:
+        return bp::object(false);
+    default:
+        return None;
+    }
+}
+
+bp::object ClassHierarchy::subclasses(
+    const bp::object &cls,
+    const bool deep_inheritance)
+{
+    reindex();
+
+    bp::list py_subclasses;
+    if (isnone(cls)) {
+        if (deep_inheritance) {
+            std::vector<String>::const_iterator it;
+            for (it = m_order.begin(); it != m_order.end(); ++it)
+                py_subclasses.append(StringConv::asPyUnicode(m_nodes[*it].m_name));
+        } else {
+            std::vector<String>::const_iterator it;
+            for (it = m_roots.begin(); it != m_roots.end(); ++it)
+                py_subclasses.append(StringConv::asPyUnicode(m_nodes[*it].m_name));
+        }
+        return py_subclasses;
+    }
+
+    String c_cls = StringConv::asString(cls, "ClassName");
+    String c_lcls = lower(c_cls);
+    const Node &cls_node = node(c_cls);
+
+    // Subtree of the class follows the class in the depth-first order.
+    for (size_t i = cls_node.m_first + 1; i <= cls_node.m_last; ++i) {
+        const Node &sub_node = m_nodes[m_order[i]];
+        if (deep_inheritance || lower(sub_node.m_superclass) == c_lcls)
+            py_subclasses.append(StringConv::asPyUnicode(sub_node.m_name));
+    }
+
+    return py_subclasses;
+}
+
+bp::object ClassHierarchy::ancestors(const bp::object &cls)
+{
+    const Node *cls_node = &node(StringConv::asString(cls, "ClassName"));
+
+    bp::list py_ancestors;
+    while (!cls_node->m_superclass.empty()) {
+        py_ancestors.append(StringConv::asPyUnicode(cls_node->m_superclass));
+
+        NodeMap::const_iterator found = m_nodes.find(
+            lower(cls_node->m_superclass));
+        if (found == m_nodes.end())
+            break;
+        cls_node = &found->second;
+    }
+
+    return py_ancestors;
+}
+
+bp::object ClassHierarchy::superclass(const bp::object &cls)
+{
+    const Node &cls_node = node(StringConv::asString(cls, "ClassName"));
+    if (cls_node.m_superclass.empty())
+        return None;
+    return StringConv::asPyUnicode(cls_node.m_superclass);
+}
+
+bp::object ClassHierarchy::len()
+{
+    return bp::object(m_nodes.size());
+}
+
+bp::object ClassHierarchy::contains(const bp::object &cls)
+{
+    return bp::object(hasClass(StringConv::asString(cls, "ClassName")));
+}
+
+bp::object ClassHierarchy::getPyNamespace() const
+{
+    return StringConv::asPyUnicode(m_namespace);
+}
+
+bool ClassHierarchy::hasClass(const String &cls) const
+{
+    return m_nodes.find(lower(cls)) != m_nodes.end();
+}
+
+ClassHierarchy::SubclassResult ClassHierarchy::isSubclass(
+    const String &superclass,
+    const String &subclass)
+{
+    reindex();
+
+    String c_lsuperclass = lower(superclass);
+    String c_lsubclass = lower(subclass);
+    if (c_lsuperclass == c_lsubclass)
+        return SUBCLASS_YES;
+
+    NodeMap::const_iterator sub_it = m_nodes.find(c_lsubclass);
+    if (sub_it == m_nodes.end())
+        return SUBCLASS_UNKNOWN;
+
+    NodeMap::const_iterator super_it = m_nodes.find(c_lsuperclass);
+    if (super_it != m_nodes.end()) {
+        const Node &sub_node = sub_it->second;
+        const Node &super_node = super_it->second;
+        if (super_node.m_first <= sub_node.m_first &&
+            sub_node.m_first <= super_node.m_last)
+        {
+            return SUBCLASS_YES;
+        }
+    }
+
+    // Classes in different subtrees can still be related, if the root of
+    // the subclass' subtree has a superclass, which is not indexed; e.g.
+    // after a refresh of a subtree only.
+    const Node *cls_node = &sub_it->second;
+    while (!cls_node->m_superclass.empty()) {
+        String c_lparent = lower(cls_node->m_superclass);
+        if (c_lparent == c_lsuperclass)
+            return SUBCLASS_YES;
+
+        NodeMap::const_iterator found = m_nodes.find(c_lparent);
+        if (found == m_nodes.end())
+            return SUBCLASS_UNKNOWN;
+        cls_node = &found->second;
+    }
+
+    return SUBCLASS_NO;
+}
+
+void ClassHierarchy::addClass(const String &cls, const String &superclass)
+{
+    Node &cls_node = m_nodes[lower(cls)];
+    cls_node.m_name = cls;
+    cls_node.m_superclass = superclass;
+    m_dirty = true;
+}
+
+void ClassHierarchy::addClasses(const bp::object &classes)
+{
+    bp::list py_classes(classes);
+    const int cnt = bp::len(py_classes);
+    for (int i = 0; i < cnt; ++i) {
+        const CIMClass &cim_class = CIMClass::asNative(py_classes[i], "classes");
+        addClass(cim_class.getClassname(), cim_class.getSuperClassname());
+    }
+}
+
+void ClassHierarchy::removeSubclasses(const String &cls)
+{
+    if (!hasClass(cls))
+        return;
+
+    reindex();
+
+    const Node &cls_node = m_nodes[lower(cls)];
+    for (size_t i = cls_node.m_first + 1; i <= cls_node.m_last; ++i)
+        m_nodes.erase(m_order[i]);
+    m_dirty = true;
+}
+
+void ClassHierarchy::reindex()
+{
+    if (!m_dirty)
+        return;
+
+    // Direct subclasses of each class; NodeMap is ordered, so are the
+    // subclasses.
+    std::map<String, std::vector<String> > children;
+    m_roots.clear();
+    NodeMap::iterator it;
+    for (it = m_nodes.begin(); it != m_nodes.end(); ++it) {
+        it->second.m_first = NOT_INDEXED;
+        it->second.m_last = NOT_INDEXED;
+
+        String c_lsuperclass = lower(it->second.m_superclass);
+        if (c_lsuperclass.empty() || m_nodes.find(c_lsuperclass) == m_nodes.end())
+            m_roots.push_back(it->first);
+        else
+            children[c_lsuperclass].push_back(it->first);
+    }
+
+    m_order.clear();
+    m_order.reserve(m_nodes.size());
+
+    // Classes in a superclass cycle are not reachable from any root; they are
+    // indexed as roots, so every class has a range.
+    std::vector<String> starts(m_roots);
+    for (it = m_nodes.begin(); it != m_nodes.end(); ++it)
+        starts.push_back(it->first);
+
+    std::vector<std::pair<String, size_t> > stack;
+    std::vector<String>::const_iterator start;
+    for (start = starts.begin(); start != starts.end(); ++start) {
+        if (m_nodes[*start].m_first != NOT_INDEXED)
+            continue;
+
+        m_nodes[*start].m_first = m_order.size();
+        m_order.push_back(*start);
+        stack.push_back(std::make_pair(*start, 0));
+
+        while (!stack.empty()) {
+            std::pair<String, size_t> &top = stack.back();
+            const std::vector<String> &kids = children[top.first];
+
+            if (top.second < kids.size()) {
+                const String &kid = kids[top.second++];
+                Node &kid_node = m_nodes[kid];
+                if (kid_node.m_first != NOT_INDEXED)
+                    continue;
+                kid_node.m_first = m_order.size();
+                m_order.push_back(kid);
+                stack.push_back(std::make_pair(kid, 0));
+            } else {
+                m_nodes[top.first].m_last = m_order.size() - 1;
+                stack.pop_back();
+            }
+        }
+    }
+
+    m_dirty = false;
+}
+
+const ClassHierarchy::Node &ClassHierarchy::node(const String &cls)
+{
+    reindex();
+
+    NodeMap::const_iterator found = m_nodes.find(lower(cls));
+    if (found == m_nodes.end())
+        throw_KeyError("Unknown class: " + cls);
+    return found->second;
+}
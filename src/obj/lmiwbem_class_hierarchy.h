@@ -0,0 +1,105 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef   LMIWBEM_CLASS_HIERARCHY_H
+#  define LMIWBEM_CLASS_HIERARCHY_H
+
+#  include <map>
+#  include <vector>
+#  include <boost/python/object.hpp>
+#  include "lmiwbem.h"
+#  include "obj/lmiwbem_cimbase.h"
+#  include "util/lmiwbem_string.h"
+
+namespace bp = boost::python;
+
+// Local index of class inheritance within a single namespace. The classes are
+// numbered in depth-first order, so each subtree occupies a contiguous range
+// of the order; subclass test is then a range check and deep subclasses are a
+// slice of the order. Numbering is recomputed lazily after modifications.
+class ClassHierarchy: public CIMBase<ClassHierarchy>
+{
+public:
+    ClassHierarchy(const bp::object &ns);
+
+    static void init_type();
+
+    bp::object repr();
+
+    void refresh(const bp::object &conn, const bp::object &cls);
+    void update(const bp::object &classes);
+    void clear();
+
+    bp::object isSubclass(
+        const bp::object &superclass,
+        const bp::object &subclass);
+    bp::object subclasses(
+        const bp::object &cls,
+        const bool deep_inheritance);
+    bp::object ancestors(const bp::object &cls);
+    bp::object superclass(const bp::object &cls);
+
+    bp::object len();
+    bp::object contains(const bp::object &cls);
+
+    bp::object getPyNamespace() const;
+
+    String getNamespace() const { return m_namespace; }
+    bool hasClass(const String &cls) const;
+
+    // Result of a subclass test; unknown, when the chain of superclasses of
+    // the subclass leaves the index before reaching the superclass.
+    enum SubclassResult {
+        SUBCLASS_NO,
+        SUBCLASS_YES,
+        SUBCLASS_UNKNOWN
+    };
+
+    SubclassResult isSubclass(const String &superclass, const String &subclass);
+
+private:
+    class Node
+    {
+    public:
+        Node();
+
+        String m_name;
+        String m_superclass;
+        size_t m_first;
+        size_t m_last;
+    };
+
+    typedef std::map<String, Node> NodeMap;
+
+    void addClass(const String &cls, const String &superclass);
+    void addClasses(const bp::object &classes);
+    void removeSubclasses(const String &cls);
+    void reindex();
+    const Node &node(const String &cls);
+
+    String m_namespace;
+    NodeMap m_nodes;
+    std::vector<String> m_order;
+    std::vector<String> m_roots;
+    bool m_dirty;
+};
+
+#endif // LMIWBEM_CLASS_HIERARCHY_H
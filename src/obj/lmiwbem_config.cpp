@@ -26,6 +26,8 @@
 #include <boost/python/errors.hpp>
 #include <boost/python/object.hpp>
 #include <boost/python/scope.hpp>
+#include "lmiwbem_exception.h"
+#include "lmiwbem_resolver.h"
 #include "obj/lmiwbem_config.h"
 #include "util/lmiwbem_convert.h"
 #include "util/lmiwbem_util.h"
@@ -42,6 +44,8 @@ const char *KEY_EXC_VERB_CALL    = "EXC_VERB_CALL";
 const char *KEY_EXC_VERB_MORE    = "EXC_VERB_MORE";
 const char *KEY_SUPPORTS_PULL_OP = "SUPPORTS_PULL_OPERATIONS";
 const char *KEY_SUPPORTS_WSMAN   = "SUPPORTS_WSMAN";
+const char *KEY_DNS_CACHE_TTL    = "DNS_CACHE_TTL";
+const char *KEY_DNS_CACHE_MAX_SIZE = "DNS_CACHE_MAX_SIZE";
 
 } // Unnamed namespace
 
@@ -137,7 +141,13 @@ void ConfigProxy::init_type()
         .add_property(KEY_SUPPORTS_PULL_OP,
             &ConfigProxy::getPySupportsPullOp)
         .add_property(KEY_SUPPORTS_WSMAN,
-            &ConfigProxy::getPySupportsWSMAN));
+            &ConfigProxy::getPySupportsWSMAN)
+        .add_property(KEY_DNS_CACHE_TTL,
+            &ConfigProxy::getPyDNSCacheTTL,
+            &ConfigProxy::setPyDNSCacheTTL)
+        .add_property(KEY_DNS_CACHE_MAX_SIZE,
+            &ConfigProxy::getPyDNSCacheMaxSize,
+            &ConfigProxy::setPyDNSCacheMaxSize));
 
     bp::scope().attr(KEY_EXC_VERB_NONE) = static_cast<int>(Config::EXC_VERB_NONE);
     bp::scope().attr(KEY_EXC_VERB_CALL) = static_cast<int>(Config::EXC_VERB_CALL);
@@ -204,6 +214,16 @@ bp::object ConfigProxy::getPySupportsWSMAN() const
 #endif
 }
 
+bp::object ConfigProxy::getPyDNSCacheTTL() const
+{
+    return bp::object(Resolver::getTTL());
+}
+
+bp::object ConfigProxy::getPyDNSCacheMaxSize() const
+{
+    return bp::object(Resolver::getMaxSize());
+}
+
 void ConfigProxy::setPyDefaultNamespace(const bp::object &def_namespace)
 {
     Config::instance()->setDefaultNamespace(
@@ -223,3 +243,21 @@ void ConfigProxy::setPyExceptionVerbosity(const bp::object &exc_verbosity)
     Config::instance()->setExceptionVerbosity(
         Conv::as<int>(exc_verbosity, KEY_EXC_VERBOSITY));
 }
+
+void ConfigProxy::setPyDNSCacheTTL(const bp::object &ttl)
+{
+    double c_ttl = Conv::as<double>(ttl, KEY_DNS_CACHE_TTL);
+    if (c_ttl < 0)
+        throw_ValueError("DNS_CACHE_TTL must be non-negative");
+
+    Resolver::setTTL(c_ttl);
+}
+
+void ConfigProxy::setPyDNSCacheMaxSize(const bp::object &max_size)
+{
+    int c_max_size = Conv::as<int>(max_size, KEY_DNS_CACHE_MAX_SIZE);
+    if (c_max_size < 0)
+        throw_ValueError("DNS_CACHE_MAX_SIZE must be non-negative");
+
+    Resolver::setMaxSize(static_cast<size_t>(c_max_size));
+}
@@ -77,10 +77,14 @@ public:
     bp::object getPyExcVerbosity() const;
     bp::object getPySupportsPullOp() const;
     bp::object getPySupportsWSMAN() const;
+    bp::object getPyDNSCacheTTL() const;
+    bp::object getPyDNSCacheMaxSize() const;
 
     void setPyDefaultNamespace(const bp::object &def_namespace);
     void setPyDefaultTrustStore(const bp::object &def_trust_store);
     void setPyExceptionVerbosity(const bp::object &exc_verbosity);
+    void setPyDNSCacheTTL(const bp::object &ttl);
+    void setPyDNSCacheMaxSize(const bp::object &max_size);
 
 protected:
     static Config *instance();
@@ -27,14 +27,21 @@
 #include <boost/python/tuple.hpp>
 #include <Pegasus/Common/CIMName.h>
 #include <Pegasus/Common/CIMPropertyList.h>
+#include <Pegasus/Common/Exception.h>
 #include "lmiwbem_client_cimxml.h"
 #include "lmiwbem_client_wsman.h"
 #include "lmiwbem_exception.h"
+#include "lmiwbem_gil.h"
 #include "lmiwbem_make_method.h"
 #include "lmiwbem_urlinfo.h"
+#include "obj/lmiwbem_association_cache.h"
+#include "obj/lmiwbem_class_cache.h"
+#include "obj/lmiwbem_class_hierarchy.h"
 #include "obj/lmiwbem_config.h"
 #include "obj/lmiwbem_connection.h"
 #include "obj/lmiwbem_connection_pydoc.h"
+#include "obj/lmiwbem_instance_cache.h"
+#include "obj/lmiwbem_negative_cache.h"
 #include "obj/lmiwbem_nocasedict.h"
 #include "obj/cim/lmiwbem_class.h"
 #include "obj/cim/lmiwbem_class_name.h"
@@ -42,34 +49,71 @@
 #include "obj/cim/lmiwbem_instance_name.h"
 #include "obj/cim/lmiwbem_value.h"
 #include "util/lmiwbem_convert.h"
+#include "util/lmiwbem_export.h"
 #include "util/lmiwbem_util.h"
 
 namespace bp = boost::python;
 
+namespace {
+
+// Applies LocalOnly to instances retrieved with class origins: only the
+// properties defined in the instance's own class are kept. Class origins are
+// dropped afterwards, unless they were asked for.
+void filter_local_properties(
+    Pegasus::Array<Pegasus::CIMInstance> &instances,
+    bool include_class_origin)
+{
+    const Pegasus::Uint32 cnt = instances.size();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+        Pegasus::CIMInstance &instance = instances[i];
+        const Pegasus::CIMName classname(instance.getClassName());
+        for (Pegasus::Uint32 j = instance.getPropertyCount(); j-- > 0; ) {
+            Pegasus::CIMProperty property(instance.getProperty(j));
+            const Pegasus::CIMName class_origin(property.getClassOrigin());
+            if (!class_origin.isNull() && class_origin != classname)
+                instance.removeProperty(j);
+            else if (!include_class_origin)
+                property.setClassOrigin(Pegasus::CIMName());
+        }
+    }
+}
+
+} // unnamed namespace
+
 WBEMConnectionBase::WBEMConnectionBase()
     : m_client()
     , m_type(CLIENT_CIMXML)
+    , m_enum_options()
+    , m_max_sessions(1)
 {
 }
 
 CIMClient *WBEMConnectionBase::client() const
 {
-    if (!m_client) {
-        switch (m_type) {
-        case CLIENT_WSMAN:
+    if (!m_client)
+        m_client.reset(clientCreate());
+
+    return m_client.get();
+}
+
+CIMClient *WBEMConnectionBase::clientCreate() const
+{
+    switch (m_type) {
+    case CLIENT_WSMAN:
 #ifdef HAVE_OPENWSMAN
-            m_client.reset(new WSMANClient());
-            break;
+    {
+        WSMANClient *client = new WSMANClient();
+        client->setEnumerationOptions(m_enum_options);
+        client->setMaxSessions(m_max_sessions);
+        return client;
+    }
 #else
-            // YES, this is OK. Fall through and always use CIM-XML.
+        // YES, this is OK. Fall through and always use CIM-XML.
 #endif // HAVE_OPENWSMAN
-        case CLIENT_CIMXML:
-            m_client.reset(new CIMXMLClient());
-            break;
-        }
+    case CLIENT_CIMXML:
+    default:
+        return new CIMXMLClient();
     }
-
-    return m_client.get();
 }
 
 WBEMConnectionBase::CIMClientType WBEMConnectionBase::clientGetType() const
@@ -86,6 +130,37 @@ void WBEMConnectionBase::clientSetType(CIMClientType type)
     m_client.reset();
 }
 
+WSMANClient::EnumerationOptions WBEMConnectionBase::clientGetEnumerationOptions() const
+{
+    return m_enum_options;
+}
+
+void WBEMConnectionBase::clientSetEnumerationOptions(
+    const WSMANClient::EnumerationOptions &options)
+{
+    m_enum_options = options;
+
+#ifdef HAVE_OPENWSMAN
+    if (m_client && m_type == CLIENT_WSMAN)
+        static_cast<WSMANClient*>(m_client.get())->setEnumerationOptions(options);
+#endif // HAVE_OPENWSMAN
+}
+
+unsigned int WBEMConnectionBase::clientGetMaxSessions() const
+{
+    return m_max_sessions;
+}
+
+void WBEMConnectionBase::clientSetMaxSessions(unsigned int max_sessions)
+{
+    m_max_sessions = max_sessions ? max_sessions : 1;
+
+#ifdef HAVE_OPENWSMAN
+    if (m_client && m_type == CLIENT_WSMAN)
+        static_cast<WSMANClient*>(m_client.get())->setMaxSessions(m_max_sessions);
+#endif // HAVE_OPENWSMAN
+}
+
 WBEMConnection::ScopedConnection::ScopedConnection(WBEMConnection *conn)
     : m_conn(conn)
     , m_conn_orig_state(m_conn->client()->isConnected())
@@ -96,6 +171,8 @@ WBEMConnection::ScopedConnection::ScopedConnection(WBEMConnection *conn)
     } else if (m_conn->m_connect_locally) {
         connectLocally();
     } else if (m_conn->client()->getURLInfo().isValid()) {
+        // Don't wait for a timeout again, if the CIMOM was unreachable.
+        m_conn->checkNegativeResult(String(), String(), String());
         connect();
     } else {
         throw_ValueError("WBEMConnection constructed with invalid url parameter");
@@ -112,6 +189,8 @@ void WBEMConnection::ScopedConnection::connect() try
         m_conn->m_key_file,
         Config::getDefaultTrustStore());
 } catch (...) {
+    m_conn->addNegativeResult(String(), None, None);
+
     std::stringstream ss;
     if (Config::isVerbose()) {
         ss << "connect(";
@@ -150,6 +229,15 @@ WBEMConnection::ScopedTransaction::ScopedTransaction(WBEMConnection *conn)
 {
 }
 
+// -----------------------------------------------------------------------------
+
+WBEMConnection::ScopedOperation::ScopedOperation(WBEMConnection *conn)
+    : m_gil_release()
+{
+    if (conn->client()->isThreadSafe())
+        m_gil_release.reset(new ScopedGILRelease);
+}
+
 WBEMConnection::WBEMConnection(
     const bp::object &url,
     const bp::object &creds,
@@ -166,6 +254,11 @@ WBEMConnection::WBEMConnection(
     , m_cert_file()
     , m_key_file()
     , m_default_namespace(Config::getDefaultNamespace())
+    , m_class_cache()
+    , m_class_hierarchy()
+    , m_instance_cache()
+    , m_association_cache()
+    , m_negative_cache()
 {
     setConnectLocally(Conv::as<bool>(connect_locally, "connect_locally"));
 
@@ -235,6 +328,7 @@ void WBEMConnection::init_type()
     WBEMConnection::WBEMConnectionClass cls("WBEMConnection", bp::no_init);
 
     init_type_base(cls);
+    init_type_traverse(cls);
 #ifdef HAVE_PEGASUS_ENUMERATION_CONTEXT
     init_type_pull(cls);
 #endif // HAVE_PEGASUS_ENUMERATION_CONTEXT
@@ -301,6 +395,46 @@ void WBEMConnection::init_type_base(WBEMConnection::WBEMConnectionClass &cls)
     .add_property("creds",
         &WBEMConnection::getCredentials,
         &WBEMConnection::setCredentials)
+    .add_property("class_cache",
+        &WBEMConnection::getClassCache,
+        &WBEMConnection::setClassCache,
+        docstr_WBEMConnection_class_cache)
+    .add_property("class_hierarchy",
+        &WBEMConnection::getClassHierarchy,
+        &WBEMConnection::setClassHierarchy,
+        docstr_WBEMConnection_class_hierarchy)
+    .add_property("instance_cache",
+        &WBEMConnection::getInstanceCache,
+        &WBEMConnection::setInstanceCache,
+        docstr_WBEMConnection_instance_cache)
+    .add_property("association_cache",
+        &WBEMConnection::getAssociationCache,
+        &WBEMConnection::setAssociationCache,
+        docstr_WBEMConnection_association_cache)
+    .add_property("negative_cache",
+        &WBEMConnection::getNegativeCache,
+        &WBEMConnection::setNegativeCache,
+        docstr_WBEMConnection_negative_cache)
+    .add_property("wsman_optimized_enumeration",
+        &WBEMConnection::getWsmanOptimizedEnumeration,
+        &WBEMConnection::setWsmanOptimizedEnumeration,
+        docstr_WBEMConnection_wsman_optimized_enumeration)
+    .add_property("wsman_adaptive_enumeration",
+        &WBEMConnection::getWsmanAdaptiveEnumeration,
+        &WBEMConnection::setWsmanAdaptiveEnumeration,
+        docstr_WBEMConnection_wsman_adaptive_enumeration)
+    .add_property("wsman_max_elements",
+        &WBEMConnection::getWsmanMaxElements,
+        &WBEMConnection::setWsmanMaxElements,
+        docstr_WBEMConnection_wsman_max_elements)
+    .add_property("wsman_max_envelope_size",
+        &WBEMConnection::getWsmanMaxEnvelopeSize,
+        &WBEMConnection::setWsmanMaxEnvelopeSize,
+        docstr_WBEMConnection_wsman_max_envelope_size)
+    .add_property("wsman_max_sessions",
+        &WBEMConnection::getWsmanMaxSessions,
+        &WBEMConnection::setWsmanMaxSessions,
+        docstr_WBEMConnection_wsman_max_sessions)
     .def("CreateInstance", &WBEMConnection::createInstance,
         (bp::arg("NewInstance"),
          bp::arg("ns") = None),
@@ -396,7 +530,19 @@ void WBEMConnection::init_type_base(WBEMConnection::WBEMConnectionClass &cls)
          bp::arg("ResultClass") = None,
          bp::arg("Role") = None,
          bp::arg("namespace") = None),
-        docstr_WBEMConnection_ReferenceNames);
+        docstr_WBEMConnection_ReferenceNames)
+    .def("ExportInstances", &WBEMConnection::exportInstances,
+        (bp::arg("ClassName"),
+         bp::arg("File"),
+         bp::arg("Format") = "mof",
+         bp::arg("namespace") = None,
+         bp::arg("LocalOnly") = true,
+         bp::arg("DeepInheritance") = true,
+         bp::arg("IncludeQualifiers") = false,
+         bp::arg("IncludeClassOrigin") = false,
+         bp::arg("PropertyList") = None,
+         bp::arg("MaxObjectCnt") = 1000),
+        docstr_WBEMConnection_ExportInstances);
 }
 
 String WBEMConnection::repr() const
@@ -537,6 +683,64 @@ void WBEMConnection::setTimeout(unsigned int timeout)
     client()->setTimeout(timeout);
 }
 
+bool WBEMConnection::getWsmanOptimizedEnumeration() const
+{
+    return clientGetEnumerationOptions().m_optimized;
+}
+
+void WBEMConnection::setWsmanOptimizedEnumeration(bool optimized)
+{
+    WSMANClient::EnumerationOptions options(clientGetEnumerationOptions());
+    options.m_optimized = optimized;
+    clientSetEnumerationOptions(options);
+}
+
+bool WBEMConnection::getWsmanAdaptiveEnumeration() const
+{
+    return clientGetEnumerationOptions().m_adaptive;
+}
+
+void WBEMConnection::setWsmanAdaptiveEnumeration(bool adaptive)
+{
+    WSMANClient::EnumerationOptions options(clientGetEnumerationOptions());
+    options.m_adaptive = adaptive;
+    clientSetEnumerationOptions(options);
+}
+
+unsigned int WBEMConnection::getWsmanMaxElements() const
+{
+    return clientGetEnumerationOptions().m_max_elements;
+}
+
+void WBEMConnection::setWsmanMaxElements(unsigned int max_elements)
+{
+    WSMANClient::EnumerationOptions options(clientGetEnumerationOptions());
+    options.m_max_elements = max_elements;
+    clientSetEnumerationOptions(options);
+}
+
+unsigned int WBEMConnection::getWsmanMaxEnvelopeSize() const
+{
+    return clientGetEnumerationOptions().m_max_envelope_size;
+}
+
+void WBEMConnection::setWsmanMaxEnvelopeSize(unsigned int max_envelope_size)
+{
+    WSMANClient::EnumerationOptions options(clientGetEnumerationOptions());
+    options.m_max_envelope_size = max_envelope_size;
+    clientSetEnumerationOptions(options);
+}
+
+unsigned int WBEMConnection::getWsmanMaxSessions() const
+{
+    return clientGetMaxSessions();
+}
+
+void WBEMConnection::setWsmanMaxSessions(unsigned int max_sessions)
+{
+    clientSetMaxSessions(max_sessions);
+}
+
 bp::object WBEMConnection::getRequestAcceptLanguages() const
 {
     Pegasus::AcceptLanguageList peg_al_list = client()->getRequestAcceptLanguages();
@@ -598,6 +802,71 @@ void WBEMConnection::setCredentials(const bp::object &creds)
     m_password = StringConv::asString(py_creds_tpl[1], "password");
 }
 
+bp::object WBEMConnection::getClassCache() const
+{
+    return m_class_cache;
+}
+
+void WBEMConnection::setClassCache(const bp::object &class_cache)
+{
+    // Type check; None disables the caching.
+    if (!isnone(class_cache))
+        ClassCache::asNative(class_cache, "class_cache");
+    m_class_cache = class_cache;
+}
+
+bp::object WBEMConnection::getClassHierarchy() const
+{
+    return m_class_hierarchy;
+}
+
+void WBEMConnection::setClassHierarchy(const bp::object &class_hierarchy)
+{
+    // Type check; None disables the index.
+    if (!isnone(class_hierarchy))
+        ClassHierarchy::asNative(class_hierarchy, "class_hierarchy");
+    m_class_hierarchy = class_hierarchy;
+}
+
+bp::object WBEMConnection::getInstanceCache() const
+{
+    return m_instance_cache;
+}
+
+void WBEMConnection::setInstanceCache(const bp::object &instance_cache)
+{
+    // Type check; None disables the caching.
+    if (!isnone(instance_cache))
+        InstanceCache::asNative(instance_cache, "instance_cache");
+    m_instance_cache = instance_cache;
+}
+
+bp::object WBEMConnection::getAssociationCache() const
+{
+    return m_association_cache;
+}
+
+void WBEMConnection::setAssociationCache(const bp::object &association_cache)
+{
+    // Type check; None disables the caching.
+    if (!isnone(association_cache))
+        AssociationCache::asNative(association_cache, "association_cache");
+    m_association_cache = association_cache;
+}
+
+bp::object WBEMConnection::getNegativeCache() const
+{
+    return m_negative_cache;
+}
+
+void WBEMConnection::setNegativeCache(const bp::object &negative_cache)
+{
+    // Type check; None disables the caching.
+    if (!isnone(negative_cache))
+        NegativeCache::asNative(negative_cache, "negative_cache");
+    m_negative_cache = negative_cache;
+}
+
 bp::object WBEMConnection::createInstance(
     const bp::object &instance,
     const bp::object &ns) try
@@ -662,6 +931,15 @@ void WBEMConnection::deleteInstance(const bp::object &object_path) try
         peg_ns,
         peg_path);
     ScopedTransactionEnd();
+
+    if (!isnone(m_instance_cache)) {
+        InstanceCache::asNative(m_instance_cache).invalidateInstance(
+            client()->getUrl(), c_ns, peg_path);
+    }
+    if (!isnone(m_association_cache)) {
+        AssociationCache::asNative(m_association_cache).invalidateInstance(
+            client()->getUrl(), c_ns, peg_path);
+    }
 } catch (...) {
     std::stringstream ss;
     if (Config::isVerbose()) {
@@ -696,6 +974,14 @@ void WBEMConnection::modifyInstance(
         include_qualifiers,
         peg_property_list);
     ScopedTransactionEnd();
+
+    if (!isnone(m_instance_cache)) {
+        String c_ns(cim_inst_name.getNamespace());
+        if (c_ns.empty())
+            c_ns = m_default_namespace;
+        InstanceCache::asNative(m_instance_cache).invalidateInstance(
+            client()->getUrl(), c_ns, cim_inst_name.asPegasusCIMObjectPath());
+    }
 } catch (...) {
     std::stringstream ss;
     if (Config::isVerbose()) {
@@ -723,6 +1009,8 @@ bp::object WBEMConnection::enumerateInstances(
     if (!isnone(ns))
         c_ns = StringConv::asString(ns, "namespace");
 
+    checkNegativeResult("EnumerateInstances", c_ns, c_cls);
+
     Pegasus::Array<Pegasus::CIMInstance> peg_instances;
     Pegasus::CIMNamespaceName peg_ns(c_ns);
     Pegasus::CIMName peg_name(c_cls);
@@ -744,6 +1032,8 @@ bp::object WBEMConnection::enumerateInstances(
     return ListConv::asPyCIMInstanceList(
         peg_instances, c_ns, client()->getHostname());
 } catch (...) {
+    addNegativeResult("EnumerateInstances", ns, cls);
+
     std::stringstream ss;
     if (Config::isVerbose()) {
         ss << "EnumerateInstances(";
@@ -769,6 +1059,8 @@ bp::object WBEMConnection::enumerateInstanceNames(
     if (!isnone(ns))
         c_ns = StringConv::asString(ns, "namespace");
 
+    checkNegativeResult("EnumerateInstanceNames", c_ns, c_cls);
+
     Pegasus::Array<Pegasus::CIMObjectPath> peg_instance_names;
     Pegasus::CIMNamespaceName peg_ns(c_ns);
     Pegasus::CIMName peg_name(c_cls);
@@ -782,6 +1074,8 @@ bp::object WBEMConnection::enumerateInstanceNames(
     return ListConv::asPyCIMInstanceNameList(
         peg_instance_names, c_ns, client()->getHostname());
 } catch (...) {
+    addNegativeResult("EnumerateInstanceNames", ns, cls);
+
     std::stringstream ss;
     if (Config::isVerbose()) {
         ss << "EnumerateInstanceNames(";
@@ -819,29 +1113,68 @@ bp::object WBEMConnection::invokeMethod(
     Pegasus::Array<Pegasus::CIMParamValue> peg_out_params;
     Pegasus::Array<Pegasus::CIMParamValue> peg_in_params;
 
+    // With a class cache, parameters are typed by the method's declaration;
+    // otherwise by their Python types.
+    Pegasus::CIMConstMethod peg_method;
+    if (!isnone(m_class_cache)) {
+        peg_method = getMethodSignature(
+            c_ns, peg_path.getClassName().getString(), c_method);
+    }
+
     // Create Pegasus::Array from **kwargs
     bp::list py_keys = kwds.keys();
     const int keys_cnt = bp::len(py_keys);
     for (int i = 0; i < keys_cnt; ++i) {
         String c_param_name = StringConv::asString(py_keys[i]);
+
+        Pegasus::Uint32 idx = Pegasus::PEG_NOT_FOUND;
+        if (!peg_method.isUninitialized())
+            idx = peg_method.findParameter(Pegasus::CIMName(c_param_name));
+
+        Pegasus::CIMValue peg_value;
+        if (idx != Pegasus::PEG_NOT_FOUND) {
+            Pegasus::CIMConstParameter peg_param = peg_method.getParameter(idx);
+            peg_value = CIMValue::asPegasusCIMValue(
+                kwds[py_keys[i]], peg_param.getType(), peg_param.isArray());
+        } else {
+            peg_value = CIMValue::asPegasusCIMValue(kwds[py_keys[i]]);
+        }
+
         peg_in_params.append(
             Pegasus::CIMParamValue(
                 c_param_name,
-                CIMValue::asPegasusCIMValue(kwds[py_keys[i]]),
+                peg_value,
                 true /* isTyped */));
     }
 
     Pegasus::CIMNamespaceName peg_ns(c_ns);
     Pegasus::CIMName peg_name(c_method);
 
-    ScopedTransactionBegin();
-    peg_rval = client()->invokeMethod(
-        peg_ns,
-        peg_path,
-        peg_name,
-        peg_in_params,
-        peg_out_params);
-    ScopedTransactionEnd();
+#ifdef HAVE_OPENWSMAN
+    if (clientGetType() == CLIENT_WSMAN) {
+        // The declaration types also the output parameters.
+        WSMANClient *wsman_client = static_cast<WSMANClient*>(client());
+        ScopedTransactionBegin();
+        peg_rval = wsman_client->invokeMethod(
+            peg_ns,
+            peg_path,
+            peg_name,
+            peg_in_params,
+            peg_out_params,
+            peg_method);
+        ScopedTransactionEnd();
+    } else
+#endif // HAVE_OPENWSMAN
+    {
+        ScopedTransactionBegin();
+        peg_rval = client()->invokeMethod(
+            peg_ns,
+            peg_path,
+            peg_name,
+            peg_in_params,
+            peg_out_params);
+        ScopedTransactionEnd();
+    }
 
     // Create a NocaseDict of method's return parameters
     bp::object py_rparams = NocaseDict::create();
@@ -870,6 +1203,113 @@ bp::object WBEMConnection::invokeMethod(
     return None;
 }
 
+bool WBEMConnection::clientProvidesClasses() const
+{
+#ifdef HAVE_OPENWSMAN
+    // WS-Management has neither GetClass nor EnumerateClassNames.
+    if (clientGetType() == CLIENT_WSMAN)
+        return false;
+#endif // HAVE_OPENWSMAN
+    return true;
+}
+
+void WBEMConnection::validateClassCache(ClassCache &cache, const String &ns)
+{
+    if (!clientProvidesClasses() ||
+        !cache.needsValidation(client()->getUrl(), ns))
+    {
+        return;
+    }
+
+    Pegasus::Array<Pegasus::CIMName> peg_classnames;
+    ScopedTransactionBegin();
+    peg_classnames = client()->enumerateClassNames(
+        Pegasus::CIMNamespaceName(ns),
+        Pegasus::CIMName(),
+        true /* DeepInheritance */);
+    ScopedTransactionEnd();
+
+    cache.setClassCount(client()->getUrl(), ns, peg_classnames.size());
+}
+
+Pegasus::CIMConstMethod WBEMConnection::getMethodSignature(
+    const String &ns,
+    const String &cls,
+    const String &method)
+{
+    ClassCache &cache = ClassCache::asNative(m_class_cache);
+
+    Pegasus::CIMConstMethod peg_method;
+    Pegasus::CIMClass peg_class;
+    try {
+        // Without classes from the CIMOM, only the declarations, which are
+        // already cached, can be used.
+        if (!clientProvidesClasses()) {
+            cache.getMethod(client()->getUrl(), ns, cls, method, peg_method);
+            return peg_method;
+        }
+
+        validateClassCache(cache, ns);
+        if (cache.getMethod(client()->getUrl(), ns, cls, method, peg_method))
+            return peg_method;
+
+        ScopedTransactionBegin();
+        peg_class = client()->getClass(
+            Pegasus::CIMNamespaceName(ns),
+            Pegasus::CIMName(cls),
+            false /* LocalOnly */,
+            false /* IncludeQualifiers */,
+            false /* IncludeClassOrigin */,
+            Pegasus::CIMPropertyList());
+        ScopedTransactionEnd();
+
+        if (peg_class.isUninitialized())
+            return peg_method;
+
+        cache.addClass(client()->getUrl(), ns, cls, false, false, false, peg_class);
+        cache.getMethod(client()->getUrl(), ns, cls, method, peg_method);
+    } catch (const Pegasus::Exception &) {
+        // The class is not accessible; InvokeMethod() falls back to Python
+        // types of the parameters.
+        return Pegasus::CIMConstMethod();
+    }
+
+    return peg_method;
+}
+
+void WBEMConnection::checkNegativeResult(
+    const String &op,
+    const String &ns,
+    const String &cls)
+{
+    if (isnone(m_negative_cache))
+        return;
+
+    NegativeCache::asNative(m_negative_cache).check(
+        client()->getUrl(), ns, cls, op);
+}
+
+void WBEMConnection::addNegativeResult(
+    const String &op,
+    const bp::object &ns,
+    const bp::object &cls)
+{
+    NegativeCache::Failure failure;
+    if (isnone(m_negative_cache) || !NegativeCache::getFailure(failure))
+        return;
+
+    // Arguments were already converted by the failed operation.
+    String c_ns(m_default_namespace);
+    if (!isnone(ns))
+        c_ns = StringConv::asString(ns);
+    String c_cls;
+    if (!isnone(cls))
+        c_cls = StringConv::asString(cls);
+
+    NegativeCache::asNative(m_negative_cache).addFailure(
+        client()->getUrl(), c_ns, c_cls, op, failure);
+}
+
 bp::object WBEMConnection::getInstance(
     const bp::object &instance_name,
     const bp::object &ns,
@@ -892,6 +1332,17 @@ bp::object WBEMConnection::getInstance(
     Pegasus::CIMPropertyList peg_property_list(
         ListConv::asPegasusPropertyList(property_list, "PropertyList"));
 
+    InstanceCache *cache = NULL;
+    if (!isnone(m_instance_cache))
+        cache = &InstanceCache::asNative(m_instance_cache);
+
+    if (cache && cache->getInstance(client()->getUrl(), c_ns, peg_object_path,
+        local_only, include_qualifiers, include_class_origin,
+        peg_property_list, peg_instance))
+    {
+        return CIMInstance::create(peg_instance);
+    }
+
     ScopedTransactionBegin();
     peg_instance = client()->getInstance(
         peg_ns,
@@ -906,6 +1357,12 @@ bp::object WBEMConnection::getInstance(
     // CIMInstance. We need to do that manually.
     peg_instance.setPath(peg_object_path);
 
+    if (cache) {
+        cache->addInstance(client()->getUrl(), c_ns, peg_object_path,
+            local_only, include_qualifiers, include_class_origin,
+            peg_property_list, peg_instance);
+    }
+
     return CIMInstance::create(peg_instance);
 } catch (...) {
     std::stringstream ss;
@@ -937,6 +1394,8 @@ bp::object WBEMConnection::enumerateClasses(
         peg_classname = Pegasus::CIMName(c_cls);
     }
 
+    checkNegativeResult("EnumerateClasses", c_ns, peg_classname.getString());
+
     Pegasus::Array<Pegasus::CIMClass> peg_classes;
     Pegasus::CIMNamespaceName peg_ns(c_ns);
 
@@ -952,6 +1411,8 @@ bp::object WBEMConnection::enumerateClasses(
 
     return ListConv::asPyCIMClassList(peg_classes);
 } catch (...) {
+    addNegativeResult("EnumerateClasses", ns, cls);
+
     std::stringstream ss;
     if (Config::isVerbose()) {
         ss << "EnumerateClasses(";
@@ -982,6 +1443,8 @@ bp::object WBEMConnection::enumerateClassNames(
         peg_classname = Pegasus::CIMName(c_cls);
     }
 
+    checkNegativeResult("EnumerateClassNames", c_ns, peg_classname.getString());
+
     Pegasus::Array<Pegasus::CIMName> peg_classnames;
     Pegasus::CIMNamespaceName peg_ns(c_ns);
 
@@ -1000,6 +1463,8 @@ bp::object WBEMConnection::enumerateClassNames(
 
     return py_class_names;;
 } catch (...) {
+    addNegativeResult("EnumerateClassNames", ns, cls);
+
     std::stringstream ss;
     if (Config::isVerbose()) {
         ss << "EnumerateClasseNames(";
@@ -1068,6 +1533,8 @@ bp::object WBEMConnection::getClass(
     if (!isnone(ns))
         c_ns = StringConv::asString(ns, "namespace");
 
+    checkNegativeResult("GetClass", c_ns, c_cls);
+
     Pegasus::CIMClass peg_class;
     Pegasus::CIMNamespaceName peg_ns(c_ns);
     Pegasus::CIMName peg_name(c_cls);
@@ -1075,6 +1542,22 @@ bp::object WBEMConnection::getClass(
         ListConv::asPegasusPropertyList(
             property_list, "PropertyList"));
 
+    // Classes requested with a PropertyList are not cached; they don't
+    // represent the whole class.
+    ClassCache *cache = NULL;
+    if (!isnone(m_class_cache) && isnone(property_list) &&
+        clientProvidesClasses())
+    {
+        cache = &ClassCache::asNative(m_class_cache);
+        validateClassCache(*cache, c_ns);
+    }
+
+    if (cache && cache->getClass(client()->getUrl(), c_ns, c_cls,
+        local_only, include_qualifiers, include_class_origin, peg_class))
+    {
+        return CIMClass::create(peg_class);
+    }
+
     ScopedTransactionBegin()
     peg_class = client()->getClass(
         peg_ns,
@@ -1085,8 +1568,15 @@ bp::object WBEMConnection::getClass(
         peg_property_list);
     ScopedTransactionEnd();
 
+    if (cache && !peg_class.isUninitialized()) {
+        cache->addClass(client()->getUrl(), c_ns, c_cls,
+            local_only, include_qualifiers, include_class_origin, peg_class);
+    }
+
     return CIMClass::create(peg_class);
 } catch (...) {
+    addNegativeResult("GetClass", ns, cls);
+
     std::stringstream ss;
     if (Config::isVerbose()) {
         ss << "GetClass(";
@@ -1219,6 +1709,18 @@ bp::object WBEMConnection::getAssociatorNames(
     if (!c_result_class.empty())
         peg_result_class = Pegasus::CIMName(c_result_class);
 
+    AssociationCache *cache = NULL;
+    if (!isnone(m_association_cache))
+        cache = &AssociationCache::asNative(m_association_cache);
+
+    if (cache && cache->getAssociatorNames(client()->getUrl(), c_ns, peg_path,
+        c_assoc_class, c_result_class, c_role, c_result_role,
+        peg_associator_names))
+    {
+        return ListConv::asPyCIMInstanceNameList(
+            peg_associator_names, c_ns, client()->getHostname());
+    }
+
     ScopedTransactionBegin();
     peg_associator_names = client()->associatorNames(
         peg_ns,
@@ -1229,6 +1731,12 @@ bp::object WBEMConnection::getAssociatorNames(
         c_result_role);
     ScopedTransactionEnd();
 
+    if (cache) {
+        cache->addAssociatorNames(client()->getUrl(), c_ns, peg_path,
+            c_assoc_class, c_result_class, c_role, c_result_role,
+            peg_associator_names);
+    }
+
     return ListConv::asPyCIMInstanceNameList(
         peg_associator_names, c_ns, client()->getHostname());
 } catch (...) {
@@ -1354,3 +1862,148 @@ bp::object WBEMConnection::getReferenceNames(
     handle_all_exceptions(ss);
     return None;
 }
+
+bp::object WBEMConnection::exportInstances(
+    const bp::object &cls,
+    const bp::object &file,
+    const bp::object &format,
+    const bp::object &ns,
+    const bool local_only,
+    const bool deep_inheritance,
+    const bool include_qualifiers,
+    const bool include_class_origin,
+    const bp::object &property_list,
+    const bp::object &max_object_cnt) try
+{
+    String c_cls(StringConv::asString(cls, "ClassName"));
+    String c_ns(m_default_namespace);
+    if (!isnone(ns))
+        c_ns = StringConv::asString(ns, "namespace");
+
+    Pegasus::Uint32 peg_max_object_cnt = Conv::as<Pegasus::Uint32>(
+        max_object_cnt, "MaxObjectCnt");
+    if (peg_max_object_cnt == 0)
+        throw_ValueError("MaxObjectCnt must be greater than 0");
+
+    Pegasus::Array<Pegasus::CIMInstance> peg_instances;
+    Pegasus::CIMNamespaceName peg_ns(c_ns);
+    Pegasus::CIMName peg_name(c_cls);
+    Pegasus::CIMPropertyList peg_property_list(
+        ListConv::asPegasusPropertyList(
+            property_list, "PropertyList"));
+
+    Exporter exporter(
+        Exporter::asFileDescriptor(file),
+        Exporter::asFormat(StringConv::asString(format, "Format")),
+        client()->getHostname(),
+        peg_property_list);
+
+    // LocalOnly is applied here for both the pull and the EnumerateInstances
+    // path, so the exported data don't depend on the CIMOM's support of pull
+    // operations or of LocalOnly.
+    const bool peg_include_class_origin = include_class_origin || local_only;
+
+#ifdef HAVE_PEGASUS_ENUMERATION_CONTEXT
+    // Pull operations can't return qualifiers.
+    if (include_qualifiers)
+        throw_ValueError("IncludeQualifiers is not supported by ExportInstances()");
+
+    // Instances are pulled in chunks of at most MaxObjectCnt and each chunk
+    // is written before the next one is requested, so the memory use doesn't
+    // grow with the size of the result.
+    EnumerationContext peg_ctx;
+    Pegasus::Boolean peg_end_of_sequence = false;
+    bool pull_supported = true;
+    try {
+        ScopedTransactionBegin();
+        peg_instances = client()->openEnumerateInstances(
+            peg_ctx,
+            peg_end_of_sequence,
+            peg_ns,
+            peg_name,
+            deep_inheritance,
+            peg_include_class_origin,
+            peg_property_list,
+            Pegasus::String::EMPTY,
+            Pegasus::String::EMPTY,
+            Pegasus::Uint32Arg(),
+            false,
+            peg_max_object_cnt);
+        ScopedTransactionEnd();
+    } catch (const Pegasus::CIMException &e) {
+        if (e.getCode() != Pegasus::CIM_ERR_NOT_SUPPORTED)
+            throw;
+        pull_supported = false;
+    }
+
+    if (pull_supported) {
+        try {
+            if (local_only)
+                filter_local_properties(peg_instances, include_class_origin);
+            exporter.putInstances(peg_instances);
+            while (!peg_end_of_sequence) {
+                ScopedTransactionBegin();
+                peg_instances = client()->pullInstancesWithPath(
+                    peg_ctx,
+                    peg_end_of_sequence,
+                    peg_max_object_cnt);
+                ScopedTransactionEnd();
+
+                if (local_only)
+                    filter_local_properties(peg_instances, include_class_origin);
+                exporter.putInstances(peg_instances);
+            }
+        } catch (...) {
+            // Don't leave the enumeration open on the CIMOM; the original
+            // error is the one reported.
+            if (!peg_end_of_sequence) {
+                try {
+                    ScopedTransactionBegin();
+                    client()->closeEnumeration(peg_ctx);
+                    ScopedTransactionEnd();
+                } catch (...) {
+                }
+            }
+            throw;
+        }
+        exporter.flush();
+
+        return bp::object(exporter.count());
+    }
+#endif // HAVE_PEGASUS_ENUMERATION_CONTEXT
+
+    // The CIMOM doesn't support pull operations; the whole result is fetched
+    // by a single call.
+    ScopedTransactionBegin();
+    peg_instances = client()->enumerateInstances(
+        peg_ns,
+        peg_name,
+        deep_inheritance,
+        local_only,
+        include_qualifiers,
+        peg_include_class_origin,
+        peg_property_list);
+    ScopedTransactionEnd();
+
+    if (local_only)
+        filter_local_properties(peg_instances, include_class_origin);
+    exporter.putInstances(peg_instances);
+    exporter.flush();
+
+    return bp::object(exporter.count());
+} catch (...) {
+    std::stringstream ss;
+    if (Config::isVerbose()) {
+        ss << "ExportInstances(";
+        if (Config::isVerboseMore()) {
+            String c_ns(m_default_namespace);
+            if (!isnone(ns))
+                c_ns = StringConv::asString(ns);
+            ss << "classname=u" << StringConv::asString(cls) << ", "
+               << "namespace=u" << c_ns;
+        }
+        ss << ')';
+    }
+    handle_all_exceptions(ss);
+    return None;
+}
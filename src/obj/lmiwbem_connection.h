@@ -25,9 +25,12 @@
 #  include <config.h>
 #  include <boost/shared_ptr.hpp>
 #  include <boost/python/class.hpp>
+#  include <boost/python/object.hpp>
+#  include <Pegasus/Common/CIMMethod.h>
 #  include "lmiwbem.h"
 #  include "lmiwbem_cimbase.h"
 #  include "lmiwbem_client.h"
+#  include "lmiwbem_client_wsman.h"
 #  include "util/lmiwbem_string.h"
 
 BOOST_PYTHON_BEGIN
@@ -38,6 +41,9 @@ BOOST_PYTHON_END
 
 namespace bp = boost::python;
 
+class ClassCache;
+class ScopedGILRelease;
+
 class WBEMConnectionBase
 {
 public:
@@ -50,12 +56,23 @@ public:
 
 protected:
     CIMClient *client() const;
+    // Creates a new, not connected, client of the connection's type.
+    CIMClient *clientCreate() const;
     CIMClientType clientGetType() const;
     void clientSetType(CIMClientType type);
+    WSMANClient::EnumerationOptions clientGetEnumerationOptions() const;
+    void clientSetEnumerationOptions(
+        const WSMANClient::EnumerationOptions &options);
+    unsigned int clientGetMaxSessions() const;
+    void clientSetMaxSessions(unsigned int max_sessions);
 
 private:
     mutable boost::shared_ptr<CIMClient> m_client;
     CIMClientType m_type;
+
+    // Kept here, because the client is recreated with the connection type.
+    WSMANClient::EnumerationOptions m_enum_options;
+    unsigned int m_max_sessions;
 };
 
 class WBEMConnection: public WBEMConnectionBase, public CIMBase<WBEMConnection>
@@ -63,12 +80,14 @@ class WBEMConnection: public WBEMConnectionBase, public CIMBase<WBEMConnection>
 private:
         /* NOTE: These macros need to be used around every CIM operation.
          * ScopedTransactionBegin creates a temporary connection, if necessary and also
-         * it ensures that CIMClient can enter a critical section.
+         * it ensures that CIMClient can enter a critical section. GIL is released
+         * for thread-safe clients, so only CIMClient calls may be placed inside.
          * ScopedTransactionEnd is defined due to semantics; to close the scope.
          */
 #  define ScopedTransactionBegin() { \
        ScopedTransaction _st(this);  \
-       ScopedConnection  _sc(this);
+       ScopedConnection  _sc(this);  \
+       ScopedOperation   _so(this);
 #  define ScopedTransactionEnd() }
 
     class ScopedConnection
@@ -95,8 +114,21 @@ private:
         CIMClient::ScopedCIMClientTransaction m_sct;
     };
 
+    // Releases GIL for the duration of an operation of a thread-safe client.
+    // Other clients hold their transaction lock; releasing GIL there could
+    // deadlock with a thread waiting for the lock.
+    class ScopedOperation
+    {
+    public:
+        ScopedOperation(WBEMConnection *conn);
+
+    private:
+        boost::shared_ptr<ScopedGILRelease> m_gil_release;
+    };
+
     friend class ScopedConnection;
     friend class ScopedTransaction;
+    friend class ScopedOperation;
 
     typedef bp::class_<WBEMConnection, boost::noncopyable> WBEMConnectionClass;
 
@@ -140,6 +172,26 @@ public:
     void setDefaultNamespace(const bp::object &ns);
     bp::object getCredentials() const;
     void setCredentials(const bp::object &creds);
+    bp::object getClassCache() const;
+    void setClassCache(const bp::object &class_cache);
+    bp::object getClassHierarchy() const;
+    void setClassHierarchy(const bp::object &class_hierarchy);
+    bp::object getInstanceCache() const;
+    void setInstanceCache(const bp::object &instance_cache);
+    bp::object getAssociationCache() const;
+    void setAssociationCache(const bp::object &association_cache);
+    bp::object getNegativeCache() const;
+    void setNegativeCache(const bp::object &negative_cache);
+    bool getWsmanOptimizedEnumeration() const;
+    void setWsmanOptimizedEnumeration(bool optimized);
+    bool getWsmanAdaptiveEnumeration() const;
+    void setWsmanAdaptiveEnumeration(bool adaptive);
+    unsigned int getWsmanMaxElements() const;
+    void setWsmanMaxElements(unsigned int max_elements);
+    unsigned int getWsmanMaxEnvelopeSize() const;
+    void setWsmanMaxEnvelopeSize(unsigned int max_envelope_size);
+    unsigned int getWsmanMaxSessions() const;
+    void setWsmanMaxSessions(unsigned int max_sessions);
 
     bp::object createInstance(
         const bp::object &instance,
@@ -237,6 +289,24 @@ public:
         const bp::object &role,
         const bp::object &ns);
 
+    bp::object exportInstances(
+        const bp::object &cls,
+        const bp::object &file,
+        const bp::object &format,
+        const bp::object &ns,
+        const bool local_only,
+        const bool deep_inheritance,
+        const bool include_qualifiers,
+        const bool include_class_origin,
+        const bp::object &property_list,
+        const bp::object &max_object_cnt);
+
+    bp::object traverse(
+        const bp::object &object_names,
+        const bp::object &hops,
+        const bp::object &ns,
+        const bp::object &workers);
+
 #  ifdef HAVE_PEGASUS_ENUMERATION_CONTEXT
     bp::object openEnumerateInstances(
         const bp::object &cls,
@@ -332,10 +402,41 @@ public:
         bp::object &max_object_cnt);
 
     void closeEnumeration(const bp::object &ctx);
+
+    bp::object exportPulledInstances(
+        const bp::object &ctx,
+        const bp::object &file,
+        const bp::object &format,
+        const bp::object &max_object_cnt);
 #  endif // HAVE_PEGASUS_ENUMERATION_CONTEXT
 
 protected:
     static void init_type_base(WBEMConnectionClass &cls);
+    static void init_type_traverse(WBEMConnectionClass &cls);
+
+    // Classes and class names can't be retrieved by every client type; the
+    // class cache is neither filled nor validated for such clients.
+    bool clientProvidesClasses() const;
+
+    // Compares the number of classes in the namespace with the persistent
+    // class cache's on first use of the namespace.
+    void validateClassCache(ClassCache &cache, const String &ns);
+
+    Pegasus::CIMConstMethod getMethodSignature(
+        const String &ns,
+        const String &cls,
+        const String &method);
+
+    // Negative cache helpers; addNegativeResult() must be called from
+    // a catch handler.
+    void checkNegativeResult(
+        const String &op,
+        const String &ns,
+        const String &cls);
+    void addNegativeResult(
+        const String &op,
+        const bp::object &ns,
+        const bp::object &cls);
 #  ifdef HAVE_PEGASUS_ENUMERATION_CONTEXT
     static void init_type_pull(WBEMConnectionClass &cls);
 #  endif // HAVE_PEGASUS_ENUMERATION_CONTEXT
@@ -347,6 +448,11 @@ protected:
     String m_cert_file;
     String m_key_file;
     String m_default_namespace;
+    bp::object m_class_cache;
+    bp::object m_class_hierarchy;
+    bp::object m_instance_cache;
+    bp::object m_association_cache;
+    bp::object m_negative_cache;
 };
 
 #endif // LMIWBEM_CONNECTION_H
@@ -30,14 +30,15 @@
 #include "obj/cim/lmiwbem_instance_name.h"
 #include "obj/cim/lmiwbem_enum_ctx.h"
 #include "util/lmiwbem_convert.h"
+#include "util/lmiwbem_export.h"
 #include "util/lmiwbem_util.h"
 
 namespace {
 
-boost::shared_ptr<Pegasus::CIMEnumerationContext> make_enumeration_ctx()
+boost::shared_ptr<EnumerationContext> make_enumeration_ctx()
 {
-    boost::shared_ptr<Pegasus::CIMEnumerationContext> ctx_ptr(
-        new Pegasus::CIMEnumerationContext);
+    boost::shared_ptr<EnumerationContext> ctx_ptr(
+        new EnumerationContext);
     if (!ctx_ptr)
         throw_MemoryError("Can't create CIMEnumerationContext");
     return ctx_ptr;
@@ -142,7 +143,13 @@ void WBEMConnection::init_type_pull(WBEMConnection::WBEMConnectionClass &cls)
         docstr_WBEMConnection_PullInstanceNames)
     .def("CloseEnumeration", &WBEMConnection::closeEnumeration,
         (bp::arg("Context")),
-        docstr_WBEMConnection_CloseEnumeration);
+        docstr_WBEMConnection_CloseEnumeration)
+    .def("ExportPulledInstances", &WBEMConnection::exportPulledInstances,
+        (bp::arg("Context"),
+         bp::arg("File"),
+         bp::arg("Format") = "mof",
+         bp::arg("MaxObjectCnt") = 1000),
+        docstr_WBEMConnection_ExportPulledInstances);
 }
 
 bp::object WBEMConnection::openEnumerateInstances(
@@ -191,7 +198,7 @@ bp::object WBEMConnection::openEnumerateInstances(
             operation_timeout, "OperationTimeout"));
     }
 
-    boost::shared_ptr<Pegasus::CIMEnumerationContext> ctx_ptr(
+    boost::shared_ptr<EnumerationContext> ctx_ptr(
         make_enumeration_ctx());
     Pegasus::Array<Pegasus::CIMInstance> peg_instances;
     Pegasus::Boolean peg_end_of_sequence;
@@ -268,7 +275,7 @@ bp::object WBEMConnection::openEnumerateInstanceNames(
     }
 
     Pegasus::Array<Pegasus::CIMObjectPath> peg_instance_names;
-    boost::shared_ptr<Pegasus::CIMEnumerationContext> ctx_ptr(
+    boost::shared_ptr<EnumerationContext> ctx_ptr(
         make_enumeration_ctx());
     Pegasus::Boolean peg_end_of_sequence;
 
@@ -371,7 +378,7 @@ bp::object WBEMConnection::openAssociators(
     }
 
     Pegasus::Array<Pegasus::CIMInstance> peg_associators;
-    boost::shared_ptr<Pegasus::CIMEnumerationContext> ctx_ptr(
+    boost::shared_ptr<EnumerationContext> ctx_ptr(
         make_enumeration_ctx());
     Pegasus::Boolean peg_end_of_sequence;
 
@@ -466,7 +473,7 @@ bp::object WBEMConnection::openAssociatorNames(
     }
 
     Pegasus::Array<Pegasus::CIMObjectPath> peg_associator_names;
-    boost::shared_ptr<Pegasus::CIMEnumerationContext> ctx_ptr(
+    boost::shared_ptr<EnumerationContext> ctx_ptr(
         make_enumeration_ctx());
     Pegasus::Boolean peg_end_of_sequence;
 
@@ -558,7 +565,7 @@ bp::object WBEMConnection::openReferences(
     }
 
     Pegasus::Array<Pegasus::CIMInstance> peg_references;
-    boost::shared_ptr<Pegasus::CIMEnumerationContext> ctx_ptr(
+    boost::shared_ptr<EnumerationContext> ctx_ptr(
         make_enumeration_ctx());
     Pegasus::Boolean peg_end_of_sequence;
 
@@ -641,7 +648,7 @@ bp::object WBEMConnection::openReferenceNames(
     }
 
     Pegasus::Array<Pegasus::CIMObjectPath> peg_reference_names;
-    boost::shared_ptr<Pegasus::CIMEnumerationContext> ctx_ptr(
+    boost::shared_ptr<EnumerationContext> ctx_ptr(
         make_enumeration_ctx());
     Pegasus::Boolean peg_end_of_sequence;
 
@@ -706,7 +713,7 @@ bp::object WBEMConnection::openExecQuery(
         max_object_cnt, "MaxObjectCount");
 
     Pegasus::Array<Pegasus::CIMInstance> peg_instances;
-    boost::shared_ptr<Pegasus::CIMEnumerationContext> ctx_ptr(
+    boost::shared_ptr<EnumerationContext> ctx_ptr(
         make_enumeration_ctx());
     Pegasus::Boolean peg_end_of_sequence;
 
@@ -831,3 +838,52 @@ void WBEMConnection::closeEnumeration(const bp::object &ctx) try
     }
     handle_all_exceptions(ss);
 }
+
+bp::object WBEMConnection::exportPulledInstances(
+    const bp::object &ctx,
+    const bp::object &file,
+    const bp::object &format,
+    const bp::object &max_object_cnt) try
+{
+    CIMEnumerationContext &ctx_ = CIMEnumerationContext::asNative(ctx, "Context");
+    Pegasus::Uint32 peg_max_object_cnt = Conv::as<Pegasus::Uint32>(
+        max_object_cnt, "MaxObjectCnt");
+    if (peg_max_object_cnt == 0)
+        throw_ValueError("MaxObjectCnt must be greater than 0");
+
+    Exporter exporter(
+        Exporter::asFileDescriptor(file),
+        Exporter::asFormat(StringConv::asString(format, "Format")),
+        client()->getHostname());
+
+    // Only a single batch of instances is held in the memory at once.
+    Pegasus::Boolean peg_end_of_sequence = false;
+    while (!peg_end_of_sequence) {
+        Pegasus::Array<Pegasus::CIMInstance> peg_instances;
+
+        ScopedTransactionBegin();
+        if (ctx_.getIsWithPaths()) {
+            peg_instances = client()->pullInstancesWithPath(
+                ctx_.getPegasusContext(),
+                peg_end_of_sequence,
+                peg_max_object_cnt);
+        } else {
+            peg_instances = client()->pullInstances(
+                ctx_.getPegasusContext(),
+                peg_end_of_sequence,
+                peg_max_object_cnt);
+        }
+        ScopedTransactionEnd();
+
+        exporter.putInstances(peg_instances);
+    }
+    exporter.flush();
+
+    return bp::object(exporter.count());
+} catch (...) {
+    std::stringstream ss;
+    if (Config::isVerbose())
+        ss << "ExportPulledInstances()";
+    handle_all_exceptions(ss);
+    return None;
+}
@@ -0,0 +1,553 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#include <config.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+#include <boost/python/dict.hpp>
+#include <boost/python/list.hpp>
+#include <boost/python/tuple.hpp>
+#include <Pegasus/Common/CIMName.h>
+#include <Pegasus/Common/Exception.h>
+#include "lmiwbem_exception.h"
+#include "lmiwbem_gil.h"
+#include "lmiwbem_mutex.h"
+#include "obj/lmiwbem_association_cache.h"
+#include "obj/lmiwbem_config.h"
+#include "obj/lmiwbem_connection.h"
+#include "obj/lmiwbem_connection_pydoc.h"
+#include "obj/cim/lmiwbem_instance_name.h"
+#include "util/lmiwbem_convert.h"
+#include "util/lmiwbem_util.h"
+
+namespace {
+
+const unsigned int TRAVERSE_DEFAULT_WORKERS = 4;
+
+// AssocClass, ResultClass, Role and ResultRole of a single hop.
+class Hop
+{
+public:
+    Hop(const bp::object &hop);
+
+    Pegasus::CIMName getAssocClass() const;
+    Pegasus::CIMName getResultClass() const;
+
+    String m_assoc_class;
+    String m_result_class;
+    String m_role;
+    String m_result_role;
+};
+
+// Nodes reached by a hop; each node is kept once.
+class Level
+{
+public:
+    Level();
+
+    size_t add(const Pegasus::CIMObjectPath &path);
+
+    std::vector<Pegasus::CIMObjectPath> m_paths;
+    std::map<String, size_t> m_index;
+};
+
+// AssociatorNames() call for a single node of a frontier.
+class Query
+{
+public:
+    Query(const Pegasus::CIMObjectPath &path);
+
+    Pegasus::CIMObjectPath m_path;
+    Pegasus::Array<Pegasus::CIMObjectPath> m_names;
+};
+
+// Pool of clients, which run the queries of a hop concurrently. Each client
+// has its own connection and thread; the threads do not touch Python objects,
+// so the GIL is released while they run.
+class WorkerPool
+{
+public:
+    WorkerPool(
+        const String &url,
+        const String &username,
+        const String &password,
+        const String &cert_file,
+        const String &key_file,
+        bool connect_locally);
+    ~WorkerPool();
+
+    void add(CIMClient *client);
+    size_t size() const;
+
+    void run(
+        const Pegasus::CIMNamespaceName &ns,
+        const Hop &hop,
+        std::vector<Query> &queries);
+
+private:
+    class Worker
+    {
+    public:
+        WorkerPool *m_pool;
+        CIMClient *m_client;
+        pthread_t m_thread;
+    };
+
+    static void *runWorker(void *worker);
+    void work(CIMClient *client);
+    void fail(bool cim_error, int code, const String &message);
+
+    String m_url;
+    String m_username;
+    String m_password;
+    String m_cert_file;
+    String m_key_file;
+    bool m_connect_locally;
+    std::vector<CIMClient*> m_clients;
+
+    // State of a running hop.
+    Mutex m_mutex;
+    const Pegasus::CIMNamespaceName *m_ns;
+    const Hop *m_hop;
+    std::vector<Query> *m_queries;
+    size_t m_next;
+    bool m_failed;
+    bool m_cim_error;
+    int m_code;
+    String m_message;
+};
+
+Hop::Hop(const bp::object &hop)
+    : m_assoc_class()
+    , m_result_class()
+    , m_role()
+    , m_result_role()
+{
+    bp::object py_assoc_class;
+    bp::object py_result_class;
+    bp::object py_role;
+    bp::object py_result_role;
+
+    if (isdict(hop)) {
+        bp::dict py_hop(hop);
+        py_assoc_class = py_hop.get("AssocClass");
+        py_result_class = py_hop.get("ResultClass");
+        py_role = py_hop.get("Role");
+        py_result_role = py_hop.get("ResultRole");
+    } else {
+        bp::tuple py_hop(Conv::get<bp::tuple>(hop, "Hops[i]"));
+        const int cnt = bp::len(py_hop);
+        if (cnt > 4)
+            throw_ValueError("Hops must contain tuples of up to 4 items");
+        if (cnt > 0)
+            py_assoc_class = py_hop[0];
+        if (cnt > 1)
+            py_result_class = py_hop[1];
+        if (cnt > 2)
+            py_role = py_hop[2];
+        if (cnt > 3)
+            py_result_role = py_hop[3];
+    }
+
+    if (!isnone(py_assoc_class))
+        m_assoc_class = StringConv::asString(py_assoc_class, "AssocClass");
+    if (!isnone(py_result_class))
+        m_result_class = StringConv::asString(py_result_class, "ResultClass");
+    if (!isnone(py_role))
+        m_role = StringConv::asString(py_role, "Role");
+    if (!isnone(py_result_role))
+        m_result_role = StringConv::asString(py_result_role, "ResultRole");
+}
+
+Pegasus::CIMName Hop::getAssocClass() const
+{
+    if (m_assoc_class.empty())
+        return Pegasus::CIMName();
+    return Pegasus::CIMName(m_assoc_class);
+}
+
+Pegasus::CIMName Hop::getResultClass() const
+{
+    if (m_result_class.empty())
+        return Pegasus::CIMName();
+    return Pegasus::CIMName(m_result_class);
+}
+
+Level::Level()
+    : m_paths()
+    , m_index()
+{
+}
+
+size_t Level::add(const Pegasus::CIMObjectPath &path)
+{
+    std::pair<std::map<String, size_t>::iterator, bool> inserted =
+        m_index.insert(std::make_pair(canonical_path(path), m_paths.size()));
+    if (inserted.second)
+        m_paths.push_back(path);
+    return inserted.first->second;
+}
+
+Query::Query(const Pegasus::CIMObjectPath &path)
+    : m_path(path)
+    , m_names()
+{
+}
+
+WorkerPool::WorkerPool(
+    const String &url,
+    const String &username,
+    const String &password,
+    const String &cert_file,
+    const String &key_file,
+    bool connect_locally)
+    : m_url(url)
+    , m_username(username)
+    , m_password(password)
+    , m_cert_file(cert_file)
+    , m_key_file(key_file)
+    , m_connect_locally(connect_locally)
+    , m_clients()
+    , m_mutex()
+    , m_ns(NULL)
+    , m_hop(NULL)
+    , m_queries(NULL)
+    , m_next(0)
+    , m_failed(false)
+    , m_cim_error(false)
+    , m_code(0)
+    , m_message()
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+    std::vector<CIMClient*>::iterator it;
+    for (it = m_clients.begin(); it != m_clients.end(); ++it) {
+        try {
+            if ((*it)->isConnected())
+                (*it)->disconnect();
+        } catch (...) {
+        }
+        delete *it;
+    }
+}
+
+void WorkerPool::add(CIMClient *client)
+{
+    m_clients.push_back(client);
+}
+
+size_t WorkerPool::size() const
+{
+    return m_clients.size();
+}
+
+void WorkerPool::run(
+    const Pegasus::CIMNamespaceName &ns,
+    const Hop &hop,
+    std::vector<Query> &queries)
+{
+    m_ns = &ns;
+    m_hop = &hop;
+    m_queries = &queries;
+    m_next = 0;
+    m_failed = false;
+
+    const size_t cnt = std::min(m_clients.size(), queries.size());
+    std::vector<Worker> workers(cnt);
+
+    {
+        ScopedGILRelease sr;
+
+        size_t started = 0;
+        for (size_t i = 0; i < cnt; ++i) {
+            workers[i].m_pool = this;
+            workers[i].m_client = m_clients[i];
+            if (pthread_create(&workers[i].m_thread, NULL,
+                    &WorkerPool::runWorker, &workers[i]) != 0)
+            {
+                break;
+            }
+            ++started;
+        }
+
+        // We could not start any thread; do the work here.
+        if (!started)
+            work(m_clients[0]);
+
+        for (size_t i = 0; i < started; ++i)
+            pthread_join(workers[i].m_thread, NULL);
+    }
+
+    if (!m_failed)
+        return;
+
+    if (m_cim_error)
+        throw_CIMError(m_message, m_code);
+    else
+        throw_ConnectionError(m_message, m_code);
+}
+
+void *WorkerPool::runWorker(void *worker)
+{
+    Worker *w = static_cast<Worker*>(worker);
+    w->m_pool->work(w->m_client);
+    return NULL;
+}
+
+void WorkerPool::work(CIMClient *client) try
+{
+    if (!client->isConnected()) {
+        if (m_connect_locally) {
+            client->connectLocally();
+        } else {
+            client->connect(m_url, m_username, m_password, m_cert_file,
+                m_key_file, Config::getDefaultTrustStore());
+        }
+    }
+
+    while (true) {
+        Query *query;
+        {
+            ScopedMutex sm(m_mutex);
+            if (m_failed || m_next >= m_queries->size())
+                return;
+            query = &(*m_queries)[m_next++];
+        }
+
+        query->m_names = client->associatorNames(
+            *m_ns,
+            query->m_path,
+            m_hop->getAssocClass(),
+            m_hop->getResultClass(),
+            m_hop->m_role,
+            m_hop->m_result_role);
+    }
+} catch (const Pegasus::CIMException &e) {
+    fail(true, static_cast<int>(e.getCode()), e.getMessage());
+} catch (const Pegasus::Exception &e) {
+    fail(false, 0, e.getMessage());
+} catch (const std::exception &e) {
+    fail(false, 0, e.what());
+} catch (...) {
+    fail(false, 0, "Unknown error");
+}
+
+void WorkerPool::fail(bool cim_error, int code, const String &message)
+{
+    ScopedMutex sm(m_mutex);
+
+    // Report the first error only.
+    if (m_failed)
+        return;
+
+    m_failed = true;
+    m_cim_error = cim_error;
+    m_code = code;
+    m_message = message;
+}
+
+} // unnamed namespace
+
+void WBEMConnection::init_type_traverse(WBEMConnection::WBEMConnectionClass &cls)
+{
+    cls.def("Traverse", &WBEMConnection::traverse,
+        (bp::arg("ObjectNames"),
+         bp::arg("Hops"),
+         bp::arg("namespace") = None,
+         bp::arg("Workers") = TRAVERSE_DEFAULT_WORKERS),
+        docstr_WBEMConnection_Traverse);
+}
+
+bp::object WBEMConnection::traverse(
+    const bp::object &object_names,
+    const bp::object &hops,
+    const bp::object &ns,
+    const bp::object &workers) try
+{
+    // Start set of the traversal.
+    bp::list py_object_names;
+    if (isinstance(object_names, CIMInstanceName::type()))
+        py_object_names.append(object_names);
+    else
+        py_object_names = bp::list(
+            Conv::get<bp::list>(object_names, "ObjectNames"));
+
+    std::vector<Level> levels(1);
+    const int names_cnt = bp::len(py_object_names);
+    for (int i = 0; i < names_cnt; ++i) {
+        const CIMInstanceName &cim_inst_name = CIMInstanceName::asNative(
+            py_object_names[i], "ObjectNames[i]");
+        levels[0].add(cim_inst_name.asPegasusCIMObjectPath());
+    }
+
+    String c_ns(m_default_namespace);
+    if (!isnone(ns))
+        c_ns = StringConv::asString(ns, "namespace");
+    else if (!levels[0].m_paths.empty() &&
+        !levels[0].m_paths[0].getNameSpace().isNull())
+    {
+        c_ns = levels[0].m_paths[0].getNameSpace().getString();
+    }
+    Pegasus::CIMNamespaceName peg_ns(c_ns);
+
+    bp::list py_hops(Conv::get<bp::list>(hops, "Hops"));
+    std::vector<Hop> c_hops;
+    const int hops_cnt = bp::len(py_hops);
+    for (int i = 0; i < hops_cnt; ++i)
+        c_hops.push_back(Hop(py_hops[i]));
+
+    const unsigned int c_workers = Conv::as<unsigned int>(workers, "Workers");
+    if (c_workers == 0)
+        throw_ValueError("Workers must be positive");
+
+    if (!m_connect_locally && !client()->getURLInfo().isValid())
+        throw_ValueError("WBEMConnection constructed with invalid url parameter");
+
+    AssociationCache *cache = NULL;
+    if (!isnone(m_association_cache))
+        cache = &AssociationCache::asNative(m_association_cache);
+
+    const String url(client()->getUrl());
+
+    // Clients of the pool are created by the first hop, which needs them.
+    WorkerPool pool(url, m_username, m_password, m_cert_file, m_key_file,
+        m_connect_locally);
+
+    typedef std::set<std::pair<size_t, size_t> > Edges;
+    std::vector<Edges> edges(c_hops.size());
+
+    levels.reserve(c_hops.size() + 1);
+    for (size_t i = 0; i < c_hops.size(); ++i) {
+        levels.push_back(Level());
+
+        const Hop &hop = c_hops[i];
+        const Level &frontier = levels[i];
+        Level &reached = levels[i + 1];
+
+        // Results of the frontier nodes, either cached or queried.
+        std::vector<Pegasus::Array<Pegasus::CIMObjectPath> > results(
+            frontier.m_paths.size());
+        std::vector<Query> queries;
+        std::vector<size_t> queried;
+        for (size_t j = 0; j < frontier.m_paths.size(); ++j) {
+            if (cache && cache->getAssociatorNames(url, c_ns,
+                frontier.m_paths[j], hop.m_assoc_class, hop.m_result_class,
+                hop.m_role, hop.m_result_role, results[j]))
+            {
+                continue;
+            }
+
+            queries.push_back(Query(frontier.m_paths[j]));
+            queried.push_back(j);
+        }
+
+        if (queries.empty()) {
+            // All the results were cached.
+        } else if (queries.size() == 1 || c_workers == 1) {
+            std::vector<Query>::iterator it;
+            ScopedTransactionBegin();
+            for (it = queries.begin(); it != queries.end(); ++it) {
+                it->m_names = client()->associatorNames(
+                    peg_ns,
+                    it->m_path,
+                    hop.getAssocClass(),
+                    hop.getResultClass(),
+                    hop.m_role,
+                    hop.m_result_role);
+            }
+            ScopedTransactionEnd();
+        } else {
+            const size_t cnt = std::min(
+                static_cast<size_t>(c_workers), queries.size());
+            while (pool.size() < cnt) {
+                CIMClient *worker_client = clientCreate();
+                worker_client->setUrlInfo(client()->getURLInfo());
+                worker_client->setVerifyCertificate(
+                    client()->getVerifyCertificate());
+                worker_client->setTimeout(client()->getTimeout());
+                worker_client->setRequestAcceptLanguages(
+                    client()->getRequestAcceptLanguages());
+                pool.add(worker_client);
+            }
+
+            pool.run(peg_ns, hop, queries);
+        }
+
+        for (size_t j = 0; j < queries.size(); ++j) {
+            results[queried[j]] = queries[j].m_names;
+            if (cache) {
+                cache->addAssociatorNames(url, c_ns, queries[j].m_path,
+                    hop.m_assoc_class, hop.m_result_class, hop.m_role,
+                    hop.m_result_role, queries[j].m_names);
+            }
+        }
+
+        for (size_t j = 0; j < results.size(); ++j) {
+            const Pegasus::Uint32 cnt = results[j].size();
+            for (Pegasus::Uint32 k = 0; k < cnt; ++k)
+                edges[i].insert(std::make_pair(j, reached.add(results[j][k])));
+        }
+    }
+
+    // Convert the reached subgraph; each node is converted once per level.
+    const String hostname(client()->getHostname());
+    std::vector<bp::list> py_levels(levels.size());
+    bp::list py_nodes;
+    for (size_t i = 0; i < levels.size(); ++i) {
+        const std::vector<Pegasus::CIMObjectPath> &paths = levels[i].m_paths;
+        for (size_t j = 0; j < paths.size(); ++j)
+            py_levels[i].append(
+                CIMInstanceName::create(paths[j], c_ns, hostname));
+        py_nodes.append(py_levels[i]);
+    }
+
+    bp::list py_edges;
+    for (size_t i = 0; i < edges.size(); ++i) {
+        bp::list py_hop_edges;
+        Edges::const_iterator it;
+        for (it = edges[i].begin(); it != edges[i].end(); ++it) {
+            py_hop_edges.append(bp::make_tuple(
+                py_levels[i][it->first],
+                py_levels[i + 1][it->second]));
+        }
+        py_edges.append(py_hop_edges);
+    }
+
+    bp::dict py_graph;
+    py_graph["nodes"] = py_nodes;
+    py_graph["edges"] = py_edges;
+    return py_graph;
+} catch (...) {
+    std::stringstream ss;
+    if (Config::isVerbose()) {
+        ss << "Traverse(";
+        if (Config::isVerboseMore())
+            ss << '\'' << ObjectConv::asString(object_names) << '\'';
+        ss << ')';
+    }
+    handle_all_exceptions(ss);
+    return None;
+}
@@ -0,0 +1,432 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#include <config.h>
+#include <algorithm>
+#include <sstream>
+#include <boost/python/class.hpp>
+#include <Pegasus/Common/CIMValue.h>
+#include "lmiwbem_exception.h"
+#include "obj/lmiwbem_instance_cache.h"
+#include "obj/lmiwbem_instance_cache_pydoc.h"
+#include "obj/cim/lmiwbem_instance_name.h"
+#include "util/lmiwbem_convert.h"
+#include "util/lmiwbem_util.h"
+
+namespace {
+
+const double INSTANCE_CACHE_DEFAULT_TTL = 10.0;
+const size_t INSTANCE_CACHE_DEFAULT_MAX_BYTES = 64 << 20;
+
+enum {
+    FLAG_LOCAL_ONLY           = 1 << 0,
+    FLAG_INCLUDE_QUALIFIERS   = 1 << 1,
+    FLAG_INCLUDE_CLASS_ORIGIN = 1 << 2
+};
+
+std::set<String> property_set(const Pegasus::CIMPropertyList &property_list)
+{
+    std::set<String> properties;
+    const Pegasus::Uint32 cnt = property_list.size();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        properties.insert(lower(property_list[i].getString()));
+    return properties;
+}
+
+// Rough estimate of memory used by the instance.
+size_t instance_size(const Pegasus::CIMConstInstance &instance)
+{
+    size_t size = 256;
+    const Pegasus::Uint32 cnt = instance.getPropertyCount();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+        Pegasus::CIMConstProperty peg_property = instance.getProperty(i);
+        size += 64 + 2 * peg_property.getName().getString().size();
+
+        const Pegasus::CIMValue &peg_value = peg_property.getValue();
+        if (peg_value.isNull())
+            continue;
+
+        if (peg_value.getType() != Pegasus::CIMTYPE_STRING) {
+            size += 16 * (peg_value.isArray() ? peg_value.getArraySize() : 1);
+        } else if (peg_value.isArray()) {
+            Pegasus::Array<Pegasus::String> peg_array;
+            peg_value.get(peg_array);
+            for (Pegasus::Uint32 j = 0; j < peg_array.size(); ++j)
+                size += 16 + 2 * peg_array[j].size();
+        } else {
+            Pegasus::String peg_str;
+            peg_value.get(peg_str);
+            size += 2 * peg_str.size();
+        }
+    }
+    return size;
+}
+
+} // unnamed namespace
+
+InstanceCache::Key::Key(
+    const String &url,
+    const String &ns,
+    const Pegasus::CIMObjectPath &path,
+    bool local_only,
+    bool include_qualifiers,
+    bool include_class_origin)
+    : m_url(url)
+    , m_ns(lower(ns))
+    , m_path(canonical_path(path))
+    , m_classname(lower(path.getClassName().getString()))
+    , m_flags(0)
+{
+    if (local_only)
+        m_flags |= FLAG_LOCAL_ONLY;
+    if (include_qualifiers)
+        m_flags |= FLAG_INCLUDE_QUALIFIERS;
+    if (include_class_origin)
+        m_flags |= FLAG_INCLUDE_CLASS_ORIGIN;
+}
+
+bool InstanceCache::Key::operator<(const Key &rhs) const
+{
+    if (m_path != rhs.m_path)
+        return m_path < rhs.m_path;
+    if (m_ns != rhs.m_ns)
+        return m_ns < rhs.m_ns;
+    if (m_url != rhs.m_url)
+        return m_url < rhs.m_url;
+    return m_flags < rhs.m_flags;
+}
+
+InstanceCache::Entry::Entry(
+    const Key &key,
+    const Pegasus::CIMInstance &instance,
+    const Pegasus::CIMPropertyList &property_list,
+    double expires)
+    : m_key(key)
+    , m_instance(instance)
+    , m_properties(property_set(property_list))
+    , m_all(property_list.isNull())
+    , m_expires(expires)
+    , m_size(instance_size(instance))
+{
+}
+
+bool InstanceCache::Entry::covers(
+    const std::set<String> &properties,
+    bool all) const
+{
+    if (m_all)
+        return true;
+    if (all)
+        return false;
+    return std::includes(
+        m_properties.begin(), m_properties.end(),
+        properties.begin(), properties.end());
+}
+
+InstanceCache::InstanceCache(
+    const bp::object &ttl,
+    const bp::object &max_bytes)
+    : m_mutex()
+    , m_entries()
+    , m_index()
+    , m_ttl(INSTANCE_CACHE_DEFAULT_TTL)
+    , m_max_bytes(INSTANCE_CACHE_DEFAULT_MAX_BYTES)
+    , m_size(0)
+    , m_hits(0)
+    , m_misses(0)
+{
+    setPyTTL(ttl);
+    setPyMaxBytes(max_bytes);
+}
+
+void InstanceCache::init_type()
+{
+    CIMBase<InstanceCache>::init_type(
+        bp::class_<InstanceCache, boost::noncopyable>("InstanceCache", bp::no_init)
+        .def(bp::init<
+            const bp::object &,
+            const bp::object &>((
+                bp::arg("ttl") = INSTANCE_CACHE_DEFAULT_TTL,
+                bp::arg("max_bytes") = INSTANCE_CACHE_DEFAULT_MAX_BYTES),
+                docstr_InstanceCache_init))
+        .def("__repr__", &InstanceCache::repr, docstr_InstanceCache_repr)
+        .def("__len__", &InstanceCache::len)
+        .def("invalidate", &InstanceCache::invalidate,
+            (bp::arg("InstanceName") = None,
+             bp::arg("ClassName") = None,
+             bp::arg("url") = None),
+            docstr_InstanceCache_invalidate)
+        .def("clear", &InstanceCache::clear, docstr_InstanceCache_clear)
+        .add_property("ttl",
+            &InstanceCache::getPyTTL,
+            &InstanceCache::setPyTTL,
+            docstr_InstanceCache_ttl)
+        .add_property("max_bytes",
+            &InstanceCache::getPyMaxBytes,
+            &InstanceCache::setPyMaxBytes,
+            docstr_InstanceCache_max_bytes)
+        .add_property("size",
+            &InstanceCache::getPySize,
+            docstr_InstanceCache_size)
+        .add_property("hits", &InstanceCache::getPyHits)
+        .add_property("misses", &InstanceCache::getPyMisses));
+}
+
+bp::object InstanceCache::repr()
+{
+    ScopedMutex sm(m_mutex);
+    std::stringstream ss;
+    ss << "InstanceCache(ttl=" << m_ttl << ", max_bytes=" << m_max_bytes
+       << ", len=" << m_entries.size() << ", ...)";
+    return StringConv::asPyUnicode(ss.str());
+}
+
+bool InstanceCache::getInstance(
+    const String &url,
+    const String &ns,
+    const Pegasus::CIMObjectPath &path,
+    bool local_only,
+    bool include_qualifiers,
+    bool include_class_origin,
+    const Pegasus::CIMPropertyList &property_list,
+    Pegasus::CIMInstance &instance)
+{
+    ScopedMutex sm(m_mutex);
+
+    EntryIndex::iterator found = m_index.find(
+        Key(url, ns, path, local_only, include_qualifiers,
+            include_class_origin));
+    if (found == m_index.end()) {
+        ++m_misses;
+        return false;
+    }
+
+    const double now = monotonic_now();
+    const bool all = property_list.isNull();
+    const std::set<String> properties(property_set(property_list));
+
+    EntryRefs refs(found->second);
+    EntryRefs::iterator it;
+    for (it = refs.begin(); it != refs.end(); ++it) {
+        EntryList::iterator entry = *it;
+        if (entry->m_expires < now) {
+            erase(entry);
+            continue;
+        }
+
+        if (!entry->covers(properties, all))
+            continue;
+
+        // Move the entry to the front of LRU list.
+        m_entries.splice(m_entries.begin(), m_entries, entry);
+
+        if (all || (!entry->m_all && entry->m_properties == properties)) {
+            instance = entry->m_instance;
+        } else {
+            // Drop the properties, which were not requested.
+            instance = entry->m_instance.clone();
+            for (Pegasus::Uint32 i = instance.getPropertyCount(); i > 0; --i) {
+                String name = lower(
+                    instance.getProperty(i - 1).getName().getString());
+                if (properties.find(name) == properties.end())
+                    instance.removeProperty(i - 1);
+            }
+        }
+
+        ++m_hits;
+        return true;
+    }
+
+    ++m_misses;
+    return false;
+}
+
+void InstanceCache::addInstance(
+    const String &url,
+    const String &ns,
+    const Pegasus::CIMObjectPath &path,
+    bool local_only,
+    bool include_qualifiers,
+    bool include_class_origin,
+    const Pegasus::CIMPropertyList &property_list,
+    const Pegasus::CIMInstance &instance)
+{
+    ScopedMutex sm(m_mutex);
+
+    Key key(url, ns, path, local_only, include_qualifiers,
+        include_class_origin);
+    Entry entry(key, instance, property_list, monotonic_now() + m_ttl);
+
+    // Drop the entries, which are covered by the new one.
+    EntryIndex::iterator found = m_index.find(key);
+    if (found != m_index.end()) {
+        EntryRefs refs(found->second);
+        EntryRefs::iterator it;
+        for (it = refs.begin(); it != refs.end(); ++it) {
+            if (entry.covers((*it)->m_properties, (*it)->m_all))
+                erase(*it);
+        }
+    }
+
+    m_entries.push_front(entry);
+    m_index[key].push_back(m_entries.begin());
+    m_size += entry.m_size;
+
+    shrink();
+}
+
+void InstanceCache::invalidateInstance(
+    const String &url,
+    const String &ns,
+    const Pegasus::CIMObjectPath &path)
+{
+    ScopedMutex sm(m_mutex);
+
+    String c_path(canonical_path(path));
+    String c_ns(lower(ns));
+
+    EntryList::iterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        const Key &key = it->m_key;
+        if (key.m_path == c_path && key.m_ns == c_ns && key.m_url == url)
+            erase(it++);
+        else
+            ++it;
+    }
+}
+
+void InstanceCache::invalidate(
+    const bp::object &instance_name,
+    const bp::object &cls,
+    const bp::object &url)
+{
+    String c_path;
+    String c_ns;
+    String c_cls;
+    String c_url;
+    if (!isnone(instance_name)) {
+        const CIMInstanceName &cim_inst_name = CIMInstanceName::asNative(
+            instance_name, "InstanceName");
+        c_path = canonical_path(cim_inst_name.asPegasusCIMObjectPath());
+        c_ns = lower(cim_inst_name.getNamespace());
+    }
+    if (!isnone(cls))
+        c_cls = lower(StringConv::asString(cls, "ClassName"));
+    if (!isnone(url))
+        c_url = StringConv::asString(url, "url");
+
+    ScopedMutex sm(m_mutex);
+
+    EntryList::iterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        const Key &key = it->m_key;
+        if ((isnone(instance_name) || (key.m_path == c_path &&
+                (c_ns.empty() || key.m_ns == c_ns))) &&
+            (isnone(cls) || key.m_classname == c_cls) &&
+            (isnone(url) || key.m_url == c_url))
+        {
+            erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void InstanceCache::clear()
+{
+    ScopedMutex sm(m_mutex);
+    m_entries.clear();
+    m_index.clear();
+    m_size = 0;
+}
+
+bp::object InstanceCache::len()
+{
+    ScopedMutex sm(m_mutex);
+    return bp::object(m_entries.size());
+}
+
+bp::object InstanceCache::getPyTTL() const
+{
+    return bp::object(m_ttl);
+}
+
+bp::object InstanceCache::getPyMaxBytes() const
+{
+    return bp::object(m_max_bytes);
+}
+
+bp::object InstanceCache::getPySize() const
+{
+    return bp::object(m_size);
+}
+
+bp::object InstanceCache::getPyHits() const
+{
+    return bp::object(m_hits);
+}
+
+bp::object InstanceCache::getPyMisses() const
+{
+    return bp::object(m_misses);
+}
+
+void InstanceCache::setPyTTL(const bp::object &ttl)
+{
+    double c_ttl = Conv::as<double>(ttl, "ttl");
+    if (c_ttl < 0)
+        throw_ValueError("ttl must be non-negative");
+
+    ScopedMutex sm(m_mutex);
+    m_ttl = c_ttl;
+}
+
+void InstanceCache::setPyMaxBytes(const bp::object &max_bytes)
+{
+    size_t c_max_bytes = Conv::as<size_t>(max_bytes, "max_bytes");
+    if (c_max_bytes == 0)
+        throw_ValueError("max_bytes must be positive");
+
+    ScopedMutex sm(m_mutex);
+    m_max_bytes = c_max_bytes;
+    shrink();
+}
+
+void InstanceCache::erase(EntryList::iterator entry)
+{
+    EntryIndex::iterator found = m_index.find(entry->m_key);
+    if (found != m_index.end()) {
+        found->second.remove(entry);
+        if (found->second.empty())
+            m_index.erase(found);
+    }
+
+    m_size -= entry->m_size;
+    m_entries.erase(entry);
+}
+
+void InstanceCache::shrink()
+{
+    while (m_size > m_max_bytes && !m_entries.empty()) {
+        EntryList::iterator last = m_entries.end();
+        erase(--last);
+    }
+}
@@ -0,0 +1,156 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef   LMIWBEM_INSTANCE_CACHE_H
+#  define LMIWBEM_INSTANCE_CACHE_H
+
+#  include <list>
+#  include <map>
+#  include <set>
+#  include <boost/python/object.hpp>
+#  include <Pegasus/Common/CIMInstance.h>
+#  include <Pegasus/Common/CIMObjectPath.h>
+#  include <Pegasus/Common/CIMPropertyList.h>
+#  include "lmiwbem.h"
+#  include "lmiwbem_mutex.h"
+#  include "obj/lmiwbem_cimbase.h"
+#  include "util/lmiwbem_string.h"
+
+namespace bp = boost::python;
+
+// Read-through cache of GetInstance() results. Instances are keyed by the
+// CIMOM's URL, canonical object path and the GetInstance() flags. For each key
+// the cache keeps instances fetched with different PropertyLists; a request is
+// served by an instance fetched with the same or a wider PropertyList, whose
+// extra properties are dropped. Entries expire after TTL seconds and the least
+// recently used ones are dropped, when the estimated memory use exceeds the
+// limit.
+class InstanceCache: public CIMBase<InstanceCache>
+{
+public:
+    InstanceCache(
+        const bp::object &ttl,
+        const bp::object &max_bytes);
+
+    static void init_type();
+
+    bp::object repr();
+
+    bool getInstance(
+        const String &url,
+        const String &ns,
+        const Pegasus::CIMObjectPath &path,
+        bool local_only,
+        bool include_qualifiers,
+        bool include_class_origin,
+        const Pegasus::CIMPropertyList &property_list,
+        Pegasus::CIMInstance &instance);
+    void addInstance(
+        const String &url,
+        const String &ns,
+        const Pegasus::CIMObjectPath &path,
+        bool local_only,
+        bool include_qualifiers,
+        bool include_class_origin,
+        const Pegasus::CIMPropertyList &property_list,
+        const Pegasus::CIMInstance &instance);
+    void invalidateInstance(
+        const String &url,
+        const String &ns,
+        const Pegasus::CIMObjectPath &path);
+
+    void invalidate(
+        const bp::object &instance_name,
+        const bp::object &cls,
+        const bp::object &url);
+    void clear();
+
+    bp::object len();
+
+    bp::object getPyTTL() const;
+    bp::object getPyMaxBytes() const;
+    bp::object getPySize() const;
+    bp::object getPyHits() const;
+    bp::object getPyMisses() const;
+
+    void setPyTTL(const bp::object &ttl);
+    void setPyMaxBytes(const bp::object &max_bytes);
+
+private:
+    class Key
+    {
+    public:
+        Key(
+            const String &url,
+            const String &ns,
+            const Pegasus::CIMObjectPath &path,
+            bool local_only,
+            bool include_qualifiers,
+            bool include_class_origin);
+
+        bool operator<(const Key &rhs) const;
+
+        String m_url;
+        String m_ns;
+        String m_path;
+        String m_classname;
+        unsigned int m_flags;
+    };
+
+    class Entry
+    {
+    public:
+        Entry(
+            const Key &key,
+            const Pegasus::CIMInstance &instance,
+            const Pegasus::CIMPropertyList &property_list,
+            double expires);
+
+        bool covers(const std::set<String> &properties, bool all) const;
+
+        Key m_key;
+        Pegasus::CIMInstance m_instance;
+        std::set<String> m_properties;
+        bool m_all;
+        double m_expires;
+        size_t m_size;
+    };
+
+    // Entries are kept in LRU order, most recently used first; the index
+    // maps keys to the entries fetched with different PropertyLists.
+    typedef std::list<Entry> EntryList;
+    typedef std::list<EntryList::iterator> EntryRefs;
+    typedef std::map<Key, EntryRefs> EntryIndex;
+
+    void erase(EntryList::iterator entry);
+    void shrink();
+
+    Mutex m_mutex;
+    EntryList m_entries;
+    EntryIndex m_index;
+    double m_ttl;
+    size_t m_max_bytes;
+    size_t m_size;
+    unsigned long m_hits;
+    unsigned long m_misses;
+};
+
+#endif // LMIWBEM_INSTANCE_CACHE_H
@@ -0,0 +1,336 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#include <config.h>
+#include <sstream>
+#include <boost/python/class.hpp>
+#include <Pegasus/Common/Exception.h>
+#include <Pegasus/Client/CIMClientException.h>
+#include "lmiwbem_exception.h"
+#include "obj/lmiwbem_negative_cache.h"
+#include "obj/lmiwbem_negative_cache_pydoc.h"
+#include "obj/cim/lmiwbem_constants.h"
+#include "util/lmiwbem_convert.h"
+#include "util/lmiwbem_util.h"
+
+namespace {
+
+const double NEGATIVE_CACHE_DEFAULT_TTL = 60.0;
+const size_t NEGATIVE_CACHE_DEFAULT_MAX_SIZE = 10000;
+
+} // unnamed namespace
+
+NegativeCache::Failure::Failure()
+    : m_connection_error(false)
+    , m_code(0)
+    , m_message()
+{
+}
+
+NegativeCache::Key::Key(
+    const String &url,
+    const String &ns,
+    const String &cls,
+    const String &op)
+    : m_url(url)
+    , m_ns(lower(ns))
+    , m_cls(lower(cls))
+    , m_op(op)
+{
+}
+
+bool NegativeCache::Key::operator<(const Key &rhs) const
+{
+    if (m_cls != rhs.m_cls)
+        return m_cls < rhs.m_cls;
+    if (m_op != rhs.m_op)
+        return m_op < rhs.m_op;
+    if (m_ns != rhs.m_ns)
+        return m_ns < rhs.m_ns;
+    return m_url < rhs.m_url;
+}
+
+NegativeCache::Entry::Entry(
+    const Key &key,
+    const Failure &failure,
+    double expires)
+    : m_key(key)
+    , m_failure(failure)
+    , m_expires(expires)
+{
+}
+
+NegativeCache::NegativeCache(
+    const bp::object &ttl,
+    const bp::object &max_size)
+    : m_mutex()
+    , m_entries()
+    , m_index()
+    , m_ttl(NEGATIVE_CACHE_DEFAULT_TTL)
+    , m_max_size(NEGATIVE_CACHE_DEFAULT_MAX_SIZE)
+    , m_hits(0)
+    , m_misses(0)
+{
+    setPyTTL(ttl);
+    setPyMaxSize(max_size);
+}
+
+void NegativeCache::init_type()
+{
+    CIMBase<NegativeCache>::init_type(
+        bp::class_<NegativeCache, boost::noncopyable>("NegativeCache", bp::no_init)
+        .def(bp::init<
+            const bp::object &,
+            const bp::object &>((
+                bp::arg("ttl") = NEGATIVE_CACHE_DEFAULT_TTL,
+                bp::arg("max_size") = NEGATIVE_CACHE_DEFAULT_MAX_SIZE),
+                docstr_NegativeCache_init))
+        .def("__repr__", &NegativeCache::repr, docstr_NegativeCache_repr)
+        .def("__len__", &NegativeCache::len)
+        .def("invalidate", &NegativeCache::invalidate,
+            (bp::arg("url") = None,
+             bp::arg("ClassName") = None),
+            docstr_NegativeCache_invalidate)
+        .def("clear", &NegativeCache::clear, docstr_NegativeCache_clear)
+        .add_property("ttl",
+            &NegativeCache::getPyTTL,
+            &NegativeCache::setPyTTL,
+            docstr_NegativeCache_ttl)
+        .add_property("max_size",
+            &NegativeCache::getPyMaxSize,
+            &NegativeCache::setPyMaxSize,
+            docstr_NegativeCache_max_size)
+        .add_property("hits", &NegativeCache::getPyHits)
+        .add_property("misses", &NegativeCache::getPyMisses));
+}
+
+bp::object NegativeCache::repr()
+{
+    ScopedMutex sm(m_mutex);
+    std::stringstream ss;
+    ss << "NegativeCache(ttl=" << m_ttl << ", max_size=" << m_max_size
+       << ", len=" << m_entries.size() << ", ...)";
+    return StringConv::asPyUnicode(ss.str());
+}
+
+bool NegativeCache::getFailure(Failure &failure)
+{
+    try {
+        throw;
+    } catch (const Pegasus::CannotConnectException &e) {
+        failure.m_connection_error = true;
+        failure.m_code = CIMConstants::CON_ERR_CANNOT_CONNECT;
+        failure.m_message = e.getMessage();
+    } catch (const Pegasus::ConnectionTimeoutException &e) {
+        failure.m_connection_error = true;
+        failure.m_code = CIMConstants::CON_ERR_CONNECTION_TIMEOUT;
+        failure.m_message = e.getMessage();
+    } catch (const TransportException &e) {
+        failure.m_connection_error = true;
+        failure.m_code = e.isTimeout() ?
+            CIMConstants::CON_ERR_CONNECTION_TIMEOUT :
+            CIMConstants::CON_ERR_CANNOT_CONNECT;
+        failure.m_message = e.what();
+    } catch (const Pegasus::CIMException &e) {
+        const int code = static_cast<int>(e.getCode());
+        if (code != CIMConstants::CIM_ERR_INVALID_NAMESPACE &&
+            code != CIMConstants::CIM_ERR_INVALID_CLASS &&
+            code != CIMConstants::CIM_ERR_NOT_SUPPORTED)
+        {
+            return false;
+        }
+        failure.m_code = code;
+        failure.m_message = e.getMessage();
+    } catch (const NotSupportedException &e) {
+        failure.m_code = CIMConstants::CIM_ERR_NOT_SUPPORTED;
+        failure.m_message = e.what();
+    } catch (...) {
+        return false;
+    }
+
+    return true;
+}
+
+void NegativeCache::check(
+    const String &url,
+    const String &ns,
+    const String &cls,
+    const String &op)
+{
+    Failure failure;
+    {
+        ScopedMutex sm(m_mutex);
+        if (!find(Key(url, String(), String(), String()), failure) &&
+            (op.empty() || !find(Key(url, ns, cls, op), failure)))
+        {
+            // Check of the CIMOM only precedes the operation's check.
+            if (!op.empty())
+                ++m_misses;
+            return;
+        }
+        ++m_hits;
+    }
+
+    if (failure.m_connection_error)
+        throw_ConnectionError(failure.m_message, failure.m_code);
+    else
+        throw_CIMError(failure.m_message, failure.m_code);
+}
+
+void NegativeCache::addFailure(
+    const String &url,
+    const String &ns,
+    const String &cls,
+    const String &op,
+    const Failure &failure)
+{
+    // Connect can fail only for unreachable CIMOM.
+    if (op.empty() && !failure.m_connection_error)
+        return;
+
+    ScopedMutex sm(m_mutex);
+
+    // Unreachable CIMOM fails all the operations.
+    Key key(failure.m_connection_error ?
+        Key(url, String(), String(), String()) : Key(url, ns, cls, op));
+
+    EntryIndex::iterator found = m_index.find(key);
+    if (found != m_index.end())
+        erase(found->second);
+
+    m_entries.push_front(Entry(key, failure, monotonic_now() + m_ttl));
+    m_index[key] = m_entries.begin();
+
+    shrink();
+}
+
+void NegativeCache::invalidate(
+    const bp::object &url,
+    const bp::object &cls)
+{
+    String c_url;
+    String c_cls;
+    if (!isnone(url))
+        c_url = StringConv::asString(url, "url");
+    if (!isnone(cls))
+        c_cls = lower(StringConv::asString(cls, "ClassName"));
+
+    ScopedMutex sm(m_mutex);
+
+    EntryList::iterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        const Key &key = it->m_key;
+        if ((isnone(url) || key.m_url == c_url) &&
+            (isnone(cls) || key.m_cls == c_cls))
+        {
+            erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void NegativeCache::clear()
+{
+    ScopedMutex sm(m_mutex);
+    m_entries.clear();
+    m_index.clear();
+}
+
+bp::object NegativeCache::len()
+{
+    ScopedMutex sm(m_mutex);
+    return bp::object(m_entries.size());
+}
+
+bp::object NegativeCache::getPyTTL() const
+{
+    return bp::object(m_ttl);
+}
+
+bp::object NegativeCache::getPyMaxSize() const
+{
+    return bp::object(m_max_size);
+}
+
+bp::object NegativeCache::getPyHits() const
+{
+    return bp::object(m_hits);
+}
+
+bp::object NegativeCache::getPyMisses() const
+{
+    return bp::object(m_misses);
+}
+
+void NegativeCache::setPyTTL(const bp::object &ttl)
+{
+    double c_ttl = Conv::as<double>(ttl, "ttl");
+    if (c_ttl < 0)
+        throw_ValueError("ttl must be non-negative");
+
+    ScopedMutex sm(m_mutex);
+    m_ttl = c_ttl;
+}
+
+void NegativeCache::setPyMaxSize(const bp::object &max_size)
+{
+    size_t c_max_size = Conv::as<size_t>(max_size, "max_size");
+    if (c_max_size == 0)
+        throw_ValueError("max_size must be positive");
+
+    ScopedMutex sm(m_mutex);
+    m_max_size = c_max_size;
+    shrink();
+}
+
+bool NegativeCache::find(const Key &key, Failure &failure)
+{
+    EntryIndex::iterator found = m_index.find(key);
+    if (found == m_index.end())
+        return false;
+
+    EntryList::iterator entry = found->second;
+    if (entry->m_expires < monotonic_now()) {
+        erase(entry);
+        return false;
+    }
+
+    // Move the entry to the front of LRU list.
+    m_entries.splice(m_entries.begin(), m_entries, entry);
+
+    failure = entry->m_failure;
+    return true;
+}
+
+void NegativeCache::erase(EntryList::iterator entry)
+{
+    m_index.erase(entry->m_key);
+    m_entries.erase(entry);
+}
+
+void NegativeCache::shrink()
+{
+    while (m_entries.size() > m_max_size) {
+        EntryList::iterator last = m_entries.end();
+        erase(--last);
+    }
+}
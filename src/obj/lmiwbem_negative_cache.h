@@ -0,0 +1,143 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef   LMIWBEM_NEGATIVE_CACHE_H
+#  define LMIWBEM_NEGATIVE_CACHE_H
+
+#  include <list>
+#  include <map>
+#  include <boost/python/object.hpp>
+#  include "lmiwbem.h"
+#  include "lmiwbem_mutex.h"
+#  include "obj/lmiwbem_cimbase.h"
+#  include "util/lmiwbem_string.h"
+
+namespace bp = boost::python;
+
+// Cache of failed operations. Missing classes and namespaces and unsupported
+// operations are keyed by the CIMOM's URL, namespace, class name and
+// operation; unreachable CIMOMs are keyed by the URL only and fail every
+// operation. Until the entry expires, the operation raises the cached error
+// without contacting the CIMOM.
+class NegativeCache: public CIMBase<NegativeCache>
+{
+public:
+    class Failure
+    {
+    public:
+        Failure();
+
+        bool m_connection_error;
+        int m_code;
+        String m_message;
+    };
+
+    NegativeCache(
+        const bp::object &ttl,
+        const bp::object &max_size);
+
+    static void init_type();
+
+    bp::object repr();
+
+    // Translates the currently handled exception into a Failure; returns
+    // false, if the exception is not a failure worth caching. Must be called
+    // from a catch handler.
+    static bool getFailure(Failure &failure);
+
+    // Raises the cached error, if the CIMOM or the operation on the class
+    // failed recently. Empty operation checks the CIMOM only.
+    void check(
+        const String &url,
+        const String &ns,
+        const String &cls,
+        const String &op);
+    void addFailure(
+        const String &url,
+        const String &ns,
+        const String &cls,
+        const String &op,
+        const Failure &failure);
+
+    void invalidate(
+        const bp::object &url,
+        const bp::object &cls);
+    void clear();
+
+    bp::object len();
+
+    bp::object getPyTTL() const;
+    bp::object getPyMaxSize() const;
+    bp::object getPyHits() const;
+    bp::object getPyMisses() const;
+
+    void setPyTTL(const bp::object &ttl);
+    void setPyMaxSize(const bp::object &max_size);
+
+private:
+    class Key
+    {
+    public:
+        Key(
+            const String &url,
+            const String &ns,
+            const String &cls,
+            const String &op);
+
+        bool operator<(const Key &rhs) const;
+
+        String m_url;
+        String m_ns;
+        String m_cls;
+        String m_op;
+    };
+
+    class Entry
+    {
+    public:
+        Entry(
+            const Key &key,
+            const Failure &failure,
+            double expires);
+
+        Key m_key;
+        Failure m_failure;
+        double m_expires;
+    };
+
+    // Entries are kept in LRU order, most recently used first.
+    typedef std::list<Entry> EntryList;
+    typedef std::map<Key, EntryList::iterator> EntryIndex;
+
+    bool find(const Key &key, Failure &failure);
+    void erase(EntryList::iterator entry);
+    void shrink();
+
+    Mutex m_mutex;
+    EntryList m_entries;
+    EntryIndex m_index;
+    double m_ttl;
+    size_t m_max_size;
+    unsigned long m_hits;
+    unsigned long m_misses;
+};
+
+#endif // LMIWBEM_NEGATIVE_CACHE_H
@@ -129,6 +129,11 @@ bool NocaseDict::empty() const
     return m_dict.empty();
 }
 
+size_t NocaseDict::size() const
+{
+    return m_dict.size();
+}
+
 void NocaseDict::delitem(const bp::object &key)
 {
     String c_key = StringConv::asString(key, "key");
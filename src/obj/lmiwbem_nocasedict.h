@@ -63,6 +63,7 @@ public:
     nocase_map_t::const_iterator end() const;
 
     bool empty() const;
+    size_t size() const;
 
     void delitem(const bp::object &key);
     void setitem(const bp::object &key, const bp::object &value);
@@ -0,0 +1,982 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include <config.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <list>
+#include <map>
+#include <set>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <boost/python/class.hpp>
+#include <boost/python/list.hpp>
+#include <boost/python/return_arg.hpp>
+#include <boost/python/tuple.hpp>
+#include <Pegasus/Common/CIMPropertyList.h>
+#include "obj/lmiwbem_config.h"
+#include "obj/lmiwbem_snapshot.h"
+#include "obj/lmiwbem_snapshot_pydoc.h"
+#include "obj/cim/lmiwbem_class.h"
+#include "obj/cim/lmiwbem_instance.h"
+#include "obj/cim/lmiwbem_instance_name.h"
+#include "util/lmiwbem_convert.h"
+#include "util/lmiwbem_util.h"
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = { 'L', 'M', 'I', 'S', 'N', 'A', 'P', '\0' };
+const Pegasus::Uint32 SNAPSHOT_VERSION = 1;
+const size_t SNAPSHOT_HEADER_SIZE = 64;
+const size_t SNAPSHOT_BUFFER_SIZE = 1 << 20;
+
+String errno_message(const String &prefix, const String &filename)
+{
+    std::stringstream ss;
+    ss << prefix << " '" << filename << "': " << strerror(errno);
+    return ss.str();
+}
+
+// Instance of an enumeration result reduced to what the diff needs.
+class DiffInstance
+{
+public:
+    DiffInstance();
+
+    size_t m_index;
+    Pegasus::CIMObjectPath m_path;
+    std::list<Pegasus::CIMConstProperty> m_properties;
+};
+
+// Enumeration result compared by SnapshotDiff; either a list of CIMInstance
+// objects or a SnapshotReader, whose records other than instances are
+// skipped.
+class DiffSource
+{
+public:
+    DiffSource(const bp::object &result, const String &name);
+
+    size_t size() const;
+    bool get(size_t index, DiffInstance &instance) const;
+    bp::object getPyInstance(size_t index) const;
+
+private:
+    String m_name;
+    bp::list m_list;
+    SnapshotReader *m_reader;
+};
+
+DiffInstance::DiffInstance()
+    : m_index(0)
+    , m_path()
+    , m_properties()
+{
+}
+
+DiffSource::DiffSource(const bp::object &result, const String &name)
+    : m_name(name)
+    , m_list()
+    , m_reader(NULL)
+{
+    if (isinstance(result, SnapshotReader::type()))
+        m_reader = &SnapshotReader::asNative(result);
+    else
+        m_list = bp::list(Conv::get<bp::list>(result, name));
+}
+
+size_t DiffSource::size() const
+{
+    if (m_reader)
+        return static_cast<size_t>(m_reader->size());
+    return static_cast<size_t>(bp::len(m_list));
+}
+
+bool DiffSource::get(size_t index, DiffInstance &instance) const
+{
+    instance.m_index = index;
+    instance.m_properties.clear();
+
+    if (!m_reader) {
+        CIMInstance &cim_instance = CIMInstance::asNative(
+            m_list[index], m_name + "[i]");
+        instance.m_path = cim_instance.getPegasusCIMObjectPath();
+        instance.m_properties = cim_instance.getPegasusCIMProperties();
+        return true;
+    }
+
+    if (m_reader->kind(index) != Serializer::KIND_INSTANCE)
+        return false;
+
+    const Pegasus::CIMInstance peg_instance(
+        m_reader->getPegasusCIMInstance(index));
+    instance.m_path = peg_instance.getPath();
+    const Pegasus::Uint32 cnt = peg_instance.getPropertyCount();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        instance.m_properties.push_back(peg_instance.getProperty(i));
+    return true;
+}
+
+bp::object DiffSource::getPyInstance(size_t index) const
+{
+    if (!m_reader)
+        return m_list[index];
+    return CIMInstance::create(m_reader->getPegasusCIMInstance(index));
+}
+
+// Names of the properties, which differ in value or are present in one of
+// the instances only. Empty properties set means all the properties.
+bp::list changed_properties(
+    const DiffInstance &old_instance,
+    const DiffInstance &new_instance,
+    const std::set<String> &properties)
+{
+    typedef std::map<String, const Pegasus::CIMConstProperty*> PropertyMap;
+
+    PropertyMap old_properties;
+    std::list<Pegasus::CIMConstProperty>::const_iterator it;
+    for (it = old_instance.m_properties.begin();
+         it != old_instance.m_properties.end(); ++it)
+    {
+        String name(lower(it->getName().getString()));
+        if (properties.empty() || properties.count(name))
+            old_properties[name] = &*it;
+    }
+
+    bp::list py_changed;
+    for (it = new_instance.m_properties.begin();
+         it != new_instance.m_properties.end(); ++it)
+    {
+        String name(lower(it->getName().getString()));
+        if (!properties.empty() && !properties.count(name))
+            continue;
+
+        PropertyMap::iterator found = old_properties.find(name);
+        if (found == old_properties.end() ||
+            !found->second->getValue().equal(it->getValue()))
+        {
+            py_changed.append(
+                StringConv::asPyUnicode(String(it->getName().getString())));
+        }
+
+        if (found != old_properties.end())
+            old_properties.erase(found);
+    }
+
+    // Properties, which are missing in the new instance; in their order.
+    for (it = old_instance.m_properties.begin();
+         it != old_instance.m_properties.end(); ++it)
+    {
+        if (old_properties.count(lower(it->getName().getString()))) {
+            py_changed.append(
+                StringConv::asPyUnicode(String(it->getName().getString())));
+        }
+    }
+
+    return py_changed;
+}
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// SnapshotWriter
+// -----------------------------------------------------------------------------
+
+SnapshotWriter::SnapshotWriter(const bp::object &filename)
+    : m_filename()
+    , m_fd(-1)
+    , m_offset(0)
+    , m_buffer()
+    , m_index()
+    , m_strings()
+    , m_layouts_index()
+    , m_layouts()
+    , m_record(&m_strings)
+{
+    m_filename = StringConv::asString(filename, "filename");
+    m_fd = ::open(m_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0)
+        throw_IOError(errno_message("Can't open snapshot", m_filename));
+
+    // Reserve space for the header; it is written when closing the file.
+    m_buffer.assign(SNAPSHOT_HEADER_SIZE, '\0');
+    m_offset = SNAPSHOT_HEADER_SIZE;
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+    // The snapshot is not complete without the trailing sections; just
+    // release the descriptor, if the user did not call close().
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+void SnapshotWriter::init_type()
+{
+    CIMBase<SnapshotWriter>::init_type(
+        bp::class_<SnapshotWriter, boost::noncopyable>("SnapshotWriter", bp::no_init)
+        .def(bp::init<const bp::object &>((
+            bp::arg("filename")),
+            docstr_SnapshotWriter_init))
+        .def("__repr__", &SnapshotWriter::repr, docstr_SnapshotWriter_repr)
+        .def("__enter__", &SnapshotWriter::enter, bp::return_self<>())
+        .def("__exit__", &SnapshotWriter::exit)
+        .def("add", &SnapshotWriter::add,
+            (bp::arg("obj")),
+            docstr_SnapshotWriter_add)
+        .def("extend", &SnapshotWriter::extend,
+            (bp::arg("objs")),
+            docstr_SnapshotWriter_extend)
+        .def("close", &SnapshotWriter::close, docstr_SnapshotWriter_close)
+        .add_property("count", &SnapshotWriter::getPyCount)
+        .add_property("closed", &SnapshotWriter::getPyClosed));
+}
+
+bp::object SnapshotWriter::repr()
+{
+    std::stringstream ss;
+    ss << "SnapshotWriter(filename=u'" << m_filename << "', count="
+       << m_index.size() << ", ...)";
+    return StringConv::asPyUnicode(ss.str());
+}
+
+void SnapshotWriter::enter()
+{
+    // The object itself is returned by return_self<> policy.
+}
+
+void SnapshotWriter::exit(
+    const bp::object &type,
+    const bp::object &value,
+    const bp::object &traceback)
+{
+    if (m_fd >= 0)
+        close();
+}
+
+void SnapshotWriter::add(const bp::object &obj) try
+{
+    throwIfClosed();
+
+    if (isinstance(obj, CIMInstance::type())) {
+        CIMInstance &cim_instance = CIMInstance::asNative(obj);
+        if (cim_instance.hasLazyProperties()) {
+            // Properties were not evaluated yet; store them straight from
+            // Pegasus values. References get the instance's hostname as in
+            // CIMInstance::evalProperties().
+            const Pegasus::CIMObjectPath path(
+                cim_instance.getPegasusCIMObjectPath());
+            std::list<Pegasus::CIMConstProperty> properties(
+                cim_instance.getPegasusCIMProperties());
+            std::list<Pegasus::CIMConstProperty>::iterator it;
+            for (it = properties.begin(); it != properties.end(); ++it) {
+                const Pegasus::CIMValue &value = it->getValue();
+                if (value.getType() != Pegasus::CIMTYPE_REFERENCE ||
+                    value.isArray() || value.isNull())
+                {
+                    continue;
+                }
+
+                Pegasus::CIMObjectPath peg_iname;
+                value.get(peg_iname);
+                peg_iname.setHost(path.getHost());
+                Pegasus::CIMProperty peg_property(it->clone());
+                peg_property.setValue(Pegasus::CIMValue(peg_iname));
+                *it = peg_property;
+            }
+
+            addInstance(
+                Pegasus::CIMName(cim_instance.getClassname()),
+                path,
+                cim_instance.getPegasusCIMQualifiers(),
+                properties);
+        } else {
+            addPegasusCIMInstance(cim_instance.asPegasusCIMInstance());
+        }
+    } else if (isinstance(obj, CIMInstanceName::type())) {
+        const CIMInstanceName &cim_path = CIMInstanceName::asNative(obj);
+        addPegasusCIMObjectPath(cim_path.asPegasusCIMObjectPath());
+    } else if (isinstance(obj, CIMClass::type())) {
+        CIMClass &cim_class = CIMClass::asNative(obj);
+        addPegasusCIMClass(cim_class.asPegasusCIMClass());
+    } else {
+        throw_TypeError("obj must be CIMInstance, CIMInstanceName or CIMClass");
+    }
+} catch (...) {
+    std::stringstream ss;
+    if (Config::isVerbose())
+        ss << "SnapshotWriter.add()";
+    handle_all_exceptions(ss);
+}
+
+void SnapshotWriter::extend(const bp::object &objs)
+{
+    const int cnt = bp::len(objs);
+    for (int i = 0; i < cnt; ++i)
+        add(objs[i]);
+}
+
+void SnapshotWriter::close() try
+{
+    throwIfClosed();
+
+    const Pegasus::Uint64 count = m_index.size();
+    Serializer s;
+
+    // String table
+    const Pegasus::Uint64 strings_offset = m_offset;
+    const std::vector<std::string> &strings = m_strings.strings();
+    s.putSize(static_cast<Pegasus::Uint32>(strings.size()));
+    for (size_t i = 0; i < strings.size(); ++i)
+        s.putString(strings[i]);
+    write(s.data());
+    s.clear();
+
+    // Layouts
+    const Pegasus::Uint64 layouts_offset = m_offset;
+    s.putSize(static_cast<Pegasus::Uint32>(m_layouts.size()));
+    for (size_t i = 0; i < m_layouts.size(); ++i)
+        s.putString(m_layouts[i]);
+    write(s.data());
+    s.clear();
+
+    // Index
+    const Pegasus::Uint64 index_offset = m_offset;
+    for (size_t i = 0; i < m_index.size(); ++i) {
+        s.putUint64(m_index[i]);
+        if (s.data().size() >= SNAPSHOT_BUFFER_SIZE) {
+            write(s.data());
+            s.clear();
+        }
+    }
+    write(s.data());
+    s.clear();
+    flush();
+
+    // Header
+    for (size_t i = 0; i < sizeof(SNAPSHOT_MAGIC); ++i)
+        s.putUint8(static_cast<Pegasus::Uint8>(SNAPSHOT_MAGIC[i]));
+    s.putUint32(SNAPSHOT_VERSION);
+    s.putUint32(0); // Reserved
+    s.putUint64(count);
+    s.putUint64(strings_offset);
+    s.putUint64(layouts_offset);
+    s.putUint64(index_offset);
+    std::string header(s.data());
+    header.resize(SNAPSHOT_HEADER_SIZE, '\0');
+    if (pwrite(m_fd, header.data(), header.size(), 0) !=
+        static_cast<ssize_t>(header.size()))
+    {
+        throw_IOError(errno_message("Can't write snapshot", m_filename));
+    }
+
+    int rval = ::close(m_fd);
+    m_fd = -1;
+    if (rval < 0)
+        throw_IOError(errno_message("Can't close snapshot", m_filename));
+
+    // Release the memory, we don't need it anymore.
+    std::vector<Pegasus::Uint64>().swap(m_index);
+    std::vector<std::string>().swap(m_layouts);
+    m_layouts_index.clear();
+} catch (...) {
+    std::stringstream ss;
+    if (Config::isVerbose())
+        ss << "SnapshotWriter.close()";
+    handle_all_exceptions(ss);
+}
+
+void SnapshotWriter::addPegasusCIMInstance(const Pegasus::CIMConstInstance &instance)
+{
+    std::list<Pegasus::CIMConstQualifier> qualifiers;
+    Pegasus::Uint32 cnt = instance.getQualifierCount();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        qualifiers.push_back(instance.getQualifier(i));
+
+    std::list<Pegasus::CIMConstProperty> properties;
+    cnt = instance.getPropertyCount();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        properties.push_back(instance.getProperty(i));
+
+    addInstance(
+        instance.getClassName(),
+        instance.getPath(),
+        qualifiers,
+        properties);
+}
+
+void SnapshotWriter::addPegasusCIMObjectPath(const Pegasus::CIMObjectPath &path)
+{
+    beginRecord(Serializer::KIND_INSTANCE_NAME);
+    m_record.putCIMObjectPath(path);
+    endRecord();
+}
+
+void SnapshotWriter::addPegasusCIMClass(const Pegasus::CIMConstClass &cls)
+{
+    beginRecord(Serializer::KIND_CLASS);
+    m_record.putCIMClass(cls);
+    endRecord();
+}
+
+bp::object SnapshotWriter::getPyCount() const
+{
+    return bp::object(m_index.size());
+}
+
+bp::object SnapshotWriter::getPyClosed() const
+{
+    return bp::object(m_fd < 0);
+}
+
+void SnapshotWriter::addInstance(
+    const Pegasus::CIMName &classname,
+    const Pegasus::CIMObjectPath &path,
+    const std::list<Pegasus::CIMConstQualifier> &qualifiers,
+    const std::list<Pegasus::CIMConstProperty> &properties)
+{
+    const Pegasus::Uint32 layout_id = layout(classname, properties);
+
+    beginRecord(Serializer::KIND_INSTANCE);
+    m_record.putSize(layout_id);
+    m_record.putCIMObjectPath(path);
+
+    m_record.putSize(qualifiers.size());
+    std::list<Pegasus::CIMConstQualifier>::const_iterator qualifier;
+    for (qualifier = qualifiers.begin(); qualifier != qualifiers.end(); ++qualifier)
+        m_record.putCIMQualifier(*qualifier);
+
+    // Property names, types and qualifiers are stored in the layout.
+    std::list<Pegasus::CIMConstProperty>::const_iterator property;
+    for (property = properties.begin(); property != properties.end(); ++property)
+        m_record.putCIMValuePayload(property->getValue());
+    endRecord();
+}
+
+Pegasus::Uint32 SnapshotWriter::layout(
+    const Pegasus::CIMName &classname,
+    const std::list<Pegasus::CIMConstProperty> &properties)
+{
+    Serializer s(&m_strings);
+    s.putCIMName(classname);
+
+    s.putSize(properties.size());
+    std::list<Pegasus::CIMConstProperty>::const_iterator it;
+    for (it = properties.begin(); it != properties.end(); ++it) {
+        const Pegasus::CIMConstProperty &property = *it;
+        s.putCIMName(property.getName());
+        s.putUint8(static_cast<Pegasus::Uint8>(property.getType()));
+        s.putSize(property.getArraySize());
+        s.putCIMName(property.getReferenceClassName());
+        s.putCIMName(property.getClassOrigin());
+        s.putBool(property.getPropagated());
+
+        const Pegasus::Uint32 qualifier_cnt = property.getQualifierCount();
+        s.putSize(qualifier_cnt);
+        for (Pegasus::Uint32 j = 0; j < qualifier_cnt; ++j)
+            s.putCIMQualifier(property.getQualifier(j));
+    }
+
+    std::map<std::string, Pegasus::Uint32>::const_iterator found =
+        m_layouts_index.find(s.data());
+    if (found != m_layouts_index.end())
+        return found->second;
+
+    Pegasus::Uint32 layout_id = static_cast<Pegasus::Uint32>(m_layouts.size());
+    m_layouts_index[s.data()] = layout_id;
+    m_layouts.push_back(s.data());
+    return layout_id;
+}
+
+void SnapshotWriter::beginRecord(Pegasus::Uint8 kind)
+{
+    throwIfClosed();
+    m_record.clear();
+    m_record.putUint8(kind);
+}
+
+void SnapshotWriter::endRecord()
+{
+    m_index.push_back(m_offset);
+    write(m_record.data());
+    m_record.clear();
+}
+
+void SnapshotWriter::write(const std::string &data)
+{
+    m_buffer.append(data);
+    m_offset += data.size();
+    if (m_buffer.size() >= SNAPSHOT_BUFFER_SIZE)
+        flush();
+}
+
+void SnapshotWriter::flush()
+{
+    const char *data = m_buffer.data();
+    size_t size = m_buffer.size();
+    while (size > 0) {
+        ssize_t written = ::write(m_fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            throw_IOError(errno_message("Can't write snapshot", m_filename));
+        }
+        data += written;
+        size -= written;
+    }
+    m_buffer.clear();
+}
+
+void SnapshotWriter::throwIfClosed() const
+{
+    if (m_fd < 0)
+        throw_ValueError("I/O operation on closed snapshot");
+}
+
+// -----------------------------------------------------------------------------
+// SnapshotReader
+// -----------------------------------------------------------------------------
+
+SnapshotReader::SnapshotReader(const bp::object &filename)
+    : m_filename()
+    , m_data(NULL)
+    , m_size(0)
+    , m_count(0)
+    , m_index(NULL)
+    , m_strings()
+    , m_layouts()
+{
+    m_filename = StringConv::asString(filename, "filename");
+
+    int fd = ::open(m_filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw_IOError(errno_message("Can't open snapshot", m_filename));
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        ::close(fd);
+        throw_IOError(errno_message("Can't stat snapshot", m_filename));
+    }
+
+    m_size = static_cast<size_t>(st.st_size);
+    if (m_size < SNAPSHOT_HEADER_SIZE) {
+        ::close(fd);
+        throw_ValueError(String("Not a snapshot file: ") + m_filename);
+    }
+
+    void *data = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        throw_IOError(errno_message("Can't map snapshot", m_filename));
+    m_data = static_cast<const char*>(data);
+
+    try {
+        if (memcmp(m_data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+            throw Exception("Invalid magic");
+
+        Deserializer header(
+            m_data + sizeof(SNAPSHOT_MAGIC),
+            SNAPSHOT_HEADER_SIZE - sizeof(SNAPSHOT_MAGIC));
+        if (header.getUint32() != SNAPSHOT_VERSION)
+            throw Exception("Unsupported version");
+        header.getUint32(); // Reserved
+
+        m_count = header.getUint64();
+        const Pegasus::Uint64 strings_offset = header.getUint64();
+        const Pegasus::Uint64 layouts_offset = header.getUint64();
+        const Pegasus::Uint64 index_offset = header.getUint64();
+        if (strings_offset > layouts_offset ||
+            layouts_offset > index_offset ||
+            index_offset > m_size ||
+            (m_size - index_offset) / sizeof(Pegasus::Uint64) < m_count)
+        {
+            throw Exception("Corrupted header");
+        }
+
+        // Only the string table and the layouts are read now; records are
+        // decoded when accessed.
+        Deserializer strings(
+            m_data + strings_offset,
+            layouts_offset - strings_offset);
+        // Every string and layout takes at least its size byte.
+        Pegasus::Uint32 cnt = strings.getCount(1);
+        m_strings.reserve(cnt);
+        for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+            m_strings.push_back(strings.getString());
+
+        Deserializer layouts(
+            m_data + layouts_offset,
+            index_offset - layouts_offset);
+        cnt = layouts.getCount(1);
+        m_layouts.reserve(cnt);
+        for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+            const Pegasus::Uint32 size = layouts.getSize();
+            const size_t offset = layouts_offset + layouts.pos();
+            if (size > index_offset - offset)
+                throw Exception("Corrupted layout");
+            m_layouts.push_back(std::make_pair(offset, size));
+            for (Pegasus::Uint32 j = 0; j < size; ++j)
+                layouts.getUint8();
+        }
+
+        m_index = m_data + index_offset;
+    } catch (const Exception &e) {
+        close();
+        throw_ValueError(String("Not a snapshot file: ") + m_filename +
+            String(": ") + String(e.what()));
+    } catch (...) {
+        // Destructor is not run for a partially constructed object.
+        close();
+        throw;
+    }
+}
+
+SnapshotReader::~SnapshotReader()
+{
+    if (m_data)
+        munmap(const_cast<char*>(m_data), m_size);
+}
+
+void SnapshotReader::init_type()
+{
+    CIMBase<SnapshotReader>::init_type(
+        bp::class_<SnapshotReader, boost::noncopyable>("SnapshotReader", bp::no_init)
+        .def(bp::init<const bp::object &>((
+            bp::arg("filename")),
+            docstr_SnapshotReader_init))
+        .def("__repr__", &SnapshotReader::repr, docstr_SnapshotReader_repr)
+        .def("__enter__", &SnapshotReader::enter, bp::return_self<>())
+        .def("__exit__", &SnapshotReader::exit)
+        .def("__len__", &SnapshotReader::len)
+        .def("__getitem__", &SnapshotReader::getitem)
+        .def("close", &SnapshotReader::close, docstr_SnapshotReader_close));
+}
+
+bp::object SnapshotReader::repr()
+{
+    std::stringstream ss;
+    ss << "SnapshotReader(filename=u'" << m_filename << "', count="
+       << m_count << ", ...)";
+    return StringConv::asPyUnicode(ss.str());
+}
+
+void SnapshotReader::enter()
+{
+    // The object itself is returned by return_self<> policy.
+}
+
+void SnapshotReader::exit(
+    const bp::object &type,
+    const bp::object &value,
+    const bp::object &traceback)
+{
+    close();
+}
+
+bp::object SnapshotReader::len() const
+{
+    return bp::object(m_count);
+}
+
+bp::object SnapshotReader::getitem(const bp::object &index) try
+{
+    throwIfClosed();
+
+    Pegasus::Sint64 i = Conv::as<Pegasus::Sint64>(index, "index");
+    if (i < 0)
+        i += static_cast<Pegasus::Sint64>(m_count);
+    if (i < 0 || static_cast<Pegasus::Uint64>(i) >= m_count)
+        throw_IndexError("Snapshot index out of range");
+
+    const Pegasus::Uint64 idx = static_cast<Pegasus::Uint64>(i);
+    switch (kind(idx)) {
+    case Serializer::KIND_INSTANCE:
+        return CIMInstance::create(getPegasusCIMInstance(idx));
+    case Serializer::KIND_INSTANCE_NAME:
+        return CIMInstanceName::create(getPegasusCIMObjectPath(idx));
+    case Serializer::KIND_CLASS:
+        return CIMClass::create(getPegasusCIMClass(idx));
+    default:
+        throw Exception("Unknown record kind");
+    }
+
+    return None;
+} catch (...) {
+    std::stringstream ss;
+    if (Config::isVerbose())
+        ss << "SnapshotReader.__getitem__()";
+    handle_all_exceptions(ss);
+    return None;
+}
+
+void SnapshotReader::close()
+{
+    if (!m_data)
+        return;
+
+    munmap(const_cast<char*>(m_data), m_size);
+    m_data = NULL;
+    m_index = NULL;
+    m_size = 0;
+    m_count = 0;
+    m_strings.clear();
+    m_layouts.clear();
+}
+
+Pegasus::Uint8 SnapshotReader::kind(Pegasus::Uint64 index) const
+{
+    return record(index).getUint8();
+}
+
+Pegasus::CIMInstance SnapshotReader::getPegasusCIMInstance(Pegasus::Uint64 index) const
+{
+    Deserializer d(record(index));
+    if (d.getUint8() != Serializer::KIND_INSTANCE)
+        throw Exception("Record is not an instance");
+    return readInstance(d);
+}
+
+Pegasus::CIMObjectPath SnapshotReader::getPegasusCIMObjectPath(Pegasus::Uint64 index) const
+{
+    Deserializer d(record(index));
+    const Pegasus::Uint8 kind = d.getUint8();
+    if (kind == Serializer::KIND_INSTANCE_NAME)
+        return d.getCIMObjectPath();
+    if (kind == Serializer::KIND_INSTANCE) {
+        d.getSize(); // Layout
+        return d.getCIMObjectPath();
+    }
+    throw Exception("Record is not an instance name");
+    return Pegasus::CIMObjectPath();
+}
+
+Pegasus::CIMClass SnapshotReader::getPegasusCIMClass(Pegasus::Uint64 index) const
+{
+    Deserializer d(record(index));
+    if (d.getUint8() != Serializer::KIND_CLASS)
+        throw Exception("Record is not a class");
+    return d.getCIMClass();
+}
+
+Deserializer SnapshotReader::record(Pegasus::Uint64 index) const
+{
+    throwIfClosed();
+
+    Deserializer offset(
+        m_index + index * sizeof(Pegasus::Uint64),
+        sizeof(Pegasus::Uint64));
+    const Pegasus::Uint64 begin = offset.getUint64();
+    if (begin < SNAPSHOT_HEADER_SIZE || begin >= m_size)
+        throw Exception("Corrupted record offset");
+
+    return Deserializer(m_data + begin, m_size - begin, &m_strings);
+}
+
+Pegasus::CIMInstance SnapshotReader::readInstance(Deserializer &d) const
+{
+    const Pegasus::Uint32 layout_id = d.getSize();
+    if (layout_id >= m_layouts.size())
+        throw Exception("Corrupted layout index");
+
+    Deserializer layout(
+        m_data + m_layouts[layout_id].first,
+        m_layouts[layout_id].second,
+        &m_strings);
+
+    Pegasus::CIMInstance instance(layout.getCIMName());
+    instance.setPath(d.getCIMObjectPath());
+
+    Pegasus::Uint32 cnt = d.getSize();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        instance.addQualifier(d.getCIMQualifier());
+
+    cnt = layout.getSize();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+        Pegasus::CIMName name(layout.getCIMName());
+        Pegasus::CIMType type = static_cast<Pegasus::CIMType>(layout.getUint8());
+        Pegasus::Uint32 array_size = layout.getSize();
+        Pegasus::CIMName reference_class(layout.getCIMName());
+        Pegasus::CIMName class_origin(layout.getCIMName());
+        bool propagated = layout.getBool();
+
+        Pegasus::CIMProperty property(
+            name,
+            d.getCIMValuePayload(type),
+            array_size,
+            reference_class,
+            class_origin,
+            propagated);
+
+        const Pegasus::Uint32 qualifier_cnt = layout.getSize();
+        for (Pegasus::Uint32 j = 0; j < qualifier_cnt; ++j)
+            property.addQualifier(layout.getCIMQualifier());
+
+        instance.addProperty(property);
+    }
+
+    return instance;
+}
+
+void SnapshotReader::throwIfClosed() const
+{
+    if (!m_data)
+        throw_ValueError("I/O operation on closed snapshot");
+}
+
+// -----------------------------------------------------------------------------
+// SnapshotDiff
+// -----------------------------------------------------------------------------
+
+SnapshotDiff::SnapshotDiff(
+    const bp::object &old_result,
+    const bp::object &new_result,
+    const bp::object &property_list) try
+    : m_added()
+    , m_removed()
+    , m_changed()
+{
+    DiffSource old_source(old_result, "old");
+    DiffSource new_source(new_result, "new");
+
+    std::set<String> properties;
+    Pegasus::CIMPropertyList peg_property_list(
+        ListConv::asPegasusPropertyList(property_list, "PropertyList"));
+    const Pegasus::Uint32 property_cnt = peg_property_list.size();
+    for (Pegasus::Uint32 i = 0; i < property_cnt; ++i)
+        properties.insert(lower(peg_property_list[i].getString()));
+
+    // Index the old instances by canonical paths; the first one wins.
+    std::map<String, DiffInstance> old_instances;
+    const size_t old_cnt = old_source.size();
+    for (size_t i = 0; i < old_cnt; ++i) {
+        DiffInstance instance;
+        if (old_source.get(i, instance))
+            old_instances.insert(
+                std::make_pair(canonical_path(instance.m_path), instance));
+    }
+
+    bp::list py_added;
+    bp::list py_changed;
+    const size_t new_cnt = new_source.size();
+    for (size_t i = 0; i < new_cnt; ++i) {
+        DiffInstance instance;
+        if (!new_source.get(i, instance))
+            continue;
+
+        std::map<String, DiffInstance>::iterator found = old_instances.find(
+            canonical_path(instance.m_path));
+        if (found == old_instances.end()) {
+            py_added.append(new_source.getPyInstance(i));
+            continue;
+        }
+
+        bp::list py_properties(
+            changed_properties(found->second, instance, properties));
+        if (bp::len(py_properties)) {
+            py_changed.append(bp::make_tuple(
+                old_source.getPyInstance(found->second.m_index),
+                new_source.getPyInstance(i),
+                py_properties));
+        }
+
+        old_instances.erase(found);
+    }
+
+    // Report the removed instances in their original order.
+    std::vector<size_t> removed;
+    std::map<String, DiffInstance>::const_iterator it;
+    for (it = old_instances.begin(); it != old_instances.end(); ++it)
+        removed.push_back(it->second.m_index);
+    std::sort(removed.begin(), removed.end());
+
+    bp::list py_removed;
+    for (size_t i = 0; i < removed.size(); ++i)
+        py_removed.append(old_source.getPyInstance(removed[i]));
+
+    m_added = py_added;
+    m_removed = py_removed;
+    m_changed = py_changed;
+} catch (...) {
+    std::stringstream ss;
+    if (Config::isVerbose())
+        ss << "SnapshotDiff()";
+    handle_all_exceptions(ss);
+}
+
+void SnapshotDiff::init_type()
+{
+    CIMBase<SnapshotDiff>::init_type(
+        bp::class_<SnapshotDiff, boost::noncopyable>("SnapshotDiff", bp::no_init)
+        .def(bp::init<
+            const bp::object &,
+            const bp::object &,
+            const bp::object &>((
+                bp::arg("old"),
+                bp::arg("new"),
+                bp::arg("PropertyList") = None),
+                docstr_SnapshotDiff_init))
+        .def("__repr__", &SnapshotDiff::repr, docstr_SnapshotDiff_repr)
+        .def("__len__", &SnapshotDiff::len)
+        .add_property("added",
+            &SnapshotDiff::getPyAdded,
+            docstr_SnapshotDiff_added)
+        .add_property("removed",
+            &SnapshotDiff::getPyRemoved,
+            docstr_SnapshotDiff_removed)
+        .add_property("changed",
+            &SnapshotDiff::getPyChanged,
+            docstr_SnapshotDiff_changed));
+}
+
+bp::object SnapshotDiff::repr()
+{
+    std::stringstream ss;
+    ss << "SnapshotDiff(added=" << bp::len(m_added)
+       << ", removed=" << bp::len(m_removed)
+       << ", changed=" << bp::len(m_changed) << ')';
+    return StringConv::asPyUnicode(ss.str());
+}
+
+bp::object SnapshotDiff::len()
+{
+    return bp::object(
+        bp::len(m_added) + bp::len(m_removed) + bp::len(m_changed));
+}
+
+bp::object SnapshotDiff::getPyAdded() const
+{
+    return m_added;
+}
+
+bp::object SnapshotDiff::getPyRemoved() const
+{
+    return m_removed;
+}
+
+bp::object SnapshotDiff::getPyChanged() const
+{
+    return m_changed;
+}
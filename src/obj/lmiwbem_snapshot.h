@@ -0,0 +1,167 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef   LMIWBEM_SNAPSHOT_H
+#  define LMIWBEM_SNAPSHOT_H
+
+#  include <list>
+#  include <map>
+#  include <string>
+#  include <vector>
+#  include <boost/python/object.hpp>
+#  include "lmiwbem.h"
+#  include "obj/lmiwbem_cimbase.h"
+#  include "util/lmiwbem_serialize.h"
+#  include "util/lmiwbem_string.h"
+
+namespace bp = boost::python;
+
+// Snapshot file layout (all the integers are little-endian):
+//
+//   header   magic, version, record count and offsets of following sections
+//   records  instances, instance names and classes; instances refer to
+//            per-class layouts, so the property names, types and qualifiers
+//            are stored only once
+//   strings  string table of identifiers
+//   layouts  per-class layouts of instance properties
+//   index    fixed-size offsets of the records for random access
+class SnapshotWriter: public CIMBase<SnapshotWriter>
+{
+public:
+    SnapshotWriter(const bp::object &filename);
+    ~SnapshotWriter();
+
+    static void init_type();
+
+    bp::object repr();
+
+    void enter();
+    void exit(
+        const bp::object &type,
+        const bp::object &value,
+        const bp::object &traceback);
+
+    void add(const bp::object &obj);
+    void extend(const bp::object &objs);
+    void close();
+
+    void addPegasusCIMInstance(const Pegasus::CIMConstInstance &instance);
+    void addPegasusCIMObjectPath(const Pegasus::CIMObjectPath &path);
+    void addPegasusCIMClass(const Pegasus::CIMConstClass &cls);
+
+    bp::object getPyCount() const;
+    bp::object getPyClosed() const;
+
+private:
+    void addInstance(
+        const Pegasus::CIMName &classname,
+        const Pegasus::CIMObjectPath &path,
+        const std::list<Pegasus::CIMConstQualifier> &qualifiers,
+        const std::list<Pegasus::CIMConstProperty> &properties);
+    Pegasus::Uint32 layout(
+        const Pegasus::CIMName &classname,
+        const std::list<Pegasus::CIMConstProperty> &properties);
+    void beginRecord(Pegasus::Uint8 kind);
+    void endRecord();
+    void write(const std::string &data);
+    void flush();
+    void throwIfClosed() const;
+
+    String m_filename;
+    int m_fd;
+    Pegasus::Uint64 m_offset;
+    std::string m_buffer;
+    std::vector<Pegasus::Uint64> m_index;
+    SerializerStringTable m_strings;
+    std::map<std::string, Pegasus::Uint32> m_layouts_index;
+    std::vector<std::string> m_layouts;
+    Serializer m_record;
+};
+
+class SnapshotReader: public CIMBase<SnapshotReader>
+{
+public:
+    SnapshotReader(const bp::object &filename);
+    ~SnapshotReader();
+
+    static void init_type();
+
+    bp::object repr();
+
+    void enter();
+    void exit(
+        const bp::object &type,
+        const bp::object &value,
+        const bp::object &traceback);
+
+    bp::object len() const;
+    bp::object getitem(const bp::object &index);
+    void close();
+
+    Pegasus::Uint64 size() const { return m_count; }
+    Pegasus::Uint8 kind(Pegasus::Uint64 index) const;
+    Pegasus::CIMInstance getPegasusCIMInstance(Pegasus::Uint64 index) const;
+    Pegasus::CIMObjectPath getPegasusCIMObjectPath(Pegasus::Uint64 index) const;
+    Pegasus::CIMClass getPegasusCIMClass(Pegasus::Uint64 index) const;
+
+private:
+    Deserializer record(Pegasus::Uint64 index) const;
+    Pegasus::CIMInstance readInstance(Deserializer &d) const;
+    void throwIfClosed() const;
+
+    String m_filename;
+    const char *m_data;
+    size_t m_size;
+    Pegasus::Uint64 m_count;
+    const char *m_index;
+    std::vector<Pegasus::String> m_strings;
+    std::vector<std::pair<size_t, size_t> > m_layouts;
+};
+
+// Difference of two enumeration results; lists of instances or snapshots.
+// Instances are matched by canonical object paths and compared on their
+// Pegasus representation, so Python objects are created only for the
+// reported instances.
+class SnapshotDiff: public CIMBase<SnapshotDiff>
+{
+public:
+    SnapshotDiff(
+        const bp::object &old_result,
+        const bp::object &new_result,
+        const bp::object &property_list);
+
+    static void init_type();
+
+    bp::object repr();
+    bp::object len();
+
+    bp::object getPyAdded() const;
+    bp::object getPyRemoved() const;
+    bp::object getPyChanged() const;
+
+private:
+    bp::object m_added;
+    bp::object m_removed;
+    bp::object m_changed;
+};
+
+#endif // LMIWBEM_SNAPSHOT_H
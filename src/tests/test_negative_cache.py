@@ -0,0 +1,50 @@
+#!/usr/bin/python
+#
+# Tests of lmiwbem.NegativeCache, which don't need a running CIMOM. Run by
+# "make check" against the built module.
+
+import unittest
+
+import lmiwbem
+
+
+# Nothing listens on the port 1 of the loopback.
+WSMAN_URL = 'http://127.0.0.1:1/wsman'
+
+
+class TestNegativeCacheWsman(unittest.TestCase):
+    def setUp(self):
+        if not lmiwbem.config.SUPPORTS_WSMAN:
+            self.skipTest('lmiwbem built without WS-Management support')
+
+        self.cache = lmiwbem.NegativeCache()
+        self.conn = lmiwbem.WBEMConnection(
+            url=WSMAN_URL,
+            creds=('username', 'password'))
+        self.conn.negative_cache = self.cache
+
+    def enumerate_instance_names(self):
+        try:
+            self.conn.EnumerateInstanceNames('CIM_ComputerSystem')
+        except lmiwbem.ConnectionError as e:
+            return e.args[0]
+        self.fail('ConnectionError not raised')
+
+    def test_unreachable_cimom_is_cached(self):
+        code = self.enumerate_instance_names()
+        self.assertEqual(code, lmiwbem.CON_ERR_CANNOT_CONNECT)
+        self.assertEqual(len(self.cache), 1)
+        self.assertEqual(self.cache.hits, 0)
+
+        # Second call raises the cached failure without a round-trip.
+        self.assertEqual(self.enumerate_instance_names(), code)
+        self.assertEqual(self.cache.hits, 1)
+
+    def test_invalidate_url(self):
+        self.enumerate_instance_names()
+        self.cache.invalidate(url=WSMAN_URL)
+        self.assertEqual(len(self.cache), 0)
+
+
+if __name__ == '__main__':
+    unittest.main()
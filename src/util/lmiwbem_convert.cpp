@@ -20,6 +20,7 @@
  * ***** END LICENSE BLOCK ***** */
 
 #include <config.h>
+#include <vector>
 #include <Pegasus/Common/CIMType.h>
 #include <Pegasus/Common/Char16.h>
 #include <Pegasus/Common/CIMDateTime.h>
@@ -28,9 +29,6 @@
 #include <Pegasus/Common/CIMPropertyList.h>
 #include <Pegasus/Common/CIMValue.h>
 #include <Pegasus/Common/String.h>
-#ifdef HAVE_OPENWSMAN
-#  include "lmiwbem_client_wsman_builder.h"
-#endif // HAVE_OPENWSMAN
 #include "obj/cim/lmiwbem_class.h"
 #include "obj/cim/lmiwbem_class_name.h"
 #include "obj/cim/lmiwbem_instance.h"
@@ -41,6 +39,88 @@
 
 boost::shared_ptr<CIMTypeConv::CIMTypeHolder> CIMTypeConv::CIMTypeHolder::s_instance;
 
+namespace {
+
+// Byte order argument for Python's UTF-16 codec matching the in-memory
+// layout of Pegasus::Char16 (-1 little endian, 1 big endian).
+int nativeUTF16ByteOrder()
+{
+    static const Pegasus::Uint16 probe = 1;
+    return *reinterpret_cast<const unsigned char*>(&probe) ? -1 : 1;
+}
+
+Pegasus::String asPegasusStringFromUTF16Bytes(PyObject *py_bytes)
+{
+    if (!py_bytes)
+        throw bp::error_already_set();
+
+    bp::object bytes_keeper = bp::object(bp::handle<>(py_bytes));
+    char *buffer = NULL;
+    Py_ssize_t size = 0;
+#if PY_MAJOR_VERSION < 3
+    PyString_AsStringAndSize(py_bytes, &buffer, &size);
+#else
+    PyBytes_AsStringAndSize(py_bytes, &buffer, &size);
+#endif // PY_MAJOR_VERSION
+
+    return Pegasus::String(
+        reinterpret_cast<const Pegasus::Char16*>(buffer),
+        static_cast<Pegasus::Uint32>(size / sizeof(Pegasus::Char16)));
+}
+
+// Builds Pegasus::String straight from the code units of a Python unicode
+// object, skipping the UTF-8 round trip through char buffers.
+Pegasus::String asPegasusStringFromUnicode(PyObject *py_unicode)
+{
+#if PY_MAJOR_VERSION < 3
+#  if Py_UNICODE_SIZE == 2
+    return Pegasus::String(
+        reinterpret_cast<const Pegasus::Char16*>(
+            PyUnicode_AS_UNICODE(py_unicode)),
+        static_cast<Pegasus::Uint32>(PyUnicode_GET_SIZE(py_unicode)));
+#  else
+    return asPegasusStringFromUTF16Bytes(
+        PyUnicode_EncodeUTF16(
+            PyUnicode_AS_UNICODE(py_unicode),
+            PyUnicode_GET_SIZE(py_unicode),
+            NULL,
+            nativeUTF16ByteOrder()));
+#  endif // Py_UNICODE_SIZE
+#else
+    if (PyUnicode_READY(py_unicode) < 0)
+        throw bp::error_already_set();
+
+    const Py_ssize_t size = PyUnicode_GET_LENGTH(py_unicode);
+    switch (PyUnicode_KIND(py_unicode)) {
+    case PyUnicode_1BYTE_KIND:
+        if (PyUnicode_IS_ASCII(py_unicode)) {
+            return Pegasus::String(
+                reinterpret_cast<const char*>(PyUnicode_1BYTE_DATA(py_unicode)),
+                static_cast<Pegasus::Uint32>(size));
+        } else {
+            const Py_UCS1 *data = PyUnicode_1BYTE_DATA(py_unicode);
+            std::vector<Pegasus::Char16> buffer(data, data + size);
+            return Pegasus::String(
+                &buffer[0], static_cast<Pegasus::Uint32>(size));
+        }
+    case PyUnicode_2BYTE_KIND:
+        return Pegasus::String(
+            reinterpret_cast<const Pegasus::Char16*>(
+                PyUnicode_2BYTE_DATA(py_unicode)),
+            static_cast<Pegasus::Uint32>(size));
+    default:
+        // Characters outside of BMP need surrogate pairs.
+        return asPegasusStringFromUTF16Bytes(
+            PyUnicode_AsEncodedString(
+                py_unicode,
+                nativeUTF16ByteOrder() < 0 ? "utf-16-le" : "utf-16-be",
+                "surrogatepass"));
+    }
+#endif // PY_MAJOR_VERSION
+}
+
+} // unnamed namespace
+
 namespace Conv {
 
 namespace detail {
@@ -246,46 +326,6 @@ Pegasus::CIMPropertyList ListConv::asPegasusPropertyList(
     return peg_property_list;
 }
 
-#ifdef HAVE_OPENWSMAN
-Pegasus::Array<Pegasus::CIMInstance> ListConv::asPegasusCIMInstancesWithPathList(
-    const std::vector<std::string> &enum_result,
-        const String &hostname,
-        const String &namespace_)
-{
-    Pegasus::Array<Pegasus::CIMInstance> peg_inst_list;
-
-    std::vector<std::string>::const_iterator it;
-    for (it = enum_result.begin(); it != enum_result.end(); ++it) {
-        peg_inst_list.append(
-            ObjectFactory::makeCIMInstanceWithPath(
-                *it,
-                hostname,
-                namespace_));
-    }
-
-    return peg_inst_list;
-}
-
-Pegasus::Array<Pegasus::CIMObjectPath> ListConv::asPegasusCIMInstanceNameList(
-    const std::vector<std::string> &enum_result,
-    const String &hostname,
-    const String &namespace_)
-{
-    Pegasus::Array<Pegasus::CIMObjectPath> peg_inst_name_list;
-
-    std::vector<std::string>::const_iterator it;
-    for (it = enum_result.begin(); it != enum_result.end(); ++it) {
-        peg_inst_name_list.append(
-            ObjectFactory::makeCIMInstanceName(
-                *it,
-                hostname,
-                namespace_));
-    }
-
-    return peg_inst_name_list;
-}
-#endif //HAVE_OPENWSMAN
-
 bp::object ListConv::asPyCIMInstanceList(
     const Pegasus::Array<Pegasus::CIMInstance> &arr,
     const String &ns,
@@ -358,6 +398,8 @@ String StringConv::asString(
 
 Pegasus::String StringConv::asPegasusString(const bp::object &obj)
 {
+    if (isunicode(obj))
+        return asPegasusStringFromUnicode(obj.ptr());
     return Pegasus::String(Conv::as<const char*>(obj));
 }
 
@@ -365,6 +407,8 @@ Pegasus::String StringConv::asPegasusString(
     const bp::object &obj,
     const String &member)
 {
+    if (isunicode(obj))
+        return asPegasusStringFromUnicode(obj.ptr());
     return Pegasus::String(Conv::as<const char*>(obj, member));
 }
 
@@ -375,12 +419,55 @@ bp::object StringConv::asPyUnicode(const char *str)
 
 bp::object StringConv::asPyUnicode(const String &str)
 {
-    return asPyUnicode(str.c_str());
+    return bp::object(bp::handle<>(
+        PyUnicode_DecodeUTF8(str.data(), str.size(), NULL)));
 }
 
 bp::object StringConv::asPyUnicode(const Pegasus::String &str)
 {
-    return asPyUnicode(str.getCString());
+    // Decode UTF-16 code units directly; no intermediate CString.
+    int byteorder = nativeUTF16ByteOrder();
+    PyObject *py_str = PyUnicode_DecodeUTF16(
+        reinterpret_cast<const char*>(str.getChar16Data()),
+        str.size() * sizeof(Pegasus::Char16),
+        NULL,
+        &byteorder);
+
+    if (!py_str) {
+        // Unpaired surrogates; let Pegasus deal with them as before.
+        PyErr_Clear();
+        return asPyUnicode(str.getCString());
+    }
+
+    return bp::object(bp::handle<>(py_str));
+}
+
+bp::object StringConv::asPyBytes(const std::string &str)
+{
+#if PY_MAJOR_VERSION < 3
+    return bp::object(bp::handle<>(
+        PyString_FromStringAndSize(str.data(), str.size())));
+#else
+    return bp::object(bp::handle<>(
+        PyBytes_FromStringAndSize(str.data(), str.size())));
+#endif // PY_MAJOR_VERSION
+}
+
+std::string StringConv::asStdBytes(
+    const bp::object &obj,
+    const String &member)
+{
+    char *buffer = NULL;
+    Py_ssize_t size = 0;
+#if PY_MAJOR_VERSION < 3
+    if (PyString_AsStringAndSize(obj.ptr(), &buffer, &size) < 0) {
+#else
+    if (PyBytes_AsStringAndSize(obj.ptr(), &buffer, &size) < 0) {
+#endif // PY_MAJOR_VERSION
+        PyErr_Clear();
+        throw_TypeError(member + String(" must be bytes type"));
+    }
+    return std::string(buffer, size);
 }
 
 bp::object StringConv::asPyBool(const char *str)
@@ -460,9 +547,7 @@ DEFINE_TO_CONVERTER(StringToPythonString, String)
 
 DEFINE_TO_CONVERTER(PegasusStringToPythonString, Pegasus::String)
 {
-    return bp::incref(
-        StringConv::asPyUnicode(
-            String(value.getCString())).ptr());
+    return bp::incref(StringConv::asPyUnicode(value).ptr());
 }
 
 DEFINE_TO_CONVERTER(PegasusCIMNameToPythonString, Pegasus::CIMName)
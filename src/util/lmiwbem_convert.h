@@ -24,9 +24,6 @@
 
 #  include <config.h>
 #  include <map>
-#  ifdef HAVE_OPENWSMAN
-#    include <vector>
-#  endif // HAVE_OPENWSMAN
 #  include <boost/python/extract.hpp>
 #  include <boost/python/list.hpp>
 #  include <boost/python/to_python_converter.hpp>
@@ -266,17 +263,6 @@ public:
         const bp::object &property_list,
         const String &message);
 
-#  ifdef HAVE_OPENWSMAN
-    static Pegasus::Array<Pegasus::CIMInstance> asPegasusCIMInstancesWithPathList(
-        const std::vector<std::string> &enum_result,
-        const String &hostname,
-        const String &namespace_);
-    static Pegasus::Array<Pegasus::CIMObjectPath> asPegasusCIMInstanceNameList(
-        const std::vector<std::string> &enum_result,
-        const String &hostname,
-        const String &namespace_);
-#  endif // HAVE_OPENWSMAN
-
     static bp::object asPyCIMInstanceList(
         const Pegasus::Array<Pegasus::CIMInstance> &arr,
         const String &ns = String(),
@@ -316,6 +302,8 @@ public:
     static bp::object  asPyUnicode(const char *str);
     static bp::object  asPyUnicode(const String &str);
     static bp::object  asPyUnicode(const Pegasus::String &str);
+    static bp::object  asPyBytes(const std::string &str);
+    static std::string asStdBytes(const bp::object &obj, const String &member);
     static bp::object  asPyBool(const char *str);
     static bp::object  asPyBool(const String &str);
     static bp::object  asPyBool(const Pegasus::String &str);
@@ -0,0 +1,475 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include <config.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <boost/python/object.hpp>
+#include <Pegasus/Common/CIMClass.h>
+#include <Pegasus/Common/CIMDateTime.h>
+#include <Pegasus/Common/CIMObject.h>
+#include <Pegasus/Common/CIMObjectPath.h>
+#include <Pegasus/Common/CIMProperty.h>
+#include <Pegasus/Common/Char16.h>
+#include "lmiwbem_exception.h"
+#include "util/lmiwbem_convert.h"
+#include "util/lmiwbem_export.h"
+#include "util/lmiwbem_mof.h"
+#include "util/lmiwbem_util.h"
+
+namespace {
+
+const size_t EXPORT_BUFFER_SIZE = 64 * 1024;
+
+void putJSONValue(std::string &buffer, const Pegasus::CIMValue &value);
+void putJSONObject(std::string &buffer, const Pegasus::CIMConstInstance &instance);
+
+void putText(std::string &buffer, const Pegasus::String &str)
+{
+    buffer += str.getCString();
+}
+
+template <typename T>
+void putNumber(std::string &buffer, const char *fmt, T value)
+{
+    char tmp[32];
+    int len = snprintf(tmp, sizeof(tmp), fmt, value);
+    buffer.append(tmp, len);
+}
+
+void putJSONString(std::string &buffer, const Pegasus::String &str)
+{
+    const Pegasus::CString c_str(str.getCString());
+    buffer += '"';
+    for (const char *c = c_str; *c; ++c) {
+        switch (*c) {
+        case '"':
+            buffer += "\\\"";
+            break;
+        case '\\':
+            buffer += "\\\\";
+            break;
+        case '\n':
+            buffer += "\\n";
+            break;
+        case '\r':
+            buffer += "\\r";
+            break;
+        case '\t':
+            buffer += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(*c) < 0x20)
+                putNumber(buffer, "\\u%04x", static_cast<unsigned int>(*c));
+            else
+                buffer += *c;
+        }
+    }
+    buffer += '"';
+}
+
+void putJSONRaw(std::string &buffer, const Pegasus::Boolean &value)
+{
+    buffer += value ? "true" : "false";
+}
+
+void putJSONRaw(std::string &buffer, const Pegasus::Uint8 &value)
+{
+    putNumber(buffer, "%u", static_cast<unsigned int>(value));
+}
+
+void putJSONRaw(std::string &buffer, const Pegasus::Sint8 &value)
+{
+    putNumber(buffer, "%d", static_cast<int>(value));
+}
+
+void putJSONRaw(std::string &buffer, const Pegasus::Uint16 &value)
+{
+    putNumber(buffer, "%u", static_cast<unsigned int>(value));
+}
+
+void putJSONRaw(std::string &buffer, const Pegasus::Sint16 &value)
+{
+    putNumber(buffer, "%d", static_cast<int>(value));
+}
+
+void putJSONRaw(std::string &buffer, const Pegasus::Uint32 &value)
+{
+    putNumber(buffer, "%u", static_cast<unsigned int>(value));
+}
+
+void putJSONRaw(std::string &buffer, const Pegasus::Sint32 &value)
+{
+    putNumber(buffer, "%d", static_cast<int>(value));
+}
+
+void putJSONRaw(std::string &buffer, const Pegasus::Uint64 &value)
+{
+    putNumber(buffer, "%llu", static_cast<unsigned long long>(value));
+}
+
+void putJSONRaw(std::string &buffer, const Pegasus::Sint64 &value)
+{
+    putNumber(buffer, "%lld", static_cast<long long>(value));
+}
+
+void putJSONRaw(std::string &buffer, const Pegasus::Real64 &value)
+{
+    // JSON can't represent NaN and infinities.
+    if (value != value || value - value != 0)
+        buffer += "null";
+    else
+        MOFWriter::putReal(buffer, value);
+}
+
+void putJSONRaw(std::string &buffer, const Pegasus::Real32 &value)
+{
+    putJSONRaw(buffer, static_cast<Pegasus::Real64>(value));
+}
+
+void putJSONRaw(std::string &buffer, const Pegasus::Char16 &value)
+{
+    putJSONString(buffer, Pegasus::String(&value, 1));
+}
+
+void putJSONRaw(std::string &buffer, const Pegasus::String &value)
+{
+    putJSONString(buffer, value);
+}
+
+void putJSONRaw(std::string &buffer, const Pegasus::CIMDateTime &value)
+{
+    putJSONString(buffer, value.toString());
+}
+
+void putJSONRaw(std::string &buffer, const Pegasus::CIMObjectPath &value)
+{
+    putJSONString(buffer, value.toString());
+}
+
+void putJSONRaw(std::string &buffer, const Pegasus::CIMInstance &value)
+{
+    putJSONObject(buffer, value);
+}
+
+void putJSONRaw(std::string &buffer, const Pegasus::CIMObject &value)
+{
+    if (value.isInstance()) {
+        putJSONObject(buffer, Pegasus::CIMConstInstance(value));
+        return;
+    }
+
+    buffer += "{\"classname\": ";
+    putJSONString(buffer, value.getClassName().getString());
+    buffer += '}';
+}
+
+template <typename T>
+void putJSONValueCore(std::string &buffer, const Pegasus::CIMValue &value)
+{
+    if (!value.isArray()) {
+        T raw_value;
+        value.get(raw_value);
+        putJSONRaw(buffer, raw_value);
+        return;
+    }
+
+    Pegasus::Array<T> raw_array;
+    value.get(raw_array);
+
+    buffer += '[';
+    const Pegasus::Uint32 cnt = raw_array.size();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+        if (i > 0)
+            buffer += ", ";
+        putJSONRaw(buffer, raw_array[i]);
+    }
+    buffer += ']';
+}
+
+void putJSONValue(std::string &buffer, const Pegasus::CIMValue &value)
+{
+    if (value.isNull()) {
+        buffer += "null";
+        return;
+    }
+
+    switch (value.getType()) {
+    case Pegasus::CIMTYPE_BOOLEAN:
+        putJSONValueCore<Pegasus::Boolean>(buffer, value);
+        break;
+    case Pegasus::CIMTYPE_UINT8:
+        putJSONValueCore<Pegasus::Uint8>(buffer, value);
+        break;
+    case Pegasus::CIMTYPE_SINT8:
+        putJSONValueCore<Pegasus::Sint8>(buffer, value);
+        break;
+    case Pegasus::CIMTYPE_UINT16:
+        putJSONValueCore<Pegasus::Uint16>(buffer, value);
+        break;
+    case Pegasus::CIMTYPE_SINT16:
+        putJSONValueCore<Pegasus::Sint16>(buffer, value);
+        break;
+    case Pegasus::CIMTYPE_UINT32:
+        putJSONValueCore<Pegasus::Uint32>(buffer, value);
+        break;
+    case Pegasus::CIMTYPE_SINT32:
+        putJSONValueCore<Pegasus::Sint32>(buffer, value);
+        break;
+    case Pegasus::CIMTYPE_UINT64:
+        putJSONValueCore<Pegasus::Uint64>(buffer, value);
+        break;
+    case Pegasus::CIMTYPE_SINT64:
+        putJSONValueCore<Pegasus::Sint64>(buffer, value);
+        break;
+    case Pegasus::CIMTYPE_REAL32:
+        putJSONValueCore<Pegasus::Real32>(buffer, value);
+        break;
+    case Pegasus::CIMTYPE_REAL64:
+        putJSONValueCore<Pegasus::Real64>(buffer, value);
+        break;
+    case Pegasus::CIMTYPE_CHAR16:
+        putJSONValueCore<Pegasus::Char16>(buffer, value);
+        break;
+    case Pegasus::CIMTYPE_STRING:
+        putJSONValueCore<Pegasus::String>(buffer, value);
+        break;
+    case Pegasus::CIMTYPE_DATETIME:
+        putJSONValueCore<Pegasus::CIMDateTime>(buffer, value);
+        break;
+    case Pegasus::CIMTYPE_REFERENCE:
+        putJSONValueCore<Pegasus::CIMObjectPath>(buffer, value);
+        break;
+    case Pegasus::CIMTYPE_OBJECT:
+        putJSONValueCore<Pegasus::CIMObject>(buffer, value);
+        break;
+    case Pegasus::CIMTYPE_INSTANCE:
+        putJSONValueCore<Pegasus::CIMInstance>(buffer, value);
+        break;
+    }
+}
+
+void putJSONObject(std::string &buffer, const Pegasus::CIMConstInstance &instance)
+{
+    buffer += "{\"classname\": ";
+    putJSONString(buffer, instance.getClassName().getString());
+
+    const Pegasus::CIMObjectPath &path = instance.getPath();
+    buffer += ", \"path\": ";
+    if (path.getClassName().isNull())
+        buffer += "null";
+    else
+        putJSONString(buffer, path.toString());
+
+    buffer += ", \"properties\": {";
+    const Pegasus::Uint32 cnt = instance.getPropertyCount();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+        Pegasus::CIMConstProperty property(instance.getProperty(i));
+        if (i > 0)
+            buffer += ", ";
+        putJSONString(buffer, property.getName().getString());
+        buffer += ": ";
+        putJSONValue(buffer, property.getValue());
+    }
+    buffer += "}}";
+}
+
+} // unnamed namespace
+
+Exporter::Exporter(
+    int fd,
+    Format format,
+    const String &hostname,
+    const Pegasus::CIMPropertyList &columns)
+    : m_fd(fd)
+    , m_format(format)
+    , m_hostname(hostname)
+    , m_columns()
+    , m_header_done(false)
+    , m_count(0)
+    , m_buffer()
+{
+    if (!columns.isNull()) {
+        const Pegasus::Uint32 cnt = columns.size();
+        for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+            m_columns.push_back(columns[i]);
+    }
+}
+
+Exporter::~Exporter()
+{
+}
+
+Exporter::Format Exporter::asFormat(const String &format)
+{
+    if (format == "mof")
+        return FORMAT_MOF;
+    else if (format == "json" || format == "jsonl")
+        return FORMAT_JSON;
+    else if (format == "csv")
+        return FORMAT_CSV;
+
+    throw_ValueError("Format must be one of 'mof', 'jsonl' or 'csv'");
+    return FORMAT_MOF;
+}
+
+int Exporter::asFileDescriptor(const bp::object &file)
+{
+    if (PyObject_HasAttrString(file.ptr(), "fileno")) {
+        // Python file objects have their own buffers; flush them, so the
+        // exported data don't get mixed with pending writes.
+        if (PyObject_HasAttrString(file.ptr(), "flush"))
+            file.attr("flush")();
+        return Conv::as<int>(file.attr("fileno")(), "File.fileno()");
+    }
+
+    return Conv::as<int>(file, "File");
+}
+
+void Exporter::putInstance(const Pegasus::CIMConstInstance &instance)
+{
+    switch (m_format) {
+    case FORMAT_MOF: {
+        // Same hostname as CIMInstance gets, when created from enumeration.
+        const Pegasus::String &host = instance.getPath().getHost();
+        MOFWriter writer(
+            m_buffer,
+            host == Pegasus::String::EMPTY ? m_hostname.asPegasusString() : host);
+        writer.putInstance(instance);
+        break;
+    }
+    case FORMAT_JSON:
+        putJSONObject(m_buffer, instance);
+        m_buffer += '\n';
+        break;
+    case FORMAT_CSV:
+        if (!m_header_done)
+            putCSVHeader(instance);
+        putCSVRow(instance);
+        break;
+    }
+
+    ++m_count;
+    if (m_buffer.size() >= EXPORT_BUFFER_SIZE)
+        flush();
+}
+
+void Exporter::putInstances(const Pegasus::Array<Pegasus::CIMInstance> &instances)
+{
+    const Pegasus::Uint32 cnt = instances.size();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        putInstance(instances[i]);
+}
+
+void Exporter::flush()
+{
+    const char *data = m_buffer.data();
+    size_t size = m_buffer.size();
+    while (size > 0) {
+        ssize_t written = ::write(m_fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            throw_IOError(String("Can't export instances: ") + String(strerror(errno)));
+        }
+        data += written;
+        size -= written;
+    }
+    m_buffer.clear();
+}
+
+void Exporter::putCSVHeader(const Pegasus::CIMConstInstance &instance)
+{
+    // Without a PropertyList, the columns are taken from the first instance.
+    if (m_columns.empty()) {
+        const Pegasus::Uint32 cnt = instance.getPropertyCount();
+        for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+            m_columns.push_back(instance.getProperty(i).getName());
+    }
+
+    std::vector<Pegasus::CIMName>::const_iterator it;
+    for (it = m_columns.begin(); it != m_columns.end(); ++it) {
+        if (it != m_columns.begin())
+            m_buffer += ',';
+        putCSVField(String(it->getString()));
+    }
+    m_buffer += '\n';
+    m_header_done = true;
+}
+
+void Exporter::putCSVRow(const Pegasus::CIMConstInstance &instance)
+{
+    std::string field;
+    std::vector<Pegasus::CIMName>::const_iterator it;
+    for (it = m_columns.begin(); it != m_columns.end(); ++it) {
+        if (it != m_columns.begin())
+            m_buffer += ',';
+
+        Pegasus::Uint32 pos = instance.findProperty(*it);
+        if (pos == Pegasus::PEG_NOT_FOUND)
+            continue;
+
+        const Pegasus::CIMValue value(instance.getProperty(pos).getValue());
+        if (value.isNull())
+            continue;
+
+        // Scalar textual values are written as they are, the rest is
+        // written in the same way as in JSON.
+        field.clear();
+        if (!value.isArray() && value.getType() == Pegasus::CIMTYPE_STRING) {
+            Pegasus::String str;
+            value.get(str);
+            putText(field, str);
+        } else if (!value.isArray() && value.getType() == Pegasus::CIMTYPE_DATETIME) {
+            Pegasus::CIMDateTime datetime;
+            value.get(datetime);
+            putText(field, datetime.toString());
+        } else if (!value.isArray() && value.getType() == Pegasus::CIMTYPE_REFERENCE) {
+            Pegasus::CIMObjectPath path;
+            value.get(path);
+            putText(field, path.toString());
+        } else {
+            putJSONValue(field, value);
+        }
+        putCSVField(field);
+    }
+    m_buffer += '\n';
+}
+
+void Exporter::putCSVField(const std::string &field)
+{
+    if (field.find_first_of(",\"\r\n") == std::string::npos) {
+        m_buffer += field;
+        return;
+    }
+
+    m_buffer += '"';
+    std::string::const_iterator it;
+    for (it = field.begin(); it != field.end(); ++it) {
+        if (*it == '"')
+            m_buffer += '"';
+        m_buffer += *it;
+    }
+    m_buffer += '"';
+}
@@ -0,0 +1,83 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef   LMIWBEM_EXPORT_H
+#  define LMIWBEM_EXPORT_H
+
+#  include <string>
+#  include <vector>
+#  include <Pegasus/Common/Array.h>
+#  include <Pegasus/Common/CIMInstance.h>
+#  include <Pegasus/Common/CIMPropertyList.h>
+#  include <Pegasus/Common/CIMValue.h>
+#  include "lmiwbem.h"
+#  include "util/lmiwbem_string.h"
+
+BOOST_PYTHON_BEGIN
+class object;
+BOOST_PYTHON_END
+
+namespace bp = boost::python;
+
+// Writes instances received from a CIMOM into a file descriptor without
+// creating Python objects. The output is buffered and flushed in chunks, so
+// the memory used does not depend on the amount of exported instances.
+class Exporter
+{
+public:
+    typedef enum {
+        FORMAT_MOF,
+        FORMAT_JSON,
+        FORMAT_CSV
+    } Format;
+
+    Exporter(
+        int fd,
+        Format format,
+        const String &hostname,
+        const Pegasus::CIMPropertyList &columns = Pegasus::CIMPropertyList());
+    ~Exporter();
+
+    static Format asFormat(const String &format);
+    static int asFileDescriptor(const bp::object &file);
+
+    void putInstance(const Pegasus::CIMConstInstance &instance);
+    void putInstances(const Pegasus::Array<Pegasus::CIMInstance> &instances);
+    void flush();
+
+    Pegasus::Uint64 count() const { return m_count; }
+
+private:
+    void putCSVHeader(const Pegasus::CIMConstInstance &instance);
+    void putCSVRow(const Pegasus::CIMConstInstance &instance);
+    void putCSVField(const std::string &field);
+
+    int m_fd;
+    Format m_format;
+    String m_hostname;
+    std::vector<Pegasus::CIMName> m_columns;
+    bool m_header_done;
+    Pegasus::Uint64 m_count;
+    std::string m_buffer;
+};
+
+#endif // LMIWBEM_EXPORT_H
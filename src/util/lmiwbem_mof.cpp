@@ -0,0 +1,594 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include <config.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <Pegasus/Common/Array.h>
+#include <Pegasus/Common/CIMClass.h>
+#include <Pegasus/Common/CIMDateTime.h>
+#include <Pegasus/Common/CIMObject.h>
+#include <Pegasus/Common/CIMProperty.h>
+#include <Pegasus/Common/Char16.h>
+#include "util/lmiwbem_convert.h"
+#include "util/lmiwbem_mof.h"
+#include "util/lmiwbem_string.h"
+
+namespace {
+
+void append(std::string &buffer, const Pegasus::String &str)
+{
+    buffer += str.getCString();
+}
+
+void append(std::string &buffer, const Pegasus::CIMName &name)
+{
+    buffer += name.getString().getCString();
+}
+
+template <typename T>
+void appendNumber(std::string &buffer, const char *fmt, T value)
+{
+    char tmp[32];
+    int len = snprintf(tmp, sizeof(tmp), fmt, value);
+    buffer.append(tmp, len);
+}
+
+// Sorts objects by their names in the same way as NocaseDict does.
+template <typename T>
+void sortByName(std::vector<T> &objects)
+{
+    std::vector<std::pair<std::string, size_t> > keys(objects.size());
+    for (size_t i = 0; i < objects.size(); ++i) {
+        std::string name(objects[i].getName().getString().getCString());
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        keys[i] = std::make_pair(name, i);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<T> sorted;
+    sorted.reserve(objects.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+        sorted.push_back(objects[keys[i].second]);
+    objects.swap(sorted);
+}
+
+} // unnamed namespace
+
+MOFWriter::MOFWriter(std::string &buffer, const Pegasus::String &hostname)
+    : m_buffer(buffer)
+    , m_hostname(hostname)
+    , m_in_instance(false)
+{
+}
+
+void MOFWriter::putInstance(const Pegasus::CIMConstInstance &instance)
+{
+    std::vector<Pegasus::CIMConstProperty> properties;
+    const Pegasus::Uint32 cnt = instance.getPropertyCount();
+    properties.reserve(cnt);
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        properties.push_back(instance.getProperty(i));
+
+    putInstanceCore(instance.getClassName(), properties);
+}
+
+void MOFWriter::putInstance(
+    const Pegasus::CIMName &classname,
+    const std::list<Pegasus::CIMConstProperty> &properties)
+{
+    std::vector<Pegasus::CIMConstProperty> properties_(
+        properties.begin(), properties.end());
+    putInstanceCore(classname, properties_);
+}
+
+void MOFWriter::putClass(const Pegasus::CIMConstClass &cls)
+{
+    std::vector<Pegasus::CIMConstQualifier> qualifiers;
+    Pegasus::Uint32 cnt = cls.getQualifierCount();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        qualifiers.push_back(cls.getQualifier(i));
+    putQualifiers(qualifiers, "");
+    if (!qualifiers.empty())
+        m_buffer += '\n';
+
+    m_buffer += "class ";
+    append(m_buffer, cls.getClassName());
+    if (!cls.getSuperClassName().isNull()) {
+        m_buffer += " : ";
+        append(m_buffer, cls.getSuperClassName());
+    }
+    m_buffer += " {\n";
+
+    std::vector<Pegasus::CIMConstProperty> properties;
+    cnt = cls.getPropertyCount();
+    properties.reserve(cnt);
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        properties.push_back(cls.getProperty(i));
+    sortByName(properties);
+
+    std::vector<Pegasus::CIMConstProperty>::const_iterator prop_it;
+    for (prop_it = properties.begin(); prop_it != properties.end(); ++prop_it)
+        putProperty(*prop_it);
+
+    std::vector<Pegasus::CIMConstMethod> methods;
+    cnt = cls.getMethodCount();
+    methods.reserve(cnt);
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        methods.push_back(cls.getMethod(i));
+    sortByName(methods);
+
+    std::vector<Pegasus::CIMConstMethod>::const_iterator meth_it;
+    for (meth_it = methods.begin(); meth_it != methods.end(); ++meth_it)
+        putMethod(*meth_it);
+
+    m_buffer += "};\n";
+}
+
+void MOFWriter::putValue(const Pegasus::CIMValue &value)
+{
+    if (value.isNull() && !value.isArray()) {
+        m_buffer += "NULL";
+        return;
+    }
+
+    switch (value.getType()) {
+    case Pegasus::CIMTYPE_BOOLEAN:
+        putValueCore<Pegasus::Boolean>(value);
+        break;
+    case Pegasus::CIMTYPE_UINT8:
+        putValueCore<Pegasus::Uint8>(value);
+        break;
+    case Pegasus::CIMTYPE_SINT8:
+        putValueCore<Pegasus::Sint8>(value);
+        break;
+    case Pegasus::CIMTYPE_UINT16:
+        putValueCore<Pegasus::Uint16>(value);
+        break;
+    case Pegasus::CIMTYPE_SINT16:
+        putValueCore<Pegasus::Sint16>(value);
+        break;
+    case Pegasus::CIMTYPE_UINT32:
+        putValueCore<Pegasus::Uint32>(value);
+        break;
+    case Pegasus::CIMTYPE_SINT32:
+        putValueCore<Pegasus::Sint32>(value);
+        break;
+    case Pegasus::CIMTYPE_UINT64:
+        putValueCore<Pegasus::Uint64>(value);
+        break;
+    case Pegasus::CIMTYPE_SINT64:
+        putValueCore<Pegasus::Sint64>(value);
+        break;
+    case Pegasus::CIMTYPE_REAL32:
+        putValueCore<Pegasus::Real32>(value);
+        break;
+    case Pegasus::CIMTYPE_REAL64:
+        putValueCore<Pegasus::Real64>(value);
+        break;
+    case Pegasus::CIMTYPE_CHAR16:
+        putValueCore<Pegasus::Char16>(value);
+        break;
+    case Pegasus::CIMTYPE_STRING:
+        putValueCore<Pegasus::String>(value);
+        break;
+    case Pegasus::CIMTYPE_DATETIME:
+        putValueCore<Pegasus::CIMDateTime>(value);
+        break;
+    case Pegasus::CIMTYPE_REFERENCE:
+        putValueCore<Pegasus::CIMObjectPath>(value);
+        break;
+    case Pegasus::CIMTYPE_OBJECT:
+        putValueCore<Pegasus::CIMObject>(value);
+        break;
+    case Pegasus::CIMTYPE_INSTANCE:
+        putValueCore<Pegasus::CIMInstance>(value);
+        break;
+    }
+}
+
+void MOFWriter::putInstanceCore(
+    const Pegasus::CIMName &classname,
+    std::vector<Pegasus::CIMConstProperty> &properties)
+{
+    m_buffer += "instance of ";
+    append(m_buffer, classname);
+    m_buffer += " {\n";
+
+    sortByName(properties);
+
+    m_in_instance = true;
+    std::vector<Pegasus::CIMConstProperty>::const_iterator it;
+    for (it = properties.begin(); it != properties.end(); ++it) {
+        m_buffer += '\t';
+        append(m_buffer, it->getName());
+        m_buffer += " = ";
+        putValue(it->getValue());
+        m_buffer += ";\n";
+    }
+    m_in_instance = false;
+
+    m_buffer += "};\n";
+}
+
+void MOFWriter::putQualifiers(
+    const std::vector<Pegasus::CIMConstQualifier> &qualifiers,
+    const char *indent)
+{
+    if (qualifiers.empty())
+        return;
+
+    std::vector<Pegasus::CIMConstQualifier> sorted(qualifiers);
+    sortByName(sorted);
+
+    m_buffer += indent;
+    m_buffer += '[';
+    std::vector<Pegasus::CIMConstQualifier>::const_iterator it;
+    for (it = sorted.begin(); it != sorted.end(); ++it) {
+        if (it != sorted.begin())
+            m_buffer += ", ";
+        putQualifier(*it);
+    }
+    m_buffer += ']';
+}
+
+void MOFWriter::putQualifier(const Pegasus::CIMConstQualifier &qualifier)
+{
+    // Mirrors CIMQualifier.tomof().
+    const Pegasus::CIMValue &value = qualifier.getValue();
+    append(m_buffer, qualifier.getName());
+    if (value.isArray()) {
+        m_buffer += ' ';
+        putValue(value);
+    } else if (value.isNull()) {
+        m_buffer += " (None)";
+    } else if (value.getType() == Pegasus::CIMTYPE_STRING) {
+        Pegasus::String str;
+        value.get(str);
+        m_buffer += " (\"";
+        append(m_buffer, str);
+        m_buffer += "\")";
+    } else {
+        m_buffer += " (";
+        putValue(value);
+        m_buffer += ')';
+    }
+}
+
+void MOFWriter::putProperty(const Pegasus::CIMConstProperty &property)
+{
+    std::vector<Pegasus::CIMConstQualifier> qualifiers;
+    const Pegasus::Uint32 cnt = property.getQualifierCount();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        qualifiers.push_back(property.getQualifier(i));
+    putQualifiers(qualifiers, "\t");
+    m_buffer += qualifiers.empty() ? "\t" : " ";
+
+    const Pegasus::CIMValue &value = property.getValue();
+    if (value.getType() == Pegasus::CIMTYPE_REFERENCE) {
+        append(m_buffer, property.getReferenceClassName());
+        m_buffer += " REF ";
+    } else {
+        m_buffer += CIMTypeConv::asString(value.getType());
+        m_buffer += ' ';
+    }
+    append(m_buffer, property.getName());
+
+    if (value.isArray()) {
+        m_buffer += '[';
+        if (property.getArraySize())
+            appendNumber(m_buffer, "%u", property.getArraySize());
+        m_buffer += ']';
+    }
+
+    if (!value.isNull()) {
+        m_buffer += " = ";
+        putValue(value);
+    }
+    m_buffer += ";\n";
+}
+
+void MOFWriter::putMethod(const Pegasus::CIMConstMethod &method)
+{
+    std::vector<Pegasus::CIMConstQualifier> qualifiers;
+    Pegasus::Uint32 cnt = method.getQualifierCount();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        qualifiers.push_back(method.getQualifier(i));
+    putQualifiers(qualifiers, "\t");
+    m_buffer += qualifiers.empty() ? "\t" : " ";
+
+    // Mirrors CIMMethod.tomof() and CIMParameter.tomof().
+    m_buffer += CIMTypeConv::asString(method.getType());
+    m_buffer += ' ';
+    append(m_buffer, method.getName());
+    m_buffer += '(';
+
+    std::vector<Pegasus::CIMConstParameter> parameters;
+    cnt = method.getParameterCount();
+    parameters.reserve(cnt);
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        parameters.push_back(method.getParameter(i));
+    sortByName(parameters);
+
+    std::vector<Pegasus::CIMConstParameter>::const_iterator it;
+    for (it = parameters.begin(); it != parameters.end(); ++it) {
+        if (it != parameters.begin())
+            m_buffer += ", ";
+        m_buffer += CIMTypeConv::asString(it->getType());
+        m_buffer += ' ';
+        append(m_buffer, it->getName());
+    }
+    m_buffer += ");\n";
+}
+
+void MOFWriter::putReal(std::string &buffer, double value)
+{
+    if (std::isnan(value)) {
+        buffer += "nan";
+        return;
+    } else if (std::isinf(value)) {
+        buffer += value < 0 ? "-inf" : "inf";
+        return;
+    }
+
+    char tmp[32];
+#if PY_MAJOR_VERSION < 3
+    // Python 2 str(float) uses 12 significant digits.
+    snprintf(tmp, sizeof(tmp), "%.12g", value);
+#else
+    // Python 3 uses the shortest representation, which reads back to the
+    // same value; scientific notation is used for exponents < -4 or >= 16.
+    int precision = 1;
+    for (; precision < 17; ++precision) {
+        snprintf(tmp, sizeof(tmp), "%.*e", precision - 1, value);
+        if (strtod(tmp, NULL) == value)
+            break;
+    }
+    snprintf(tmp, sizeof(tmp), "%.*e", precision - 1, value);
+    const int exponent = atoi(strchr(tmp, 'e') + 1);
+    if (exponent >= -4 && exponent < 16) {
+        const int decimals = std::max(precision - 1 - exponent, 0);
+        snprintf(tmp, sizeof(tmp), "%.*f", decimals, value);
+    }
+#endif // PY_MAJOR_VERSION
+
+    buffer += tmp;
+    if (!strpbrk(tmp, ".e"))
+        buffer += ".0";
+}
+
+template <typename T>
+void MOFWriter::putValueCore(const Pegasus::CIMValue &value)
+{
+    if (!value.isArray()) {
+        T raw_value;
+        value.get(raw_value);
+        putRaw(raw_value);
+        return;
+    }
+
+    Pegasus::Array<T> raw_array;
+    if (!value.isNull())
+        value.get(raw_array);
+
+    m_buffer += '{';
+    const Pegasus::Uint32 cnt = raw_array.size();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+        putRaw(raw_array[i]);
+        if (i < cnt - 1)
+            m_buffer += ", ";
+    }
+    m_buffer += '}';
+}
+
+void MOFWriter::putRaw(const Pegasus::Boolean &value)
+{
+    m_buffer += value ? "True" : "False";
+}
+
+void MOFWriter::putRaw(const Pegasus::Uint8 &value)
+{
+    appendNumber(m_buffer, "%u", static_cast<unsigned int>(value));
+}
+
+void MOFWriter::putRaw(const Pegasus::Sint8 &value)
+{
+    appendNumber(m_buffer, "%d", static_cast<int>(value));
+}
+
+void MOFWriter::putRaw(const Pegasus::Uint16 &value)
+{
+    appendNumber(m_buffer, "%u", static_cast<unsigned int>(value));
+}
+
+void MOFWriter::putRaw(const Pegasus::Sint16 &value)
+{
+    appendNumber(m_buffer, "%d", static_cast<int>(value));
+}
+
+void MOFWriter::putRaw(const Pegasus::Uint32 &value)
+{
+    appendNumber(m_buffer, "%u", static_cast<unsigned int>(value));
+}
+
+void MOFWriter::putRaw(const Pegasus::Sint32 &value)
+{
+    appendNumber(m_buffer, "%d", static_cast<int>(value));
+}
+
+void MOFWriter::putRaw(const Pegasus::Uint64 &value)
+{
+    appendNumber(m_buffer, "%llu", static_cast<unsigned long long>(value));
+}
+
+void MOFWriter::putRaw(const Pegasus::Sint64 &value)
+{
+    appendNumber(m_buffer, "%lld", static_cast<long long>(value));
+}
+
+void MOFWriter::putRaw(const Pegasus::Real32 &value)
+{
+    putReal(m_buffer, static_cast<double>(value));
+}
+
+void MOFWriter::putRaw(const Pegasus::Real64 &value)
+{
+    putReal(m_buffer, value);
+}
+
+void MOFWriter::putRaw(const Pegasus::Char16 &value)
+{
+    // Char16 is represented as Uint16 in Python.
+    putRaw(static_cast<Pegasus::Uint16>(value));
+}
+
+void MOFWriter::putRaw(const Pegasus::String &value)
+{
+    m_buffer += '\'';
+    append(m_buffer, value);
+    m_buffer += '\'';
+}
+
+void MOFWriter::putRaw(const Pegasus::CIMDateTime &value)
+{
+    append(m_buffer, value.toString());
+}
+
+void MOFWriter::putRaw(const Pegasus::CIMObjectPath &value)
+{
+    if (!m_in_instance) {
+        putInstanceNameRepr(value);
+        return;
+    }
+
+    Pegasus::CIMObjectPath path(value);
+    path.setHost(m_hostname);
+    putInstanceNameRepr(path);
+}
+
+void MOFWriter::putRaw(const Pegasus::CIMObject &value)
+{
+    m_buffer += value.isInstance() ? "CIMInstance" : "CIMClass";
+    m_buffer += "(classname=u'";
+    append(m_buffer, value.getClassName());
+    m_buffer += "', ...)";
+}
+
+void MOFWriter::putRaw(const Pegasus::CIMInstance &value)
+{
+    m_buffer += "CIMInstance(classname=u'";
+    append(m_buffer, value.getClassName());
+    m_buffer += "', ...)";
+}
+
+void MOFWriter::putKeyBindingRepr(
+    const Pegasus::CIMKeyBinding &keybinding,
+    const Pegasus::String &hostname)
+{
+    // Mirrors CIMInstanceName::keybindingToValue() and NocaseDict::repr().
+    const Pegasus::String value(keybinding.getValue());
+    const Pegasus::CString c_value(value.getCString());
+    if (keybinding.getType() == Pegasus::CIMKeyBinding::STRING)
+        m_buffer += 'u';
+    m_buffer += '\'';
+    switch (keybinding.getType()) {
+    case Pegasus::CIMKeyBinding::BOOLEAN:
+        m_buffer += strtol(c_value, NULL, 10) ? "True" : "False";
+        break;
+    case Pegasus::CIMKeyBinding::STRING:
+        m_buffer += c_value;
+        break;
+    case Pegasus::CIMKeyBinding::NUMERIC: {
+        const char *str = c_value;
+        char *end = NULL;
+        errno = 0;
+        long long number = strtoll(str, &end, 10);
+        if (*str && !*end && !errno) {
+            appendNumber(m_buffer, "%lld", number);
+            break;
+        }
+        errno = 0;
+        unsigned long long unumber = strtoull(str, &end, 10);
+        if (*str && !*end && !errno) {
+            appendNumber(m_buffer, "%llu", unumber);
+            break;
+        }
+        putReal(m_buffer, strtod(str, NULL));
+        break;
+    }
+    case Pegasus::CIMKeyBinding::REFERENCE: {
+        Pegasus::CIMObjectPath path(value);
+        if (path.getHost() == Pegasus::String::EMPTY)
+            path.setHost(hostname);
+        putInstanceNameRepr(path);
+        break;
+    }
+    }
+    m_buffer += '\'';
+}
+
+void MOFWriter::putInstanceNameRepr(
+    const Pegasus::CIMObjectPath &path,
+    const Pegasus::String &hostname)
+{
+    // Mirrors CIMInstanceName::create() and CIMInstanceName::repr().
+    const Pegasus::String host(path.getHost() == Pegasus::String::EMPTY
+        ? hostname : path.getHost());
+
+    m_buffer += "CIMInstanceName(classname=u'";
+    append(m_buffer, path.getClassName());
+    m_buffer += "', keybindings=NocaseDict({";
+
+    const Pegasus::Array<Pegasus::CIMKeyBinding> &peg_keybindings =
+        path.getKeyBindings();
+    std::vector<Pegasus::CIMKeyBinding> keybindings;
+    keybindings.reserve(peg_keybindings.size());
+    for (Pegasus::Uint32 i = 0; i < peg_keybindings.size(); ++i)
+        keybindings.push_back(peg_keybindings[i]);
+    sortByName(keybindings);
+
+    std::vector<Pegasus::CIMKeyBinding>::const_iterator it;
+    for (it = keybindings.begin(); it != keybindings.end(); ++it) {
+        if (it != keybindings.begin())
+            m_buffer += ", ";
+        m_buffer += "u'";
+        append(m_buffer, it->getName());
+        m_buffer += "': ";
+        putKeyBindingRepr(*it, host);
+    }
+
+    m_buffer += "})";
+    if (host != Pegasus::String::EMPTY) {
+        m_buffer += ", host=u'";
+        append(m_buffer, host);
+        m_buffer += '\'';
+    }
+    m_buffer += ", namespace=u'";
+    if (!path.getNameSpace().isNull())
+        append(m_buffer, path.getNameSpace().getString());
+    m_buffer += "')";
+}
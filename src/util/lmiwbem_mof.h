@@ -0,0 +1,104 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef   LMIWBEM_MOF_H
+#  define LMIWBEM_MOF_H
+
+#  include <list>
+#  include <string>
+#  include <vector>
+#  include <Pegasus/Common/CIMClass.h>
+#  include <Pegasus/Common/CIMInstance.h>
+#  include <Pegasus/Common/CIMMethod.h>
+#  include <Pegasus/Common/CIMProperty.h>
+#  include <Pegasus/Common/CIMQualifier.h>
+#  include <Pegasus/Common/CIMObjectPath.h>
+#  include <Pegasus/Common/CIMValue.h>
+#  include "lmiwbem.h"
+
+// Renders MOF directly from Pegasus objects into a single growing buffer.
+// The output is the same as produced by CIMInstance.tomof() for objects
+// converted to Python; values are formatted as their Python counterparts.
+//
+// Hostname is set to all the reference values of instance properties, in the
+// same way as CIMInstance does, when it evaluates its properties.
+class MOFWriter
+{
+public:
+    MOFWriter(
+        std::string &buffer,
+        const Pegasus::String &hostname = Pegasus::String());
+
+    void putInstance(const Pegasus::CIMConstInstance &instance);
+    void putInstance(
+        const Pegasus::CIMName &classname,
+        const std::list<Pegasus::CIMConstProperty> &properties);
+    void putClass(const Pegasus::CIMConstClass &cls);
+    void putValue(const Pegasus::CIMValue &value);
+
+    static void putReal(std::string &buffer, double value);
+
+private:
+    void putInstanceCore(
+        const Pegasus::CIMName &classname,
+        std::vector<Pegasus::CIMConstProperty> &properties);
+    void putQualifiers(
+        const std::vector<Pegasus::CIMConstQualifier> &qualifiers,
+        const char *indent);
+    void putQualifier(const Pegasus::CIMConstQualifier &qualifier);
+    void putProperty(const Pegasus::CIMConstProperty &property);
+    void putMethod(const Pegasus::CIMConstMethod &method);
+
+    template <typename T>
+    void putValueCore(const Pegasus::CIMValue &value);
+
+    void putRaw(const Pegasus::Boolean &value);
+    void putRaw(const Pegasus::Uint8 &value);
+    void putRaw(const Pegasus::Sint8 &value);
+    void putRaw(const Pegasus::Uint16 &value);
+    void putRaw(const Pegasus::Sint16 &value);
+    void putRaw(const Pegasus::Uint32 &value);
+    void putRaw(const Pegasus::Sint32 &value);
+    void putRaw(const Pegasus::Uint64 &value);
+    void putRaw(const Pegasus::Sint64 &value);
+    void putRaw(const Pegasus::Real32 &value);
+    void putRaw(const Pegasus::Real64 &value);
+    void putRaw(const Pegasus::Char16 &value);
+    void putRaw(const Pegasus::String &value);
+    void putRaw(const Pegasus::CIMDateTime &value);
+    void putRaw(const Pegasus::CIMObjectPath &value);
+    void putRaw(const Pegasus::CIMObject &value);
+    void putRaw(const Pegasus::CIMInstance &value);
+
+    void putKeyBindingRepr(
+        const Pegasus::CIMKeyBinding &keybinding,
+        const Pegasus::String &hostname);
+    void putInstanceNameRepr(
+        const Pegasus::CIMObjectPath &path,
+        const Pegasus::String &hostname = Pegasus::String());
+
+    std::string &m_buffer;
+    Pegasus::String m_hostname;
+    bool m_in_instance;
+};
+
+#endif // LMIWBEM_MOF_H
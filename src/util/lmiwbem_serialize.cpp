@@ -0,0 +1,985 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include <config.h>
+#include <cstring>
+#include <Pegasus/Common/Array.h>
+#include <Pegasus/Common/CIMDateTime.h>
+#include <Pegasus/Common/CIMFlavor.h>
+#include <Pegasus/Common/CIMName.h>
+#include <Pegasus/Common/Char16.h>
+#include "lmiwbem_exception.h"
+#include "util/lmiwbem_serialize.h"
+
+namespace {
+
+const Pegasus::Uint8 SERIALIZE_MAGIC   = 0x4c; // 'L'
+const Pegasus::Uint8 SERIALIZE_VERSION = 1;
+
+// Flags stored along with every CIMValue.
+const Pegasus::Uint8 VALUE_IS_ARRAY = 0x01;
+const Pegasus::Uint8 VALUE_IS_NULL  = 0x02;
+
+// Flavors, which are preserved. Same set as CIMQualifier handles.
+const Pegasus::Uint8 FLAVOR_OVERRIDABLE  = 0x01;
+const Pegasus::Uint8 FLAVOR_TOSUBCLASS   = 0x02;
+const Pegasus::Uint8 FLAVOR_TOINSTANCE   = 0x04;
+const Pegasus::Uint8 FLAVOR_TRANSLATABLE = 0x08;
+
+// -----------------------------------------------------------------------------
+// Raw value encoders
+// -----------------------------------------------------------------------------
+
+template <typename T>
+void putRaw(Serializer &s, const T &value);
+
+template <>
+void putRaw<Pegasus::Boolean>(Serializer &s, const Pegasus::Boolean &value)
+{
+    s.putBool(value);
+}
+
+template <>
+void putRaw<Pegasus::Uint8>(Serializer &s, const Pegasus::Uint8 &value)
+{
+    s.putUint8(value);
+}
+
+template <>
+void putRaw<Pegasus::Sint8>(Serializer &s, const Pegasus::Sint8 &value)
+{
+    s.putUint8(static_cast<Pegasus::Uint8>(value));
+}
+
+template <>
+void putRaw<Pegasus::Uint16>(Serializer &s, const Pegasus::Uint16 &value)
+{
+    s.putUint16(value);
+}
+
+template <>
+void putRaw<Pegasus::Sint16>(Serializer &s, const Pegasus::Sint16 &value)
+{
+    s.putUint16(static_cast<Pegasus::Uint16>(value));
+}
+
+template <>
+void putRaw<Pegasus::Uint32>(Serializer &s, const Pegasus::Uint32 &value)
+{
+    s.putUint32(value);
+}
+
+template <>
+void putRaw<Pegasus::Sint32>(Serializer &s, const Pegasus::Sint32 &value)
+{
+    s.putUint32(static_cast<Pegasus::Uint32>(value));
+}
+
+template <>
+void putRaw<Pegasus::Uint64>(Serializer &s, const Pegasus::Uint64 &value)
+{
+    s.putUint64(value);
+}
+
+template <>
+void putRaw<Pegasus::Sint64>(Serializer &s, const Pegasus::Sint64 &value)
+{
+    s.putUint64(static_cast<Pegasus::Uint64>(value));
+}
+
+template <>
+void putRaw<Pegasus::Real32>(Serializer &s, const Pegasus::Real32 &value)
+{
+    Pegasus::Uint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    s.putUint32(bits);
+}
+
+template <>
+void putRaw<Pegasus::Real64>(Serializer &s, const Pegasus::Real64 &value)
+{
+    Pegasus::Uint64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    s.putUint64(bits);
+}
+
+template <>
+void putRaw<Pegasus::Char16>(Serializer &s, const Pegasus::Char16 &value)
+{
+    s.putUint16(static_cast<Pegasus::Uint16>(value));
+}
+
+template <>
+void putRaw<Pegasus::String>(Serializer &s, const Pegasus::String &value)
+{
+    s.putString(value);
+}
+
+template <>
+void putRaw<Pegasus::CIMDateTime>(Serializer &s, const Pegasus::CIMDateTime &value)
+{
+    s.putString(value.toString());
+}
+
+template <>
+void putRaw<Pegasus::CIMObjectPath>(Serializer &s, const Pegasus::CIMObjectPath &value)
+{
+    s.putCIMObjectPath(value);
+}
+
+template <>
+void putRaw<Pegasus::CIMObject>(Serializer &s, const Pegasus::CIMObject &value)
+{
+    s.putBool(value.isClass());
+    if (value.isClass())
+        s.putCIMClass(Pegasus::CIMConstClass(value));
+    else
+        s.putCIMInstance(Pegasus::CIMConstInstance(value));
+}
+
+template <>
+void putRaw<Pegasus::CIMInstance>(Serializer &s, const Pegasus::CIMInstance &value)
+{
+    s.putCIMInstance(value);
+}
+
+template <typename T>
+void putValue(Serializer &s, const Pegasus::CIMValue &value)
+{
+    if (value.isArray()) {
+        Pegasus::Array<T> raw_array;
+        value.get(raw_array);
+        const Pegasus::Uint32 cnt = raw_array.size();
+        s.putSize(cnt);
+        for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+            putRaw<T>(s, raw_array[i]);
+    } else {
+        T raw_value;
+        value.get(raw_value);
+        putRaw<T>(s, raw_value);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Raw value decoders
+// -----------------------------------------------------------------------------
+
+template <typename T>
+T getRaw(Deserializer &d);
+
+template <>
+Pegasus::Boolean getRaw<Pegasus::Boolean>(Deserializer &d)
+{
+    return d.getBool();
+}
+
+template <>
+Pegasus::Uint8 getRaw<Pegasus::Uint8>(Deserializer &d)
+{
+    return d.getUint8();
+}
+
+template <>
+Pegasus::Sint8 getRaw<Pegasus::Sint8>(Deserializer &d)
+{
+    return static_cast<Pegasus::Sint8>(d.getUint8());
+}
+
+template <>
+Pegasus::Uint16 getRaw<Pegasus::Uint16>(Deserializer &d)
+{
+    return d.getUint16();
+}
+
+template <>
+Pegasus::Sint16 getRaw<Pegasus::Sint16>(Deserializer &d)
+{
+    return static_cast<Pegasus::Sint16>(d.getUint16());
+}
+
+template <>
+Pegasus::Uint32 getRaw<Pegasus::Uint32>(Deserializer &d)
+{
+    return d.getUint32();
+}
+
+template <>
+Pegasus::Sint32 getRaw<Pegasus::Sint32>(Deserializer &d)
+{
+    return static_cast<Pegasus::Sint32>(d.getUint32());
+}
+
+template <>
+Pegasus::Uint64 getRaw<Pegasus::Uint64>(Deserializer &d)
+{
+    return d.getUint64();
+}
+
+template <>
+Pegasus::Sint64 getRaw<Pegasus::Sint64>(Deserializer &d)
+{
+    return static_cast<Pegasus::Sint64>(d.getUint64());
+}
+
+template <>
+Pegasus::Real32 getRaw<Pegasus::Real32>(Deserializer &d)
+{
+    Pegasus::Uint32 bits = d.getUint32();
+    Pegasus::Real32 value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+template <>
+Pegasus::Real64 getRaw<Pegasus::Real64>(Deserializer &d)
+{
+    Pegasus::Uint64 bits = d.getUint64();
+    Pegasus::Real64 value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+template <>
+Pegasus::Char16 getRaw<Pegasus::Char16>(Deserializer &d)
+{
+    return Pegasus::Char16(d.getUint16());
+}
+
+template <>
+Pegasus::String getRaw<Pegasus::String>(Deserializer &d)
+{
+    return d.getString();
+}
+
+template <>
+Pegasus::CIMDateTime getRaw<Pegasus::CIMDateTime>(Deserializer &d)
+{
+    return Pegasus::CIMDateTime(d.getString());
+}
+
+template <>
+Pegasus::CIMObjectPath getRaw<Pegasus::CIMObjectPath>(Deserializer &d)
+{
+    return d.getCIMObjectPath();
+}
+
+template <>
+Pegasus::CIMObject getRaw<Pegasus::CIMObject>(Deserializer &d)
+{
+    if (d.getBool())
+        return Pegasus::CIMObject(d.getCIMClass());
+    return Pegasus::CIMObject(d.getCIMInstance());
+}
+
+template <>
+Pegasus::CIMInstance getRaw<Pegasus::CIMInstance>(Deserializer &d)
+{
+    return d.getCIMInstance();
+}
+
+// Smallest serialized size of a raw value; bounds element counts read from
+// the data before any memory is reserved for them.
+template <typename T>
+size_t minRawSize()
+{
+    return sizeof(T);
+}
+
+template <>
+size_t minRawSize<Pegasus::String>()
+{
+    return 1;
+}
+
+template <>
+size_t minRawSize<Pegasus::CIMDateTime>()
+{
+    return 1;
+}
+
+template <>
+size_t minRawSize<Pegasus::CIMObjectPath>()
+{
+    // Host, namespace, class name and key binding count.
+    return 4;
+}
+
+template <>
+size_t minRawSize<Pegasus::CIMObject>()
+{
+    return 1;
+}
+
+template <>
+size_t minRawSize<Pegasus::CIMInstance>()
+{
+    return 1;
+}
+
+template <typename T>
+Pegasus::CIMValue getValue(Deserializer &d, bool is_array)
+{
+    if (!is_array)
+        return Pegasus::CIMValue(getRaw<T>(d));
+
+    const Pegasus::Uint32 cnt = d.getCount(minRawSize<T>());
+    Pegasus::Array<T> raw_array;
+    raw_array.reserveCapacity(cnt);
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        raw_array.append(getRaw<T>(d));
+    return Pegasus::CIMValue(raw_array);
+}
+
+} // unnamed namespace
+
+// -----------------------------------------------------------------------------
+// SerializerStringTable
+// -----------------------------------------------------------------------------
+
+SerializerStringTable::SerializerStringTable()
+    : m_index()
+    , m_strings()
+{
+}
+
+Pegasus::Uint32 SerializerStringTable::add(const std::string &str)
+{
+    std::map<std::string, Pegasus::Uint32>::const_iterator found =
+        m_index.find(str);
+    if (found != m_index.end())
+        return found->second;
+
+    Pegasus::Uint32 index = static_cast<Pegasus::Uint32>(m_strings.size());
+    m_index[str] = index;
+    m_strings.push_back(str);
+    return index;
+}
+
+// -----------------------------------------------------------------------------
+// Serializer
+// -----------------------------------------------------------------------------
+
+Serializer::Serializer(SerializerStringTable *string_table)
+    : m_data()
+    , m_string_table(string_table)
+{
+}
+
+void Serializer::putHeader(Pegasus::Uint8 kind)
+{
+    putUint8(SERIALIZE_MAGIC);
+    putUint8(SERIALIZE_VERSION);
+    putUint8(kind);
+}
+
+void Serializer::putUint8(Pegasus::Uint8 value)
+{
+    m_data.push_back(static_cast<char>(value));
+}
+
+void Serializer::putUint16(Pegasus::Uint16 value)
+{
+    putUint8(static_cast<Pegasus::Uint8>(value & 0xff));
+    putUint8(static_cast<Pegasus::Uint8>(value >> 8));
+}
+
+void Serializer::putUint32(Pegasus::Uint32 value)
+{
+    putUint16(static_cast<Pegasus::Uint16>(value & 0xffff));
+    putUint16(static_cast<Pegasus::Uint16>(value >> 16));
+}
+
+void Serializer::putUint64(Pegasus::Uint64 value)
+{
+    putUint32(static_cast<Pegasus::Uint32>(value & 0xffffffff));
+    putUint32(static_cast<Pegasus::Uint32>(value >> 32));
+}
+
+void Serializer::putSize(Pegasus::Uint32 size)
+{
+    // Sizes are usually small; store them as variable-length integers
+    // (7 bits per byte, most significant bit set, if more bytes follow).
+    while (size >= 0x80) {
+        putUint8(static_cast<Pegasus::Uint8>((size & 0x7f) | 0x80));
+        size >>= 7;
+    }
+    putUint8(static_cast<Pegasus::Uint8>(size));
+}
+
+void Serializer::putBool(bool value)
+{
+    putUint8(value ? 1 : 0);
+}
+
+void Serializer::putString(const std::string &value)
+{
+    putSize(static_cast<Pegasus::Uint32>(value.size()));
+    m_data.append(value);
+}
+
+void Serializer::putString(const Pegasus::String &value)
+{
+    putString(std::string(static_cast<const char*>(value.getCString())));
+}
+
+void Serializer::putIdentifier(const Pegasus::String &value)
+{
+    if (!m_string_table) {
+        putString(value);
+        return;
+    }
+
+    putSize(m_string_table->add(
+        std::string(static_cast<const char*>(value.getCString()))));
+}
+
+void Serializer::putCIMName(const Pegasus::CIMName &name)
+{
+    putIdentifier(name.getString());
+}
+
+void Serializer::putCIMValue(const Pegasus::CIMValue &value)
+{
+    putUint8(static_cast<Pegasus::Uint8>(value.getType()));
+    putCIMValuePayload(value);
+}
+
+void Serializer::putCIMValuePayload(const Pegasus::CIMValue &value)
+{
+    Pegasus::Uint8 flags = 0;
+    if (value.isArray())
+        flags |= VALUE_IS_ARRAY;
+    if (value.isNull())
+        flags |= VALUE_IS_NULL;
+
+    putUint8(flags);
+
+    if (value.isNull())
+        return;
+
+    switch (value.getType()) {
+    case Pegasus::CIMTYPE_BOOLEAN:
+        putValue<Pegasus::Boolean>(*this, value);
+        break;
+    case Pegasus::CIMTYPE_UINT8:
+        putValue<Pegasus::Uint8>(*this, value);
+        break;
+    case Pegasus::CIMTYPE_SINT8:
+        putValue<Pegasus::Sint8>(*this, value);
+        break;
+    case Pegasus::CIMTYPE_UINT16:
+        putValue<Pegasus::Uint16>(*this, value);
+        break;
+    case Pegasus::CIMTYPE_SINT16:
+        putValue<Pegasus::Sint16>(*this, value);
+        break;
+    case Pegasus::CIMTYPE_UINT32:
+        putValue<Pegasus::Uint32>(*this, value);
+        break;
+    case Pegasus::CIMTYPE_SINT32:
+        putValue<Pegasus::Sint32>(*this, value);
+        break;
+    case Pegasus::CIMTYPE_UINT64:
+        putValue<Pegasus::Uint64>(*this, value);
+        break;
+    case Pegasus::CIMTYPE_SINT64:
+        putValue<Pegasus::Sint64>(*this, value);
+        break;
+    case Pegasus::CIMTYPE_REAL32:
+        putValue<Pegasus::Real32>(*this, value);
+        break;
+    case Pegasus::CIMTYPE_REAL64:
+        putValue<Pegasus::Real64>(*this, value);
+        break;
+    case Pegasus::CIMTYPE_CHAR16:
+        putValue<Pegasus::Char16>(*this, value);
+        break;
+    case Pegasus::CIMTYPE_STRING:
+        putValue<Pegasus::String>(*this, value);
+        break;
+    case Pegasus::CIMTYPE_DATETIME:
+        putValue<Pegasus::CIMDateTime>(*this, value);
+        break;
+    case Pegasus::CIMTYPE_REFERENCE:
+        putValue<Pegasus::CIMObjectPath>(*this, value);
+        break;
+    case Pegasus::CIMTYPE_OBJECT:
+        putValue<Pegasus::CIMObject>(*this, value);
+        break;
+    case Pegasus::CIMTYPE_INSTANCE:
+        putValue<Pegasus::CIMInstance>(*this, value);
+        break;
+    default:
+        throw Exception("Serializer: Unknown CIM type value passed");
+    }
+}
+
+void Serializer::putCIMObjectPath(const Pegasus::CIMObjectPath &path)
+{
+    putIdentifier(path.getHost());
+    putIdentifier(path.getNameSpace().getString());
+    putCIMName(path.getClassName());
+
+    const Pegasus::Array<Pegasus::CIMKeyBinding> &keybindings = path.getKeyBindings();
+    const Pegasus::Uint32 cnt = keybindings.size();
+    putSize(cnt);
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+        putCIMName(keybindings[i].getName());
+        putUint8(static_cast<Pegasus::Uint8>(keybindings[i].getType()));
+        putString(keybindings[i].getValue());
+    }
+}
+
+void Serializer::putCIMQualifier(const Pegasus::CIMConstQualifier &qualifier)
+{
+    const Pegasus::CIMFlavor &flavor = qualifier.getFlavor();
+    Pegasus::Uint8 flavor_bits = 0;
+    if (flavor.hasFlavor(Pegasus::CIMFlavor::OVERRIDABLE))
+        flavor_bits |= FLAVOR_OVERRIDABLE;
+    if (flavor.hasFlavor(Pegasus::CIMFlavor::TOSUBCLASS))
+        flavor_bits |= FLAVOR_TOSUBCLASS;
+    if (flavor.hasFlavor(Pegasus::CIMFlavor::TOINSTANCE))
+        flavor_bits |= FLAVOR_TOINSTANCE;
+    if (flavor.hasFlavor(Pegasus::CIMFlavor::TRANSLATABLE))
+        flavor_bits |= FLAVOR_TRANSLATABLE;
+
+    putCIMName(qualifier.getName());
+    putCIMValue(qualifier.getValue());
+    putUint8(flavor_bits);
+    putBool(qualifier.getPropagated());
+}
+
+void Serializer::putCIMProperty(const Pegasus::CIMConstProperty &property)
+{
+    putCIMName(property.getName());
+    putCIMValue(property.getValue());
+    putSize(property.getArraySize());
+    putCIMName(property.getReferenceClassName());
+    putCIMName(property.getClassOrigin());
+    putBool(property.getPropagated());
+
+    const Pegasus::Uint32 cnt = property.getQualifierCount();
+    putSize(cnt);
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        putCIMQualifier(property.getQualifier(i));
+}
+
+void Serializer::putCIMParameter(const Pegasus::CIMConstParameter &parameter)
+{
+    putCIMName(parameter.getName());
+    putUint8(static_cast<Pegasus::Uint8>(parameter.getType()));
+    putBool(parameter.isArray());
+    putSize(parameter.getArraySize());
+    putCIMName(parameter.getReferenceClassName());
+
+    const Pegasus::Uint32 cnt = parameter.getQualifierCount();
+    putSize(cnt);
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        putCIMQualifier(parameter.getQualifier(i));
+}
+
+void Serializer::putCIMMethod(const Pegasus::CIMConstMethod &method)
+{
+    putCIMName(method.getName());
+    putUint8(static_cast<Pegasus::Uint8>(method.getType()));
+    putCIMName(method.getClassOrigin());
+    putBool(method.getPropagated());
+
+    Pegasus::Uint32 cnt = method.getParameterCount();
+    putSize(cnt);
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        putCIMParameter(method.getParameter(i));
+
+    cnt = method.getQualifierCount();
+    putSize(cnt);
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        putCIMQualifier(method.getQualifier(i));
+}
+
+void Serializer::putCIMInstance(const Pegasus::CIMConstInstance &instance)
+{
+    putCIMName(instance.getClassName());
+    putCIMObjectPath(instance.getPath());
+
+    Pegasus::Uint32 cnt = instance.getQualifierCount();
+    putSize(cnt);
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        putCIMQualifier(instance.getQualifier(i));
+
+    cnt = instance.getPropertyCount();
+    putSize(cnt);
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        putCIMProperty(instance.getProperty(i));
+}
+
+void Serializer::putCIMClass(const Pegasus::CIMConstClass &cls)
+{
+    putCIMName(cls.getClassName());
+    putCIMName(cls.getSuperClassName());
+
+    Pegasus::Uint32 cnt = cls.getQualifierCount();
+    putSize(cnt);
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        putCIMQualifier(cls.getQualifier(i));
+
+    cnt = cls.getPropertyCount();
+    putSize(cnt);
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        putCIMProperty(cls.getProperty(i));
+
+    cnt = cls.getMethodCount();
+    putSize(cnt);
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        putCIMMethod(cls.getMethod(i));
+}
+
+// -----------------------------------------------------------------------------
+// Deserializer
+// -----------------------------------------------------------------------------
+
+Deserializer::Deserializer(
+    const char *data,
+    size_t size,
+    const std::vector<Pegasus::String> *string_table)
+    : m_data(data)
+    , m_size(size)
+    , m_pos(0)
+    , m_string_table(string_table)
+{
+}
+
+Deserializer::Deserializer(const std::string &data)
+    : m_data(data.data())
+    , m_size(data.size())
+    , m_pos(0)
+    , m_string_table(NULL)
+{
+}
+
+const char *Deserializer::need(size_t size)
+{
+    if (m_size - m_pos < size)
+        throw Exception("Deserializer: Truncated data");
+
+    const char *ptr = m_data + m_pos;
+    m_pos += size;
+    return ptr;
+}
+
+Pegasus::Uint8 Deserializer::getHeader()
+{
+    if (getUint8() != SERIALIZE_MAGIC)
+        throw Exception("Deserializer: Invalid data");
+    if (getUint8() != SERIALIZE_VERSION)
+        throw Exception("Deserializer: Unsupported data version");
+    return getUint8();
+}
+
+Pegasus::Uint8 Deserializer::getUint8()
+{
+    return static_cast<Pegasus::Uint8>(*need(1));
+}
+
+Pegasus::Uint16 Deserializer::getUint16()
+{
+    Pegasus::Uint16 lo = getUint8();
+    Pegasus::Uint16 hi = getUint8();
+    return static_cast<Pegasus::Uint16>(lo | (hi << 8));
+}
+
+Pegasus::Uint32 Deserializer::getUint32()
+{
+    Pegasus::Uint32 lo = getUint16();
+    Pegasus::Uint32 hi = getUint16();
+    return lo | (hi << 16);
+}
+
+Pegasus::Uint64 Deserializer::getUint64()
+{
+    Pegasus::Uint64 lo = getUint32();
+    Pegasus::Uint64 hi = getUint32();
+    return lo | (hi << 32);
+}
+
+Pegasus::Uint32 Deserializer::getSize()
+{
+    Pegasus::Uint32 size = 0;
+    for (unsigned int shift = 0; shift < 35; shift += 7) {
+        Pegasus::Uint8 byte = getUint8();
+        size |= static_cast<Pegasus::Uint32>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return size;
+    }
+
+    throw Exception("Deserializer: Invalid size");
+    return 0;
+}
+
+Pegasus::Uint32 Deserializer::getCount(size_t min_size)
+{
+    const Pegasus::Uint32 cnt = getSize();
+    if (cnt > remaining() / min_size)
+        throw Exception("Deserializer: Invalid element count");
+    return cnt;
+}
+
+bool Deserializer::getBool()
+{
+    return getUint8() != 0;
+}
+
+std::string Deserializer::getStdString()
+{
+    const Pegasus::Uint32 size = getSize();
+    return std::string(need(size), size);
+}
+
+Pegasus::String Deserializer::getString()
+{
+    const Pegasus::Uint32 size = getSize();
+    return Pegasus::String(need(size), size);
+}
+
+Pegasus::String Deserializer::getIdentifier()
+{
+    if (!m_string_table)
+        return getString();
+
+    const Pegasus::Uint32 index = getSize();
+    if (index >= m_string_table->size())
+        throw Exception("Deserializer: Invalid string table index");
+    return (*m_string_table)[index];
+}
+
+Pegasus::CIMName Deserializer::getCIMName()
+{
+    Pegasus::String name(getIdentifier());
+    if (name.size() == 0)
+        return Pegasus::CIMName();
+    return Pegasus::CIMName(name);
+}
+
+Pegasus::CIMValue Deserializer::getCIMValue()
+{
+    return getCIMValuePayload(static_cast<Pegasus::CIMType>(getUint8()));
+}
+
+Pegasus::CIMValue Deserializer::getCIMValuePayload(Pegasus::CIMType type)
+{
+    Pegasus::Uint8 flags = getUint8();
+    bool is_array = flags & VALUE_IS_ARRAY;
+
+    if (flags & VALUE_IS_NULL)
+        return Pegasus::CIMValue(type, is_array);
+
+    switch (type) {
+    case Pegasus::CIMTYPE_BOOLEAN:
+        return getValue<Pegasus::Boolean>(*this, is_array);
+    case Pegasus::CIMTYPE_UINT8:
+        return getValue<Pegasus::Uint8>(*this, is_array);
+    case Pegasus::CIMTYPE_SINT8:
+        return getValue<Pegasus::Sint8>(*this, is_array);
+    case Pegasus::CIMTYPE_UINT16:
+        return getValue<Pegasus::Uint16>(*this, is_array);
+    case Pegasus::CIMTYPE_SINT16:
+        return getValue<Pegasus::Sint16>(*this, is_array);
+    case Pegasus::CIMTYPE_UINT32:
+        return getValue<Pegasus::Uint32>(*this, is_array);
+    case Pegasus::CIMTYPE_SINT32:
+        return getValue<Pegasus::Sint32>(*this, is_array);
+    case Pegasus::CIMTYPE_UINT64:
+        return getValue<Pegasus::Uint64>(*this, is_array);
+    case Pegasus::CIMTYPE_SINT64:
+        return getValue<Pegasus::Sint64>(*this, is_array);
+    case Pegasus::CIMTYPE_REAL32:
+        return getValue<Pegasus::Real32>(*this, is_array);
+    case Pegasus::CIMTYPE_REAL64:
+        return getValue<Pegasus::Real64>(*this, is_array);
+    case Pegasus::CIMTYPE_CHAR16:
+        return getValue<Pegasus::Char16>(*this, is_array);
+    case Pegasus::CIMTYPE_STRING:
+        return getValue<Pegasus::String>(*this, is_array);
+    case Pegasus::CIMTYPE_DATETIME:
+        return getValue<Pegasus::CIMDateTime>(*this, is_array);
+    case Pegasus::CIMTYPE_REFERENCE:
+        return getValue<Pegasus::CIMObjectPath>(*this, is_array);
+    case Pegasus::CIMTYPE_OBJECT:
+        return getValue<Pegasus::CIMObject>(*this, is_array);
+    case Pegasus::CIMTYPE_INSTANCE:
+        return getValue<Pegasus::CIMInstance>(*this, is_array);
+    default:
+        throw Exception("Deserializer: Unknown CIM type value");
+    }
+
+    return Pegasus::CIMValue();
+}
+
+Pegasus::CIMObjectPath Deserializer::getCIMObjectPath()
+{
+    Pegasus::String host(getIdentifier());
+    Pegasus::String ns(getIdentifier());
+    Pegasus::CIMName classname(getCIMName());
+
+    // Name, type and value of each key binding.
+    const Pegasus::Uint32 cnt = getCount(3);
+    Pegasus::Array<Pegasus::CIMKeyBinding> keybindings;
+    keybindings.reserveCapacity(cnt);
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+        Pegasus::CIMName name(getCIMName());
+        Pegasus::CIMKeyBinding::Type type =
+            static_cast<Pegasus::CIMKeyBinding::Type>(getUint8());
+        keybindings.append(Pegasus::CIMKeyBinding(name, getString(), type));
+    }
+
+    return Pegasus::CIMObjectPath(
+        host,
+        ns.size() ? Pegasus::CIMNamespaceName(ns) : Pegasus::CIMNamespaceName(),
+        classname,
+        keybindings);
+}
+
+Pegasus::CIMQualifier Deserializer::getCIMQualifier()
+{
+    Pegasus::CIMName name(getCIMName());
+    Pegasus::CIMValue value(getCIMValue());
+    Pegasus::Uint8 flavor_bits = getUint8();
+    bool propagated = getBool();
+
+    Pegasus::CIMFlavor flavor;
+    if (flavor_bits & FLAVOR_OVERRIDABLE)
+        flavor.addFlavor(Pegasus::CIMFlavor::OVERRIDABLE);
+    if (flavor_bits & FLAVOR_TOSUBCLASS)
+        flavor.addFlavor(Pegasus::CIMFlavor::TOSUBCLASS);
+    if (flavor_bits & FLAVOR_TOINSTANCE)
+        flavor.addFlavor(Pegasus::CIMFlavor::TOINSTANCE);
+    if (flavor_bits & FLAVOR_TRANSLATABLE)
+        flavor.addFlavor(Pegasus::CIMFlavor::TRANSLATABLE);
+
+    return Pegasus::CIMQualifier(name, value, flavor, propagated);
+}
+
+Pegasus::CIMProperty Deserializer::getCIMProperty()
+{
+    Pegasus::CIMName name(getCIMName());
+    Pegasus::CIMValue value(getCIMValue());
+    Pegasus::Uint32 array_size = getSize();
+    Pegasus::CIMName reference_class(getCIMName());
+    Pegasus::CIMName class_origin(getCIMName());
+    bool propagated = getBool();
+
+    Pegasus::CIMProperty property(
+        name,
+        value,
+        array_size,
+        reference_class,
+        class_origin,
+        propagated);
+
+    const Pegasus::Uint32 cnt = getSize();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        property.addQualifier(getCIMQualifier());
+
+    return property;
+}
+
+Pegasus::CIMParameter Deserializer::getCIMParameter()
+{
+    Pegasus::CIMName name(getCIMName());
+    Pegasus::CIMType type = static_cast<Pegasus::CIMType>(getUint8());
+    bool is_array = getBool();
+    Pegasus::Uint32 array_size = getSize();
+    Pegasus::CIMName reference_class(getCIMName());
+
+    Pegasus::CIMParameter parameter(
+        name,
+        type,
+        is_array,
+        array_size,
+        reference_class);
+
+    const Pegasus::Uint32 cnt = getSize();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        parameter.addQualifier(getCIMQualifier());
+
+    return parameter;
+}
+
+Pegasus::CIMMethod Deserializer::getCIMMethod()
+{
+    Pegasus::CIMName name(getCIMName());
+    Pegasus::CIMType type = static_cast<Pegasus::CIMType>(getUint8());
+    Pegasus::CIMName class_origin(getCIMName());
+    bool propagated = getBool();
+
+    Pegasus::CIMMethod method(name, type, class_origin, propagated);
+
+    Pegasus::Uint32 cnt = getSize();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        method.addParameter(getCIMParameter());
+
+    cnt = getSize();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        method.addQualifier(getCIMQualifier());
+
+    return method;
+}
+
+Pegasus::CIMInstance Deserializer::getCIMInstance()
+{
+    Pegasus::CIMName classname(getCIMName());
+    Pegasus::CIMObjectPath path(getCIMObjectPath());
+
+    Pegasus::CIMInstance instance(classname);
+    instance.setPath(path);
+
+    Pegasus::Uint32 cnt = getSize();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        instance.addQualifier(getCIMQualifier());
+
+    cnt = getSize();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        instance.addProperty(getCIMProperty());
+
+    return instance;
+}
+
+Pegasus::CIMClass Deserializer::getCIMClass()
+{
+    Pegasus::CIMName classname(getCIMName());
+    Pegasus::CIMName super_classname(getCIMName());
+
+    Pegasus::CIMClass cls(classname, super_classname);
+
+    Pegasus::Uint32 cnt = getSize();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        cls.addQualifier(getCIMQualifier());
+
+    cnt = getSize();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        cls.addProperty(getCIMProperty());
+
+    cnt = getSize();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i)
+        cls.addMethod(getCIMMethod());
+
+    return cls;
+}
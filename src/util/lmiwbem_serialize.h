@@ -0,0 +1,148 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ *
+ *   Copyright (C) 2014-2015, Peter Hatina <phatina@redhat.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 2.1 of the
+ *   License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *   MA 02110-1301 USA
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef   LMIWBEM_SERIALIZE_H
+#  define LMIWBEM_SERIALIZE_H
+
+#  include <map>
+#  include <string>
+#  include <vector>
+#  include <Pegasus/Common/CIMClass.h>
+#  include <Pegasus/Common/CIMInstance.h>
+#  include <Pegasus/Common/CIMMethod.h>
+#  include <Pegasus/Common/CIMObjectPath.h>
+#  include <Pegasus/Common/CIMParameter.h>
+#  include <Pegasus/Common/CIMProperty.h>
+#  include <Pegasus/Common/CIMQualifier.h>
+#  include <Pegasus/Common/CIMValue.h>
+#  include "lmiwbem.h"
+
+// Table of identifiers (class, property, qualifier names, namespaces and
+// hostnames), which repeat a lot in enumeration results. If a table is set,
+// the Serializer stores only indices into it.
+class SerializerStringTable
+{
+public:
+    SerializerStringTable();
+
+    Pegasus::Uint32 add(const std::string &str);
+    const std::vector<std::string> &strings() const { return m_strings; }
+
+private:
+    std::map<std::string, Pegasus::Uint32> m_index;
+    std::vector<std::string> m_strings;
+};
+
+// Compact binary encoding of Pegasus CIM objects. The encoding is private to
+// lmiwbem; it is used for pickling and must not be considered stable across
+// lmiwbem versions, hence every blob starts with a version byte (see
+// Serializer::putHeader()).
+class Serializer
+{
+public:
+    enum Kind {
+        KIND_INSTANCE = 1,
+        KIND_INSTANCE_NAME,
+        KIND_CLASS
+    };
+
+    Serializer(SerializerStringTable *string_table = NULL);
+
+    void putHeader(Pegasus::Uint8 kind);
+
+    void putUint8(Pegasus::Uint8 value);
+    void putUint16(Pegasus::Uint16 value);
+    void putUint32(Pegasus::Uint32 value);
+    void putUint64(Pegasus::Uint64 value);
+    void putSize(Pegasus::Uint32 size);
+    void putBool(bool value);
+    void putString(const std::string &value);
+    void putString(const Pegasus::String &value);
+    void putCIMName(const Pegasus::CIMName &name);
+    void putCIMValue(const Pegasus::CIMValue &value);
+    void putCIMValuePayload(const Pegasus::CIMValue &value);
+    void putCIMObjectPath(const Pegasus::CIMObjectPath &path);
+    void putCIMQualifier(const Pegasus::CIMConstQualifier &qualifier);
+    void putCIMProperty(const Pegasus::CIMConstProperty &property);
+    void putCIMParameter(const Pegasus::CIMConstParameter &parameter);
+    void putCIMMethod(const Pegasus::CIMConstMethod &method);
+    void putCIMInstance(const Pegasus::CIMConstInstance &instance);
+    void putCIMClass(const Pegasus::CIMConstClass &cls);
+
+    const std::string &data() const { return m_data; }
+    void clear() { m_data.clear(); }
+
+private:
+    void putIdentifier(const Pegasus::String &value);
+
+    std::string m_data;
+    SerializerStringTable *m_string_table;
+};
+
+class Deserializer
+{
+public:
+    Deserializer(
+        const char *data,
+        size_t size,
+        const std::vector<Pegasus::String> *string_table = NULL);
+    Deserializer(const std::string &data);
+
+    Pegasus::Uint8 getHeader();
+
+    Pegasus::Uint8 getUint8();
+    Pegasus::Uint16 getUint16();
+    Pegasus::Uint32 getUint32();
+    Pegasus::Uint64 getUint64();
+    Pegasus::Uint32 getSize();
+    // Reads a count of elements, which take at least min_size bytes each;
+    // throws if the remaining data can't hold them.
+    Pegasus::Uint32 getCount(size_t min_size);
+    bool getBool();
+    std::string getStdString();
+    Pegasus::String getString();
+    Pegasus::CIMName getCIMName();
+    Pegasus::CIMValue getCIMValue();
+    Pegasus::CIMValue getCIMValuePayload(Pegasus::CIMType type);
+    Pegasus::CIMObjectPath getCIMObjectPath();
+    Pegasus::CIMQualifier getCIMQualifier();
+    Pegasus::CIMProperty getCIMProperty();
+    Pegasus::CIMParameter getCIMParameter();
+    Pegasus::CIMMethod getCIMMethod();
+    Pegasus::CIMInstance getCIMInstance();
+    Pegasus::CIMClass getCIMClass();
+
+    bool atEnd() const { return m_pos == m_size; }
+    size_t pos() const { return m_pos; }
+    size_t remaining() const { return m_size - m_pos; }
+
+private:
+    const char *need(size_t size);
+    Pegasus::String getIdentifier();
+
+    const char *m_data;
+    size_t m_size;
+    size_t m_pos;
+    const std::vector<Pegasus::String> *m_string_table;
+};
+
+#endif // LMIWBEM_SERIALIZE_H
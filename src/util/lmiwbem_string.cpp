@@ -59,7 +59,7 @@ std::string String::asStdString() const
 
 Pegasus::String String::asPegasusString() const
 {
-    return Pegasus::String(c_str());
+    return Pegasus::String(data(), static_cast<Pegasus::Uint32>(size()));
 }
 
 String::operator Pegasus::String() const
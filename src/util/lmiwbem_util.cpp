@@ -22,12 +22,22 @@
 #include <config.h>
 #include <algorithm>
 #include <cstring>
+#include <sstream>
+#include <utility>
+#include <vector>
 #include <boost/python/borrowed.hpp>
+#include <boost/python/dict.hpp>
 #include <boost/python/handle.hpp>
 #include <boost/python/list.hpp>
 #include <boost/python/object.hpp>
 #include <boost/python/str.hpp>
+#include <Pegasus/Common/CIMObjectPath.h>
 #include "lmiwbem.h"
+#include "lmiwbem_exception.h"
+#include "lmiwbem_gil.h"
+#include "lmiwbem_resolver.h"
+#include "lmiwbem_urlinfo.h"
+#include "obj/lmiwbem_class_hierarchy.h"
 #include "obj/lmiwbem_connection.h"
 #include "obj/cim/lmiwbem_class.h"
 #include "obj/cim/lmiwbem_constants.h"
@@ -146,9 +156,7 @@ bool cim_issubclass(
     String c_subclass;
     String c_subsuperclass;
     String c_lsubclass;
-    String c_lsuperclass(c_superclass);
-    std::transform(c_lsuperclass.begin(), c_lsuperclass.end(),
-        c_lsuperclass.begin(), ::tolower);
+    String c_lsuperclass(lower(c_superclass));
 
     if (isinstance(subclass, CIMClass::type())) {
         const CIMClass &cim_subclass = CIMClass::asNative(subclass);
@@ -158,11 +166,27 @@ bool cim_issubclass(
         c_subclass = StringConv::asString(subclass, "subclass");
     }
 
+    // Answer from the local index, if the connection has one for the
+    // namespace and it knows the subclass.
+    bp::object py_hierarchy = c_conn.getClassHierarchy();
+    if (!isnone(py_hierarchy)) {
+        ClassHierarchy &hierarchy = ClassHierarchy::asNative(py_hierarchy);
+        if (lower(c_ns) == lower(hierarchy.getNamespace())) {
+            switch (hierarchy.isSubclass(c_superclass, c_subclass)) {
+            case ClassHierarchy::SUBCLASS_YES:
+                return true;
+            case ClassHierarchy::SUBCLASS_NO:
+                return false;
+            default:
+                // Not enough classes indexed; ask the CIMOM.
+                break;
+            }
+        }
+    }
+
     while (1) {
         // Matching is case insensitive.
-        c_lsubclass = c_subclass;
-        std::transform(c_lsubclass.begin(), c_lsubclass.end(),
-            c_lsubclass.begin(), ::tolower);
+        c_lsubclass = lower(c_subclass);
 
         if (c_lsubclass == c_lsuperclass) {
             // Do subclass and superclass match?
@@ -188,6 +212,69 @@ bool cim_issubclass(
     return false;
 }
 
+bp::object resolve_hosts(const bp::object &hosts, const bp::object &workers)
+{
+    bp::list py_hosts(Conv::get<bp::list>(hosts, "hosts"));
+    const unsigned int c_workers = Conv::as<unsigned int>(workers, "workers");
+    if (c_workers == 0)
+        throw_ValueError("workers must be positive");
+
+    // Hosts can be given also as URLs.
+    std::vector<String> hostnames;
+    const int cnt = bp::len(py_hosts);
+    for (int i = 0; i < cnt; ++i) {
+        String host(StringConv::asString(py_hosts[i], "hosts[i]"));
+        if (host.find("://") != String::npos)
+            host = URLInfo(host).hostname();
+        hostnames.push_back(host);
+    }
+
+    std::vector<String> addresses;
+    {
+        ScopedGILRelease sr;
+        addresses = Resolver::resolve(hostnames, c_workers);
+    }
+
+    bp::dict py_addresses;
+    for (int i = 0; i < cnt; ++i) {
+        if (addresses[i].empty())
+            py_addresses[py_hosts[i]] = None;
+        else
+            py_addresses[py_hosts[i]] = StringConv::asPyUnicode(addresses[i]);
+    }
+    return py_addresses;
+}
+
+String canonical_path(const Pegasus::CIMObjectPath &path)
+{
+    // Key values are prefixed with their length, so the string is
+    // unambiguous.
+    std::vector<std::pair<String, String> > keys;
+    const Pegasus::Array<Pegasus::CIMKeyBinding> &peg_keys = path.getKeyBindings();
+    const Pegasus::Uint32 cnt = peg_keys.size();
+    for (Pegasus::Uint32 i = 0; i < cnt; ++i) {
+        keys.push_back(std::make_pair(
+            lower(peg_keys[i].getName().getString()),
+            String(peg_keys[i].getValue())));
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::stringstream ss;
+    ss << lower(path.getClassName().getString());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ss << (i ? ',' : '.') << keys[i].first << '='
+           << keys[i].second.size() << ':' << keys[i].second;
+    }
+    return ss.str();
+}
+
+String lower(const String &str)
+{
+    String result(str);
+    std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+    return result;
+}
+
 bool is_error(const bp::object &value)
 {
     int ivalue = Conv::as<int>(value, "value");
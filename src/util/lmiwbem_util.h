@@ -23,7 +23,9 @@
 #  define LMIWBEM_UTIL_H
 
 #  include <cassert>
+#  include <time.h>
 #  include "lmiwbem.h"
+#  include "util/lmiwbem_string.h"
 
 BOOST_PYTHON_BEGIN
 class object;
@@ -80,6 +82,24 @@ bool cim_issubclass(
     const bp::object &superclass,
     const bp::object &subclass);
 bool is_error(const bp::object &value);
+bp::object resolve_hosts(const bp::object &hosts, const bp::object &workers);
+
+// Returns a string identifying the object path within a namespace: class name
+// and key bindings sorted by their names; namespace and host are left out.
+String canonical_path(const Pegasus::CIMObjectPath &path);
+
+// Seconds elapsed since an unspecified point; not affected by changes of the
+// system time. Inline, so that the standalone benchmark can use it without
+// linking the rest of the module.
+inline double monotonic_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Returns a lower case copy of the string; used for case insensitive names.
+String lower(const String &str);
 
 #  if PY_MAJOR_VERSION < 3
 int compare(const bp::object &o1, const bp::object &o2);